@@ -28,12 +28,16 @@
 
 #include "talk/app/webrtc/peerconnectionfactoryproxy.h"
 #include "talk/app/webrtc/proxy.h"
+#include "webrtc/base/physicalsocketserver.h"
 
 using namespace v8;
 using namespace WebRTC;
 
 class BlockingThread : public rtc::Thread {
   public:
+    BlockingThread() { }
+    explicit BlockingThread(rtc::SocketServer *ss) : rtc::Thread(ss) { }
+
     virtual void Run() {
       LOG(LS_INFO) << __PRETTY_FUNCTION__;
       
@@ -88,7 +92,13 @@ class ThreadPool {
     }
     
   private:
-    ThreadPool() : _count(0), _worker(new BlockingThread()) {
+    // Workers own the network sockets of their PeerConnections, so they wait
+    // with epoll (where available) to keep wakeups cheap with many sockets.
+    ThreadPool() :
+      _count(0),
+      _socketServer(new rtc::PhysicalSocketServer(rtc::PhysicalSocketServer::WAIT_EPOLL)),
+      _worker(new BlockingThread(_socketServer))
+    {
       LOG(LS_INFO) << __PRETTY_FUNCTION__;
       
       _worker->Start();
@@ -99,10 +109,12 @@ class ThreadPool {
       
       _worker->Stop();
       delete _worker;
+      delete _socketServer;
     }
     
   protected:
     size_t _count;
+    rtc::PhysicalSocketServer* _socketServer;
     BlockingThread* _worker;
     static ThreadPool* _pool;
     static int _instances;
@@ -36,13 +36,44 @@
 #include "MediaStream.h"
 #include "MediaStreamTrack.h"
 
+#include "webrtc/base/logsinks.h"
+
 using namespace v8;
 
+// Log files written by setDebug(true, directory).
+static const char kLogFilePrefix[] = "webrtc_log";
+static const size_t kLogFileSize = 10 * 1024 * 1024;
+static const size_t kNumLogFiles = 5;
+
+static rtc::scoped_ptr<rtc::AsyncFileRotatingLogSink> log_sink;
+
+static void StopFileLogging() {
+  if (log_sink.get()) {
+    rtc::LogMessage::RemoveLogToStream(log_sink.get());
+    log_sink.reset();
+  }
+}
+
 void SetDebug(const Nan::FunctionCallbackInfo<Value> &info) {
   LOG(LS_INFO) << __PRETTY_FUNCTION__;
   
   if (info.Length() && !info[0].IsEmpty()) {
-    if (info[0]->IsTrue()) {
+    StopFileLogging();
+
+    if (info[0]->IsTrue() && info.Length() > 1 && info[1]->IsString()) {
+      // The files are written on a background thread, so that the threads
+      // that log never wait for the disk.
+      std::string directory(*Nan::Utf8String(info[1]));
+      log_sink.reset(new rtc::AsyncFileRotatingLogSink(directory, kLogFilePrefix, kLogFileSize, kNumLogFiles));
+
+      if (!log_sink->Init()) {
+        log_sink.reset();
+        return Nan::ThrowError("Unable to write log files to the directory");
+      }
+
+      rtc::LogMessage::LogToDebug(rtc::LS_NONE);
+      rtc::LogMessage::AddLogToStream(log_sink.get(), rtc::LS_VERBOSE);
+    } else if (info[0]->IsTrue()) {
       rtc::LogMessage::LogToDebug(rtc::LS_VERBOSE);
     } else {
       rtc::LogMessage::LogToDebug(rtc::LS_NONE);
@@ -96,6 +127,7 @@ void WebrtcModuleDispose(void *arg) {
   LOG(LS_INFO) << __PRETTY_FUNCTION__;
   
   WebRTC::Core::Dispose(); 
+  StopFileLogging();
 }
 
 void WebrtcModuleInit(Handle<Object> exports) {
@@ -109,8 +109,21 @@ void RemoteDescriptionObserver::OnFailure(const std::string &error) {
   Emit(kPeerConnectionSetRemoteDescriptionError, error);
 }
 
+enum {
+  kFlushCandidates = 1
+};
+
 PeerConnectionObserver::PeerConnectionObserver(EventEmitter *listener) : 
-  NotifyEmitter(listener) { }
+  NotifyEmitter(listener),
+  _batchWindow(0),
+  _batchThread(0),
+  _candidates(Json::arrayValue) { }
+
+void PeerConnectionObserver::SetCandidateBatchWindow(int window) {
+  LOG(LS_INFO) << __PRETTY_FUNCTION__;
+
+  _batchWindow = (window > 0) ? window : 0;
+}
 
 void PeerConnectionObserver::OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState state) {
   LOG(LS_INFO) << __PRETTY_FUNCTION__;
@@ -134,7 +147,11 @@ void PeerConnectionObserver::OnIceGatheringChange(webrtc::PeerConnectionInterfac
   Emit(kPeerConnectionIceGathering);
   
   if (state == webrtc::PeerConnectionInterface::kIceGatheringComplete) {
-    Emit(kPeerConnectionIceCandidate, std::string());
+    if (_batchWindow) {
+      FlushCandidates(true);
+    } else {
+      Emit(kPeerConnectionIceCandidate, std::string());
+    }
   }
 }
 
@@ -190,8 +207,49 @@ void PeerConnectionObserver::OnIceCandidate(const webrtc::IceCandidateInterface*
     msg["sdpMLineIndex"] = candidate->sdp_mline_index();
     msg["candidate"] = sdp;
     
-    Emit(kPeerConnectionIceCandidate, writer.write(msg));
+    if (!_batchWindow) {
+      Emit(kPeerConnectionIceCandidate, writer.write(msg));
+    } else {
+      if (_candidates.empty()) {
+        _batchThread = rtc::Thread::Current();
+        _batchThread->PostDelayed(_batchWindow, this, kFlushCandidates);
+      }
+
+      _candidates.append(msg);
+    }
+  }
+}
+
+void PeerConnectionObserver::OnMessage(rtc::Message *msg) {
+  LOG(LS_INFO) << __PRETTY_FUNCTION__;
+
+  if (msg->message_id == kFlushCandidates) {
+    FlushCandidates();
+  }
+}
+
+void PeerConnectionObserver::FlushCandidates(bool completed) {
+  LOG(LS_INFO) << __PRETTY_FUNCTION__;
+
+  Json::FastWriter writer;
+  Json::Value msg;
+
+  if (_batchThread) {
+    _batchThread->Clear(this, kFlushCandidates);
   }
+
+  if (_candidates.empty() && !completed) {
+    return;
+  }
+
+  msg["candidates"] = _candidates;
+
+  if (completed) {
+    msg["candidate"] = Json::Value();
+  }
+
+  _candidates = Json::Value(Json::arrayValue);
+  Emit(kPeerConnectionIceCandidates, writer.write(msg));
 }
 
 DataChannelObserver::DataChannelObserver(EventEmitter *listener) : 
@@ -63,11 +63,16 @@ namespace WebRTC {
   
   class PeerConnectionObserver : 
     public webrtc::PeerConnectionObserver, 
+    public rtc::MessageHandler,
     public rtc::RefCountInterface,
     public NotifyEmitter
   {
    public:
     PeerConnectionObserver(EventEmitter *listener = 0);
+
+    // Candidates gathered within |window| milliseconds are delivered as one
+    // kPeerConnectionIceCandidates event. Zero disables batching.
+    void SetCandidateBatchWindow(int window);
     
     void OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState state) final;
     void OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState state) final;
@@ -79,6 +84,16 @@ namespace WebRTC {
 
     void OnAddStream(webrtc::MediaStreamInterface* stream) final;
     void OnRemoveStream(webrtc::MediaStreamInterface* stream) final;
+
+    void OnMessage(rtc::Message *msg) final;
+
+   private:
+    void FlushCandidates(bool completed = false);
+
+   protected:
+    int _batchWindow;
+    rtc::Thread *_batchThread;
+    Json::Value _candidates;
   };
   
   class DataChannelObserver : 
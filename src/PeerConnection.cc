@@ -112,11 +112,41 @@ PeerConnection::PeerConnection(const Local<Object> &configuration,
               entry.password = *credential;
             }
 
-            _servers.push_back(entry);
+            _config.servers.push_back(entry);
           }
         }        
       }
     }
+
+    Local<Value> icelite_value = configuration->Get(Nan::New("iceLite").ToLocalChecked());
+
+    if (!icelite_value.IsEmpty() && icelite_value->IsBoolean()) {
+      _config.ice_lite = icelite_value->BooleanValue();
+    }
+
+    Local<Value> sndbuf_value = configuration->Get(Nan::New("sctpSendBufferSize").ToLocalChecked());
+
+    if (!sndbuf_value.IsEmpty() && sndbuf_value->IsNumber()) {
+      _config.sctp_send_buffer_size = sndbuf_value->Int32Value();
+    }
+
+    Local<Value> rcvwnd_value = configuration->Get(Nan::New("sctpReceiveWindow").ToLocalChecked());
+
+    if (!rcvwnd_value.IsEmpty() && rcvwnd_value->IsNumber()) {
+      _config.sctp_receive_window = rcvwnd_value->Int32Value();
+    }
+
+    Local<Value> fragment_value = configuration->Get(Nan::New("sctpFragmentLargeMessages").ToLocalChecked());
+
+    if (!fragment_value.IsEmpty() && fragment_value->IsBoolean()) {
+      _config.sctp_fragment_large_messages = fragment_value->BooleanValue();
+    }
+
+    Local<Value> resumption_value = configuration->Get(Nan::New("dtlsSessionResumption").ToLocalChecked());
+
+    if (!resumption_value.IsEmpty() && resumption_value->IsBoolean()) {
+      _config.enable_dtls_session_resumption = resumption_value->BooleanValue();
+    }
   }
 
   _constraints = MediaConstraints::New(constraints);
@@ -133,6 +163,15 @@ PeerConnection::PeerConnection(const Local<Object> &configuration,
   _local = new rtc::RefCountedObject<LocalDescriptionObserver>(this);
   _remote = new rtc::RefCountedObject<RemoteDescriptionObserver>(this);
   _peer = new rtc::RefCountedObject<PeerConnectionObserver>(this);
+
+  if (!configuration.IsEmpty()) {
+    Local<Value> window_value = configuration->Get(Nan::New("iceCandidateBatchWindow").ToLocalChecked());
+
+    if (!window_value.IsEmpty() && window_value->IsNumber()) {
+      _peer->SetCandidateBatchWindow(window_value->Int32Value());
+    }
+  }
+
   _factory = Core::CreateFactory();
 }
 
@@ -161,7 +200,7 @@ webrtc::PeerConnectionInterface *PeerConnection::GetSocket() {
   if (!_socket.get()) {
     if (_factory.get()) {
       EventEmitter::SetReference(true);
-      _socket = _factory->CreatePeerConnection(_servers, _constraints->ToConstraints(), NULL, NULL, _peer.get());
+      _socket = _factory->CreatePeerConnection(_config, _constraints->ToConstraints(), NULL, NULL, _peer.get());
     } else {
       Nan::ThrowError("Internal Factory Error");
     }
@@ -454,7 +493,7 @@ void PeerConnection::CreateDataChannel(const Nan::FunctionCallbackInfo<Value> &i
   }
   
   if (!info[1].IsEmpty() && info[1]->IsObject()) {
-    Local<Object> config_obj = Local<Object>::Cast(info[0]);
+    Local<Object> config_obj = Local<Object>::Cast(info[1]);
     
     Local<Value> reliable_value = config_obj->Get(Nan::New("reliable").ToLocalChecked());
     Local<Value> ordered_value = config_obj->Get(Nan::New("ordered").ToLocalChecked());
@@ -462,6 +501,8 @@ void PeerConnection::CreateDataChannel(const Nan::FunctionCallbackInfo<Value> &i
     Local<Value> maxRetransmits_value = config_obj->Get(Nan::New("maxRetransmits").ToLocalChecked());
     Local<Value> protocol_value = config_obj->Get(Nan::New("protocol").ToLocalChecked());
     Local<Value> id_value = config_obj->Get(Nan::New("id").ToLocalChecked());
+    Local<Value> scheduler_value = config_obj->Get(Nan::New("scheduler").ToLocalChecked());
+    Local<Value> priority_value = config_obj->Get(Nan::New("priority").ToLocalChecked());
 
     if (!reliable_value.IsEmpty()) {
       if (reliable_value->IsTrue()) {
@@ -498,6 +539,29 @@ void PeerConnection::CreateDataChannel(const Nan::FunctionCallbackInfo<Value> &i
       Local<Int32> id(id_value->ToInt32());
       config.id = id->Value();
     }
+
+    if (!scheduler_value.IsEmpty() && !scheduler_value->IsUndefined()) {
+      String::Utf8Value scheduler_utf8(scheduler_value->ToString());
+      std::string scheduler(*scheduler_utf8 ? *scheduler_utf8 : "");
+
+      if (scheduler == "first-come") {
+        config.scheduler = webrtc::DataChannelInit::kFirstCome;
+      } else if (scheduler == "round-robin") {
+        config.scheduler = webrtc::DataChannelInit::kRoundRobin;
+      } else if (scheduler == "priority") {
+        config.scheduler = webrtc::DataChannelInit::kStrictPriority;
+      } else {
+        return Nan::ThrowTypeError("scheduler must be 'first-come', 'round-robin' or 'priority'");
+      }
+    }
+
+    if (!priority_value.IsEmpty() && !priority_value->IsUndefined()) {
+      if (!priority_value->IsInt32() || priority_value->Int32Value() < 0 || priority_value->Int32Value() > 65535) {
+        return Nan::ThrowRangeError("priority must be an integer from 0 to 65535");
+      }
+
+      config.priority = priority_value->Int32Value();
+    }
   }
   
   if (socket) {
@@ -1058,6 +1122,14 @@ void PeerConnection::On(Event *event) {
       argv[0] = container;
       argc = 1;
       
+      break;
+    case kPeerConnectionIceCandidates:
+      callback = Nan::New<Function>(_onicecandidate);
+
+      data = event->Unwrap<std::string>();
+      argv[0] = JSON::Parse(Nan::New(data.c_str()).ToLocalChecked());
+      argc = 1;
+
       break;
     case kPeerConnectionSignalChange:
       callback = Nan::New<Function>(_onsignalingstatechange);
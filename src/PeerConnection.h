@@ -44,6 +44,7 @@ namespace WebRTC {
     kPeerConnectionSetRemoteDescription,
     kPeerConnectionSetRemoteDescriptionError,
     kPeerConnectionIceCandidate,
+    kPeerConnectionIceCandidates,
     kPeerConnectionSignalChange,
     kPeerConnectionIceChange,
     kPeerConnectionIceGathering,
@@ -145,7 +146,7 @@ namespace WebRTC {
     rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> _factory;
     
     rtc::scoped_refptr<MediaConstraints> _constraints;
-    webrtc::PeerConnectionInterface::IceServers _servers;
+    webrtc::PeerConnectionInterface::RTCConfiguration _config;
   };
 };
 
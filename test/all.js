@@ -1,2 +1,3 @@
 require('./multiconnect');
+require('./iceCandidateBatch');
 require('./bwtest').tape();
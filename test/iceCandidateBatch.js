@@ -0,0 +1,83 @@
+'use strict';
+
+var tape = require('tape');
+var wrtc = require('..');
+
+//wrtc.setDebug(true);
+
+var constraints = {
+    optional: [
+        {
+            RtpDataChannels: false,
+            DtlsSrtpKeyAgreement: true,
+        },
+    ],
+};
+
+// Starts gathering on a new peer and calls back with every onicecandidate
+// event once the end-of-candidates marker has arrived.
+function gather(configuration, callback) {
+    var peer = new wrtc.RTCPeerConnection(configuration, constraints);
+    var events = [];
+
+    peer.onicecandidate = function(event) {
+        events.push(event);
+
+        if (event.candidate === null) {
+            peer.close();
+            callback(null, events);
+        }
+    };
+
+    peer.createDataChannel('batch');
+    peer.createOffer(function(sdp) {
+        peer.setLocalDescription(sdp, function() {}, callback);
+    }, callback);
+}
+
+function countCandidates(events) {
+    return events.reduce(function(count, event) {
+        if (event.candidates) {
+            return count + event.candidates.length;
+        }
+
+        return count + (event.candidate ? 1 : 0);
+    }, 0);
+}
+
+tape('batch candidates within the window', function(t) {
+    t.plan(6);
+
+    gather({ iceServers: [] }, function(err, unbatched) {
+        t.error(err, 'unbatched gathering');
+
+        // The window outlasts gathering, so only end-of-candidates flushes.
+        gather({ iceServers: [], iceCandidateBatchWindow: 60000 }, function(err, batched) {
+            t.error(err, 'batched gathering');
+            t.equal(batched.length, 1, 'one onicecandidate event');
+            t.ok(batched[0].candidates.length > 1, 'several candidates in the batch');
+            t.equal(batched[0].candidate, null, 'batch carries end-of-candidates');
+            t.equal(countCandidates(batched), countCandidates(unbatched), 'no candidate lost');
+        });
+    });
+});
+
+tape('flush pending candidates at end-of-candidates', function(t) {
+    t.plan(5);
+
+    gather({ iceServers: [] }, function(err, unbatched) {
+        t.error(err, 'unbatched gathering');
+
+        // A short window lets batches go out while gathering is still running.
+        gather({ iceServers: [], iceCandidateBatchWindow: 1 }, function(err, batched) {
+            var last = batched[batched.length - 1];
+
+            t.error(err, 'batched gathering');
+            t.ok(batched.every(function(event) {
+                return Array.isArray(event.candidates);
+            }), 'every event is a batch');
+            t.equal(last.candidate, null, 'last batch carries end-of-candidates');
+            t.equal(countCandidates(batched), countCandidates(unbatched), 'no candidate lost');
+        });
+    });
+});
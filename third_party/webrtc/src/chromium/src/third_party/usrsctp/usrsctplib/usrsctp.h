@@ -519,6 +519,9 @@ struct sctp_event_subscribe {
 #define SCTP_DEFAULT_SNDINFO            0x00000021
 #define SCTP_DEFAULT_PRINFO             0x00000022
 #define SCTP_REMOTE_UDP_ENCAPS_PORT     0x00000024
+/* Pluggable Stream Scheduling Socket option */
+#define SCTP_PLUGGABLE_SS               0x00001203
+#define SCTP_SS_VALUE                   0x00001204
 
 #define SCTP_ENABLE_STREAM_RESET        0x00000900 /* struct sctp_assoc_value */
 
@@ -604,6 +607,13 @@ struct sctp_assoc_value {
 	uint32_t assoc_value;
 };
 
+/* Used for SCTP_SS_VALUE */
+struct sctp_stream_value {
+	sctp_assoc_t assoc_id;
+	uint16_t stream_id;
+	uint16_t stream_value;
+};
+
 /* To enable stream reset */
 #define SCTP_ENABLE_RESET_STREAM_REQ  0x00000001
 #define SCTP_ENABLE_RESET_ASSOC_REQ   0x00000002
@@ -43,6 +43,20 @@ enum {
   MSG_CHANNELREADY,
 };
 
+static cricket::DataStreamScheduler GetStreamScheduler(
+    DataChannelInit::Scheduler scheduler) {
+  switch (scheduler) {
+    case DataChannelInit::kFirstCome:
+      return cricket::DSS_FIRST_COME;
+    case DataChannelInit::kRoundRobin:
+      return cricket::DSS_ROUND_ROBIN;
+    case DataChannelInit::kStrictPriority:
+      return cricket::DSS_PRIORITY;
+    default:
+      return cricket::DSS_DEFAULT;
+  }
+}
+
 DataChannel::PacketQueue::PacketQueue() : byte_count_(0) {}
 
 DataChannel::PacketQueue::~PacketQueue() {
@@ -132,7 +146,8 @@ bool DataChannel::Init(const InternalDataChannelInit& config) {
   } else if (data_channel_type_ == cricket::DCT_SCTP) {
     if (config.id < -1 ||
         config.maxRetransmits < -1 ||
-        config.maxRetransmitTime < -1) {
+        config.maxRetransmitTime < -1 ||
+        config.priority < 0 || config.priority > 0xFFFF) {
       LOG(LS_ERROR) << "Failed to initialize the SCTP data channel due to "
                     << "invalid DataChannelInit.";
       return false;
@@ -508,6 +523,8 @@ bool DataChannel::SendDataMessage(const DataBuffer& buffer,
     send_params.max_rtx_count = config_.maxRetransmits;
     send_params.max_rtx_ms = config_.maxRetransmitTime;
     send_params.ssrc = config_.id;
+    send_params.scheduler = GetStreamScheduler(config_.scheduler);
+    send_params.priority = config_.priority;
   } else {
     send_params.ssrc = send_ssrc_;
   }
@@ -583,6 +600,8 @@ bool DataChannel::SendControlMessage(const rtc::Buffer& buffer) {
   // OPEN message.
   send_params.ordered = config_.ordered || is_open_message;
   send_params.type = cricket::DMT_CONTROL;
+  send_params.scheduler = GetStreamScheduler(config_.scheduler);
+  send_params.priority = config_.priority;
 
   cricket::SendDataResult send_result = cricket::SDR_SUCCESS;
   bool retval = provider_->SendData(send_params, buffer, &send_result);
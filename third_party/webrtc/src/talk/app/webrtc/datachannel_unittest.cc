@@ -339,6 +339,28 @@ TEST_F(SctpDataChannelTest, SendDataSsrc) {
   EXPECT_EQ(1U, provider_.last_send_data_params().ssrc);
 }
 
+// Tests that messages are sent with the scheduler and priority of the channel.
+TEST_F(SctpDataChannelTest, SendDataPriority) {
+  SetChannelReady();
+  webrtc::InternalDataChannelInit init;
+  init.id = 1;
+  init.scheduler = webrtc::DataChannelInit::kStrictPriority;
+  init.priority = 100;
+  rtc::scoped_refptr<DataChannel> dc = DataChannel::Create(
+      &provider_, cricket::DCT_SCTP, "test1", init);
+  EXPECT_EQ_WAIT(webrtc::DataChannelInterface::kOpen, dc->state(), 1000);
+  EXPECT_EQ(cricket::DSS_PRIORITY, provider_.last_send_data_params().scheduler);
+
+  ASSERT_TRUE(dc->Send(webrtc::DataBuffer("data")));
+  EXPECT_EQ(cricket::DSS_PRIORITY, provider_.last_send_data_params().scheduler);
+  EXPECT_EQ(100, provider_.last_send_data_params().priority);
+
+  init.id = 2;
+  init.priority = 0x10000;
+  EXPECT_TRUE(DataChannel::Create(
+      &provider_, cricket::DCT_SCTP, "test2", init) == NULL);
+}
+
 // Tests that the incoming messages with wrong ssrcs are rejected.
 TEST_F(SctpDataChannelTest, ReceiveDataWithInvalidSsrc) {
   webrtc_data_channel_->SetSctpSid(1);
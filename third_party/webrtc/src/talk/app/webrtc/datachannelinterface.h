@@ -42,13 +42,25 @@
 namespace webrtc {
 
 struct DataChannelInit {
+  // How the SCTP association, which all data channels of a PeerConnection
+  // share, picks the channel to send from next.
+  enum Scheduler {
+    kDefaultScheduler,   // Leaves the scheduler as it is, round-robin unless
+                         // another channel asked for something else.
+    kFirstCome,          // In the order the messages were sent.
+    kRoundRobin,         // One message from each channel in turn.
+    kStrictPriority,     // Highest |priority| first, round-robin among equals.
+  };
+
   DataChannelInit()
       : reliable(false),
         ordered(true),
         maxRetransmitTime(-1),
         maxRetransmits(-1),
         negotiated(false),
-        id(-1) {
+        id(-1),
+        scheduler(kDefaultScheduler),
+        priority(0) {
   }
 
   bool reliable;           // Deprecated.
@@ -64,6 +76,9 @@ struct DataChannelInit {
                            // form of an "open" message.
   int id;                  // The stream id, or SID, for SCTP data channels. -1
                            // if unset.
+  Scheduler scheduler;     // Set for the association once the channel sends.
+                           // The last channel to ask for a scheduler wins.
+  int priority;            // From 0 to 65535, under kStrictPriority.
 };
 
 struct DataBuffer {
@@ -183,6 +183,8 @@ bool PeerConnectionFactory::Initialize() {
       new cricket::ChannelManager(media_engine, worker_thread_));
 
   channel_manager_->SetVideoRtxEnabled(true);
+  channel_manager_->SetGcmCryptoSuitesEnabled(
+      options_.enable_gcm_crypto_suites);
   if (!channel_manager_->Init()) {
     return false;
   }
@@ -193,6 +195,14 @@ bool PeerConnectionFactory::Initialize() {
   return true;
 }
 
+void PeerConnectionFactory::SetOptions(const Options& options) {
+  options_ = options;
+  if (channel_manager_) {
+    channel_manager_->SetGcmCryptoSuitesEnabled(
+        options.enable_gcm_crypto_suites);
+  }
+}
+
 rtc::scoped_refptr<AudioSourceInterface>
 PeerConnectionFactory::CreateAudioSource(
     const MediaConstraintsInterface* constraints) {
@@ -45,9 +45,7 @@ typedef rtc::RefCountedObject<DtlsIdentityStoreImpl>
 
 class PeerConnectionFactory : public PeerConnectionFactoryInterface {
  public:
-  virtual void SetOptions(const Options& options) {
-    options_ = options;
-  }
+  virtual void SetOptions(const Options& options);
 
   // webrtc::PeerConnectionFactoryInterface override;
   rtc::scoped_refptr<PeerConnectionInterface>
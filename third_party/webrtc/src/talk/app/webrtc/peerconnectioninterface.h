@@ -251,6 +251,10 @@ class PeerConnectionInterface : public rtc::RefCountInterface {
     // A localhost candidate is signaled whenever a candidate with the any
     // address is allocated.
     bool enable_localhost_ice_candidate;
+    // Run as an ICE-lite implementation (RFC 5245, section 2.7). Only useful
+    // for end points with a public address: only host candidates are
+    // gathered and connectivity checks are answered but never sent.
+    bool ice_lite;
     BundlePolicy bundle_policy;
     RtcpMuxPolicy rtcp_mux_policy;
     TcpCandidatePolicy tcp_candidate_policy;
@@ -259,17 +263,34 @@ class PeerConnectionInterface : public rtc::RefCountInterface {
     int ice_connection_receiving_timeout;
     ContinualGatheringPolicy continual_gathering_policy;
     std::vector<rtc::scoped_refptr<rtc::RTCCertificate>> certificates;
+    // The SCTP send buffer size and receive window, in bytes, for data
+    // channels. kUndefined keeps the defaults.
+    int sctp_send_buffer_size;
+    int sctp_receive_window;
+    // Send large messages on ordered data channels as several SCTP messages
+    // with partial PPIDs, so they don't hold up other channels. Only for
+    // peers that reassemble them, as Firefox does.
+    bool sctp_fragment_large_messages;
+    // Resume the DTLS session of an earlier connection in this process with
+    // the same certificates, which saves the public key operations when a
+    // call is reestablished.
+    bool enable_dtls_session_resumption;
 
     RTCConfiguration()
         : type(kAll),
           enable_localhost_ice_candidate(false),
+          ice_lite(false),
           bundle_policy(kBundlePolicyBalanced),
           rtcp_mux_policy(kRtcpMuxPolicyNegotiate),
           tcp_candidate_policy(kTcpCandidatePolicyEnabled),
           audio_jitter_buffer_max_packets(kAudioJitterBufferMaxPackets),
           audio_jitter_buffer_fast_accelerate(false),
           ice_connection_receiving_timeout(kUndefined),
-          continual_gathering_policy(GATHER_ONCE) {}
+          continual_gathering_policy(GATHER_ONCE),
+          sctp_send_buffer_size(kUndefined),
+          sctp_receive_window(kUndefined),
+          sctp_fragment_large_messages(false),
+          enable_dtls_session_resumption(false) {}
   };
 
   struct RTCOfferAnswerOptions {
@@ -542,7 +563,8 @@ class PeerConnectionFactoryInterface : public rtc::RefCountInterface {
       disable_encryption(false),
       disable_sctp_data_channels(false),
       network_ignore_mask(rtc::kDefaultNetworkIgnoreMask),
-      ssl_max_version(rtc::SSL_PROTOCOL_DTLS_10) {
+      ssl_max_version(rtc::SSL_PROTOCOL_DTLS_10),
+      enable_gcm_crypto_suites(false) {
     }
     bool disable_encryption;
     bool disable_sctp_data_channels;
@@ -556,6 +578,11 @@ class PeerConnectionFactoryInterface : public rtc::RefCountInterface {
     // supported by both ends will be used for the connection, i.e. if one
     // party supports DTLS 1.0 and the other DTLS 1.2, DTLS 1.0 will be used.
     rtc::SSLProtocolVersion ssl_max_version;
+
+    // Offers the AES-GCM SRTP crypto suites (RFC 7714) when negotiating
+    // DTLS-SRTP, in preference to AES-CM with HMAC-SHA1. Applies to channels
+    // created after the options are set.
+    bool enable_gcm_crypto_suites;
   };
 
   virtual void SetOptions(const Options& options) = 0;
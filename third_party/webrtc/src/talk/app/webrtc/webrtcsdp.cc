@@ -818,6 +818,15 @@ std::string SdpSerialize(const JsepSessionDescription& jdesc) {
   // Time Description.
   AddLine(kTimeDescription, &message);
 
+  // ICE-lite is a session level attribute, but it is stored with every
+  // transport description.
+  const cricket::TransportInfos& transport_infos = desc->transport_infos();
+  if (!transport_infos.empty() &&
+      transport_infos[0].description.ice_mode == cricket::ICEMODE_LITE) {
+    InitAttrLine(kAttributeIceLite, &os);
+    AddLine(os.str(), &message);
+  }
+
   // Group
   if (desc->HasGroup(cricket::GROUP_TYPE_BUNDLE)) {
     std::string group_line = kAttrGroup;
@@ -2559,6 +2559,21 @@ TEST_F(WebRtcSdpTest, DeserializeSdpWithIceLite) {
   EXPECT_EQ(cricket::ICEMODE_LITE, vtinfo->description.ice_mode);
 }
 
+TEST_F(WebRtcSdpTest, SerializeSdpWithIceLite) {
+  cricket::TransportInfos& transport_infos = desc_.transport_infos();
+  for (size_t i = 0; i < transport_infos.size(); ++i) {
+    transport_infos[i].description.ice_mode = cricket::ICEMODE_LITE;
+  }
+
+  ASSERT_TRUE(jdesc_.Initialize(desc_.Copy(),
+                                jdesc_.session_id(),
+                                jdesc_.session_version()));
+  std::string message = webrtc::SdpSerialize(jdesc_);
+  std::string sdp_with_icelite = kSdpFullString;
+  InjectAfter(kSessionTime, "a=ice-lite\r\n", &sdp_with_icelite);
+  EXPECT_EQ(sdp_with_icelite, message);
+}
+
 // Verifies that the candidates in the input SDP are parsed and serialized
 // correctly in the output SDP.
 TEST_F(WebRtcSdpTest, RoundTripSdpWithSctpDataChannelsWithCandidates) {
@@ -598,6 +598,8 @@ bool WebRtcSession::Initialize(
   bundle_policy_ = rtc_configuration.bundle_policy;
   rtcp_mux_policy_ = rtc_configuration.rtcp_mux_policy;
   transport_controller()->SetSslMaxProtocolVersion(options.ssl_max_version);
+  transport_controller()->SetDtlsSessionResumption(
+      rtc_configuration.enable_dtls_session_resumption);
 
   // Obtain a certificate from RTCConfiguration if any were provided (optional).
   rtc::scoped_refptr<rtc::RTCCertificate> certificate;
@@ -645,6 +647,10 @@ bool WebRtcSession::Initialize(
   if (data_channel_type_ != cricket::DCT_NONE) {
     mediastream_signaling_->SetDataChannelFactory(this);
   }
+  data_options_.sctp_send_buffer_size = rtc_configuration.sctp_send_buffer_size;
+  data_options_.sctp_receive_window = rtc_configuration.sctp_receive_window;
+  data_options_.sctp_fragment_large_messages =
+      rtc_configuration.sctp_fragment_large_messages;
 
   // Find DSCP constraint.
   if (FindConstraint(
@@ -766,6 +772,9 @@ bool WebRtcSession::Initialize(
   if (options.disable_encryption) {
     webrtc_session_desc_factory_->SetSdesPolicy(cricket::SEC_DISABLED);
   }
+  if (rtc_configuration.ice_lite) {
+    webrtc_session_desc_factory_->SetIceMode(cricket::ICEMODE_LITE);
+  }
   port_allocator()->set_candidate_filter(
       ConvertIceTransportTypeToCandidateFilter(rtc_configuration.type));
 
@@ -1840,7 +1849,8 @@ bool WebRtcSession::CreateVideoChannel(const cricket::ContentInfo* content) {
 bool WebRtcSession::CreateDataChannel(const cricket::ContentInfo* content) {
   bool sctp = (data_channel_type_ == cricket::DCT_SCTP);
   data_channel_.reset(channel_manager_->CreateDataChannel(
-      transport_controller(), content->name, !sctp, data_channel_type_));
+      transport_controller(), content->name, !sctp, data_channel_type_,
+      data_options_));
   if (!data_channel_) {
     return false;
   }
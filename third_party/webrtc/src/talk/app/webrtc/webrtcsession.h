@@ -419,6 +419,7 @@ class WebRtcSession : public cricket::BaseSession,
   // Member variables for caching global options.
   cricket::AudioOptions audio_options_;
   cricket::VideoOptions video_options_;
+  cricket::DataOptions data_options_;
   MetricsObserverInterface* metrics_observer_;
 
   // Declares the bundle policy for the WebRTCSession.
@@ -370,6 +370,10 @@ cricket::SecurePolicy WebRtcSessionDescriptionFactory::SdesPolicy() const {
   return session_desc_factory_.secure();
 }
 
+void WebRtcSessionDescriptionFactory::SetIceMode(cricket::IceMode ice_mode) {
+  transport_desc_factory_.set_ice_mode(ice_mode);
+}
+
 void WebRtcSessionDescriptionFactory::OnMessage(rtc::Message* msg) {
   switch (msg->message_id) {
     case MSG_CREATE_SESSIONDESCRIPTION_SUCCESS: {
@@ -134,6 +134,8 @@ class WebRtcSessionDescriptionFactory : public rtc::MessageHandler,
   void SetSdesPolicy(cricket::SecurePolicy secure_policy);
   cricket::SecurePolicy SdesPolicy() const;
 
+  void SetIceMode(cricket::IceMode ice_mode);
+
   sigslot::signal1<const rtc::scoped_refptr<rtc::RTCCertificate>&>
       SignalCertificateReady;
 
@@ -35,6 +35,7 @@
 #include "talk/media/base/rtputils.h"
 #include "webrtc/base/buffer.h"
 #include "webrtc/base/byteorder.h"
+#include "webrtc/base/copyonwritebuffer.h"
 #include "webrtc/base/criticalsection.h"
 #include "webrtc/base/dscp.h"
 #include "webrtc/base/messagehandler.h"
@@ -106,7 +107,8 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
     if (index >= NumRtpPackets()) {
       return NULL;
     }
-    return new rtc::Buffer(rtp_packets_[index]);
+    return new rtc::Buffer(rtp_packets_[index].cdata(),
+                           rtp_packets_[index].size());
   }
 
   int NumRtcpPackets() {
@@ -120,7 +122,8 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
     if (index >= NumRtcpPackets()) {
       return NULL;
     }
-    return new rtc::Buffer(rtcp_packets_[index]);
+    return new rtc::Buffer(rtcp_packets_[index].cdata(),
+                           rtcp_packets_[index].size());
   }
 
   int sendbuf_size() const { return sendbuf_size_; }
@@ -128,19 +131,19 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
   rtc::DiffServCodePoint dscp() const { return dscp_; }
 
  protected:
-  virtual bool SendPacket(rtc::Buffer* packet,
+  virtual bool SendPacket(rtc::CopyOnWriteBuffer* packet,
                           rtc::DiffServCodePoint dscp) {
     rtc::CritScope cs(&crit_);
 
     uint32 cur_ssrc = 0;
-    if (!GetRtpSsrc(packet->data(), packet->size(), &cur_ssrc)) {
+    if (!GetRtpSsrc(packet->cdata(), packet->size(), &cur_ssrc)) {
       return false;
     }
     sent_ssrcs_[cur_ssrc]++;
 
     rtp_packets_.push_back(*packet);
     if (conf_) {
-      rtc::Buffer buffer_copy(*packet);
+      rtc::CopyOnWriteBuffer buffer_copy(*packet);
       for (size_t i = 0; i < conf_sent_ssrcs_.size(); ++i) {
         if (!SetRtpSsrc(buffer_copy.data(), buffer_copy.size(),
                         conf_sent_ssrcs_[i])) {
@@ -154,7 +157,7 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
     return true;
   }
 
-  virtual bool SendRtcp(rtc::Buffer* packet,
+  virtual bool SendRtcp(rtc::CopyOnWriteBuffer* packet,
                         rtc::DiffServCodePoint dscp) {
     rtc::CritScope cs(&crit_);
     rtcp_packets_.push_back(*packet);
@@ -177,13 +180,13 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
     return 0;
   }
 
-  void PostMessage(int id, const rtc::Buffer& packet) {
+  void PostMessage(int id, const rtc::CopyOnWriteBuffer& packet) {
     thread_->Post(this, id, rtc::WrapMessageData(packet));
   }
 
   virtual void OnMessage(rtc::Message* msg) {
-    rtc::TypedMessageData<rtc::Buffer>* msg_data =
-        static_cast<rtc::TypedMessageData<rtc::Buffer>*>(
+    rtc::TypedMessageData<rtc::CopyOnWriteBuffer>* msg_data =
+        static_cast<rtc::TypedMessageData<rtc::CopyOnWriteBuffer>*>(
             msg->pdata);
     if (dest_) {
       if (msg->message_id == ST_RTP) {
@@ -207,7 +210,7 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
     }
     uint32 cur_ssrc = 0;
     for (size_t i = 0; i < rtp_packets_.size(); ++i) {
-      if (!GetRtpSsrc(rtp_packets_[i].data(), rtp_packets_[i].size(),
+      if (!GetRtpSsrc(rtp_packets_[i].cdata(), rtp_packets_[i].size(),
                       &cur_ssrc)) {
         return;
       }
@@ -233,8 +236,8 @@ class FakeNetworkInterface : public MediaChannel::NetworkInterface,
   // Map to track packet-number that needs to be dropped per ssrc.
   std::map<uint32, std::set<uint32> > drop_map_;
   rtc::CriticalSection crit_;
-  std::vector<rtc::Buffer> rtp_packets_;
-  std::vector<rtc::Buffer> rtcp_packets_;
+  std::vector<rtc::CopyOnWriteBuffer> rtp_packets_;
+  std::vector<rtc::CopyOnWriteBuffer> rtcp_packets_;
   int sendbuf_size_;
   int recvbuf_size_;
   rtc::DiffServCodePoint dscp_;
@@ -36,6 +36,7 @@
 #include "talk/media/base/streamparams.h"
 #include "webrtc/base/basictypes.h"
 #include "webrtc/base/buffer.h"
+#include "webrtc/base/copyonwritebuffer.h"
 #include "webrtc/base/dscp.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/sigslot.h"
@@ -524,10 +525,10 @@ class MediaChannel : public sigslot::has_slots<> {
    public:
     enum SocketType { ST_RTP, ST_RTCP };
     virtual bool SendPacket(
-        rtc::Buffer* packet,
+        rtc::CopyOnWriteBuffer* packet,
         rtc::DiffServCodePoint dscp = rtc::DSCP_NO_CHANGE) = 0;
     virtual bool SendRtcp(
-        rtc::Buffer* packet,
+        rtc::CopyOnWriteBuffer* packet,
         rtc::DiffServCodePoint dscp = rtc::DSCP_NO_CHANGE) = 0;
     virtual int SetOption(SocketType type, rtc::Socket::Option opt,
                           int option) = 0;
@@ -544,10 +545,10 @@ class MediaChannel : public sigslot::has_slots<> {
   }
 
   // Called when a RTP packet is received.
-  virtual void OnPacketReceived(rtc::Buffer* packet,
+  virtual void OnPacketReceived(rtc::CopyOnWriteBuffer* packet,
                                 const rtc::PacketTime& packet_time) = 0;
   // Called when a RTCP packet is received.
-  virtual void OnRtcpReceived(rtc::Buffer* packet,
+  virtual void OnRtcpReceived(rtc::CopyOnWriteBuffer* packet,
                               const rtc::PacketTime& packet_time) = 0;
   // Called when the socket's ability to send has changed.
   virtual void OnReadyToSend(bool ready) = 0;
@@ -572,11 +573,11 @@ class MediaChannel : public sigslot::has_slots<> {
   }
 
   // Base method to send packet using NetworkInterface.
-  bool SendPacket(rtc::Buffer* packet) {
+  bool SendPacket(rtc::CopyOnWriteBuffer* packet) {
     return DoSendPacket(packet, false);
   }
 
-  bool SendRtcp(rtc::Buffer* packet) {
+  bool SendRtcp(rtc::CopyOnWriteBuffer* packet) {
     return DoSendPacket(packet, true);
   }
 
@@ -606,7 +607,7 @@ class MediaChannel : public sigslot::has_slots<> {
   }
 
  private:
-  bool DoSendPacket(rtc::Buffer* packet, bool rtcp) {
+  bool DoSendPacket(rtc::CopyOnWriteBuffer* packet, bool rtcp) {
     rtc::CritScope cs(&network_interface_crit_);
     if (!network_interface_)
       return false;
@@ -1185,6 +1186,15 @@ struct ReceiveDataParams {
   }
 };
 
+// How SCTP picks the stream to send from next, among the streams with queued
+// messages in an association.
+enum DataStreamScheduler {
+  DSS_DEFAULT = 0,     // Leaves the association's scheduler as it is.
+  DSS_FIRST_COME,      // In the order the messages were sent.
+  DSS_ROUND_ROBIN,     // One message from each stream in turn.
+  DSS_PRIORITY,        // Highest priority first, round-robin among equals.
+};
+
 struct SendDataParams {
   // The in-packet stream indentifier.
   // For SCTP, this is really SID, not SSRC.
@@ -1207,6 +1217,13 @@ struct SendDataParams {
   // is supported, not both at the same time.
   int max_rtx_ms;
 
+  // For SCTP, the scheduler of the whole association. Any message asking for
+  // a scheduler other than the current one changes it.
+  DataStreamScheduler scheduler;
+  // For SCTP, the priority of the stream, from 0 to 65535, under
+  // DSS_PRIORITY. Higher priority streams are sent first.
+  int priority;
+
   SendDataParams() :
       ssrc(0),
       type(DMT_TEXT),
@@ -1214,16 +1231,40 @@ struct SendDataParams {
       ordered(false),
       reliable(false),
       max_rtx_count(0),
-      max_rtx_ms(0) {
+      max_rtx_ms(0),
+      scheduler(DSS_DEFAULT),
+      priority(0) {
   }
 };
 
 enum SendDataResult { SDR_SUCCESS, SDR_ERROR, SDR_BLOCK };
 
 struct DataOptions {
+  DataOptions()
+      : sctp_send_buffer_size(-1),
+        sctp_receive_window(-1),
+        sctp_fragment_large_messages(false) {}
+
   std::string ToString() {
-    return "{}";
+    std::ostringstream ost;
+    ost << "DataOptions {";
+    ost << "sctp_send_buffer_size: " << sctp_send_buffer_size << ", ";
+    ost << "sctp_receive_window: " << sctp_receive_window << ", ";
+    ost << "sctp_fragment_large_messages: "
+        << (sctp_fragment_large_messages ? "true" : "false");
+    ost << "}";
+    return ost.str();
   }
+
+  // The size of the SCTP send buffer, which bounds the data queued in the
+  // association, and of the receive buffer, which is the window advertised
+  // to the peer. Negative keeps the defaults.
+  int sctp_send_buffer_size;
+  int sctp_receive_window;
+  // Send large ordered messages as several SCTP messages with partial PPIDs,
+  // so that messages on other streams can go out in between. Only for peers
+  // that reassemble them, as Firefox does.
+  bool sctp_fragment_large_messages;
 };
 
 struct DataSendParameters : RtpSendParameters<DataCodec, DataOptions> {
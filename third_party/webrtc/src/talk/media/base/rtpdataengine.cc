@@ -223,9 +223,9 @@ bool RtpDataMediaChannel::RemoveRecvStream(uint32 ssrc) {
 }
 
 void RtpDataMediaChannel::OnPacketReceived(
-    rtc::Buffer* packet, const rtc::PacketTime& packet_time) {
+    rtc::CopyOnWriteBuffer* packet, const rtc::PacketTime& packet_time) {
   RtpHeader header;
-  if (!GetRtpHeader(packet->data(), packet->size(), &header)) {
+  if (!GetRtpHeader(packet->cdata(), packet->size(), &header)) {
     // Don't want to log for every corrupt packet.
     // LOG(LS_WARNING) << "Could not read rtp header from packet of length "
     //                 << packet->length() << ".";
@@ -233,7 +233,7 @@ void RtpDataMediaChannel::OnPacketReceived(
   }
 
   size_t header_length;
-  if (!GetRtpHeaderLen(packet->data(), packet->size(), &header_length)) {
+  if (!GetRtpHeaderLen(packet->cdata(), packet->size(), &header_length)) {
     // Don't want to log for every corrupt packet.
     // LOG(LS_WARNING) << "Could not read rtp header"
     //                 << length from packet of length "
@@ -241,7 +241,7 @@ void RtpDataMediaChannel::OnPacketReceived(
     return;
   }
   const char* data =
-      packet->data<char>() + header_length + sizeof(kReservedSpace);
+      packet->cdata<char>() + header_length + sizeof(kReservedSpace);
   size_t data_len = packet->size() - header_length - sizeof(kReservedSpace);
 
   if (!receiving_) {
@@ -347,12 +347,12 @@ bool RtpDataMediaChannel::SendData(
   rtp_clock_by_send_ssrc_[header.ssrc]->Tick(
       now, &header.seq_num, &header.timestamp);
 
-  rtc::Buffer packet(kMinRtpPacketLen, packet_len);
+  rtc::CopyOnWriteBuffer packet(kMinRtpPacketLen, packet_len);
   if (!SetRtpHeader(packet.data(), packet.size(), header)) {
     return false;
   }
   packet.AppendData(kReservedSpace);
-  packet.AppendData(payload);
+  packet.AppendData(payload.data(), payload.size());
 
   LOG(LS_VERBOSE) << "Sent RTP data packet: "
                   << " stream=" << found_stream->id << " ssrc=" << header.ssrc
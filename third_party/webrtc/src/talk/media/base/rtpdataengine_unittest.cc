@@ -427,7 +427,7 @@ TEST_F(RtpDataMediaChannelTest, ReceiveData) {
     0x00, 0x00, 0x00, 0x00,
     'a', 'b', 'c', 'd', 'e'
   };
-  rtc::Buffer packet(data, sizeof(data));
+  rtc::CopyOnWriteBuffer packet(data, sizeof(data));
 
   rtc::scoped_ptr<cricket::RtpDataMediaChannel> dmc(CreateChannel());
 
@@ -467,7 +467,7 @@ TEST_F(RtpDataMediaChannelTest, InvalidRtpPackets) {
   unsigned char data[] = {
     0x80, 0x65, 0x00, 0x02
   };
-  rtc::Buffer packet(data, sizeof(data));
+  rtc::CopyOnWriteBuffer packet(data, sizeof(data));
 
   rtc::scoped_ptr<cricket::RtpDataMediaChannel> dmc(CreateChannel());
 
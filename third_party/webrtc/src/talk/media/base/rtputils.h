@@ -34,6 +34,9 @@ namespace cricket {
 
 const size_t kMinRtpPacketLen = 12;
 const size_t kMaxRtpPacketLen = 2048;
+// Space media engines reserve in front of outgoing packets, so that the
+// transport can prepend its framing, e.g. a TURN ChannelData header, in place.
+const size_t kRtpPacketHeadroom = 16;
 const size_t kMinRtcpPacketLen = 4;
 
 struct RtpHeader {
@@ -29,6 +29,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
@@ -37,6 +38,7 @@
 #include "talk/media/base/streamparams.h"
 #include "usrsctplib/usrsctp.h"
 #include "webrtc/base/buffer.h"
+#include "webrtc/base/copyonwritebuffer.h"
 #include "webrtc/base/helpers.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/safe_conversions.h"
@@ -102,8 +104,6 @@ std::string ListArray(const uint16* array, int num_elems) {
 }  // namespace
 
 namespace cricket {
-typedef rtc::ScopedMessageData<SctpInboundPacket> InboundPacketMessage;
-typedef rtc::ScopedMessageData<rtc::Buffer> OutboundPacketMessage;
 
 // The biggest SCTP packet.  Starting from a 'safe' wire MTU value of 1280,
 // take off 80 bytes for DTLS/TURN/TCP/IP overhead.
@@ -111,17 +111,45 @@ static const size_t kSctpMtu = 1200;
 
 // The size of the SCTP association send buffer.  256kB, the usrsctp default.
 static const int kSendBufferSize = 262144;
+
+// Messages larger than this are handed to usrsctp in parts of this size, so
+// they aren't limited by the send buffer size. By default the parts make up
+// one SCTP message, ended by SCTP_EOR. With DataOptions::
+// sctp_fragment_large_messages, ordered text and binary messages are instead
+// sent as several SCTP messages, all but the last with the partial PPID of
+// their type, as Firefox does. That lets messages on other streams go out
+// between the fragments, but only peers that reassemble partial PPIDs see one
+// message. Until the last part of an SCTP message is handed over, usrsctp
+// refuses messages on other streams, so a large message that isn't
+// fragmented blocks all streams until it's been handed over whole.
+static const size_t kMaxSctpFragmentSize = 16384;
+// Larger reassembled messages are dropped.
+static const size_t kMaxReassembledMessageSize = 16 * 1024 * 1024;
+
 enum {
   MSG_SCTPINBOUNDPACKET = 1,   // MessageData is SctpInboundPacket
-  MSG_SCTPOUTBOUNDPACKET = 2,  // MessageData is rtc:Buffer
+  MSG_SCTPOUTBOUNDPACKET = 2,  // MessageData is SctpOutboundPacket
 };
 
-struct SctpInboundPacket {
+// The number of packets in flight to or from the worker thread whose message
+// data, including the buffer, is kept for reuse. Received messages can be
+// large; buffers that grew beyond kMaxPooledBufferSize are not kept.
+static const size_t kPacketPoolSize = 32;
+static const size_t kMaxPooledBufferSize = 65536;
+
+struct SctpInboundPacket : public rtc::MessageData {
   rtc::Buffer buffer;
   ReceiveDataParams params;
   // The |flags| parameter is used by SCTP to distinguish notification packets
   // from other types of packets.
   int flags;
+  // True if the rest of the message follows in the next packets of the
+  // stream.
+  bool partial;
+};
+
+struct SctpOutboundPacket : public rtc::MessageData {
+  rtc::CopyOnWriteBuffer buffer;
 };
 
 // Helper for logging SCTP messages.
@@ -150,6 +178,65 @@ static SctpDataMediaChannel::PayloadProtocolIdentifier GetPpid(
   };
 }
 
+// Get the PPID to use for the other fragments of this type.
+static SctpDataMediaChannel::PayloadProtocolIdentifier GetPartialPpid(
+    cricket::DataMessageType type) {
+  switch (type) {
+  case cricket::DMT_BINARY:
+    return SctpDataMediaChannel::PPID_BINARY_PARTIAL;
+  case cricket::DMT_TEXT:
+    return SctpDataMediaChannel::PPID_TEXT_PARTIAL;
+  default:
+    return GetPpid(type);
+  };
+}
+
+// Fills in the usrsctp send info for a message, or for a part of one, sent
+// with |params|. |eor| marks the end of the SCTP message.
+static sctp_sendv_spa GetSendInfo(
+    const SendDataParams& params,
+    SctpDataMediaChannel::PayloadProtocolIdentifier ppid,
+    bool eor) {
+  struct sctp_sendv_spa spa = {0};
+  spa.sendv_flags |= SCTP_SEND_SNDINFO_VALID;
+  spa.sendv_sndinfo.snd_sid = params.ssrc;
+  spa.sendv_sndinfo.snd_ppid = rtc::HostToNetwork32(ppid);
+  if (eor) {
+    spa.sendv_sndinfo.snd_flags |= SCTP_EOR;
+  }
+
+  // Ordered implies reliable.
+  if (!params.ordered) {
+    spa.sendv_sndinfo.snd_flags |= SCTP_UNORDERED;
+    if (params.max_rtx_count >= 0 || params.max_rtx_ms == 0) {
+      spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
+      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_RTX;
+      spa.sendv_prinfo.pr_value = params.max_rtx_count;
+    } else {
+      spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
+      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_TTL;
+      spa.sendv_prinfo.pr_value = params.max_rtx_ms;
+    }
+  }
+  return spa;
+}
+
+// Get the usrsctp stream scheduling module for a scheduler.
+static uint32_t GetStreamSchedulingModule(
+    cricket::DataStreamScheduler scheduler) {
+  switch (scheduler) {
+  default:
+  case cricket::DSS_DEFAULT:
+    return SCTP_SS_DEFAULT;
+  case cricket::DSS_FIRST_COME:
+    return SCTP_SS_FIRST_COME;
+  case cricket::DSS_ROUND_ROBIN:
+    return SCTP_SS_ROUND_ROBIN;
+  case cricket::DSS_PRIORITY:
+    return SCTP_SS_PRIORITY;
+  };
+}
+
 static bool GetDataMediaType(
     SctpDataMediaChannel::PayloadProtocolIdentifier ppid,
     cricket::DataMessageType *dest) {
@@ -179,11 +266,12 @@ static bool GetDataMediaType(
 }
 
 // Log the packet in text2pcap format, if log level is at LS_VERBOSE.
-static void VerboseLogPacket(void *data, size_t length, int direction) {
+static void VerboseLogPacket(const void *data, size_t length, int direction) {
   if (LOG_CHECK_LEVEL(LS_VERBOSE) && length > 0) {
     char *dump_buf;
+    // usrsctp_dumppacket() only reads the packet.
     if ((dump_buf = usrsctp_dumppacket(
-             data, length, direction)) != NULL) {
+             const_cast<void*>(data), length, direction)) != NULL) {
       LOG(LS_VERBOSE) << dump_buf;
       usrsctp_freedumpbuffer(dump_buf);
     }
@@ -201,10 +289,11 @@ static int OnSctpOutboundPacket(void* addr, void* data, size_t length,
                   << "; set_df: " << std::hex << static_cast<int>(set_df);
 
   VerboseLogPacket(addr, length, SCTP_DUMP_OUTBOUND);
-  // Note: We have to copy the data; the caller will delete it.
-  auto* msg = new OutboundPacketMessage(
-      new rtc::Buffer(reinterpret_cast<uint8_t*>(data), length));
-  channel->worker_thread()->Post(channel, MSG_SCTPOUTBOUNDPACKET, msg);
+  // Note: We have to copy the data; the caller will delete it. The buffer of
+  // a recycled packet is reused unless the network still holds on to it.
+  SctpOutboundPacket* packet = channel->outbound_packets()->Get();
+  packet->buffer.SetData(reinterpret_cast<uint8_t*>(data), length);
+  channel->worker_thread()->Post(channel, MSG_SCTPOUTBOUNDPACKET, packet);
   return 0;
 }
 
@@ -229,16 +318,18 @@ static int OnSctpInboundPacket(struct socket* sock, union sctp_sockstore addr,
     LOG(LS_ERROR) << "Received an unknown PPID " << ppid
                   << " on an SCTP packet.  Dropping.";
   } else {
-    SctpInboundPacket* packet = new SctpInboundPacket;
+    SctpInboundPacket* packet = channel->inbound_packets()->Get();
     packet->buffer.SetData(reinterpret_cast<uint8_t*>(data), length);
     packet->params.ssrc = rcv.rcv_sid;
     packet->params.seq_num = rcv.rcv_ssn;
     packet->params.timestamp = rcv.rcv_tsn;
     packet->params.type = type;
     packet->flags = flags;
-    // The ownership of |packet| transfers to |msg|.
-    InboundPacketMessage* msg = new InboundPacketMessage(packet);
-    channel->worker_thread()->Post(channel, MSG_SCTPINBOUNDPACKET, msg);
+    // usrsctp leaves out MSG_EOR when it delivers part of a message early.
+    packet->partial = !(flags & MSG_EOR) ||
+                      ppid == SctpDataMediaChannel::PPID_BINARY_PARTIAL ||
+                      ppid == SctpDataMediaChannel::PPID_TEXT_PARTIAL;
+    channel->worker_thread()->Post(channel, MSG_SCTPINBOUNDPACKET, packet);
   }
   free(data);
   return 1;
@@ -369,7 +460,13 @@ SctpDataMediaChannel::SctpDataMediaChannel(rtc::Thread* thread)
       sock_(NULL),
       sending_(false),
       receiving_(false),
-      debug_name_("SctpDataMediaChannel") {
+      send_buffer_size_(0),
+      receive_window_(0),
+      fragment_large_messages_(false),
+      scheduler_(DSS_DEFAULT),
+      debug_name_("SctpDataMediaChannel"),
+      inbound_packets_(kPacketPoolSize),
+      outbound_packets_(kPacketPoolSize) {
 }
 
 SctpDataMediaChannel::~SctpDataMediaChannel() {
@@ -378,7 +475,14 @@ SctpDataMediaChannel::~SctpDataMediaChannel() {
 
 void SctpDataMediaChannel::OnSendThresholdCallback() {
   RTC_DCHECK(rtc::Thread::Current() == worker_thread_);
+  // New messages go first, pending parts fill up what's left of the send
+  // buffer, so that a large message doesn't hold up the small ones. The rest
+  // of a message that isn't fragmented has to go first, since usrsctp takes
+  // nothing else until it has all of it.
+  if (HasUnendedMessage())
+    SendPendingMessages();
   SignalReadyToSend(true);
+  SendPendingMessages();
 }
 
 sockaddr_conn SctpDataMediaChannel::GetSctpSockAddr(int port) {
@@ -403,12 +507,13 @@ bool SctpDataMediaChannel::OpenSctpSocket() {
   // If kSendBufferSize isn't reflective of reality, we log an error, but we
   // still have to do something reasonable here.  Look up what the buffer's
   // real size is and set our threshold to something reasonable.
-  const static int kSendThreshold = usrsctp_sysctl_get_sctp_sendspace() / 2;
+  const int send_buffer_size = send_buffer_size_ > 0 ?
+      send_buffer_size_ : usrsctp_sysctl_get_sctp_sendspace();
 
   sock_ = usrsctp_socket(AF_CONN, SOCK_STREAM, IPPROTO_SCTP,
                          cricket::OnSctpInboundPacket,
                          &SctpDataEngine::SendThresholdCallback,
-                         kSendThreshold, this);
+                         send_buffer_size / 2, this);
   if (!sock_) {
     LOG_ERRNO(LS_ERROR) << debug_name_ << "Failed to create SCTP socket.";
     return false;
@@ -433,6 +538,30 @@ bool SctpDataMediaChannel::OpenSctpSocket() {
     return false;
   }
 
+  // The receive buffer has to be set before connecting, the INIT carries the
+  // window.
+  if (send_buffer_size_ > 0 &&
+      usrsctp_setsockopt(sock_, SOL_SOCKET, SO_SNDBUF, &send_buffer_size_,
+                         sizeof(send_buffer_size_))) {
+    LOG_ERRNO(LS_ERROR) << debug_name_ << "Failed to set SO_SNDBUF.";
+    return false;
+  }
+  if (receive_window_ > 0 &&
+      usrsctp_setsockopt(sock_, SOL_SOCKET, SO_RCVBUF, &receive_window_,
+                         sizeof(receive_window_))) {
+    LOG_ERRNO(LS_ERROR) << debug_name_ << "Failed to set SO_RCVBUF.";
+    return false;
+  }
+
+  // Large messages are handed to usrsctp in parts; only the part with
+  // SCTP_EOR ends a message.
+  int explicit_eor = 1;
+  if (usrsctp_setsockopt(sock_, IPPROTO_SCTP, SCTP_EXPLICIT_EOR, &explicit_eor,
+                         sizeof(explicit_eor))) {
+    LOG_ERRNO(LS_ERROR) << debug_name_ << "Failed to set SCTP_EXPLICIT_EOR.";
+    return false;
+  }
+
   // Enable stream ID resets.
   struct sctp_assoc_value stream_rst;
   stream_rst.assoc_id = SCTP_ALL_ASSOC;
@@ -492,6 +621,10 @@ bool SctpDataMediaChannel::OpenSctpSocket() {
 
 void SctpDataMediaChannel::CloseSctpSocket() {
   sending_ = false;
+  pending_messages_.clear();
+  partial_messages_.clear();
+  scheduler_ = DSS_DEFAULT;
+  stream_priorities_.clear();
   if (sock_) {
     // We assume that SO_LINGER option is set to close the association when
     // close is called. This means that any pending packets in usrsctp will be
@@ -564,6 +697,9 @@ bool SctpDataMediaChannel::SetReceive(bool receive) {
 }
 
 bool SctpDataMediaChannel::SetSendParameters(const DataSendParameters& params) {
+  send_buffer_size_ = std::max(0, params.options.sctp_send_buffer_size);
+  receive_window_ = std::max(0, params.options.sctp_receive_window);
+  fragment_large_messages_ = params.options.sctp_fragment_large_messages;
   return SetSendCodecs(params.codecs);
 }
 
@@ -618,43 +754,52 @@ bool SctpDataMediaChannel::SendData(
     return false;
   }
 
-  //
-  // Send data using SCTP.
-  ssize_t send_res = 0;  // result from usrsctp_sendv.
-  struct sctp_sendv_spa spa = {0};
-  spa.sendv_flags |= SCTP_SEND_SNDINFO_VALID;
-  spa.sendv_sndinfo.snd_sid = params.ssrc;
-  spa.sendv_sndinfo.snd_ppid = rtc::HostToNetwork32(
-      GetPpid(params.type));
+  SetStreamScheduling(params);
 
-  // Ordered implies reliable.
-  if (!params.ordered) {
-    spa.sendv_sndinfo.snd_flags |= SCTP_UNORDERED;
-    if (params.max_rtx_count >= 0 || params.max_rtx_ms == 0) {
-      spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
-      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_RTX;
-      spa.sendv_prinfo.pr_value = params.max_rtx_count;
-    } else {
-      spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
-      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_TTL;
-      spa.sendv_prinfo.pr_value = params.max_rtx_ms;
+  // Nothing may overtake the rest of a message on its stream, and while
+  // usrsctp waits for the end of a message, it fails sends on the other
+  // streams.
+  if (HasPendingMessage(params.ssrc) || HasUnendedMessage()) {
+    if (result) {
+      *result = SDR_BLOCK;
     }
+    return false;
   }
 
-  // We don't fragment.
-  send_res = usrsctp_sendv(
-      sock_, payload.data(), static_cast<size_t>(payload.size()), NULL, 0, &spa,
-      rtc::checked_cast<socklen_t>(sizeof(spa)), SCTP_SENDV_SPA, 0);
-  if (send_res < 0) {
-    if (errno == SCTP_EWOULDBLOCK) {
-      *result = SDR_BLOCK;
-      LOG(LS_INFO) << debug_name_ << "->SendData(...): EWOULDBLOCK returned";
-    } else {
+  //
+  // Send data using SCTP, as much as fits straight from |payload|. Only the
+  // rest of a message that didn't fit is copied.
+  const bool fragmented =
+      fragment_large_messages_ && params.ordered &&
+      (params.type == cricket::DMT_BINARY || params.type == cricket::DMT_TEXT);
+  size_t offset = 0;
+  bool sent;
+  do {
+    sent = SendMessagePart(params, fragmented, payload, &offset);
+  } while (sent && offset < payload.size());
+  if (!sent) {
+    if (errno != SCTP_EWOULDBLOCK) {
       LOG_ERRNO(LS_ERROR) << "ERROR:" << debug_name_
                           << "->SendData(...): "
                           << " usrsctp_sendv: ";
+      return false;
     }
-    return false;
+    if (offset == 0) {
+      if (result) {
+        *result = SDR_BLOCK;
+      }
+      LOG(LS_INFO) << debug_name_ << "->SendData(...): EWOULDBLOCK returned";
+      return false;
+    }
+    // Keep the parts aligned to where they would have been, so the message
+    // ends where usrsctp expects it to.
+    const size_t start = offset - offset % kMaxSctpFragmentSize;
+    pending_messages_.push_back(PendingMessage());
+    PendingMessage& pending = pending_messages_.back();
+    pending.params = params;
+    pending.fragmented = fragmented;
+    pending.data.SetData(payload.data() + start, payload.size() - start);
+    pending.offset = offset - start;
   }
   if (result) {
     // Only way out now is success.
@@ -663,9 +808,154 @@ bool SctpDataMediaChannel::SendData(
   return true;
 }
 
+bool SctpDataMediaChannel::SendMessagePart(const SendDataParams& params,
+                                           bool fragmented,
+                                           const rtc::Buffer& data,
+                                           size_t* offset) {
+  // A part ends at the next multiple of kMaxSctpFragmentSize, also when
+  // usrsctp took only the start of it last time.
+  const size_t size =
+      std::min(kMaxSctpFragmentSize - *offset % kMaxSctpFragmentSize,
+               data.size() - *offset);
+  const bool last = *offset + size == data.size();
+  PayloadProtocolIdentifier ppid = GetPpid(params.type);
+  if (fragmented && !last) {
+    ppid = GetPartialPpid(params.type);
+  }
+  struct sctp_sendv_spa spa = GetSendInfo(params, ppid, fragmented || last);
+  ssize_t send_res = usrsctp_sendv(
+      sock_, data.data() + *offset, size, NULL, 0, &spa,
+      rtc::checked_cast<socklen_t>(sizeof(spa)), SCTP_SENDV_SPA, 0);
+  if (send_res < 0) {
+    return false;
+  }
+  // With SCTP_EXPLICIT_EOR usrsctp takes what fits in the send buffer, and
+  // ends the message only once it has all of it.
+  *offset += send_res;
+  if (send_res == 0 && size > 0) {
+    errno = SCTP_EWOULDBLOCK;
+    return false;
+  }
+  return true;
+}
+
+void SctpDataMediaChannel::SendPendingMessages() {
+  while (sending_ && !pending_messages_.empty()) {
+    std::list<PendingMessage>::iterator it = NextPendingMessage();
+    if (!SendMessagePart(it->params, it->fragmented, it->data, &it->offset)) {
+      if (errno == SCTP_EWOULDBLOCK)
+        return;
+      LOG_ERRNO(LS_ERROR) << debug_name_ << "->SendPendingMessages(): "
+                          << "Dropping the rest of a message on sid "
+                          << it->params.ssrc;
+      pending_messages_.erase(it);
+    } else if (it->offset == it->data.size()) {
+      pending_messages_.erase(it);
+    } else if (scheduler_ != DSS_FIRST_COME) {
+      pending_messages_.splice(pending_messages_.end(), pending_messages_, it);
+    }
+  }
+}
+
+std::list<SctpDataMediaChannel::PendingMessage>::iterator
+SctpDataMediaChannel::NextPendingMessage() {
+  std::list<PendingMessage>::iterator next = pending_messages_.begin();
+  for (std::list<PendingMessage>::iterator it = next;
+       it != pending_messages_.end(); ++it) {
+    if (!it->fragmented)
+      return it;
+  }
+  if (scheduler_ != DSS_PRIORITY)
+    return next;
+  int next_priority = GetStreamPriority(next->params.ssrc);
+  for (std::list<PendingMessage>::iterator it = next;
+       it != pending_messages_.end(); ++it) {
+    int priority = GetStreamPriority(it->params.ssrc);
+    if (priority > next_priority) {
+      next = it;
+      next_priority = priority;
+    }
+  }
+  return next;
+}
+
+int SctpDataMediaChannel::GetStreamPriority(uint32 sid) const {
+  std::map<uint32, int>::const_iterator it = stream_priorities_.find(sid);
+  return it != stream_priorities_.end() ? it->second : 0;
+}
+
+bool SctpDataMediaChannel::HasPendingMessage(uint32 sid) const {
+  for (std::list<PendingMessage>::const_iterator it =
+           pending_messages_.begin();
+       it != pending_messages_.end(); ++it) {
+    if (it->params.ssrc == sid)
+      return true;
+  }
+  return false;
+}
+
+bool SctpDataMediaChannel::HasUnendedMessage() const {
+  for (std::list<PendingMessage>::const_iterator it =
+           pending_messages_.begin();
+       it != pending_messages_.end(); ++it) {
+    if (!it->fragmented)
+      return true;
+  }
+  return false;
+}
+
+void SctpDataMediaChannel::DropMessages(uint32 sid) {
+  // The rest of a message that isn't fragmented is still sent: usrsctp holds
+  // the association on its stream until the message ends.
+  for (std::list<PendingMessage>::iterator it = pending_messages_.begin();
+       it != pending_messages_.end();) {
+    if (it->params.ssrc == sid && it->fragmented) {
+      it = pending_messages_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  partial_messages_.erase(sid);
+}
+
+void SctpDataMediaChannel::SetStreamScheduling(const SendDataParams& params) {
+  if (params.scheduler != DSS_DEFAULT && params.scheduler != scheduler_) {
+    struct sctp_assoc_value scheduler;
+    scheduler.assoc_id = SCTP_ALL_ASSOC;
+    scheduler.assoc_value = GetStreamSchedulingModule(params.scheduler);
+    if (usrsctp_setsockopt(sock_, IPPROTO_SCTP, SCTP_PLUGGABLE_SS, &scheduler,
+                           sizeof(scheduler))) {
+      LOG_ERRNO(LS_ERROR) << debug_name_ << "Failed to set SCTP_PLUGGABLE_SS.";
+    } else {
+      scheduler_ = params.scheduler;
+      // Changing the scheduler resets the priorities.
+      stream_priorities_.clear();
+    }
+  }
+  if (scheduler_ != DSS_PRIORITY)
+    return;
+
+  std::map<uint32, int>::iterator it = stream_priorities_.find(params.ssrc);
+  if (it != stream_priorities_.end() && it->second == params.priority)
+    return;
+  // usrsctp sends the lowest value first.
+  struct sctp_stream_value value;
+  value.assoc_id = SCTP_CURRENT_ASSOC;
+  value.stream_id = rtc::checked_cast<uint16_t>(params.ssrc);
+  value.stream_value = static_cast<uint16_t>(
+      0xFFFF - std::max(0, std::min(params.priority, 0xFFFF)));
+  if (usrsctp_setsockopt(sock_, IPPROTO_SCTP, SCTP_SS_VALUE, &value,
+                         sizeof(value))) {
+    LOG_ERRNO(LS_WARNING) << debug_name_ << "Failed to set the priority of sid "
+                          << params.ssrc;
+    return;
+  }
+  stream_priorities_[params.ssrc] = params.priority;
+}
+
 // Called by network interface when a packet has been received.
 void SctpDataMediaChannel::OnPacketReceived(
-    rtc::Buffer* packet, const rtc::PacketTime& packet_time) {
+    rtc::CopyOnWriteBuffer* packet, const rtc::PacketTime& packet_time) {
   RTC_DCHECK(rtc::Thread::Current() == worker_thread_);
   LOG(LS_VERBOSE) << debug_name_ << "->OnPacketReceived(...): "
                   << " length=" << packet->size() << ", sending: " << sending_;
@@ -677,8 +967,8 @@ void SctpDataMediaChannel::OnPacketReceived(
     // Pass received packet to SCTP stack. Once processed by usrsctp, the data
     // will be will be given to the global OnSctpInboundData, and then,
     // marshalled by a Post and handled with OnMessage.
-    VerboseLogPacket(packet->data(), packet->size(), SCTP_DUMP_INBOUND);
-    usrsctp_conninput(this, packet->data(), packet->size(), 0);
+    VerboseLogPacket(packet->cdata(), packet->size(), SCTP_DUMP_INBOUND);
+    usrsctp_conninput(this, packet->cdata(), packet->size(), 0);
   } else {
     // TODO(ldixon): Consider caching the packet for very slightly better
     // reliability.
@@ -701,8 +991,40 @@ void SctpDataMediaChannel::OnInboundPacketFromSctpToChannel(
   }
   if (packet->flags & MSG_NOTIFICATION) {
     OnNotificationFromSctp(&packet->buffer);
-  } else {
-    OnDataFromSctpToChannel(packet->params, &packet->buffer);
+    return;
+  }
+
+  const uint32 sid = packet->params.ssrc;
+  std::map<uint32, PartialMessage>::iterator it = partial_messages_.find(sid);
+  if (it == partial_messages_.end()) {
+    if (!packet->partial) {
+      OnDataFromSctpToChannel(packet->params, &packet->buffer);
+      return;
+    }
+    it = partial_messages_.insert(std::make_pair(sid, PartialMessage())).first;
+  }
+
+  PartialMessage& message = it->second;
+  const size_t size = message.data.size() + packet->buffer.size();
+  if (size > kMaxReassembledMessageSize && !message.discard) {
+    LOG(LS_ERROR) << debug_name_ << "->OnInboundPacketFromSctpToChannel(...): "
+                  << "Dropping a message larger than "
+                  << kMaxReassembledMessageSize << " bytes on sid " << sid;
+    message.data.Clear();
+    message.discard = true;
+  }
+  if (!message.discard) {
+    // Grow geometrically, a message may come in many fragments.
+    if (size > message.data.capacity()) {
+      message.data.EnsureCapacity(
+          std::max(size, 2 * message.data.capacity()));
+    }
+    message.data.AppendData(packet->buffer.data(), packet->buffer.size());
+  }
+  if (!packet->partial) {
+    if (!message.discard)
+      OnDataFromSctpToChannel(packet->params, &message.data);
+    partial_messages_.erase(it);
   }
 }
 
@@ -760,6 +1082,7 @@ bool SctpDataMediaChannel::ResetStream(uint32 ssrc) {
     LOG(LS_VERBOSE) << debug_name_ << "->ResetStream(" << ssrc << "): "
                     << "Removing and queuing RE-CONFIG chunk.";
     open_streams_.erase(found);
+    DropMessages(ssrc);
   }
 
   // SCTP won't let you have more than one stream reset pending at a time, but
@@ -803,7 +1126,10 @@ void SctpDataMediaChannel::OnNotificationFromSctp(rtc::Buffer* buffer) {
       break;
     case SCTP_SENDER_DRY_EVENT:
       LOG(LS_VERBOSE) << "SCTP_SENDER_DRY_EVENT";
+      if (HasUnendedMessage())
+        SendPendingMessages();
       SignalReadyToSend(true);
+      SendPendingMessages();
       break;
     // TODO(ldixon): Unblock after congestion.
     case SCTP_NOTIFICATIONS_STOPPED_EVENT:
@@ -910,6 +1236,7 @@ void SctpDataMediaChannel::OnStreamResetEvent(
         LOG(LS_VERBOSE) << "SCTP_STREAM_RESET_EVENT(" << debug_name_
                         << "): closing sid " << stream_id;
         open_streams_.erase(it);
+        DropMessages(stream_id);
         SignalStreamClosedRemotely(stream_id);
 
       } else if ((it = queued_reset_streams_.find(stream_id))
@@ -971,7 +1298,7 @@ bool SctpDataMediaChannel::SetRecvCodecs(const std::vector<DataCodec>& codecs) {
 }
 
 void SctpDataMediaChannel::OnPacketFromSctpToNetwork(
-    rtc::Buffer* buffer) {
+    rtc::CopyOnWriteBuffer* buffer) {
   // usrsctp seems to interpret the MTU we give it strangely -- it seems to
   // give us back packets bigger than that MTU, if only by a fixed amount.
   // This is that amount that we've observed.
@@ -1030,15 +1357,20 @@ bool SctpDataMediaChannel::SendQueuedStreamResets() {
 void SctpDataMediaChannel::OnMessage(rtc::Message* msg) {
   switch (msg->message_id) {
     case MSG_SCTPINBOUNDPACKET: {
-      rtc::scoped_ptr<InboundPacketMessage> pdata(
-          static_cast<InboundPacketMessage*>(msg->pdata));
-      OnInboundPacketFromSctpToChannel(pdata->data().get());
+      SctpInboundPacket* packet = static_cast<SctpInboundPacket*>(msg->pdata);
+      OnInboundPacketFromSctpToChannel(packet);
+      if (packet->buffer.capacity() > kMaxPooledBufferSize) {
+        delete packet;
+      } else {
+        inbound_packets_.Release(packet);
+      }
       break;
     }
     case MSG_SCTPOUTBOUNDPACKET: {
-      rtc::scoped_ptr<OutboundPacketMessage> pdata(
-          static_cast<OutboundPacketMessage*>(msg->pdata));
-      OnPacketFromSctpToNetwork(pdata->data().get());
+      SctpOutboundPacket* packet =
+          static_cast<SctpOutboundPacket*>(msg->pdata);
+      OnPacketFromSctpToNetwork(&packet->buffer);
+      outbound_packets_.Release(packet);
       break;
     }
   }
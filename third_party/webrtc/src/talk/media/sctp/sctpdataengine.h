@@ -29,6 +29,8 @@
 #define TALK_MEDIA_SCTP_SCTPDATAENGINE_H_
 
 #include <errno.h>
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -108,9 +110,9 @@ class SctpDataEngine : public DataEngineInterface, public sigslot::has_slots<> {
   static SctpDataMediaChannel* GetChannelFromSocket(struct socket* sock);
 };
 
-// TODO(ldixon): Make into a special type of TypedMessageData.
-// Holds data to be passed on to a channel.
+// Hold data to be passed on to a channel, and to the network.
 struct SctpInboundPacket;
+struct SctpOutboundPacket;
 
 class SctpDataMediaChannel : public DataMediaChannel,
                              public rtc::MessageHandler {
@@ -165,15 +167,22 @@ class SctpDataMediaChannel : public DataMediaChannel,
                         const rtc::Buffer& payload,
                         SendDataResult* result = NULL);
   // A packet is received from the network interface. Posted to OnMessage.
-  virtual void OnPacketReceived(rtc::Buffer* packet,
+  virtual void OnPacketReceived(rtc::CopyOnWriteBuffer* packet,
                                 const rtc::PacketTime& packet_time);
 
   // Exposed to allow Post call from c-callbacks.
   rtc::Thread* worker_thread() const { return worker_thread_; }
+  // The message data posted for each packet is recycled through these.
+  rtc::MessageDataPool<SctpInboundPacket>* inbound_packets() {
+    return &inbound_packets_;
+  }
+  rtc::MessageDataPool<SctpOutboundPacket>* outbound_packets() {
+    return &outbound_packets_;
+  }
 
   // Many of these things are unused by SCTP, but are needed to fulfill
   // the MediaChannel interface.
-  virtual void OnRtcpReceived(rtc::Buffer* packet,
+  virtual void OnRtcpReceived(rtc::CopyOnWriteBuffer* packet,
                               const rtc::PacketTime& packet_time) {}
   virtual void OnReadyToSend(bool ready) {}
 
@@ -185,6 +194,24 @@ class SctpDataMediaChannel : public DataMediaChannel,
   const std::string& debug_name() const { return debug_name_; }
   const struct socket* socket() const { return sock_; }
  private:
+  // A message that didn't fit in usrsctp's send buffer, of which the parts
+  // from |offset| on are still to be sent.
+  struct PendingMessage {
+    SendDataParams params;
+    // Whether each part is an SCTP message of its own, with a partial PPID,
+    // rather than a piece of one SCTP message.
+    bool fragmented;
+    rtc::Buffer data;
+    size_t offset;
+  };
+  // A message being reassembled from fragments received on a stream.
+  struct PartialMessage {
+    PartialMessage() : discard(false) {}
+    rtc::Buffer data;
+    // Set when the message grew too large; the rest of it is dropped.
+    bool discard;
+  };
+
   sockaddr_conn GetSctpSockAddr(int port);
 
   bool SetSendCodecs(const std::vector<DataCodec>& codecs);
@@ -204,13 +231,38 @@ class SctpDataMediaChannel : public DataMediaChannel,
   // Sends a SCTP_RESET_STREAM for all streams in closing_ssids_.
   bool SendQueuedStreamResets();
 
+  // Sends the part of |data| at |*offset| and moves |*offset| past it. The
+  // part is an SCTP message of its own if |fragmented|, and otherwise the
+  // last part ends the SCTP message. Returns false, with errno set, if
+  // usrsctp didn't take it.
+  bool SendMessagePart(const SendDataParams& params, bool fragmented,
+                       const rtc::Buffer& data, size_t* offset);
+  // Sends parts of the pending messages until usrsctp's send buffer is full,
+  // the rest of a message that isn't fragmented first, and then in the
+  // order of the association's scheduler: one part per stream in turn,
+  // one message after the other under DSS_FIRST_COME, and the highest
+  // priority first under DSS_PRIORITY.
+  void SendPendingMessages();
+  std::list<PendingMessage>::iterator NextPendingMessage();
+  // The priority last set for |sid| under DSS_PRIORITY, 0 if none.
+  int GetStreamPriority(uint32 sid) const;
+  bool HasPendingMessage(uint32 sid) const;
+  // Whether usrsctp has the start of a message that isn't fragmented, and
+  // so holds the association until it gets the rest.
+  bool HasUnendedMessage() const;
+  // Drops the pending and partially received messages of |sid|.
+  void DropMessages(uint32 sid);
+  // Sets the association's scheduler and the stream's priority asked for in
+  // |params|, unless already set.
+  void SetStreamScheduling(const SendDataParams& params);
+
   // Adds a stream.
   bool AddStream(const StreamParams &sp);
   // Queues a stream for reset.
   bool ResetStream(uint32 ssrc);
 
   // Called by OnMessage to send packet on the network.
-  void OnPacketFromSctpToNetwork(rtc::Buffer* buffer);
+  void OnPacketFromSctpToNetwork(rtc::CopyOnWriteBuffer* buffer);
   // Called by OnMessage to decide what to do with the packet.
   void OnInboundPacketFromSctpToChannel(SctpInboundPacket* packet);
   void OnDataFromSctpToChannel(const ReceiveDataParams& params,
@@ -247,8 +299,25 @@ class SctpDataMediaChannel : public DataMediaChannel,
   StreamSet queued_reset_streams_;
   StreamSet sent_reset_streams_;
 
+  // From DataOptions. The buffer sizes apply from the next SetSend(true);
+  // zero keeps the usrsctp defaults.
+  int send_buffer_size_;
+  int receive_window_;
+  bool fragment_large_messages_;
+
+  std::list<PendingMessage> pending_messages_;
+  std::map<uint32, PartialMessage> partial_messages_;
+
+  // The association's scheduler, and the priorities set for streams under
+  // DSS_PRIORITY.
+  DataStreamScheduler scheduler_;
+  std::map<uint32, int> stream_priorities_;
+
   // A human-readable name for debugging messages.
   std::string debug_name_;
+
+  rtc::MessageDataPool<SctpInboundPacket> inbound_packets_;
+  rtc::MessageDataPool<SctpOutboundPacket> outbound_packets_;
 };
 
 }  // namespace cricket
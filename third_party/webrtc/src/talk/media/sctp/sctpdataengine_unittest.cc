@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,7 @@
 #include "talk/media/sctp/sctpdataengine.h"
 #include "webrtc/base/bind.h"
 #include "webrtc/base/buffer.h"
+#include "webrtc/base/byteorder.h"
 #include "webrtc/base/criticalsection.h"
 #include "webrtc/base/gunit.h"
 #include "webrtc/base/helpers.h"
@@ -56,20 +58,24 @@ class SctpFakeNetworkInterface : public cricket::MediaChannel::NetworkInterface,
  public:
   explicit SctpFakeNetworkInterface(rtc::Thread* thread)
     : thread_(thread),
-      dest_(NULL) {
+      dest_(NULL),
+      num_partial_chunks_(0) {
   }
 
   void SetDestination(cricket::DataMediaChannel* dest) { dest_ = dest; }
 
+  // The number of DATA chunks sent with a partial PPID.
+  int num_partial_chunks() const { return num_partial_chunks_; }
+
  protected:
   // Called to send raw packet down the wire (e.g. SCTP an packet).
-  virtual bool SendPacket(rtc::Buffer* packet,
+  virtual bool SendPacket(rtc::CopyOnWriteBuffer* packet,
                           rtc::DiffServCodePoint dscp) {
     LOG(LS_VERBOSE) << "SctpFakeNetworkInterface::SendPacket";
+    CountPartialChunks(*packet);
 
-    // TODO(ldixon): Can/should we use Buffer.TransferTo here?
-    // Note: this assignment does a deep copy of data from packet.
-    rtc::Buffer* buffer = new rtc::Buffer(packet->data(), packet->size());
+    // Note: this shares the data with the packet instead of copying it.
+    rtc::CopyOnWriteBuffer* buffer = new rtc::CopyOnWriteBuffer(*packet);
     thread_->Post(this, MSG_PACKET, rtc::WrapMessageData(buffer));
     LOG(LS_VERBOSE) << "SctpFakeNetworkInterface::SendPacket, Posted message.";
     return true;
@@ -80,8 +86,8 @@ class SctpFakeNetworkInterface : public cricket::MediaChannel::NetworkInterface,
   // an SCTP packet.
   virtual void OnMessage(rtc::Message* msg) {
     LOG(LS_VERBOSE) << "SctpFakeNetworkInterface::OnMessage";
-    rtc::scoped_ptr<rtc::Buffer> buffer(
-        static_cast<rtc::TypedMessageData<rtc::Buffer*>*>(
+    rtc::scoped_ptr<rtc::CopyOnWriteBuffer> buffer(
+        static_cast<rtc::TypedMessageData<rtc::CopyOnWriteBuffer*>*>(
             msg->pdata)->data());
     if (dest_) {
       dest_->OnPacketReceived(buffer.get(), rtc::PacketTime());
@@ -92,7 +98,7 @@ class SctpFakeNetworkInterface : public cricket::MediaChannel::NetworkInterface,
   // Unsupported functions required to exist by NetworkInterface.
   // TODO(ldixon): Refactor parent NetworkInterface class so these are not
   // required. They are RTC specific and should be in an appropriate subclass.
-  virtual bool SendRtcp(rtc::Buffer* packet,
+  virtual bool SendRtcp(rtc::CopyOnWriteBuffer* packet,
                         rtc::DiffServCodePoint dscp) {
     LOG(LS_WARNING) << "Unsupported: SctpFakeNetworkInterface::SendRtcp.";
     return false;
@@ -107,9 +113,31 @@ class SctpFakeNetworkInterface : public cricket::MediaChannel::NetworkInterface,
   }
 
  private:
+  // Walks the chunks after the 12 byte common header. The PPID of a DATA
+  // chunk follows its 4 byte header, TSN, stream id and sequence number.
+  void CountPartialChunks(const rtc::CopyOnWriteBuffer& packet) {
+    const uint8_t* data = packet.data();
+    size_t offset = 12;
+    while (offset + 4 <= packet.size()) {
+      uint8_t type = data[offset];
+      size_t length = rtc::GetBE16(data + offset + 2);
+      if (length < 4)
+        break;
+      if (type == 0 && offset + 16 <= packet.size()) {
+        uint32 ppid = rtc::GetBE32(data + offset + 12);
+        if (ppid == cricket::SctpDataMediaChannel::PPID_BINARY_PARTIAL ||
+            ppid == cricket::SctpDataMediaChannel::PPID_TEXT_PARTIAL) {
+          ++num_partial_chunks_;
+        }
+      }
+      offset += (length + 3) & ~3;
+    }
+  }
+
   // Not owned by this class.
   rtc::Thread* thread_;
   cricket::DataMediaChannel* dest_;
+  int num_partial_chunks_;
 };
 
 // This is essentially a buffer to hold recieved data. It stores only the last
@@ -119,7 +147,7 @@ class SctpFakeNetworkInterface : public cricket::MediaChannel::NetworkInterface,
 // instead of replacing it.
 class SctpFakeDataReceiver : public sigslot::has_slots<> {
  public:
-  SctpFakeDataReceiver() : received_(false) {}
+  SctpFakeDataReceiver() : received_(false), num_received_(0) {}
 
   void Clear() {
     received_ = false;
@@ -130,16 +158,19 @@ class SctpFakeDataReceiver : public sigslot::has_slots<> {
   virtual void OnDataReceived(const cricket::ReceiveDataParams& params,
                               const char* data, size_t length) {
     received_ = true;
+    ++num_received_;
     last_data_ = std::string(data, length);
     last_params_ = params;
   }
 
   bool received() const { return received_; }
+  int num_received() const { return num_received_; }
   std::string last_data() const { return last_data_; }
   cricket::ReceiveDataParams last_params() const { return last_params_; }
 
  private:
   bool received_;
+  int num_received_;
   std::string last_data_;
   cricket::ReceiveDataParams last_params_;
 };
@@ -212,6 +243,90 @@ class SignalChannelClosedReopener : public sigslot::has_slots<> {
 };
 
 // SCTP Data Engine testing framework.
+// Keeps stream 1 of a channel busy with bulk data, and measures how long a
+// small message on stream 2 takes to arrive.
+class SctpLatencyProbe : public sigslot::has_slots<> {
+ public:
+  SctpLatencyProbe(cricket::SctpDataMediaChannel* sender,
+                   cricket::SctpDataMediaChannel* receiver,
+                   cricket::DataStreamScheduler scheduler)
+      : sender_(sender),
+        scheduler_(scheduler),
+        bulk_(64 * 1024, 'x'),
+        sending_bulk_(true),
+        probe_pending_(false),
+        probe_received_(false),
+        probe_sent_us_(0),
+        num_probes_(0),
+        total_latency_us_(0),
+        max_latency_us_(0) {
+    sender->SignalReadyToSend.connect(this, &SctpLatencyProbe::OnReadyToSend);
+    receiver->SignalDataReceived.connect(this,
+                                         &SctpLatencyProbe::OnDataReceived);
+  }
+
+  // Sends a probe, or queues it if the channel is blocked.
+  void SendProbe() {
+    probe_pending_ = true;
+    probe_received_ = false;
+    probe_sent_us_ = rtc::TimeMicros();
+    OnReadyToSend(true);
+  }
+  void StopBulk() { sending_bulk_ = false; }
+
+  bool probe_received() const { return probe_received_; }
+  uint64 average_latency_us() const {
+    return num_probes_ ? total_latency_us_ / num_probes_ : 0;
+  }
+  uint64 max_latency_us() const { return max_latency_us_; }
+
+ private:
+  void OnReadyToSend(bool ready) {
+    if (probe_pending_ && Send(2, "probe", 1))
+      probe_pending_ = false;
+    while (sending_bulk_ && Send(1, bulk_, 0)) {
+    }
+  }
+
+  void OnDataReceived(const cricket::ReceiveDataParams& params,
+                      const char* data, size_t length) {
+    if (params.ssrc != 2)
+      return;
+    const uint64 latency_us = rtc::TimeMicros() - probe_sent_us_;
+    ++num_probes_;
+    total_latency_us_ += latency_us;
+    max_latency_us_ = std::max(max_latency_us_, latency_us);
+    probe_received_ = true;
+  }
+
+  bool Send(uint32 sid, const std::string& data, int priority) {
+    cricket::SendDataParams params;
+    params.ssrc = sid;
+    params.ordered = true;
+    params.reliable = true;
+    params.scheduler = scheduler_;
+    params.priority = priority;
+    cricket::SendDataResult result;
+    bool sent = sender_->SendData(
+        params, rtc::Buffer(data.data(), data.size()), &result);
+    // Anything but a full send buffer would close a data channel.
+    EXPECT_TRUE(result == cricket::SDR_SUCCESS ||
+                result == cricket::SDR_BLOCK);
+    return sent;
+  }
+
+  cricket::SctpDataMediaChannel* sender_;
+  cricket::DataStreamScheduler scheduler_;
+  std::string bulk_;
+  bool sending_bulk_;
+  bool probe_pending_;
+  bool probe_received_;
+  uint64 probe_sent_us_;
+  uint64 num_probes_;
+  uint64 total_latency_us_;
+  uint64 max_latency_us_;
+};
+
 class SctpDataMediaChannelTest : public testing::Test,
                                  public sigslot::has_slots<> {
  protected:
@@ -222,8 +337,12 @@ class SctpDataMediaChannelTest : public testing::Test,
 
   virtual void SetUp() {
     engine_.reset(new cricket::SctpDataEngine());
+    options_ = cricket::DataOptions();
   }
 
+  // Applies to the channels created by SetupConnectedChannels().
+  void SetOptions(const cricket::DataOptions& options) { options_ = options; }
+
   void SetupConnectedChannels() {
     net1_.reset(new SctpFakeNetworkInterface(rtc::Thread::Current()));
     net2_.reset(new SctpFakeNetworkInterface(rtc::Thread::Current()));
@@ -286,6 +405,13 @@ class SctpDataMediaChannelTest : public testing::Test,
         static_cast<cricket::SctpDataMediaChannel*>(engine_->CreateChannel(
             cricket::DCT_SCTP));
     channel->SetInterface(net);
+    cricket::DataCodec codec(cricket::kGoogleSctpDataCodecId,
+                             cricket::kGoogleSctpDataCodecName, 0);
+    codec.SetParam(cricket::kCodecParamPort, cricket::kSctpDefaultPort);
+    cricket::DataSendParameters params;
+    params.codecs.push_back(codec);
+    params.options = options_;
+    EXPECT_TRUE(channel->SetSendParameters(params));
     // When data is received, pass it to the SctpFakeDataReceiver.
     channel->SignalDataReceived.connect(
         recv, &SctpFakeDataReceiver::OnDataReceived);
@@ -302,6 +428,18 @@ class SctpDataMediaChannelTest : public testing::Test,
         &msg[0], msg.length()), result);
   }
 
+  bool SendReliableData(cricket::SctpDataMediaChannel* chan, uint32 ssrc,
+                        const std::string& msg,
+                        cricket::SendDataResult* result) {
+    cricket::SendDataParams params;
+    params.ssrc = ssrc;
+    params.ordered = true;
+    params.reliable = true;
+
+    return chan->SendData(params, rtc::Buffer(
+        &msg[0], msg.length()), result);
+  }
+
   bool ReceivedData(const SctpFakeDataReceiver* recv, uint32 ssrc,
                     const std::string& msg ) {
     return (recv->received() &&
@@ -324,6 +462,7 @@ class SctpDataMediaChannelTest : public testing::Test,
   cricket::SctpDataMediaChannel* channel2() { return chan2_.get(); }
   SctpFakeDataReceiver* receiver1() { return recv1_.get(); }
   SctpFakeDataReceiver* receiver2() { return recv2_.get(); }
+  SctpFakeNetworkInterface* network1() { return net1_.get(); }
 
   int channel1_ready_to_send_count() { return chan1_ready_to_send_count_; }
   int channel2_ready_to_send_count() { return chan2_ready_to_send_count_; }
@@ -336,6 +475,7 @@ class SctpDataMediaChannelTest : public testing::Test,
   rtc::scoped_ptr<cricket::SctpDataMediaChannel> chan1_;
   rtc::scoped_ptr<cricket::SctpDataMediaChannel> chan2_;
 
+  cricket::DataOptions options_;
   int chan1_ready_to_send_count_;
   int chan2_ready_to_send_count_;
 
@@ -424,6 +564,214 @@ TEST_F(SctpDataMediaChannelTest, SendDataBlocked) {
   EXPECT_EQ(cricket::SDR_BLOCK, result);
 }
 
+// Transfers messages over the loopback and counts the message data allocated
+// for the packets handed between the usrsctp and the worker thread.
+TEST_F(SctpDataMediaChannelTest, TransferAllocations) {
+  SetupConnectedChannels();
+  const int kNumMessages = 2000;
+  const std::string message(1000, 'x');
+
+  size_t allocated = channel1()->outbound_packets()->allocated() +
+                     channel1()->inbound_packets()->allocated() +
+                     channel2()->outbound_packets()->allocated() +
+                     channel2()->inbound_packets()->allocated();
+  cricket::SendDataResult result;
+  uint32 start = rtc::Time();
+  for (int i = 0; i < kNumMessages; ++i) {
+    ASSERT_TRUE(SendData(channel1(), 1, message, &result));
+    ProcessMessagesUntilIdle();
+  }
+  EXPECT_EQ_WAIT(kNumMessages, receiver2()->num_received(), 1000);
+  int elapsed = rtc::TimeSince(start);
+  allocated = channel1()->outbound_packets()->allocated() +
+              channel1()->inbound_packets()->allocated() +
+              channel2()->outbound_packets()->allocated() +
+              channel2()->inbound_packets()->allocated() - allocated;
+
+  // Once the pools are warm, packets don't allocate message data.
+  EXPECT_LT(allocated, static_cast<size_t>(kNumMessages / 10));
+  LOG(LS_INFO) << kNumMessages << " messages of " << message.size()
+               << " bytes transferred in " << elapsed << " ms, "
+               << allocated << " packet message allocations";
+}
+
+// A message larger than the send buffer goes out as one SCTP message, with
+// the PPID of its type, so any peer receives it whole.
+TEST_F(SctpDataMediaChannelTest, SendsLargeMessage) {
+  SetupConnectedChannels();
+  std::string large(1024 * 1024, 0);
+  for (size_t i = 0; i < large.size(); ++i)
+    large[i] = static_cast<char>(i * 7);
+
+  cricket::SendDataResult result;
+  ASSERT_TRUE(SendReliableData(channel1(), 1, large, &result));
+  EXPECT_EQ(cricket::SDR_SUCCESS, result);
+  // The rest of the message is queued; nothing may overtake it on its stream.
+  EXPECT_FALSE(SendReliableData(channel1(), 1, "after", &result));
+  EXPECT_EQ(cricket::SDR_BLOCK, result);
+
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, large), 5000);
+  EXPECT_EQ(1, receiver2()->num_received());
+  EXPECT_EQ(0, network1()->num_partial_chunks());
+
+  ASSERT_TRUE(SendReliableData(channel1(), 1, "after", &result));
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, "after"), 1000);
+}
+
+// While the rest of a large message that isn't fragmented waits for the send
+// buffer, sends on other streams are blocked rather than failed, so their
+// data channels stay open.
+TEST_F(SctpDataMediaChannelTest, BlocksOtherStreamsDuringLargeMessage) {
+  SetupConnectedChannels();
+  const std::string large(1024 * 1024, 'x');
+
+  cricket::SendDataResult result;
+  ASSERT_TRUE(SendReliableData(channel1(), 1, large, &result));
+  EXPECT_EQ(cricket::SDR_SUCCESS, result);
+  EXPECT_FALSE(SendData(channel1(), 2, "control", &result));
+  EXPECT_EQ(cricket::SDR_BLOCK, result);
+
+  // Once all of the large message has been handed over, the other stream
+  // can send again.
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, large), 5000);
+  ASSERT_TRUE(SendData(channel1(), 2, "control", &result));
+  EXPECT_EQ(cricket::SDR_SUCCESS, result);
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 2, "control"), 1000);
+  EXPECT_EQ(2, receiver2()->num_received());
+}
+
+// With sctp_fragment_large_messages, a large message is sent as fragments
+// with partial PPIDs, and messages on other streams go out between them.
+TEST_F(SctpDataMediaChannelTest, SendsLargeMessageInFragments) {
+  cricket::DataOptions options;
+  options.sctp_fragment_large_messages = true;
+  SetOptions(options);
+  SetupConnectedChannels();
+  std::string large(1024 * 1024, 0);
+  for (size_t i = 0; i < large.size(); ++i)
+    large[i] = static_cast<char>(i * 7);
+
+  cricket::SendDataResult result;
+  ASSERT_TRUE(SendReliableData(channel1(), 1, large, &result));
+  EXPECT_EQ(cricket::SDR_SUCCESS, result);
+  EXPECT_FALSE(SendReliableData(channel1(), 1, "after", &result));
+  EXPECT_EQ(cricket::SDR_BLOCK, result);
+  // The fragments fill the send buffer; once it drains, the control message
+  // goes out ahead of the rest of the large one.
+  EXPECT_TRUE_WAIT(SendData(channel1(), 2, "control", &result), 1000);
+
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 2, "control"), 1000);
+  EXPECT_EQ(1, receiver2()->num_received());
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, large), 5000);
+  EXPECT_EQ(2, receiver2()->num_received());
+  EXPECT_LT(0, network1()->num_partial_chunks());
+
+  ASSERT_TRUE(SendReliableData(channel1(), 1, "after", &result));
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, "after"), 1000);
+}
+
+// Measures the throughput over the loopback for a range of message sizes,
+// with the default and with larger send and receive buffers.
+TEST_F(SctpDataMediaChannelTest, Throughput) {
+  const int kBufferSizes[] = {0, 1024 * 1024};
+  const size_t kMessageSizes[] = {1024, 64 * 1024, 1024 * 1024};
+  const size_t kTotalSize = 8 * 1024 * 1024;
+
+  for (size_t b = 0; b < ARRAY_SIZE(kBufferSizes); ++b) {
+    cricket::DataOptions options;
+    options.sctp_send_buffer_size = kBufferSizes[b];
+    options.sctp_receive_window = kBufferSizes[b];
+    SetOptions(options);
+    SetupConnectedChannels();
+    for (size_t m = 0; m < ARRAY_SIZE(kMessageSizes); ++m) {
+      const std::string message(kMessageSizes[m], 'x');
+      const int num_messages = static_cast<int>(kTotalSize / message.size());
+      const int num_received = receiver2()->num_received();
+      cricket::SendDataResult result;
+      uint32 start = rtc::Time();
+      for (int i = 0; i < num_messages;) {
+        if (SendReliableData(channel1(), 1, message, &result)) {
+          ++i;
+        } else {
+          ASSERT_EQ(cricket::SDR_BLOCK, result);
+          ProcessMessagesUntilIdle();
+        }
+      }
+      EXPECT_EQ_WAIT(num_received + num_messages, receiver2()->num_received(),
+                     10000);
+      int elapsed = std::max(1, rtc::TimeSince(start));
+      LOG(LS_INFO) << "Buffers " << kBufferSizes[b] << ": " << num_messages
+                   << " messages of " << message.size() << " bytes in "
+                   << elapsed << " ms, " << kTotalSize / 1000 / elapsed
+                   << " MB/s";
+    }
+    TearDown();
+  }
+}
+
+// Measures the latency of small messages on one stream while another stream
+// sends bulk data, for each scheduler, with the bulk messages sent whole and
+// in fragments.
+TEST_F(SctpDataMediaChannelTest, LatencyUnderBulkLoad) {
+  const cricket::DataStreamScheduler kSchedulers[] = {
+    cricket::DSS_DEFAULT,
+    cricket::DSS_FIRST_COME,
+    cricket::DSS_ROUND_ROBIN,
+    cricket::DSS_PRIORITY,
+  };
+  const int kNumProbes = 100;
+
+  for (int fragment = 0; fragment < 2; ++fragment) {
+    cricket::DataOptions options;
+    options.sctp_fragment_large_messages = (fragment != 0);
+    SetOptions(options);
+    for (size_t i = 0; i < ARRAY_SIZE(kSchedulers); ++i) {
+      SetupConnectedChannels();
+      SctpLatencyProbe probe(channel1(), channel2(), kSchedulers[i]);
+      for (int p = 0; p < kNumProbes; ++p) {
+        probe.SendProbe();
+        EXPECT_TRUE_WAIT(probe.probe_received(), 1000);
+      }
+      probe.StopBulk();
+      LOG(LS_INFO) << "Scheduler " << kSchedulers[i]
+                   << (fragment ? ", fragmented" : ", whole")
+                   << ": average latency " << probe.average_latency_us()
+                   << " us, max " << probe.max_latency_us() << " us";
+      TearDown();
+    }
+  }
+}
+
+// Under DSS_PRIORITY, the rest of a large message on a high priority stream
+// is sent before the rest of one on a lower priority stream, even when that
+// one was sent first.
+TEST_F(SctpDataMediaChannelTest, SendsPendingMessagesByPriority) {
+  cricket::DataOptions options;
+  options.sctp_fragment_large_messages = true;
+  SetOptions(options);
+  SetupConnectedChannels();
+  const std::string low(1024 * 1024, 'l');
+  const std::string high(1024 * 1024, 'h');
+
+  cricket::SendDataParams params;
+  params.ordered = true;
+  params.reliable = true;
+  params.scheduler = cricket::DSS_PRIORITY;
+  cricket::SendDataResult result;
+  params.ssrc = 1;
+  params.priority = 0;
+  ASSERT_TRUE(channel1()->SendData(
+      params, rtc::Buffer(low.data(), low.size()), &result));
+  params.ssrc = 2;
+  params.priority = 1;
+  EXPECT_TRUE_WAIT(channel1()->SendData(
+      params, rtc::Buffer(high.data(), high.size()), &result), 1000);
+
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 2, high), 5000);
+  EXPECT_EQ(1, receiver2()->num_received());
+  EXPECT_TRUE_WAIT(ReceivedData(receiver2(), 1, low), 5000);
+}
+
 TEST_F(SctpDataMediaChannelTest, ClosesRemoteStream) {
   SetupConnectedChannels();
   SignalChannelClosedObserver chan_1_sig_receiver, chan_2_sig_receiver;
@@ -1418,14 +1418,14 @@ bool WebRtcVideoChannel2::RequestIntraFrame() {
 }
 
 void WebRtcVideoChannel2::OnPacketReceived(
-    rtc::Buffer* packet,
+    rtc::CopyOnWriteBuffer* packet,
     const rtc::PacketTime& packet_time) {
   const webrtc::PacketTime webrtc_packet_time(packet_time.timestamp,
                                               packet_time.not_before);
   const webrtc::PacketReceiver::DeliveryStatus delivery_result =
       call_->Receiver()->DeliverPacket(
           webrtc::MediaType::VIDEO,
-          reinterpret_cast<const uint8_t*>(packet->data()), packet->size(),
+          reinterpret_cast<const uint8_t*>(packet->cdata()), packet->size(),
           webrtc_packet_time);
   switch (delivery_result) {
     case webrtc::PacketReceiver::DELIVERY_OK:
@@ -1437,12 +1437,12 @@ void WebRtcVideoChannel2::OnPacketReceived(
   }
 
   uint32 ssrc = 0;
-  if (!GetRtpSsrc(packet->data(), packet->size(), &ssrc)) {
+  if (!GetRtpSsrc(packet->cdata(), packet->size(), &ssrc)) {
     return;
   }
 
   int payload_type = 0;
-  if (!GetRtpPayloadType(packet->data(), packet->size(), &payload_type)) {
+  if (!GetRtpPayloadType(packet->cdata(), packet->size(), &payload_type)) {
     return;
   }
 
@@ -1468,7 +1468,7 @@ void WebRtcVideoChannel2::OnPacketReceived(
 
   if (call_->Receiver()->DeliverPacket(
           webrtc::MediaType::VIDEO,
-          reinterpret_cast<const uint8_t*>(packet->data()), packet->size(),
+          reinterpret_cast<const uint8_t*>(packet->cdata()), packet->size(),
           webrtc_packet_time) != webrtc::PacketReceiver::DELIVERY_OK) {
     LOG(LS_WARNING) << "Failed to deliver RTP packet on re-delivery.";
     return;
@@ -1476,13 +1476,13 @@ void WebRtcVideoChannel2::OnPacketReceived(
 }
 
 void WebRtcVideoChannel2::OnRtcpReceived(
-    rtc::Buffer* packet,
+    rtc::CopyOnWriteBuffer* packet,
     const rtc::PacketTime& packet_time) {
   const webrtc::PacketTime webrtc_packet_time(packet_time.timestamp,
                                               packet_time.not_before);
   if (call_->Receiver()->DeliverPacket(
           webrtc::MediaType::VIDEO,
-          reinterpret_cast<const uint8_t*>(packet->data()), packet->size(),
+          reinterpret_cast<const uint8_t*>(packet->cdata()), packet->size(),
           webrtc_packet_time) != webrtc::PacketReceiver::DELIVERY_OK) {
     LOG(LS_WARNING) << "Failed to deliver RTCP packet.";
   }
@@ -1674,12 +1674,14 @@ void WebRtcVideoChannel2::OnLoadUpdate(Load load) {
 bool WebRtcVideoChannel2::SendRtp(const uint8_t* data,
                                   size_t len,
                                   const webrtc::PacketOptions& options) {
-  rtc::Buffer packet(data, len, kMaxRtpPacketLen);
+  rtc::CopyOnWriteBuffer packet(data, len, kMaxRtpPacketLen,
+                                kRtpPacketHeadroom);
   return MediaChannel::SendPacket(&packet);
 }
 
 bool WebRtcVideoChannel2::SendRtcp(const uint8_t* data, size_t len) {
-  rtc::Buffer packet(data, len, kMaxRtpPacketLen);
+  rtc::CopyOnWriteBuffer packet(data, len, kMaxRtpPacketLen,
+                                kRtpPacketHeadroom);
   return MediaChannel::SendRtcp(&packet);
 }
 
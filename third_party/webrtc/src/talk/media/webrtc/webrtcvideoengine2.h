@@ -184,9 +184,9 @@ class WebRtcVideoChannel2 : public rtc::MessageHandler,
   bool SendIntraFrame() override;
   bool RequestIntraFrame() override;
 
-  void OnPacketReceived(rtc::Buffer* packet,
+  void OnPacketReceived(rtc::CopyOnWriteBuffer* packet,
                         const rtc::PacketTime& packet_time) override;
-  void OnRtcpReceived(rtc::Buffer* packet,
+  void OnRtcpReceived(rtc::CopyOnWriteBuffer* packet,
                       const rtc::PacketTime& packet_time) override;
   void OnReadyToSend(bool ready) override;
   void SetInterface(NetworkInterface* iface) override;
@@ -215,9 +215,9 @@ class WebRtcVoiceMediaChannel : public VoiceMediaChannel,
   bool CanInsertDtmf() override;
   bool InsertDtmf(uint32 ssrc, int event, int duration, int flags) override;
 
-  void OnPacketReceived(rtc::Buffer* packet,
+  void OnPacketReceived(rtc::CopyOnWriteBuffer* packet,
                         const rtc::PacketTime& packet_time) override;
-  void OnRtcpReceived(rtc::Buffer* packet,
+  void OnRtcpReceived(rtc::CopyOnWriteBuffer* packet,
                       const rtc::PacketTime& packet_time) override;
   void OnReadyToSend(bool ready) override {}
   bool GetStats(VoiceMediaInfo* info) override;
@@ -226,14 +226,14 @@ class WebRtcVoiceMediaChannel : public VoiceMediaChannel,
   bool SendRtp(const uint8_t* data,
                size_t len,
                const webrtc::PacketOptions& options) override {
-    rtc::Buffer packet(reinterpret_cast<const uint8_t*>(data), len,
-                       kMaxRtpPacketLen);
+    rtc::CopyOnWriteBuffer packet(reinterpret_cast<const uint8_t*>(data), len,
+                                  kMaxRtpPacketLen, kRtpPacketHeadroom);
     return VoiceMediaChannel::SendPacket(&packet);
   }
 
   bool SendRtcp(const uint8_t* data, size_t len) override {
-    rtc::Buffer packet(reinterpret_cast<const uint8_t*>(data), len,
-                       kMaxRtpPacketLen);
+    rtc::CopyOnWriteBuffer packet(reinterpret_cast<const uint8_t*>(data), len,
+                                  kMaxRtpPacketLen, kRtpPacketHeadroom);
     return VoiceMediaChannel::SendRtcp(&packet);
   }
 
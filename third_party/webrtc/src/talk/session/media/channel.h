@@ -84,6 +84,11 @@ class BaseChannel
               bool rtcp);
   virtual ~BaseChannel();
   bool Init();
+  // Offers the AEAD_AES_*_GCM suites, ahead of AES-CM, when negotiating
+  // DTLS-SRTP. Must be called before Init().
+  void set_gcm_crypto_suites_enabled(bool enable) {
+    gcm_crypto_suites_enabled_ = enable;
+  }
   // Deinit may be called multiple times and is simply ignored if it's alreay
   // done.
   void Deinit();
@@ -198,9 +203,9 @@ class BaseChannel
   void FlushRtcpMessages();
 
   // NetworkInterface implementation, called by MediaEngine
-  virtual bool SendPacket(rtc::Buffer* packet,
+  virtual bool SendPacket(rtc::CopyOnWriteBuffer* packet,
                           rtc::DiffServCodePoint dscp);
-  virtual bool SendRtcp(rtc::Buffer* packet,
+  virtual bool SendRtcp(rtc::CopyOnWriteBuffer* packet,
                         rtc::DiffServCodePoint dscp);
 
   // From TransportChannel
@@ -214,10 +219,10 @@ class BaseChannel
 
   bool PacketIsRtcp(const TransportChannel* channel, const char* data,
                     size_t len);
-  bool SendPacket(bool rtcp, rtc::Buffer* packet,
+  bool SendPacket(bool rtcp, rtc::CopyOnWriteBuffer* packet,
                   rtc::DiffServCodePoint dscp);
-  virtual bool WantsPacket(bool rtcp, rtc::Buffer* packet);
-  void HandlePacket(bool rtcp, rtc::Buffer* packet,
+  virtual bool WantsPacket(bool rtcp, rtc::CopyOnWriteBuffer* packet);
+  void HandlePacket(bool rtcp, rtc::CopyOnWriteBuffer* packet,
                     const rtc::PacketTime& packet_time);
 
   void EnableMedia_w();
@@ -320,7 +325,12 @@ class BaseChannel
   bool has_received_packet_;
   bool dtls_keyed_;
   bool secure_required_;
+  bool gcm_crypto_suites_enabled_;
   int rtp_abs_sendtime_extn_id_;
+  // Received packets are unprotected in place, so they are copied out of the
+  // transport's buffer. The storage is reused unless the media channel kept a
+  // reference to the previous packet.
+  rtc::CopyOnWriteBuffer recv_packet_;
 };
 
 // VoiceChannel is a specialization that adds support for early media, DTMF,
@@ -532,6 +542,11 @@ class DataChannel : public BaseChannel {
               bool rtcp);
   ~DataChannel();
   bool Init();
+  // Options passed to the media channel along with the send parameters, once
+  // the remote description is set. Must be called before that.
+  void set_options(const DataOptions& options) {
+    last_send_params_.options = options;
+  }
 
   virtual bool SendData(const SendDataParams& params,
                         const rtc::Buffer& payload,
@@ -615,7 +630,7 @@ class DataChannel : public BaseChannel {
                                   ContentAction action,
                                   std::string* error_desc);
   virtual void ChangeState();
-  virtual bool WantsPacket(bool rtcp, rtc::Buffer* packet);
+  virtual bool WantsPacket(bool rtcp, rtc::CopyOnWriteBuffer* packet);
 
   virtual void OnMessage(rtc::Message* pmsg);
   virtual void GetSrtpCryptoSuiteNames(std::vector<std::string>* ciphers) const;
@@ -25,6 +25,8 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdlib.h>
+
 #include "talk/media/base/fakemediaengine.h"
 #include "talk/media/base/fakertp.h"
 #include "talk/media/base/fakescreencapturerfactory.h"
@@ -35,14 +37,17 @@
 #include "talk/media/base/testutils.h"
 #include "webrtc/p2p/base/faketransportcontroller.h"
 #include "talk/session/media/channel.h"
+#include "webrtc/base/checks.h"
 #include "webrtc/base/fileutils.h"
 #include "webrtc/base/gunit.h"
 #include "webrtc/base/helpers.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/pathutils.h"
+#include "webrtc/base/platform_thread.h"
 #include "webrtc/base/signalthread.h"
 #include "webrtc/base/ssladapter.h"
 #include "webrtc/base/sslidentity.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/base/window.h"
 
 #define MAYBE_SKIP_TEST(feature)                    \
@@ -73,6 +78,37 @@ static const uint32 kSsrc3 = 0x3333;
 static const int kAudioPts[] = {0, 8};
 static const int kVideoPts[] = {97, 99};
 
+// Heap allocations made on |g_allocation_thread| while |g_count_allocations|
+// is set, so a test can count the allocations a code path really makes,
+// without those of other threads in the binary.
+static volatile bool g_count_allocations = false;
+static rtc::PlatformThreadRef g_allocation_thread;
+static int g_num_allocations = 0;
+
+static void StartCountingAllocations() {
+  g_allocation_thread = rtc::CurrentThreadRef();
+  g_num_allocations = 0;
+  g_count_allocations = true;
+}
+
+static void StopCountingAllocations() {
+  g_count_allocations = false;
+}
+
+void* operator new(size_t size) {
+  if (g_count_allocations &&
+      rtc::IsThreadRefEqual(rtc::CurrentThreadRef(), g_allocation_thread)) {
+    ++g_num_allocations;
+  }
+  void* ptr = malloc(size ? size : 1);
+  RTC_CHECK(ptr);
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
 template <class ChannelT,
           class MediaChannelT,
           class ContentT,
@@ -139,7 +175,8 @@ class ChannelTest : public testing::Test, public sigslot::has_slots<> {
         rtp_packet_(reinterpret_cast<const char*>(rtp_data), rtp_len),
         rtcp_packet_(reinterpret_cast<const char*>(rtcp_data), rtcp_len),
         media_info_callbacks1_(),
-        media_info_callbacks2_() {}
+        media_info_callbacks2_(),
+        last_read_packet_(NULL) {}
 
   void CreateChannels(int flags1, int flags2) {
     CreateChannels(new typename T::MediaChannel(NULL, typename T::Options()),
@@ -967,6 +1004,87 @@ class ChannelTest : public testing::Test, public sigslot::has_slots<> {
     EXPECT_TRUE(SendTerminate());
   }
 
+  // Sends SRTP packets through the channels and the transport and counts the
+  // copies and heap allocations on the way. The packet the engine writes is
+  // protected in place and handed to the transport as it is, and the
+  // receiving side unprotects into a buffer that it reuses, so the engine's
+  // packet is the only allocation per packet.
+  void TestPacketPathAllocations() {
+    class CountingMediaChannel : public T::MediaChannel {
+     public:
+      CountingMediaChannel()
+          : T::MediaChannel(NULL, typename T::Options()), num_received_(0) {}
+      void OnPacketReceived(rtc::CopyOnWriteBuffer* packet,
+                            const rtc::PacketTime& packet_time) override {
+        ++num_received_;
+      }
+      int num_received() const { return num_received_; }
+
+     private:
+      int num_received_;
+    };
+    const int kNumPackets = 10000;
+    CountingMediaChannel* media_channel2 = new CountingMediaChannel();
+    CreateChannels(new CountingMediaChannel(), media_channel2,
+                   RTCP | RTCP_MUX | SECURE, RTCP | RTCP_MUX | SECURE,
+                   rtc::Thread::Current());
+    EXPECT_TRUE(SendInitiate());
+    EXPECT_TRUE(SendAccept());
+    EXPECT_TRUE(channel1_->secure());
+    EXPECT_TRUE(channel2_->secure());
+    channel2_->transport_channel()->SignalReadPacket.connect(
+        this, &ChannelTest<T>::OnTransportReadPacket);
+
+    // The first packet sets up the SRTP streams and the receive buffer.
+    std::string rtp(CreateRtpData(kSsrc1, 0, -1));
+    EXPECT_TRUE(media_channel1_->SendRtp(rtp.data(),
+                                         static_cast<int>(rtp.size())));
+    StartCountingAllocations();
+    {
+      rtc::CopyOnWriteBuffer packet(reinterpret_cast<const uint8_t*>(
+                                        rtp.data()), rtp.size(),
+                                    cricket::kMaxRtpPacketLen,
+                                    cricket::kRtpPacketHeadroom);
+    }
+    StopCountingAllocations();
+    const int packet_allocations = g_num_allocations;
+
+    int copies = 0;
+    uint32 start = rtc::Time();
+    StartCountingAllocations();
+    for (int i = 1; i <= kNumPackets; ++i) {
+      rtc::SetBE16(&rtp[2], static_cast<uint16>(i));
+      rtc::CopyOnWriteBuffer packet(reinterpret_cast<const uint8_t*>(
+                                        rtp.data()), rtp.size(),
+                                    cricket::kMaxRtpPacketLen,
+                                    cricket::kRtpPacketHeadroom);
+      const char* written = packet.cdata<char>();
+      EXPECT_TRUE(media_channel1_->SendPacket(&packet));
+      if (last_read_packet_ != written) {
+        ++copies;
+      }
+    }
+    StopCountingAllocations();
+    int elapsed_ms = rtc::TimeSince(start);
+
+    EXPECT_EQ(kNumPackets + 1, media_channel2->num_received());
+    EXPECT_EQ(0, copies);
+    EXPECT_EQ(kNumPackets * packet_allocations, g_num_allocations);
+    LOG(LS_INFO) << kNumPackets << " SRTP packets of " << rtp.size()
+                 << " bytes in " << elapsed_ms << " ms, "
+                 << static_cast<double>(copies) / kNumPackets
+                 << " copies and "
+                 << static_cast<double>(g_num_allocations) / kNumPackets
+                 << " allocations per packet sent and received, "
+                 << packet_allocations << " of them by the engine";
+  }
+
+  void OnTransportReadPacket(TransportChannel* channel, const char* data,
+                             size_t len, const rtc::PacketTime& packet_time,
+                             int flags) {
+    last_read_packet_ = data;
+  }
+
   // Send voice RTP data to the other side and ensure it gets there.
   void SendRtpToRtp() {
     CreateChannels(0, 0);
@@ -1803,6 +1921,8 @@ class ChannelTest : public testing::Test, public sigslot::has_slots<> {
   std::string rtcp_packet_;
   int media_info_callbacks1_;
   int media_info_callbacks2_;
+  // The last packet delivered by the transport to |channel2_|.
+  const char* last_read_packet_;
 };
 
 template<>
@@ -2005,6 +2125,10 @@ TEST_F(VoiceChannelTest, TestCallTeardownRtcpMux) {
   Base::TestCallTeardownRtcpMux();
 }
 
+TEST_F(VoiceChannelTest, TestPacketPathAllocations) {
+  Base::TestPacketPathAllocations();
+}
+
 TEST_F(VoiceChannelTest, SendRtpToRtp) {
   Base::SendRtpToRtp();
 }
@@ -2377,6 +2501,10 @@ TEST_F(VideoChannelTest, TestCallTeardownRtcpMux) {
   Base::TestCallTeardownRtcpMux();
 }
 
+TEST_F(VideoChannelTest, TestPacketPathAllocations) {
+  Base::TestPacketPathAllocations();
+}
+
 TEST_F(VideoChannelTest, SendRtpToRtp) {
   Base::SendRtpToRtp();
 }
@@ -107,6 +107,7 @@ void ChannelManager::Construct(MediaEngineInterface* me,
   local_renderer_ = NULL;
   capturing_ = false;
   enable_rtx_ = false;
+  enable_gcm_crypto_suites_ = false;
 
   capture_manager_->SignalCapturerStateChange.connect(
       this, &ChannelManager::OnVideoCaptureStateChange);
@@ -286,6 +287,7 @@ VoiceChannel* ChannelManager::CreateVoiceChannel_w(
   VoiceChannel* voice_channel =
       new VoiceChannel(worker_thread_, media_engine_.get(), media_channel,
                        transport_controller, content_name, rtcp);
+  voice_channel->set_gcm_crypto_suites_enabled(enable_gcm_crypto_suites_);
   if (!voice_channel->Init()) {
     delete voice_channel;
     return nullptr;
@@ -342,6 +344,7 @@ VideoChannel* ChannelManager::CreateVideoChannel_w(
 
   VideoChannel* video_channel = new VideoChannel(
       worker_thread_, media_channel, transport_controller, content_name, rtcp);
+  video_channel->set_gcm_crypto_suites_enabled(enable_gcm_crypto_suites_);
   if (!video_channel->Init()) {
     delete video_channel;
     return NULL;
@@ -375,17 +378,19 @@ DataChannel* ChannelManager::CreateDataChannel(
     TransportController* transport_controller,
     const std::string& content_name,
     bool rtcp,
-    DataChannelType channel_type) {
+    DataChannelType channel_type,
+    const DataOptions& options) {
   return worker_thread_->Invoke<DataChannel*>(
       Bind(&ChannelManager::CreateDataChannel_w, this, transport_controller,
-           content_name, rtcp, channel_type));
+           content_name, rtcp, channel_type, options));
 }
 
 DataChannel* ChannelManager::CreateDataChannel_w(
     TransportController* transport_controller,
     const std::string& content_name,
     bool rtcp,
-    DataChannelType data_channel_type) {
+    DataChannelType data_channel_type,
+    const DataOptions& options) {
   // This is ok to alloc from a thread other than the worker thread.
   ASSERT(initialized_);
   DataMediaChannel* media_channel = data_media_engine_->CreateChannel(
@@ -398,6 +403,8 @@ DataChannel* ChannelManager::CreateDataChannel_w(
 
   DataChannel* data_channel = new DataChannel(
       worker_thread_, media_channel, transport_controller, content_name, rtcp);
+  data_channel->set_gcm_crypto_suites_enabled(enable_gcm_crypto_suites_);
+  data_channel->set_options(options);
   if (!data_channel->Init()) {
     LOG(LS_WARNING) << "Failed to init data channel.";
     delete data_channel;
@@ -119,7 +119,8 @@ class ChannelManager : public rtc::MessageHandler,
   DataChannel* CreateDataChannel(TransportController* transport_controller,
                                  const std::string& content_name,
                                  bool rtcp,
-                                 DataChannelType data_channel_type);
+                                 DataChannelType data_channel_type,
+                                 const DataOptions& options);
   // Destroys a data channel created with the Create API.
   void DestroyDataChannel(DataChannel* data_channel);
 
@@ -134,6 +135,11 @@ class ChannelManager : public rtc::MessageHandler,
   // RTX will be enabled/disabled in engines that support it. The supporting
   // engines will start offering an RTX codec. Must be called before Init().
   bool SetVideoRtxEnabled(bool enable);
+  // Lets channels created from now on negotiate the AES-GCM SRTP suites with
+  // DTLS-SRTP.
+  void SetGcmCryptoSuitesEnabled(bool enable) {
+    enable_gcm_crypto_suites_ = enable;
+  }
 
   // Starts/stops the local microphone and enables polling of the input level.
   bool capturing() const { return capturing_; }
@@ -207,7 +213,8 @@ class ChannelManager : public rtc::MessageHandler,
   DataChannel* CreateDataChannel_w(TransportController* transport_controller,
                                    const std::string& content_name,
                                    bool rtcp,
-                                   DataChannelType data_channel_type);
+                                   DataChannelType data_channel_type,
+                                   const DataOptions& options);
   void DestroyDataChannel_w(DataChannel* data_channel);
   bool SetAudioOptions_w(const AudioOptions& options,
                          const Device* in_dev, const Device* out_dev);
@@ -235,6 +242,7 @@ class ChannelManager : public rtc::MessageHandler,
   VideoEncoderConfig default_video_encoder_config_;
   VideoRenderer* local_renderer_;
   bool enable_rtx_;
+  bool enable_gcm_crypto_suites_;
 
   bool capturing_;
 };
@@ -139,7 +139,8 @@ TEST_F(ChannelManagerTest, CreateDestroyChannels) {
                               cricket::CN_VIDEO, false, VideoOptions());
   EXPECT_TRUE(video_channel != nullptr);
   cricket::DataChannel* data_channel = cm_->CreateDataChannel(
-      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP);
+      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP,
+      cricket::DataOptions());
   EXPECT_TRUE(data_channel != nullptr);
   cm_->DestroyVideoChannel(video_channel);
   cm_->DestroyVoiceChannel(voice_channel);
@@ -164,7 +165,8 @@ TEST_F(ChannelManagerTest, CreateDestroyChannelsOnThread) {
                               cricket::CN_VIDEO, false, VideoOptions());
   EXPECT_TRUE(video_channel != nullptr);
   cricket::DataChannel* data_channel = cm_->CreateDataChannel(
-      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP);
+      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP,
+      cricket::DataOptions());
   EXPECT_TRUE(data_channel != nullptr);
   cm_->DestroyVideoChannel(video_channel);
   cm_->DestroyVoiceChannel(voice_channel);
@@ -191,7 +193,8 @@ TEST_F(ChannelManagerTest, NoTransportChannelTest) {
                               cricket::CN_VIDEO, false, VideoOptions());
   EXPECT_TRUE(video_channel == nullptr);
   cricket::DataChannel* data_channel = cm_->CreateDataChannel(
-      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP);
+      transport_controller_, cricket::CN_DATA, false, cricket::DCT_RTP,
+      cricket::DataOptions());
   EXPECT_TRUE(data_channel == nullptr);
   cm_->Terminate();
 }
@@ -176,6 +176,13 @@ void GetDefaultSrtpCryptoSuiteNames(std::vector<std::string>* crypto_suites) {
 #endif
 }
 
+void GetGcmCryptoSuiteNames(std::vector<std::string>* crypto_suites) {
+#ifdef HAVE_SRTP
+  crypto_suites->push_back(rtc::CS_AEAD_AES_256_GCM);
+  crypto_suites->push_back(rtc::CS_AEAD_AES_128_GCM);
+#endif
+}
+
 // For video support only 80-bit SHA1 HMAC. For audio 32-bit HMAC is
 // tolerated unless bundle is enabled because it is low overhead. Pick the
 // crypto in the list that is supported.
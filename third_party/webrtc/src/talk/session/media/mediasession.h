@@ -551,6 +551,9 @@ void GetSupportedAudioCryptoSuites(std::vector<std::string>* crypto_suites);
 void GetSupportedVideoCryptoSuites(std::vector<std::string>* crypto_suites);
 void GetSupportedDataCryptoSuites(std::vector<std::string>* crypto_suites);
 void GetDefaultSrtpCryptoSuiteNames(std::vector<std::string>* crypto_suites);
+// The RFC 7714 AEAD suites, in order of preference. Only negotiated with
+// DTLS-SRTP, and only when enabled.
+void GetGcmCryptoSuiteNames(std::vector<std::string>* crypto_suites);
 }  // namespace cricket
 
 #endif  // TALK_SESSION_MEDIA_MEDIASESSION_H_
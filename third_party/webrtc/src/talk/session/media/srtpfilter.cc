@@ -31,8 +31,6 @@
 
 #include <string.h>
 
-#include <algorithm>
-
 #include "talk/media/base/rtputils.h"
 #include "webrtc/base/base64.h"
 #include "webrtc/base/byteorder.h"
@@ -248,6 +246,24 @@ bool SrtpFilter::UnprotectRtp(void* p, int in_len, int* out_len) {
   return recv_session_->UnprotectRtp(p, in_len, out_len);
 }
 
+size_t SrtpFilter::ProtectRtp(SrtpPacket* packets, size_t count) {
+  if (!IsActive()) {
+    LOG(LS_WARNING) << "Failed to ProtectRtp: SRTP not active";
+    return 0;
+  }
+  ASSERT(send_session_ != NULL);
+  return send_session_->ProtectRtp(packets, count);
+}
+
+size_t SrtpFilter::UnprotectRtp(SrtpPacket* packets, size_t count) {
+  if (!IsActive()) {
+    LOG(LS_WARNING) << "Failed to UnprotectRtp: SRTP not active";
+    return 0;
+  }
+  ASSERT(recv_session_ != NULL);
+  return recv_session_->UnprotectRtp(packets, count);
+}
+
 bool SrtpFilter::UnprotectRtcp(void* p, int in_len, int* out_len) {
   if (!IsActive()) {
     LOG(LS_WARNING) << "Failed to UnprotectRtcp: SRTP not active";
@@ -473,7 +489,7 @@ bool SrtpFilter::ParseKeyParams(const std::string& key_params,
 
 bool SrtpSession::inited_ = false;
 
-// This lock protects SrtpSession::inited_ and SrtpSession::sessions_.
+// This lock protects SrtpSession::inited_.
 rtc::GlobalLockPod SrtpSession::lock_;
 
 SrtpSession::SrtpSession()
@@ -482,18 +498,10 @@ SrtpSession::SrtpSession()
       rtcp_auth_tag_len_(0),
       srtp_stat_(new SrtpStat()),
       last_send_seq_num_(-1) {
-  {
-    rtc::GlobalLockScope ls(&lock_);
-    sessions()->push_back(this);
-  }
   SignalSrtpError.repeat(srtp_stat_->SignalSrtpError);
 }
 
 SrtpSession::~SrtpSession() {
-  {
-    rtc::GlobalLockScope ls(&lock_);
-    sessions()->erase(std::find(sessions()->begin(), sessions()->end(), this));
-  }
   if (session_) {
     srtp_dealloc(session_);
   }
@@ -546,6 +554,48 @@ bool SrtpSession::ProtectRtp(void* p, int in_len, int max_len, int* out_len,
   return (index) ? GetSendStreamPacketIndex(p, in_len, index) : true;
 }
 
+size_t SrtpSession::ProtectRtp(SrtpPacket* packets, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    packets[i].ok = false;
+  }
+  if (!session_) {
+    LOG(LS_WARNING) << "Failed to protect SRTP packets: no SRTP Session";
+    return 0;
+  }
+
+  size_t succeeded = 0;
+  const SrtpPacket* last = NULL;
+  for (size_t i = 0; i < count; ++i) {
+    SrtpPacket& packet = packets[i];
+    int need_len = packet.len + rtp_auth_tag_len_;
+    if (packet.max_len < need_len) {
+      LOG(LS_WARNING) << "Failed to protect SRTP packet: The buffer length "
+                      << packet.max_len << " is less than the needed "
+                      << need_len;
+      continue;
+    }
+    int in_len = packet.len;
+    int err = srtp_protect(session_, packet.data, &packet.len);
+    if (err != err_status_ok) {
+      // Successes don't change the stats, so only failures are reported.
+      uint32 ssrc;
+      if (GetRtpSsrc(packet.data, in_len, &ssrc)) {
+        srtp_stat_->AddProtectRtpResult(ssrc, err);
+      }
+      LOG(LS_WARNING) << "Failed to protect SRTP packet, err=" << err
+                      << ", last seqnum=" << last_send_seq_num_;
+      continue;
+    }
+    packet.ok = true;
+    last = &packet;
+    ++succeeded;
+  }
+  if (last) {
+    GetRtpSeqNum(last->data, last->len, &last_send_seq_num_);
+  }
+  return succeeded;
+}
+
 bool SrtpSession::ProtectRtcp(void* p, int in_len, int max_len, int* out_len) {
   if (!session_) {
     LOG(LS_WARNING) << "Failed to protect SRTCP packet: no SRTP Session";
@@ -588,6 +638,36 @@ bool SrtpSession::UnprotectRtp(void* p, int in_len, int* out_len) {
   return true;
 }
 
+size_t SrtpSession::UnprotectRtp(SrtpPacket* packets, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    packets[i].ok = false;
+  }
+  if (!session_) {
+    LOG(LS_WARNING) << "Failed to unprotect SRTP packets: no SRTP Session";
+    return 0;
+  }
+
+  size_t succeeded = 0;
+  for (size_t i = 0; i < count; ++i) {
+    SrtpPacket& packet = packets[i];
+    int in_len = packet.len;
+    int err = srtp_unprotect(session_, packet.data, &packet.len);
+    if (err != err_status_ok) {
+      // Successes don't change the stats, so only failures are reported.
+      uint32 ssrc;
+      if (GetRtpSsrc(packet.data, in_len, &ssrc)) {
+        srtp_stat_->AddUnprotectRtpResult(ssrc, err);
+      }
+      LOG(LS_WARNING) << "Failed to unprotect SRTP packet, err=" << err;
+      packet.len = in_len;
+      continue;
+    }
+    packet.ok = true;
+    ++succeeded;
+  }
+  return succeeded;
+}
+
 bool SrtpSession::UnprotectRtcp(void* p, int in_len, int* out_len) {
   if (!session_) {
     LOG(LS_WARNING) << "Failed to unprotect SRTCP packet: no SRTP Session";
@@ -667,13 +747,22 @@ bool SrtpSession::SetKey(int type, const std::string& cs,
   } else if (cs == rtc::CS_AES_CM_128_HMAC_SHA1_32) {
     crypto_policy_set_aes_cm_128_hmac_sha1_32(&policy.rtp);   // rtp is 32,
     crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);  // rtcp still 80
+  } else if (cs == rtc::CS_AEAD_AES_128_GCM) {
+    crypto_policy_set_aes_gcm_128_16_auth(&policy.rtp);
+    crypto_policy_set_aes_gcm_128_16_auth(&policy.rtcp);
+  } else if (cs == rtc::CS_AEAD_AES_256_GCM) {
+    crypto_policy_set_aes_gcm_256_16_auth(&policy.rtp);
+    crypto_policy_set_aes_gcm_256_16_auth(&policy.rtcp);
   } else {
     LOG(LS_WARNING) << "Failed to create SRTP session: unsupported"
                     << " cipher_suite " << cs.c_str();
     return false;
   }
 
-  if (!key || len != SRTP_MASTER_KEY_LEN) {
+  int key_len;
+  int salt_len;
+  if (!rtc::GetSrtpKeyAndSaltLengths(cs, &key_len, &salt_len) || !key ||
+      len != key_len + salt_len) {
     LOG(LS_WARNING) << "Failed to create SRTP session: invalid key";
     return false;
   }
@@ -702,7 +791,7 @@ bool SrtpSession::SetKey(int type, const std::string& cs,
     LOG(LS_ERROR) << "Failed to create SRTP session, err=" << err;
     return false;
   }
-
+  srtp_set_user_data(session_, this);
 
   rtp_auth_tag_len_ = policy.rtp.auth_tag_len;
   rtcp_auth_tag_len_ = policy.rtcp.auth_tag_len;
@@ -772,22 +861,14 @@ void SrtpSession::HandleEvent(const srtp_event_data_t* ev) {
 }
 
 void SrtpSession::HandleEventThunk(srtp_event_data_t* ev) {
-  rtc::GlobalLockScope ls(&lock_);
-
-  for (std::list<SrtpSession*>::iterator it = sessions()->begin();
-       it != sessions()->end(); ++it) {
-    if ((*it)->session_ == ev->session) {
-      (*it)->HandleEvent(ev);
-      break;
-    }
+  // Events are raised from within calls on the session, so it is alive.
+  SrtpSession* session =
+      static_cast<SrtpSession*>(srtp_get_user_data(ev->session));
+  if (session) {
+    session->HandleEvent(ev);
   }
 }
 
-std::list<SrtpSession*>* SrtpSession::sessions() {
-  RTC_DEFINE_STATIC_LOCAL(std::list<SrtpSession*>, sessions, ());
-  return &sessions;
-}
-
 #else   // !HAVE_SRTP
 
 // On some systems, SRTP is not (yet) available.
@@ -825,6 +906,16 @@ bool SrtpSession::UnprotectRtcp(void* data, int in_len, int* out_len) {
   return SrtpNotAvailable(__FUNCTION__);
 }
 
+size_t SrtpSession::ProtectRtp(SrtpPacket* packets, size_t count) {
+  SrtpNotAvailable(__FUNCTION__);
+  return 0;
+}
+
+size_t SrtpSession::UnprotectRtp(SrtpPacket* packets, size_t count) {
+  SrtpNotAvailable(__FUNCTION__);
+  return 0;
+}
+
 void SrtpSession::set_signal_silent_time(uint32 signal_silent_time) {
   // Do nothing.
 }
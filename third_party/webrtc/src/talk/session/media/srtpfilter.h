@@ -28,7 +28,6 @@
 #ifndef TALK_SESSION_MEDIA_SRTPFILTER_H_
 #define TALK_SESSION_MEDIA_SRTPFILTER_H_
 
-#include <list>
 #include <map>
 #include <string>
 #include <vector>
@@ -58,6 +57,22 @@ extern const int SRTP_MASTER_KEY_SALT_LEN;
 class SrtpSession;
 class SrtpStat;
 
+// A packet passed to the batch versions of Protect/UnprotectRtp.
+struct SrtpPacket {
+  SrtpPacket() : data(NULL), len(0), max_len(0), ok(false) {}
+  SrtpPacket(void* data, int len, int max_len)
+      : data(data), len(len), max_len(max_len), ok(false) {}
+
+  void* data;
+  // Length of the packet, updated in place.
+  int len;
+  // Size of the buffer at |data|. Only used when protecting, which may grow
+  // the packet.
+  int max_len;
+  // Set by the batch call if the packet was processed successfully.
+  bool ok;
+};
+
 void EnableSrtpDebugging();
 void ShutdownSrtp();
 
@@ -124,6 +139,11 @@ class SrtpFilter {
   // If an HMAC is used, this will decrease the packet size.
   bool UnprotectRtp(void* data, int in_len, int* out_len);
   bool UnprotectRtcp(void* data, int in_len, int* out_len);
+  // Batch versions of ProtectRtp/UnprotectRtp, for a burst of packets.
+  // Every packet is processed even if an earlier one fails. Returns the
+  // number of packets that succeeded.
+  size_t ProtectRtp(SrtpPacket* packets, size_t count);
+  size_t UnprotectRtp(SrtpPacket* packets, size_t count);
 
   // Returns rtp auth params from srtp context.
   bool GetRtpAuthParams(uint8** key, int* key_len, int* tag_len);
@@ -208,6 +228,9 @@ class SrtpSession {
   // If an HMAC is used, this will decrease the packet size.
   bool UnprotectRtp(void* data, int in_len, int* out_len);
   bool UnprotectRtcp(void* data, int in_len, int* out_len);
+  // Batch versions of the above, see SrtpFilter.
+  size_t ProtectRtp(SrtpPacket* packets, size_t count);
+  size_t UnprotectRtp(SrtpPacket* packets, size_t count);
 
   // Helper method to get authentication params.
   bool GetRtpAuthParams(uint8** key, int* key_len, int* tag_len);
@@ -228,10 +251,10 @@ class SrtpSession {
 
   static bool Init();
   void HandleEvent(const srtp_event_data_t* ev);
+  // Finds the session an event is for through the libsrtp user data, which
+  // points back to the SrtpSession.
   static void HandleEventThunk(srtp_event_data_t* ev);
 
-  static std::list<SrtpSession*>* sessions();
-
   srtp_ctx_t* session_;
   int rtp_auth_tag_len_;
   int rtcp_auth_tag_len_;
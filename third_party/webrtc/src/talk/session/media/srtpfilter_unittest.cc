@@ -31,7 +31,9 @@
 #include "talk/session/media/srtpfilter.h"
 #include "webrtc/base/byteorder.h"
 #include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 extern "C" {
 #ifdef SRTP_RELATIVE_PATH
 #include "crypto/include/err.h"
@@ -42,6 +44,8 @@ extern "C" {
 
 using rtc::CS_AES_CM_128_HMAC_SHA1_80;
 using rtc::CS_AES_CM_128_HMAC_SHA1_32;
+using rtc::CS_AEAD_AES_128_GCM;
+using rtc::CS_AEAD_AES_256_GCM;
 using cricket::CryptoParams;
 using cricket::CS_LOCAL;
 using cricket::CS_REMOTE;
@@ -49,6 +53,16 @@ using cricket::CS_REMOTE;
 static const uint8 kTestKey1[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234";
 static const uint8 kTestKey2[] = "4321ZYXWVUTSRQPONMLKJIHGFEDCBA";
 static const int kTestKeyLen = 30;
+static const uint8 kTestKeyGcm128_1[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ12";
+static const uint8 kTestKeyGcm128_2[] = "21ZYXWVUTSRQPONMLKJIHGFEDCBA";
+static const int kTestKeyGcm128Len = 28;  // 128 bits key + 96 bits salt.
+static const uint8 kTestKeyGcm256_1[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqr";
+static const uint8 kTestKeyGcm256_2[] =
+    "rqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA";
+static const int kTestKeyGcm256Len = 44;  // 256 bits key + 96 bits salt.
+// Room for the largest auth tag, used by the GCM suites.
+static const int kMaxAuthTagLen = 16;
 static const std::string kTestKeyParams1 =
     "inline:WVNfX19zZW1jdGwgKCkgewkyMjA7fQp9CnVubGVz";
 static const std::string kTestKeyParams2 =
@@ -62,11 +76,16 @@ static const cricket::CryptoParams kTestCryptoParams1(
 static const cricket::CryptoParams kTestCryptoParams2(
     1, "AES_CM_128_HMAC_SHA1_80", kTestKeyParams2, "");
 
+static bool IsGcmCryptoSuite(const std::string& cs) {
+  return cs == CS_AEAD_AES_128_GCM || cs == CS_AEAD_AES_256_GCM;
+}
 static int rtp_auth_tag_len(const std::string& cs) {
+  if (IsGcmCryptoSuite(cs))
+    return 16;
   return (cs == CS_AES_CM_128_HMAC_SHA1_32) ? 4 : 10;
 }
 static int rtcp_auth_tag_len(const std::string& cs) {
-  return 10;
+  return IsGcmCryptoSuite(cs) ? 16 : 10;
 }
 
 class SrtpFilterTest : public testing::Test {
@@ -92,9 +111,9 @@ class SrtpFilterTest : public testing::Test {
     EXPECT_TRUE(f2_.IsActive());
   }
   void TestProtectUnprotect(const std::string& cs1, const std::string& cs2) {
-    char rtp_packet[sizeof(kPcmuFrame) + 10];
+    char rtp_packet[sizeof(kPcmuFrame) + kMaxAuthTagLen];
     char original_rtp_packet[sizeof(kPcmuFrame)];
-    char rtcp_packet[sizeof(kRtcpReport) + 4 + 10];
+    char rtcp_packet[sizeof(kRtcpReport) + 4 + kMaxAuthTagLen];
     int rtp_len = sizeof(kPcmuFrame), rtcp_len = sizeof(kRtcpReport), out_len;
     memcpy(rtp_packet, kPcmuFrame, rtp_len);
     // In order to be able to run this test function multiple times we can not
@@ -553,6 +572,30 @@ TEST_F(SrtpFilterTest, TestProtect_SetParamsDirect_AES_CM_128_HMAC_SHA1_32) {
 }
 
 // Test directly setting the params with bogus keys
+// Test directly setting the params with AEAD_AES_128_GCM and
+// AEAD_AES_256_GCM, as DTLS-SRTP does.
+TEST_F(SrtpFilterTest, TestProtect_SetParamsDirect_AEAD_AES_GCM) {
+  EXPECT_TRUE(f1_.SetRtpParams(CS_AEAD_AES_128_GCM,
+                               kTestKeyGcm128_1, kTestKeyGcm128Len,
+                               CS_AEAD_AES_128_GCM,
+                               kTestKeyGcm128_2, kTestKeyGcm128Len));
+  EXPECT_TRUE(f2_.SetRtpParams(CS_AEAD_AES_128_GCM,
+                               kTestKeyGcm128_2, kTestKeyGcm128Len,
+                               CS_AEAD_AES_128_GCM,
+                               kTestKeyGcm128_1, kTestKeyGcm128Len));
+  EXPECT_TRUE(f1_.SetRtcpParams(CS_AEAD_AES_256_GCM,
+                                kTestKeyGcm256_1, kTestKeyGcm256Len,
+                                CS_AEAD_AES_256_GCM,
+                                kTestKeyGcm256_2, kTestKeyGcm256Len));
+  EXPECT_TRUE(f2_.SetRtcpParams(CS_AEAD_AES_256_GCM,
+                                kTestKeyGcm256_2, kTestKeyGcm256Len,
+                                CS_AEAD_AES_256_GCM,
+                                kTestKeyGcm256_1, kTestKeyGcm256Len));
+  EXPECT_TRUE(f1_.IsActive());
+  EXPECT_TRUE(f2_.IsActive());
+  TestProtectUnprotect(CS_AEAD_AES_128_GCM, CS_AEAD_AES_128_GCM);
+}
+
 TEST_F(SrtpFilterTest, TestSetParamsKeyTooShort) {
   EXPECT_FALSE(f1_.SetRtpParams(CS_AES_CM_128_HMAC_SHA1_80,
                                 kTestKey1, kTestKeyLen - 1,
@@ -621,8 +664,8 @@ class SrtpSessionTest : public testing::Test {
   }
   cricket::SrtpSession s1_;
   cricket::SrtpSession s2_;
-  char rtp_packet_[sizeof(kPcmuFrame) + 10];
-  char rtcp_packet_[sizeof(kRtcpReport) + 4 + 10];
+  char rtp_packet_[sizeof(kPcmuFrame) + kMaxAuthTagLen];
+  char rtcp_packet_[sizeof(kRtcpReport) + 4 + kMaxAuthTagLen];
   int rtp_len_;
   int rtcp_len_;
 };
@@ -667,6 +710,41 @@ TEST_F(SrtpSessionTest, TestProtect_AES_CM_128_HMAC_SHA1_32) {
   TestUnprotectRtcp(CS_AES_CM_128_HMAC_SHA1_32);
 }
 
+// Test that we can encrypt and decrypt RTP/RTCP using AEAD_AES_128_GCM.
+TEST_F(SrtpSessionTest, TestProtect_AEAD_AES_128_GCM) {
+  EXPECT_TRUE(s1_.SetSend(CS_AEAD_AES_128_GCM, kTestKeyGcm128_1,
+                          kTestKeyGcm128Len));
+  EXPECT_TRUE(s2_.SetRecv(CS_AEAD_AES_128_GCM, kTestKeyGcm128_1,
+                          kTestKeyGcm128Len));
+  TestProtectRtp(CS_AEAD_AES_128_GCM);
+  TestProtectRtcp(CS_AEAD_AES_128_GCM);
+  TestUnprotectRtp(CS_AEAD_AES_128_GCM);
+  TestUnprotectRtcp(CS_AEAD_AES_128_GCM);
+}
+
+// Test that we can encrypt and decrypt RTP/RTCP using AEAD_AES_256_GCM.
+TEST_F(SrtpSessionTest, TestProtect_AEAD_AES_256_GCM) {
+  EXPECT_TRUE(s1_.SetSend(CS_AEAD_AES_256_GCM, kTestKeyGcm256_1,
+                          kTestKeyGcm256Len));
+  EXPECT_TRUE(s2_.SetRecv(CS_AEAD_AES_256_GCM, kTestKeyGcm256_1,
+                          kTestKeyGcm256Len));
+  TestProtectRtp(CS_AEAD_AES_256_GCM);
+  TestProtectRtcp(CS_AEAD_AES_256_GCM);
+  TestUnprotectRtp(CS_AEAD_AES_256_GCM);
+  TestUnprotectRtcp(CS_AEAD_AES_256_GCM);
+}
+
+// Test that the GCM suites reject AES-CM sized keys and vice versa.
+TEST_F(SrtpSessionTest, TestGcmKeyLengths) {
+  EXPECT_FALSE(s1_.SetSend(CS_AEAD_AES_128_GCM, kTestKey1, kTestKeyLen));
+  EXPECT_FALSE(s1_.SetSend(CS_AEAD_AES_256_GCM, kTestKeyGcm128_1,
+                           kTestKeyGcm128Len));
+  EXPECT_FALSE(s1_.SetSend(CS_AES_CM_128_HMAC_SHA1_80, kTestKeyGcm128_1,
+                           kTestKeyGcm128Len));
+  EXPECT_TRUE(s1_.SetSend(CS_AEAD_AES_256_GCM, kTestKeyGcm256_1,
+                          kTestKeyGcm256Len));
+}
+
 TEST_F(SrtpSessionTest, TestGetSendStreamPacketIndex) {
   EXPECT_TRUE(s1_.SetSend(CS_AES_CM_128_HMAC_SHA1_32, kTestKey1, kTestKeyLen));
   int64 index;
@@ -705,9 +783,98 @@ TEST_F(SrtpSessionTest, TestBuffersTooSmall) {
   int out_len;
   EXPECT_TRUE(s1_.SetSend(CS_AES_CM_128_HMAC_SHA1_80, kTestKey1, kTestKeyLen));
   EXPECT_FALSE(s1_.ProtectRtp(rtp_packet_, rtp_len_,
-                              sizeof(rtp_packet_) - 10, &out_len));
+                              rtp_len_ + 9, &out_len));
   EXPECT_FALSE(s1_.ProtectRtcp(rtcp_packet_, rtcp_len_,
-                               sizeof(rtcp_packet_) - 14, &out_len));
+                               rtcp_len_ + 4 + 9, &out_len));
+}
+
+// Test that a batch of RTP packets can be protected and unprotected in one
+// call, and that failures are reported per packet.
+TEST_F(SrtpSessionTest, TestProtectBatch) {
+  static const size_t kNumPackets = 8;
+  EXPECT_TRUE(s1_.SetSend(CS_AES_CM_128_HMAC_SHA1_80, kTestKey1, kTestKeyLen));
+  EXPECT_TRUE(s2_.SetRecv(CS_AES_CM_128_HMAC_SHA1_80, kTestKey1, kTestKeyLen));
+
+  char buffers[kNumPackets][sizeof(rtp_packet_)];
+  cricket::SrtpPacket packets[kNumPackets];
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    memcpy(buffers[i], kPcmuFrame, sizeof(kPcmuFrame));
+    rtc::SetBE16(reinterpret_cast<uint8*>(buffers[i]) + 2,
+                 static_cast<uint16>(i + 1));
+    packets[i] = cricket::SrtpPacket(buffers[i], rtp_len_,
+                                     sizeof(buffers[i]));
+  }
+  // No room for the auth tag in the third packet.
+  packets[2].max_len = rtp_len_;
+
+  EXPECT_EQ(kNumPackets - 1, s1_.ProtectRtp(packets, kNumPackets));
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(i != 2, packets[i].ok);
+    EXPECT_EQ(i != 2 ? rtp_len_ + rtp_auth_tag_len(CS_AES_CM_128_HMAC_SHA1_80)
+                     : rtp_len_,
+              packets[i].len);
+  }
+
+  // The third packet isn't encrypted and fails authentication.
+  EXPECT_EQ(kNumPackets - 1, s2_.UnprotectRtp(packets, kNumPackets));
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(i != 2, packets[i].ok);
+    EXPECT_EQ(rtp_len_, packets[i].len);
+    EXPECT_EQ(0, memcmp(buffers[i] + 4, kPcmuFrame + 4, rtp_len_ - 4));
+  }
+}
+
+// Compares protect and unprotect throughput of the supported crypto suites
+// on video-sized RTP packets.
+TEST_F(SrtpSessionTest, ProtectUnprotectPerf) {
+  static const int kNumPackets = 20000;
+  static const int kPayloadLen = 1200;
+  static const struct {
+    const char* cs;
+    const uint8* key;
+    int key_len;
+  } kSuites[] = {
+    {CS_AES_CM_128_HMAC_SHA1_80, kTestKey1, kTestKeyLen},
+    {CS_AES_CM_128_HMAC_SHA1_32, kTestKey1, kTestKeyLen},
+    {CS_AEAD_AES_128_GCM, kTestKeyGcm128_1, kTestKeyGcm128Len},
+    {CS_AEAD_AES_256_GCM, kTestKeyGcm256_1, kTestKeyGcm256Len},
+  };
+
+  char packet[12 + kPayloadLen + kMaxAuthTagLen];
+  for (int i = 0; i < ARRAY_SIZE(kSuites); ++i) {
+    cricket::SrtpSession sender;
+    cricket::SrtpSession receiver;
+    ASSERT_TRUE(sender.SetSend(kSuites[i].cs, kSuites[i].key,
+                               kSuites[i].key_len));
+    ASSERT_TRUE(receiver.SetRecv(kSuites[i].cs, kSuites[i].key,
+                                 kSuites[i].key_len));
+
+    uint64 protect_ns = 0;
+    uint64 unprotect_ns = 0;
+    for (int n = 0; n < kNumPackets; ++n) {
+      memset(packet, 0, sizeof(packet));
+      memcpy(packet, kPcmuFrame, 12);
+      rtc::SetBE16(reinterpret_cast<uint8*>(packet) + 2,
+                   static_cast<uint16>(n));
+      rtc::SetBE32(reinterpret_cast<uint8*>(packet) + 4, n * 3000);
+      int len = 0;
+      uint64 start = rtc::TimeNanos();
+      ASSERT_TRUE(sender.ProtectRtp(packet, 12 + kPayloadLen,
+                                    sizeof(packet), &len));
+      uint64 protected_at = rtc::TimeNanos();
+      ASSERT_TRUE(receiver.UnprotectRtp(packet, len, &len));
+      unprotect_ns += rtc::TimeNanos() - protected_at;
+      protect_ns += protected_at - start;
+      ASSERT_EQ(12 + kPayloadLen, len);
+    }
+    LOG(LS_INFO) << kSuites[i].cs << ": protect "
+                 << protect_ns / kNumPackets << " ns/packet ("
+                 << 8000ULL * kPayloadLen * kNumPackets / protect_ns
+                 << " Mbps), unprotect " << unprotect_ns / kNumPackets
+                 << " ns/packet ("
+                 << 8000ULL * kPayloadLen * kNumPackets / unprotect_ns
+                 << " Mbps)";
+  }
 }
 
 TEST_F(SrtpSessionTest, TestReplay) {
@@ -34,11 +34,16 @@ struct PacketTimeUpdateParams {
 // This structure holds meta information for the packet which is about to send
 // over network.
 struct PacketOptions {
-  PacketOptions() : dscp(DSCP_NO_CHANGE) {}
-  explicit PacketOptions(DiffServCodePoint dscp) : dscp(dscp) {}
+  PacketOptions() : dscp(DSCP_NO_CHANGE), headroom(0) {}
+  explicit PacketOptions(DiffServCodePoint dscp) : dscp(dscp), headroom(0) {}
 
   DiffServCodePoint dscp;
   PacketTimeUpdateParams packet_time_params;
+  // Number of bytes in front of the packet data that the sender owns and that
+  // may be overwritten, so that an encapsulating layer can prepend its header
+  // in place instead of copying the packet. Layers that send anything other
+  // than the data they were handed must clear this.
+  size_t headroom;
 };
 
 // This structure will have the information about when packet is actually
@@ -103,6 +108,12 @@ class AsyncPacketSocket : public sigslot::has_slots<> {
   virtual int GetError() const = 0;
   virtual void SetError(int error) = 0;
 
+  // Returns the number of bytes in front of the data passed to
+  // SignalReadPacket that are part of the socket's receive buffer. A handler
+  // may overwrite them, e.g. to prepend a header and forward the packet
+  // without copying it, but only before the handler returns.
+  virtual size_t GetReceiveHeadroom() const { return 0; }
+
   // Emitted each time a packet is read. Used only for UDP and
   // connected TCP sockets.
   sigslot::signal5<AsyncPacketSocket*, const char*, size_t,
@@ -12,9 +12,13 @@
 
 #include <string.h>
 
+#include <algorithm>
+
+#include "webrtc/base/arraysize.h"
 #include "webrtc/base/byteorder.h"
 #include "webrtc/base/common.h"
 #include "webrtc/base/logging.h"
+#include "webrtc/base/timeutils.h"
 
 #if defined(WEBRTC_POSIX)
 #include <errno.h>
@@ -31,6 +35,12 @@ static const size_t kBufSize = kMaxPacketSize + kPacketLenSize;
 
 static const int kListenBacklog = 5;
 
+// Maximum number of queued packets passed to one gathered send.
+static const size_t kMaxSendPieces = 64;
+
+const size_t AsyncTCPSocketBase::kMinBufferSize;
+const uint32 AsyncTCPSocketBase::kShrinkDelayMs;
+
 // Binds and connects |socket|
 AsyncSocket* AsyncTCPSocketBase::ConnectSocket(
     rtc::AsyncSocket* socket,
@@ -52,12 +62,16 @@ AsyncTCPSocketBase::AsyncTCPSocketBase(AsyncSocket* socket, bool listen,
                                        size_t max_packet_size)
     : socket_(socket),
       listen_(listen),
-      insize_(max_packet_size),
+      max_packet_size_(max_packet_size),
+      insize_(std::min(kMinBufferSize, max_packet_size)),
       inpos_(0),
-      outsize_(max_packet_size),
-      outpos_(0) {
-  inbuf_ = new char[insize_];
-  outbuf_ = new char[outsize_];
+      inend_(0),
+      in_full_time_(0),
+      outpos_(0),
+      outsize_(0) {
+  if (!listen_) {
+    inbuf_.reset(new char[insize_]);
+  }
 
   ASSERT(socket_.get() != NULL);
   socket_->SignalConnectEvent.connect(
@@ -73,10 +87,7 @@ AsyncTCPSocketBase::AsyncTCPSocketBase(AsyncSocket* socket, bool listen,
   }
 }
 
-AsyncTCPSocketBase::~AsyncTCPSocketBase() {
-  delete [] inbuf_;
-  delete [] outbuf_;
-}
+AsyncTCPSocketBase::~AsyncTCPSocketBase() {}
 
 SocketAddress AsyncTCPSocketBase::GetLocalAddress() const {
   return socket_->GetLocalAddress();
@@ -136,39 +147,111 @@ int AsyncTCPSocketBase::SendTo(const void *pv, size_t cb,
   return -1;
 }
 
-int AsyncTCPSocketBase::SendRaw(const void * pv, size_t cb) {
-  if (outpos_ + cb > outsize_) {
-    socket_->SetError(EMSGSIZE);
-    return -1;
+int AsyncTCPSocketBase::SendPacket(const Socket::IoBuffer* pieces,
+                                   size_t count) {
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    size += pieces[i].length;
   }
 
-  memcpy(outbuf_ + outpos_, pv, cb);
-  outpos_ += cb;
-
-  return FlushOutBuffer();
-}
+  if (!out_queue_.empty()) {
+    // We are blocking on send. Queue the packet while there is room, then
+    // silently drop it.
+    if (outsize_ + size <= max_packet_size_) {
+      QueuePacket(pieces, count, 0);
+    }
+    return static_cast<int>(size);
+  }
 
-int AsyncTCPSocketBase::FlushOutBuffer() {
-  int res = socket_->Send(outbuf_, outpos_);
+  int res = socket_->SendGather(pieces, count);
   if (res <= 0) {
+    // Drop the packet if we made no progress.
     return res;
   }
-  if (static_cast<size_t>(res) <= outpos_) {
-    outpos_ -= res;
-  } else {
+  if (static_cast<size_t>(res) < size) {
+    // The rest has to follow, or the stream would be corrupted. Retry right
+    // away; only a send that would block arms the write event.
+    QueuePacket(pieces, count, res);
+    FlushOutQueue();
+  } else if (static_cast<size_t>(res) > size) {
     ASSERT(false);
     return -1;
   }
-  if (outpos_ > 0) {
-    memmove(outbuf_, outbuf_ + res, outpos_);
+  return static_cast<int>(size);
+}
+
+void AsyncTCPSocketBase::QueuePacket(const Socket::IoBuffer* pieces,
+                                     size_t count, size_t skip) {
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    size += pieces[i].length;
+  }
+  ASSERT(skip < size);
+  CopyOnWriteBuffer packet(0, size - skip);
+  for (size_t i = 0; i < count; ++i) {
+    if (skip >= pieces[i].length) {
+      skip -= pieces[i].length;
+      continue;
+    }
+    packet.AppendData(static_cast<const char*>(pieces[i].data) + skip,
+                      pieces[i].length - skip);
+    skip = 0;
+  }
+  outsize_ += packet.size();
+  out_queue_.push_back(packet.Pass());
+}
+
+int AsyncTCPSocketBase::FlushOutQueue() {
+  // Keep sending until the queue is empty or the socket would block, so that
+  // we get a write event once there is room again.
+  int total = 0;
+  while (!out_queue_.empty()) {
+    Socket::IoBuffer pieces[kMaxSendPieces];
+    size_t count = 0;
+    size_t length = 0;
+    for (std::deque<CopyOnWriteBuffer>::const_iterator it = out_queue_.begin();
+         it != out_queue_.end() && count < kMaxSendPieces; ++it, ++count) {
+      size_t offset = (count == 0) ? outpos_ : 0;
+      pieces[count] = Socket::IoBuffer(it->cdata() + offset,
+                                       it->size() - offset);
+      length += it->size() - offset;
+    }
+
+    int res = socket_->SendGather(pieces, count);
+    if (res <= 0) {
+      return (total > 0) ? total : res;
+    }
+    total += res;
+
+    size_t sent = static_cast<size_t>(res);
+    ASSERT(sent <= length);
+    outsize_ -= sent;
+    while (sent > 0) {
+      size_t left = out_queue_.front().size() - outpos_;
+      if (sent < left) {
+        outpos_ += sent;
+        break;
+      }
+      sent -= left;
+      outpos_ = 0;
+      out_queue_.pop_front();
+    }
   }
-  return res;
+  return total;
 }
 
-void AsyncTCPSocketBase::AppendToOutBuffer(const void* pv, size_t cb) {
-  ASSERT(outpos_ + cb < outsize_);
-  memcpy(outbuf_ + outpos_, pv, cb);
-  outpos_ += cb;
+void AsyncTCPSocketBase::ResizeInBuffer(size_t size) {
+  ASSERT(size >= inend_ - inpos_);
+  if (size == insize_) {
+    memmove(inbuf_.get(), inbuf_.get() + inpos_, inend_ - inpos_);
+  } else {
+    scoped_ptr<char[]> inbuf(new char[size]);
+    memcpy(inbuf.get(), inbuf_.get() + inpos_, inend_ - inpos_);
+    inbuf_.swap(inbuf);
+    insize_ = size;
+  }
+  inend_ -= inpos_;
+  inpos_ = 0;
 }
 
 void AsyncTCPSocketBase::OnConnectEvent(AsyncSocket* socket) {
@@ -193,23 +276,52 @@ void AsyncTCPSocketBase::OnReadEvent(AsyncSocket* socket) {
     // Prime a read event in case data is waiting.
     new_socket->SignalReadEvent(new_socket);
   } else {
-    int len = socket_->Recv(inbuf_ + inpos_, insize_ - inpos_);
-    if (len < 0) {
-      // TODO: Do something better like forwarding the error to the user.
-      if (!socket_->IsBlocking()) {
-        LOG(LS_ERROR) << "Recv() returned error: " << socket_->GetError();
+    // Read until the socket is drained; a read that fills the buffer may
+    // leave data behind that won't trigger another read event.
+    bool filled = true;
+    while (filled) {
+      size_t room = insize_ - inend_;
+      int len = socket_->Recv(inbuf_.get() + inend_, room);
+      if (len < 0) {
+        // TODO: Do something better like forwarding the error to the user.
+        if (!socket_->IsBlocking()) {
+          LOG(LS_ERROR) << "Recv() returned error: " << socket_->GetError();
+        }
+        return;
       }
-      return;
-    }
 
-    inpos_ += len;
+      inend_ += len;
+      filled = (len > 0 && static_cast<size_t>(len) == room);
+      if (filled) {
+        in_full_time_ = Time();
+      }
 
-    ProcessInput(inbuf_, &inpos_);
+      inpos_ += ProcessInput(inbuf_.get() + inpos_, inend_ - inpos_);
+      ASSERT(inpos_ <= inend_);
+      if (inpos_ == inend_) {
+        // Everything was consumed; start over at the front without copying.
+        inpos_ = inend_ = 0;
+      }
 
-    if (inpos_ >= insize_) {
-      LOG(LS_ERROR) << "input buffer overflow";
-      ASSERT(false);
-      inpos_ = 0;
+      if (filled && insize_ < max_packet_size_) {
+        // More data is probably waiting, read bigger chunks from now on.
+        // This also makes room for a packet larger than the buffer.
+        ResizeInBuffer(std::min(insize_ * 2, max_packet_size_));
+      } else if (inend_ == 0 && insize_ > kMinBufferSize &&
+                 TimeSince(in_full_time_) >
+                     static_cast<int32>(kShrinkDelayMs)) {
+        // The connection has been quiet for a while.
+        ResizeInBuffer(std::max(insize_ / 2, kMinBufferSize));
+      } else if (inend_ == insize_) {
+        if (inpos_ == 0) {
+          LOG(LS_ERROR) << "input buffer overflow";
+          ASSERT(false);
+          inpos_ = inend_ = 0;
+        } else {
+          // Only the start of a packet is left at the end of the buffer.
+          ResizeInBuffer(insize_);
+        }
+      }
     }
   }
 }
@@ -217,11 +329,11 @@ void AsyncTCPSocketBase::OnReadEvent(AsyncSocket* socket) {
 void AsyncTCPSocketBase::OnWriteEvent(AsyncSocket* socket) {
   ASSERT(socket_.get() == socket);
 
-  if (outpos_ > 0) {
-    FlushOutBuffer();
+  if (!out_queue_.empty()) {
+    FlushOutQueue();
   }
 
-  if (outpos_ == 0) {
+  if (out_queue_.empty()) {
     SignalReadyToSend(this);
   }
 }
@@ -253,18 +365,13 @@ int AsyncTCPSocket::Send(const void *pv, size_t cb,
     return -1;
   }
 
-  // If we are blocking on send, then silently drop this packet
-  if (!IsOutBufferEmpty())
-    return static_cast<int>(cb);
-
   PacketLength pkt_len = HostToNetwork16(static_cast<PacketLength>(cb));
-  AppendToOutBuffer(&pkt_len, kPacketLenSize);
-  AppendToOutBuffer(pv, cb);
-
-  int res = FlushOutBuffer();
+  Socket::IoBuffer pieces[] = {
+    Socket::IoBuffer(&pkt_len, kPacketLenSize),
+    Socket::IoBuffer(pv, cb),
+  };
+  int res = SendPacket(pieces, arraysize(pieces));
   if (res <= 0) {
-    // drop packet if we made no progress
-    ClearOutBuffer();
     return res;
   }
 
@@ -272,25 +379,20 @@ int AsyncTCPSocket::Send(const void *pv, size_t cb,
   return static_cast<int>(cb);
 }
 
-void AsyncTCPSocket::ProcessInput(char * data, size_t* len) {
+size_t AsyncTCPSocket::ProcessInput(const char* data, size_t len) {
   SocketAddress remote_addr(GetRemoteAddress());
 
-  while (true) {
-    if (*len < kPacketLenSize)
-      return;
+  size_t processed = 0;
+  while (len - processed >= kPacketLenSize) {
+    PacketLength pkt_len = rtc::GetBE16(data + processed);
+    if (len - processed < kPacketLenSize + pkt_len)
+      break;
 
-    PacketLength pkt_len = rtc::GetBE16(data);
-    if (*len < kPacketLenSize + pkt_len)
-      return;
-
-    SignalReadPacket(this, data + kPacketLenSize, pkt_len, remote_addr,
-                     CreatePacketTime(0));
-
-    *len -= kPacketLenSize + pkt_len;
-    if (*len > 0) {
-      memmove(data, data + kPacketLenSize + pkt_len, *len);
-    }
+    SignalReadPacket(this, data + processed + kPacketLenSize, pkt_len,
+                     remote_addr, CreatePacketTime(0));
+    processed += kPacketLenSize + pkt_len;
   }
+  return processed;
 }
 
 void AsyncTCPSocket::HandleIncomingConnection(AsyncSocket* socket) {
@@ -11,15 +11,23 @@
 #ifndef WEBRTC_BASE_ASYNCTCPSOCKET_H_
 #define WEBRTC_BASE_ASYNCTCPSOCKET_H_
 
+#include <deque>
+
 #include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/copyonwritebuffer.h"
 #include "webrtc/base/scoped_ptr.h"
 #include "webrtc/base/socketfactory.h"
 
 namespace rtc {
 
 // Simulates UDP semantics over TCP.  Send and Recv packet sizes
-// are preserved, and drops packets silently on Send, rather than
-// buffer them in user space.
+// are preserved. While the socket is blocked, packets are queued up to
+// |max_packet_size| bytes and dropped silently beyond that, rather than
+// buffered without limit in user space.
+//
+// Queued packets are written with one gathered send. Received data is framed
+// in place; the receive buffer starts small, grows while reads keep filling
+// it and shrinks again once the connection has been quiet for a while.
 class AsyncTCPSocketBase : public AsyncPacketSocket {
  public:
   AsyncTCPSocketBase(AsyncSocket* socket, bool listen, size_t max_packet_size);
@@ -28,7 +36,10 @@ class AsyncTCPSocketBase : public AsyncPacketSocket {
   // Pure virtual methods to send and recv data.
   int Send(const void *pv, size_t cb,
                    const rtc::PacketOptions& options) override = 0;
-  virtual void ProcessInput(char* data, size_t* len) = 0;
+  // Signals the complete packets in the |len| bytes at |data| and returns
+  // the number of bytes they took up. The rest is passed in again, with more
+  // data behind it, on the next read.
+  virtual size_t ProcessInput(const char* data, size_t len) = 0;
   // Signals incoming connection.
   virtual void HandleIncomingConnection(AsyncSocket* socket) = 0;
 
@@ -46,6 +57,14 @@ class AsyncTCPSocketBase : public AsyncPacketSocket {
   int GetError() const override;
   void SetError(int error) override;
 
+  // Current size of the receive buffer, for tests.
+  size_t receive_buffer_size() const { return insize_; }
+
+  // Receive buffer size of an idle socket.
+  static const size_t kMinBufferSize = 4096;
+  // How long the receive buffer has to stay unfilled before it shrinks.
+  static const uint32 kShrinkDelayMs = 2000;
+
  protected:
   // Binds and connects |socket| and creates AsyncTCPSocket for
   // it. Takes ownership of |socket|. Returns NULL if bind() or
@@ -53,16 +72,21 @@ class AsyncTCPSocketBase : public AsyncPacketSocket {
   static AsyncSocket* ConnectSocket(AsyncSocket* socket,
                                     const SocketAddress& bind_address,
                                     const SocketAddress& remote_address);
-  virtual int SendRaw(const void* pv, size_t cb);
-  int FlushOutBuffer();
-  // Add data to |outbuf_|.
-  void AppendToOutBuffer(const void* pv, size_t cb);
-
-  // Helper methods for |outpos_|.
-  bool IsOutBufferEmpty() const { return outpos_ == 0; }
-  void ClearOutBuffer() { outpos_ = 0; }
+  // Sends one framed packet made of the |count| pieces, e.g. a length
+  // prefix, the payload and padding. Whatever the socket doesn't take right
+  // away is copied to the send queue. Returns the packet size, also when the
+  // packet was dropped because the queue is full, or the result of the send
+  // if nothing could be sent, in which case the packet is dropped.
+  int SendPacket(const Socket::IoBuffer* pieces, size_t count);
 
  private:
+  // Queues the |pieces| of a packet, skipping the first |skip| bytes.
+  void QueuePacket(const Socket::IoBuffer* pieces, size_t count, size_t skip);
+  // Sends as much of the queue as the socket takes.
+  int FlushOutQueue();
+  // Moves the unprocessed input to the front of a buffer of |size| bytes.
+  void ResizeInBuffer(size_t size);
+
   // Called by the underlying socket
   void OnConnectEvent(AsyncSocket* socket);
   void OnReadEvent(AsyncSocket* socket);
@@ -71,8 +95,18 @@ class AsyncTCPSocketBase : public AsyncPacketSocket {
 
   scoped_ptr<AsyncSocket> socket_;
   bool listen_;
-  char* inbuf_, * outbuf_;
-  size_t insize_, inpos_, outsize_, outpos_;
+  const size_t max_packet_size_;
+
+  // Received data occupies [inpos_, inend_) of |inbuf_|.
+  scoped_ptr<char[]> inbuf_;
+  size_t insize_, inpos_, inend_;
+  // When a read last filled the receive buffer.
+  uint32 in_full_time_;
+
+  // Packets waiting to be sent. |outpos_| bytes of the first one are sent
+  // already; |outsize_| counts the bytes not sent yet.
+  std::deque<CopyOnWriteBuffer> out_queue_;
+  size_t outpos_, outsize_;
 
   RTC_DISALLOW_COPY_AND_ASSIGN(AsyncTCPSocketBase);
 };
@@ -91,7 +125,7 @@ class AsyncTCPSocket : public AsyncTCPSocketBase {
   int Send(const void* pv,
            size_t cb,
            const rtc::PacketOptions& options) override;
-  void ProcessInput(char* data, size_t* len) override;
+  size_t ProcessInput(const char* data, size_t len) override;
   void HandleIncomingConnection(AsyncSocket* socket) override;
 
  private:
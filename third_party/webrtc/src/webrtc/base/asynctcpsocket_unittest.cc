@@ -9,11 +9,17 @@
  */
 
 #include <string>
+#include <vector>
 
+#include "webrtc/base/arraysize.h"
+#include "webrtc/base/asyncsocket.h"
 #include "webrtc/base/asynctcpsocket.h"
 #include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
 #include "webrtc/base/physicalsocketserver.h"
 #include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/base/virtualsocketserver.h"
 
 namespace rtc {
@@ -50,4 +56,220 @@ TEST_F(AsyncTCPSocketTest, OnWriteEvent) {
   EXPECT_TRUE(ready_to_send_);
 }
 
+static const SocketAddress kLoopbackAddr(IPAddress(INADDR_LOOPBACK), 0);
+static const int kTimeout = 5000;
+
+// Counts the Send() calls that reach a wrapped socket, like an SSL adapter
+// that makes a record of each one.
+class SendCountingAdapter : public AsyncSocketAdapter {
+ public:
+  explicit SendCountingAdapter(AsyncSocket* socket)
+      : AsyncSocketAdapter(socket), num_sends_(0) {}
+
+  int Send(const void* pv, size_t cb) override {
+    ++num_sends_;
+    return AsyncSocketAdapter::Send(pv, cb);
+  }
+
+  int num_sends() const { return num_sends_; }
+
+ private:
+  int num_sends_;
+};
+
+// Connects two AsyncTCPSockets over loopback and collects the packets the
+// accepted side receives.
+class AsyncTCPSocketPairTest
+    : public testing::Test,
+      public sigslot::has_slots<> {
+ public:
+  AsyncTCPSocketPairTest()
+      : vss_(&pss_),
+        client_adapter_(NULL),
+        keep_packets_(true),
+        bytes_received_(0),
+        ready_to_send_(false) {}
+
+  // With |count_sends|, the client's socket is wrapped in a
+  // SendCountingAdapter.
+  void Connect(SocketServer* ss, bool count_sends = false) {
+    ss_scope_.reset(new SocketServerScope(ss));
+    AsyncSocket* socket = ss->CreateAsyncSocket(AF_INET, SOCK_STREAM);
+    ASSERT_EQ(0, socket->Bind(kLoopbackAddr));
+    listener_.reset(new AsyncTCPSocket(socket, true));
+    listener_->SignalNewConnection.connect(
+        this, &AsyncTCPSocketPairTest::OnNewConnection);
+    AsyncSocket* client_socket = ss->CreateAsyncSocket(AF_INET, SOCK_STREAM);
+    if (count_sends) {
+      client_adapter_ = new SendCountingAdapter(client_socket);
+      client_socket = client_adapter_;
+    }
+    client_.reset(AsyncTCPSocket::Create(client_socket, kLoopbackAddr,
+                                         listener_->GetLocalAddress()));
+    ASSERT_TRUE(client_);
+    client_->SignalReadyToSend.connect(
+        this, &AsyncTCPSocketPairTest::OnReadyToSend);
+    EXPECT_TRUE_WAIT(server_ &&
+                     client_->GetState() == AsyncPacketSocket::STATE_CONNECTED,
+                     kTimeout);
+  }
+
+  void OnNewConnection(AsyncPacketSocket* socket,
+                       AsyncPacketSocket* new_socket) {
+    server_.reset(static_cast<AsyncTCPSocket*>(new_socket));
+    server_->SignalReadPacket.connect(this,
+                                      &AsyncTCPSocketPairTest::OnReadPacket);
+  }
+
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& remote_addr,
+                    const PacketTime& packet_time) {
+    if (keep_packets_) {
+      packets_.push_back(std::string(data, size));
+    }
+    bytes_received_ += size;
+  }
+
+  void OnReadyToSend(AsyncPacketSocket* socket) {
+    ready_to_send_ = true;
+  }
+
+  // A packet of |size| bytes that starts with |index|.
+  static std::string MakePacket(size_t size, int index) {
+    std::string packet(size, static_cast<char>('a' + index % 26));
+    if (size > 0) {
+      packet[0] = static_cast<char>(index);
+    }
+    return packet;
+  }
+
+  int Send(const std::string& packet) {
+    return client_->Send(packet.data(), packet.size(), PacketOptions());
+  }
+
+ protected:
+  PhysicalSocketServer pss_;
+  VirtualSocketServer vss_;
+  scoped_ptr<SocketServerScope> ss_scope_;
+  scoped_ptr<AsyncTCPSocket> listener_;
+  scoped_ptr<AsyncTCPSocket> client_;
+  // Owned by |client_|.
+  SendCountingAdapter* client_adapter_;
+  scoped_ptr<AsyncTCPSocket> server_;
+  bool keep_packets_;
+  std::vector<std::string> packets_;
+  size_t bytes_received_;
+  bool ready_to_send_;
+};
+
+// Packets from empty to the largest possible arrive intact, and the receive
+// buffer grows to make room for them.
+TEST_F(AsyncTCPSocketPairTest, TestPacketSizes) {
+  Connect(&pss_);
+  const size_t kSizes[] = {
+    0, 1, 1200, AsyncTCPSocketBase::kMinBufferSize,
+    AsyncTCPSocketBase::kMinBufferSize + 1, 65535, 7, 30000
+  };
+  EXPECT_EQ(AsyncTCPSocketBase::kMinBufferSize,
+            server_->receive_buffer_size());
+  for (size_t i = 0; i < arraysize(kSizes); ++i) {
+    std::string packet = MakePacket(kSizes[i], static_cast<int>(i));
+    EXPECT_EQ(static_cast<int>(packet.size()), Send(packet));
+    ASSERT_EQ_WAIT(i + 1, packets_.size(), kTimeout);
+    EXPECT_EQ(packet, packets_.back());
+  }
+  EXPECT_GT(server_->receive_buffer_size(), 65535U);
+}
+
+// Many small packets sent at once are framed correctly, also when one is
+// split across the end of the receive buffer.
+TEST_F(AsyncTCPSocketPairTest, TestManySmallPackets) {
+  Connect(&pss_);
+  const int kCount = 1000;
+  for (int i = 0; i < kCount; ++i) {
+    Send(MakePacket(100 + i % 50, i));
+  }
+  ASSERT_EQ_WAIT(static_cast<size_t>(kCount), packets_.size(), kTimeout);
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_EQ(MakePacket(100 + i % 50, i), packets_[i]);
+  }
+}
+
+// A socket that wraps another one gets each packet, length prefix included,
+// in a single Send().
+TEST_F(AsyncTCPSocketPairTest, TestOneSendPerPacketThroughAdapter) {
+  Connect(&pss_, true);
+  const int kCount = 10;
+  for (int i = 0; i < kCount; ++i) {
+    std::string packet = MakePacket(100 * (i + 1), i);
+    EXPECT_EQ(static_cast<int>(packet.size()), Send(packet));
+    EXPECT_EQ(i + 1, client_adapter_->num_sends());
+  }
+  ASSERT_EQ_WAIT(static_cast<size_t>(kCount), packets_.size(), kTimeout);
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_EQ(MakePacket(100 * (i + 1), i), packets_[i]);
+  }
+}
+
+// While the socket is blocked, packets are queued up to the maximum packet
+// size and then dropped, but the stream stays intact.
+TEST_F(AsyncTCPSocketPairTest, TestQueueWhileBlocked) {
+  vss_.set_send_buffer_capacity(2000);
+  vss_.set_recv_buffer_capacity(2000);
+  Connect(&vss_);
+  const int kCount = 10;
+  const size_t kSize = 10000;
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_EQ(static_cast<int>(kSize), Send(MakePacket(kSize, i)));
+  }
+  // The first packet was partly sent; the queue took five more.
+  ASSERT_EQ_WAIT(6U, packets_.size(), kTimeout);
+  EXPECT_TRUE(ready_to_send_);
+  for (size_t i = 0; i < packets_.size(); ++i) {
+    EXPECT_EQ(MakePacket(kSize, static_cast<int>(i)), packets_[i]);
+  }
+
+  // Once drained, sending works as before.
+  std::string packet = MakePacket(kSize, kCount);
+  Send(packet);
+  ASSERT_EQ_WAIT(7U, packets_.size(), kTimeout);
+  EXPECT_EQ(packet, packets_.back());
+}
+
+// Measures loopback throughput on a single thread, sending bursts that fit
+// into the send queue and waiting for each one to arrive. Nagle is off, as
+// for the sockets BasicPacketSocketFactory creates.
+TEST_F(AsyncTCPSocketPairTest, Perf) {
+  Connect(&pss_);
+  client_->SetOption(Socket::OPT_NODELAY, 1);
+  server_->SetOption(Socket::OPT_NODELAY, 1);
+  keep_packets_ = false;
+  const size_t kPacketSizes[] = { 100, 1200, 16000 };
+  const size_t kBytesPerSize = 32 * 1024 * 1024;
+  for (size_t i = 0; i < arraysize(kPacketSizes); ++i) {
+    const size_t size = kPacketSizes[i];
+    const size_t burst = 32 * 1024 / size;
+    const size_t total = kBytesPerSize / (burst * size) * (burst * size);
+    std::string packet = MakePacket(size, 0);
+    size_t start_bytes = bytes_received_;
+    uint64 start = TimeNanos();
+    for (size_t sent = 0; sent < total;) {
+      for (size_t j = 0; j < burst; ++j) {
+        Send(packet);
+      }
+      sent += burst * size;
+      for (int k = 0; k < 10000 && bytes_received_ - start_bytes < sent;
+           ++k) {
+        pss_.Wait(0, true);
+      }
+    }
+    uint64 elapsed = TimeNanos() - start;
+    LOG(LS_INFO) << size << "-byte packets: "
+                 << (bytes_received_ - start_bytes) * 8e3 / elapsed
+                 << " Mbps, receive buffer " << server_->receive_buffer_size()
+                 << " bytes";
+    EXPECT_EQ(total, bytes_received_ - start_bytes);
+  }
+}
+
 }  // namespace rtc
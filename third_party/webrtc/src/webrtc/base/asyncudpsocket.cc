@@ -9,12 +9,26 @@
  */
 
 #include "webrtc/base/asyncudpsocket.h"
+
+#include <string.h>
+
+#include <algorithm>
+
 #include "webrtc/base/logging.h"
+#include "webrtc/base/thread.h"
 
 namespace rtc {
 
 static const int BUF_SIZE = 64 * 1024;
 
+enum {
+  MSG_FLUSH_SENDS = 1,
+};
+
+const size_t AsyncUDPSocket::kMaxBatchSize;
+const size_t AsyncUDPSocket::kBatchBufferSize;
+const size_t AsyncUDPSocket::kReceiveHeadroom;
+
 AsyncUDPSocket* AsyncUDPSocket::Create(
     AsyncSocket* socket,
     const SocketAddress& bind_address) {
@@ -36,10 +50,23 @@ AsyncUDPSocket* AsyncUDPSocket::Create(SocketFactory* factory,
 }
 
 AsyncUDPSocket::AsyncUDPSocket(AsyncSocket* socket)
-    : socket_(socket) {
+    : socket_(socket),
+      recv_batch_(kMaxBatchSize),
+      batch_buf_(new char[(kMaxBatchSize - 1) *
+                          (kReceiveHeadroom + kBatchBufferSize)]),
+      destroyed_(NULL),
+      send_batching_(false),
+      send_queue_length_(0) {
   ASSERT(socket_);
   size_ = BUF_SIZE;
-  buf_ = new char[size_];
+  buf_ = new char[kReceiveHeadroom + size_];
+  recv_batch_[0].data = buf_ + kReceiveHeadroom;
+  recv_batch_[0].size = size_;
+  for (size_t i = 1; i < kMaxBatchSize; ++i) {
+    recv_batch_[i].data = batch_buf_.get() + kReceiveHeadroom +
+        (i - 1) * (kReceiveHeadroom + kBatchBufferSize);
+    recv_batch_[i].size = kBatchBufferSize;
+  }
 
   // The socket should start out readable but not writable.
   socket_->SignalReadEvent.connect(this, &AsyncUDPSocket::OnReadEvent);
@@ -47,6 +74,9 @@ AsyncUDPSocket::AsyncUDPSocket(AsyncSocket* socket)
 }
 
 AsyncUDPSocket::~AsyncUDPSocket() {
+  FlushSends();
+  if (destroyed_)
+    *destroyed_ = true;
   delete [] buf_;
 }
 
@@ -60,16 +90,32 @@ SocketAddress AsyncUDPSocket::GetRemoteAddress() const {
 
 int AsyncUDPSocket::Send(const void *pv, size_t cb,
                          const rtc::PacketOptions& options) {
+  FlushSends();
   return socket_->Send(pv, cb);
 }
 
 int AsyncUDPSocket::SendTo(const void *pv, size_t cb,
                            const SocketAddress& addr,
                            const rtc::PacketOptions& options) {
-  return socket_->SendTo(pv, cb, addr);
+  Thread* thread = Thread::Current();
+  if (!send_batching_ || cb > kBatchBufferSize || !thread) {
+    FlushSends();
+    return socket_->SendTo(pv, cb, addr);
+  }
+
+  if (send_queue_length_ == 0)
+    thread->Post(this, MSG_FLUSH_SENDS);
+  Socket::Datagram& datagram = send_queue_[send_queue_length_++];
+  memcpy(datagram.data, pv, cb);
+  datagram.length = cb;
+  datagram.addr = addr;
+  if (send_queue_length_ == send_queue_.size())
+    FlushSends();
+  return static_cast<int>(cb);
 }
 
 int AsyncUDPSocket::Close() {
+  FlushSends();
   return socket_->Close();
 }
 
@@ -93,12 +139,47 @@ void AsyncUDPSocket::SetError(int error) {
   return socket_->SetError(error);
 }
 
+void AsyncUDPSocket::SetSendBatching(bool enable) {
+  if (!enable) {
+    FlushSends();
+    send_queue_.clear();
+    send_buf_.reset();
+  } else if (!send_buf_) {
+    send_buf_.reset(new char[kMaxBatchSize * kBatchBufferSize]);
+    send_queue_.resize(kMaxBatchSize);
+    for (size_t i = 0; i < kMaxBatchSize; ++i) {
+      send_queue_[i].data = send_buf_.get() + i * kBatchBufferSize;
+      send_queue_[i].size = kBatchBufferSize;
+    }
+  }
+  send_batching_ = enable;
+}
+
+void AsyncUDPSocket::FlushSends() {
+  if (send_queue_length_ == 0)
+    return;
+
+  size_t count = send_queue_length_;
+  send_queue_length_ = 0;
+  int sent = socket_->SendToBatch(&send_queue_[0], count);
+  if (sent < static_cast<int>(count)) {
+    // Like unbatched sends, drop what doesn't fit into the socket buffer.
+    LOG(LS_VERBOSE) << "AsyncUDPSocket: Dropped "
+                    << count - std::max(sent, 0) << " of " << count
+                    << " queued packets, error " << socket_->GetError();
+  }
+}
+
+void AsyncUDPSocket::OnMessage(Message* msg) {
+  ASSERT(msg->message_id == MSG_FLUSH_SENDS);
+  FlushSends();
+}
+
 void AsyncUDPSocket::OnReadEvent(AsyncSocket* socket) {
   ASSERT(socket_.get() == socket);
 
-  SocketAddress remote_addr;
-  int len = socket_->RecvFrom(buf_, size_, &remote_addr);
-  if (len < 0) {
+  int count = socket_->RecvFromBatch(&recv_batch_[0], recv_batch_.size());
+  if (count < 0) {
     // An error here typically means we got an ICMP error in response to our
     // send datagram, indicating the remote address was unreachable.
     // When doing ICE, this kind of thing will often happen.
@@ -109,10 +190,24 @@ void AsyncUDPSocket::OnReadEvent(AsyncSocket* socket) {
     return;
   }
 
-  // TODO: Make sure that we got all of the packet.
-  // If we did not, then we should resize our buffer to be large enough.
-  SignalReadPacket(this, buf_, static_cast<size_t>(len), remote_addr,
-                   CreatePacketTime(0));
+  // A handler may destroy this socket, in which case the rest of the batch
+  // is dropped.
+  bool destroyed = false;
+  destroyed_ = &destroyed;
+  PacketTime packet_time = CreatePacketTime(0);
+  for (int i = 0; i < count; ++i) {
+    const Socket::Datagram& datagram = recv_batch_[i];
+    if (datagram.length > datagram.size) {
+      LOG(LS_WARNING) << "AsyncUDPSocket: Dropping truncated packet of "
+                      << datagram.length << " bytes";
+      continue;
+    }
+    SignalReadPacket(this, datagram.data, datagram.length, datagram.addr,
+                     packet_time);
+    if (destroyed)
+      return;
+  }
+  destroyed_ = NULL;
 }
 
 void AsyncUDPSocket::OnWriteEvent(AsyncSocket* socket) {
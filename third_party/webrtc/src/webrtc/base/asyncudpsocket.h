@@ -11,7 +11,10 @@
 #ifndef WEBRTC_BASE_ASYNCUDPSOCKET_H_
 #define WEBRTC_BASE_ASYNCUDPSOCKET_H_
 
+#include <vector>
+
 #include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/messagehandler.h"
 #include "webrtc/base/scoped_ptr.h"
 #include "webrtc/base/socketfactory.h"
 
@@ -19,8 +22,22 @@ namespace rtc {
 
 // Provides the ability to receive packets asynchronously.  Sends are not
 // buffered since it is acceptable to drop packets under high load.
-class AsyncUDPSocket : public AsyncPacketSocket {
+//
+// Each read event drains up to kMaxBatchSize datagrams with a single
+// Socket::RecvFromBatch() call and signals them one after the other. Sends
+// can optionally be batched as well, see SetSendBatching().
+class AsyncUDPSocket : public AsyncPacketSocket, public MessageHandler {
  public:
+  // Maximum number of datagrams received or sent at once.
+  static const size_t kMaxBatchSize = 16;
+  // Size of the buffers of all but the first datagram of a batch. The first
+  // one can hold any UDP datagram; larger datagrams arriving later in a
+  // batch are dropped.
+  static const size_t kBatchBufferSize = 2048;
+  // Bytes reserved in front of every receive buffer, see
+  // AsyncPacketSocket::GetReceiveHeadroom().
+  static const size_t kReceiveHeadroom = 16;
+
   // Binds |socket| and creates AsyncUDPSocket for it. Takes ownership
   // of |socket|. Returns NULL if bind() fails (|socket| is destroyed
   // in that case).
@@ -49,6 +66,21 @@ class AsyncUDPSocket : public AsyncPacketSocket {
   int SetOption(Socket::Option opt, int value) override;
   int GetError() const override;
   void SetError(int error) override;
+  size_t GetReceiveHeadroom() const override { return kReceiveHeadroom; }
+
+  // When enabled, datagrams of up to kBatchBufferSize bytes passed to
+  // SendTo() are queued and sent with one Socket::SendToBatch() call once the
+  // current thread has finished processing its I/O events, or when the queue
+  // is full. SendTo() then reports success for every queued datagram; send
+  // errors only show up in GetError(). Disabled by default.
+  void SetSendBatching(bool enable);
+  bool send_batching() const { return send_batching_; }
+
+  // Sends all queued datagrams.
+  void FlushSends();
+
+  // MessageHandler implementation.
+  void OnMessage(Message* msg) override;
 
  private:
   // Called when the underlying socket is ready to be read from.
@@ -59,6 +91,18 @@ class AsyncUDPSocket : public AsyncPacketSocket {
   scoped_ptr<AsyncSocket> socket_;
   char* buf_;
   size_t size_;
+  // Receive slots; the first one points to |buf_|, the others into
+  // |batch_buf_|. Each slot is preceded by kReceiveHeadroom unused bytes.
+  std::vector<Socket::Datagram> recv_batch_;
+  scoped_ptr<char[]> batch_buf_;
+  // Set while OnReadEvent() signals a batch, so that it notices when a
+  // handler destroys the socket.
+  bool* destroyed_;
+
+  bool send_batching_;
+  std::vector<Socket::Datagram> send_queue_;
+  size_t send_queue_length_;
+  scoped_ptr<char[]> send_buf_;
 };
 
 }  // namespace rtc
@@ -10,10 +10,17 @@
 
 #include <string>
 
+#if defined(WEBRTC_POSIX)
+#include <time.h>
+#endif
+
 #include "webrtc/base/asyncudpsocket.h"
 #include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
 #include "webrtc/base/physicalsocketserver.h"
 #include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/base/virtualsocketserver.h"
 
 namespace rtc {
@@ -50,4 +57,200 @@ TEST_F(AsyncUdpSocketTest, OnWriteEvent) {
   EXPECT_TRUE(ready_to_send_);
 }
 
+static const SocketAddress kLoopbackAddr(IPAddress(INADDR_LOOPBACK), 0);
+
+// Batching tests, run over real loopback sockets.
+class AsyncUdpSocketBatchTest
+    : public testing::Test,
+      public sigslot::has_slots<> {
+ public:
+  AsyncUdpSocketBatchTest()
+      : ss_scope_(&ss_),
+        receiver_(AsyncUDPSocket::Create(&ss_, kLoopbackAddr)),
+        sender_(AsyncUDPSocket::Create(&ss_, kLoopbackAddr)),
+        received_(0),
+        prepend_header_(false) {
+    receiver_->SignalReadPacket.connect(this,
+                                        &AsyncUdpSocketBatchTest::OnReadPacket);
+  }
+
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& remote_addr,
+                    const PacketTime& packet_time) {
+    EXPECT_EQ(sender_->GetLocalAddress(), remote_addr);
+    if (prepend_header_) {
+      // Frame the packet in place, the way a relay would.
+      ASSERT_GE(socket->GetReceiveHeadroom(), 4U);
+      char* header = const_cast<char*>(data) - 4;
+      memcpy(header, "HEAD", 4);
+      last_packet_.assign(header, size + 4);
+    } else {
+      last_packet_.assign(data, size);
+    }
+    ++received_;
+  }
+
+  // Processes read events until |*received| reaches |expected|, giving up
+  // after a while in case packets got lost.
+  void DrainBurst(int* received, int expected) {
+    for (int i = 0; *received < expected && i < 100; ++i) {
+      ss_.Wait(0, true);
+    }
+  }
+
+  void SendPackets(int count, size_t size) {
+    std::string packet(size, 'x');
+    for (int i = 0; i < count; ++i) {
+      EXPECT_EQ(static_cast<int>(size),
+                sender_->SendTo(packet.data(), packet.size(),
+                                receiver_->GetLocalAddress(), PacketOptions()));
+    }
+  }
+
+ protected:
+  PhysicalSocketServer ss_;
+  SocketServerScope ss_scope_;
+  scoped_ptr<AsyncUDPSocket> receiver_;
+  scoped_ptr<AsyncUDPSocket> sender_;
+  int received_;
+  std::string last_packet_;
+  bool prepend_header_;
+};
+
+// One read event delivers everything that is queued, up to the batch size.
+TEST_F(AsyncUdpSocketBatchTest, TestReceiveBatch) {
+  SendPackets(10, 100);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(10, received_);
+}
+
+// Only the first datagram of a batch can be larger than kBatchBufferSize.
+TEST_F(AsyncUdpSocketBatchTest, TestReceiveLargePacket) {
+  const size_t kLargeSize = AsyncUDPSocket::kBatchBufferSize + 1;
+  SendPackets(1, kLargeSize);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(1, received_);
+  EXPECT_EQ(kLargeSize, last_packet_.size());
+
+  SendPackets(1, 100);
+  SendPackets(1, kLargeSize);
+  SendPackets(1, 200);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(3, received_);
+  EXPECT_EQ(200U, last_packet_.size());
+}
+
+// Handlers can write into the headroom of the first and the later datagrams
+// of a batch.
+TEST_F(AsyncUdpSocketBatchTest, TestReceiveHeadroom) {
+  prepend_header_ = true;
+  SendPackets(1, 100);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ("HEAD" + std::string(100, 'x'), last_packet_);
+
+  SendPackets(3, 200);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(4, received_);
+  EXPECT_EQ("HEAD" + std::string(200, 'x'), last_packet_);
+}
+
+// Queued sends go out once the thread processes its messages.
+TEST_F(AsyncUdpSocketBatchTest, TestSendBatching) {
+  sender_->SetSendBatching(true);
+  SendPackets(5, 100);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(0, received_);
+
+  EXPECT_EQ_WAIT(5, received_, 1000);
+}
+
+// A full queue is flushed right away, oversized packets bypass it.
+TEST_F(AsyncUdpSocketBatchTest, TestSendBatchingFlush) {
+  sender_->SetSendBatching(true);
+  SendPackets(static_cast<int>(AsyncUDPSocket::kMaxBatchSize), 100);
+  EXPECT_TRUE(ss_.Wait(0, true));
+  EXPECT_EQ(static_cast<int>(AsyncUDPSocket::kMaxBatchSize), received_);
+
+  // The queue is flushed first to keep the packets in order. Receive them
+  // with a plain socket, the second one wouldn't fit into a batch.
+  scoped_ptr<Socket> receiver(ss_.CreateSocket(AF_INET, SOCK_DGRAM));
+  ASSERT_EQ(0, receiver->Bind(kLoopbackAddr));
+  const size_t kLargeSize = AsyncUDPSocket::kBatchBufferSize + 1;
+  std::string packet(kLargeSize, 'x');
+  sender_->SendTo(packet.data(), 100, receiver->GetLocalAddress(),
+                  PacketOptions());
+  sender_->SendTo(packet.data(), kLargeSize, receiver->GetLocalAddress(),
+                  PacketOptions());
+  char buf[2 * AsyncUDPSocket::kBatchBufferSize];
+  EXPECT_EQ(100, receiver->RecvFrom(buf, sizeof(buf), NULL));
+  EXPECT_EQ(static_cast<int>(kLargeSize),
+            receiver->RecvFrom(buf, sizeof(buf), NULL));
+}
+
+#if defined(WEBRTC_POSIX)
+
+// Receives and sends packets the way AsyncUDPSocket did before batching: one
+// datagram per read event, one system call per send.
+class UnbatchedUdpSocket : public sigslot::has_slots<> {
+ public:
+  explicit UnbatchedUdpSocket(AsyncSocket* socket)
+      : socket_(socket), received_(0) {
+    socket_->Bind(kLoopbackAddr);
+    socket_->SignalReadEvent.connect(this, &UnbatchedUdpSocket::OnReadEvent);
+  }
+
+  void OnReadEvent(AsyncSocket* socket) {
+    SocketAddress addr;
+    if (socket_->RecvFrom(buf_, sizeof(buf_), &addr) >= 0)
+      ++received_;
+  }
+
+  scoped_ptr<AsyncSocket> socket_;
+  int received_;
+  char buf_[2048];
+};
+
+static uint64 ThreadCpuNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64>(ts.tv_sec) * kNumNanosecsPerSec + ts.tv_nsec;
+}
+
+// Measures loopback packets per second per core, sending bursts of
+// kMaxBatchSize packets from one socket to another on a single thread.
+TEST_F(AsyncUdpSocketBatchTest, Perf) {
+  const int kBursts = 2000;
+  const int kBurstSize = static_cast<int>(AsyncUDPSocket::kMaxBatchSize);
+  const size_t kPacketSize = 200;
+  char packet[kPacketSize] = { 0 };
+
+  UnbatchedUdpSocket unbatched_sender(
+      ss_.CreateAsyncSocket(AF_INET, SOCK_DGRAM));
+  UnbatchedUdpSocket unbatched_receiver(
+      ss_.CreateAsyncSocket(AF_INET, SOCK_DGRAM));
+  SocketAddress unbatched_addr = unbatched_receiver.socket_->GetLocalAddress();
+  uint64 start = ThreadCpuNanos();
+  for (int i = 0; i < kBursts; ++i) {
+    for (int j = 0; j < kBurstSize; ++j) {
+      unbatched_sender.socket_->SendTo(packet, kPacketSize, unbatched_addr);
+    }
+    DrainBurst(&unbatched_receiver.received_, (i + 1) * kBurstSize);
+  }
+  uint64 unbatched_ns = ThreadCpuNanos() - start;
+
+  sender_->SetSendBatching(true);
+  start = ThreadCpuNanos();
+  for (int i = 0; i < kBursts; ++i) {
+    SendPackets(kBurstSize, kPacketSize);
+    DrainBurst(&received_, (i + 1) * kBurstSize);
+  }
+  uint64 batched_ns = ThreadCpuNanos() - start;
+
+  LOG(LS_INFO) << "Unbatched: " << unbatched_receiver.received_ * 1e9 /
+                  unbatched_ns << " packets/s, batched: "
+               << received_ * 1e9 / batched_ns << " packets/s";
+}
+
+#endif  // defined(WEBRTC_POSIX)
+
 }  // namespace rtc
@@ -134,6 +134,8 @@
         'callback.h',
         'common.cc',
         'common.h',
+        'copyonwritebuffer.cc',
+        'copyonwritebuffer.h',
         'crc32.cc',
         'crc32.h',
         'cryptstring.cc',
@@ -157,6 +159,8 @@
         'gunit_prod.h',
         'helpers.cc',
         'helpers.h',
+        'hmacsha1.cc',
+        'hmacsha1.h',
         'httpbase.cc',
         'httpbase.h',
         'httpclient.cc',
@@ -309,6 +313,8 @@
         'testclient.h',
         'thread.cc',
         'thread.h',
+        'timerwheel.cc',
+        'timerwheel.h',
         'timing.cc',
         'timing.h',
         'transformadapter.cc',
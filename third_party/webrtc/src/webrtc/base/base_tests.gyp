@@ -56,6 +56,7 @@
           'bytebuffer_unittest.cc',
           'byteorder_unittest.cc',
           'callback_unittest.cc',
+          'copyonwritebuffer_unittest.cc',
           'crc32_unittest.cc',
           'criticalsection_unittest.cc',
           'event_tracer_unittest.cc',
@@ -64,11 +65,13 @@
           'filerotatingstream_unittest.cc',
           'fileutils_unittest.cc',
           'helpers_unittest.cc',
+          'hmacsha1_unittest.cc',
           'httpbase_unittest.cc',
           'httpcommon_unittest.cc',
           'httpserver_unittest.cc',
           'ipaddress_unittest.cc',
           'logging_unittest.cc',
+          'logsinks_unittest.cc',
           'md5digest_unittest.cc',
           'messagedigest_unittest.cc',
           'messagequeue_unittest.cc',
@@ -105,6 +108,7 @@
           'testclient_unittest.cc',
           'thread_checker_unittest.cc',
           'thread_unittest.cc',
+          'timerwheel_unittest.cc',
           'timeutils_unittest.cc',
           'urlencode_unittest.cc',
           'versionparsing_unittest.cc',
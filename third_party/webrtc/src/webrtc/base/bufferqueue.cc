@@ -10,6 +10,10 @@
 
 #include "webrtc/base/bufferqueue.h"
 
+#include <string.h>
+
+#include "webrtc/base/checks.h"
+
 namespace rtc {
 
 BufferQueue::BufferQueue(size_t capacity, size_t default_size)
@@ -77,4 +81,74 @@ bool BufferQueue::WriteBack(const void* buffer, size_t bytes,
   return true;
 }
 
+SpscBufferQueue::SpscBufferQueue(size_t capacity, size_t default_size)
+    : num_slots_(static_cast<int>(capacity + 1)),
+      slots_(new Buffer[capacity + 1]),
+      read_index_(0),
+      cached_write_index_(0),
+      write_index_(0),
+      cached_read_index_(0) {
+  RTC_DCHECK_GT(capacity, 0u);
+  for (int i = 0; i < num_slots_; ++i) {
+    slots_[i].EnsureCapacity(default_size);
+  }
+}
+
+SpscBufferQueue::~SpscBufferQueue() {
+}
+
+size_t SpscBufferQueue::size() const {
+  int read = AtomicOps::AcquireLoad(&read_index_);
+  int write = AtomicOps::AcquireLoad(&write_index_);
+  return static_cast<size_t>(
+      (write >= read) ? write - read : write + num_slots_ - read);
+}
+
+bool SpscBufferQueue::ReadFront(void* buffer, size_t bytes,
+                                size_t* bytes_read) {
+  int read = read_index_;
+  if (read == cached_write_index_) {
+    // Only look at the writer's index, and its cache line, when we seem to
+    // have caught up.
+    cached_write_index_ = AtomicOps::AcquireLoad(&write_index_);
+    if (read == cached_write_index_) {
+      return false;
+    }
+  }
+
+  const Buffer& packet = slots_[read];
+  size_t next_packet_size = packet.size();
+  if (bytes > next_packet_size) {
+    bytes = next_packet_size;
+  }
+
+  memcpy(buffer, packet.data(), bytes);
+  if (bytes_read) {
+    *bytes_read = bytes;
+  }
+  // Hands the slot back to the writer.
+  AtomicOps::ReleaseStore(&read_index_, Next(read));
+  return true;
+}
+
+bool SpscBufferQueue::WriteBack(const void* buffer, size_t bytes,
+                                size_t* bytes_written) {
+  int write = write_index_;
+  int next = Next(write);
+  if (next == cached_read_index_) {
+    cached_read_index_ = AtomicOps::AcquireLoad(&read_index_);
+    if (next == cached_read_index_) {
+      return false;
+    }
+  }
+
+  slots_[write].SetData(static_cast<const uint8_t*>(buffer), bytes);
+  if (bytes_written) {
+    *bytes_written = bytes;
+  }
+  // Publishes the data to the reader.
+  AtomicOps::ReleaseStore(&write_index_, next);
+  return true;
+}
+
 }  // namespace rtc
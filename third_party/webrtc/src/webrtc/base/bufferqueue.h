@@ -14,8 +14,10 @@
 #include <deque>
 #include <vector>
 
+#include "webrtc/base/atomicops.h"
 #include "webrtc/base/buffer.h"
 #include "webrtc/base/criticalsection.h"
+#include "webrtc/base/scoped_ptr.h"
 
 namespace rtc {
 
@@ -45,6 +47,54 @@ class BufferQueue {
   RTC_DISALLOW_COPY_AND_ASSIGN(BufferQueue);
 };
 
+// A BufferQueue for exactly one writing and one reading thread. All buffers
+// are allocated up front, and ReadFront and WriteBack never lock or wait for
+// the other thread; they only publish a slot index with release semantics.
+// WriteBack only allocates if a write doesn't fit into a slot's buffer.
+// Use BufferQueue if several threads write or read.
+class SpscBufferQueue {
+ public:
+  // Creates a queue of |capacity| buffers of |default_size| bytes each.
+  SpscBufferQueue(size_t capacity, size_t default_size);
+  ~SpscBufferQueue();
+
+  // Return number of queued buffers. Only a snapshot if the other thread is
+  // busy with the queue.
+  size_t size() const;
+
+  // Called on the reading thread only. Same semantics as in BufferQueue.
+  bool ReadFront(void* data, size_t bytes, size_t* bytes_read);
+
+  // Called on the writing thread only. Same semantics as in BufferQueue.
+  bool WriteBack(const void* data, size_t bytes, size_t* bytes_written);
+
+ private:
+  // Slot indices are in [0, capacity]; one slot stays empty to tell a full
+  // queue from an empty one.
+  int Next(int index) const {
+    return (index + 1 == num_slots_) ? 0 : index + 1;
+  }
+
+  const int num_slots_;
+  scoped_ptr<Buffer[]> slots_;
+
+  // Keep the indices each thread writes on separate cache lines.
+  static const size_t kCacheLineSize = 64;
+  char pad0_[kCacheLineSize];
+  // Next slot to read; written by the reader only.
+  volatile int read_index_;
+  // The reader's last look at |write_index_|.
+  int cached_write_index_;
+  char pad1_[kCacheLineSize];
+  // Next slot to write; written by the writer only.
+  volatile int write_index_;
+  // The writer's last look at |read_index_|.
+  int cached_read_index_;
+  char pad2_[kCacheLineSize];
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(SpscBufferQueue);
+};
+
 }  // namespace rtc
 
 #endif  // WEBRTC_BASE_BUFFERQUEUE_H_
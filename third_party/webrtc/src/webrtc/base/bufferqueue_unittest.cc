@@ -8,8 +8,13 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <vector>
+
 #include "webrtc/base/bufferqueue.h"
 #include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 
 namespace rtc {
 
@@ -83,4 +88,121 @@ TEST(BufferQueueTest, TestAll) {
   EXPECT_EQ(0u, queue2.size());
 }
 
+TEST(SpscBufferQueueTest, TestAll) {
+  const size_t kSize = 16;
+  const char in[kSize * 2 + 1] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+  char out[kSize * 2];
+  size_t bytes;
+  SpscBufferQueue queue(2, kSize);
+
+  EXPECT_EQ(0u, queue.size());
+  EXPECT_FALSE(queue.ReadFront(out, kSize, &bytes));
+
+  // Writes succeed until the queue is full.
+  EXPECT_TRUE(queue.WriteBack(in, kSize / 2, &bytes));
+  EXPECT_EQ(kSize / 2, bytes);
+  EXPECT_TRUE(queue.WriteBack(in + kSize / 2, kSize / 2, &bytes));
+  EXPECT_EQ(2u, queue.size());
+  EXPECT_FALSE(queue.WriteBack(in, kSize, &bytes));
+  EXPECT_EQ(2u, queue.size());
+
+  // Reading maintains buffer boundaries and truncates.
+  EXPECT_TRUE(queue.ReadFront(out, kSize / 4, &bytes));
+  EXPECT_EQ(kSize / 4, bytes);
+  EXPECT_EQ(0, memcmp(in, out, kSize / 4));
+  EXPECT_EQ(1u, queue.size());
+
+  // The slot can be reused, also for data larger than the default size.
+  EXPECT_TRUE(queue.WriteBack(in, kSize * 2, &bytes));
+  EXPECT_EQ(kSize * 2, bytes);
+  EXPECT_TRUE(queue.ReadFront(out, kSize * 2, &bytes));
+  EXPECT_EQ(kSize / 2, bytes);
+  EXPECT_EQ(0, memcmp(in + kSize / 2, out, kSize / 2));
+  EXPECT_TRUE(queue.ReadFront(out, kSize * 2, &bytes));
+  EXPECT_EQ(kSize * 2, bytes);
+  EXPECT_EQ(0, memcmp(in, out, kSize * 2));
+  EXPECT_EQ(0u, queue.size());
+  EXPECT_FALSE(queue.ReadFront(out, kSize, &bytes));
+}
+
+// Spins for a while before giving up the CPU, so that the benchmark measures
+// the queue rather than the scheduler.
+static void Backoff(int* tries) {
+  if (++*tries % 1000 == 0) {
+    Thread::Current()->SleepMs(0);
+  }
+}
+
+// Writes |count| numbered packets of |size| bytes to a queue from another
+// thread, retrying while the queue is full.
+template <class Queue>
+class QueueWriter : public Runnable {
+ public:
+  QueueWriter(Queue* queue, int count, size_t size)
+      : queue_(queue), count_(count), size_(size) {}
+
+  void Run(Thread* thread) override {
+    std::vector<char> packet(size_);
+    for (int i = 0; i < count_; ++i) {
+      memcpy(&packet[0], &i, sizeof(i));
+      int tries = 0;
+      while (!queue_->WriteBack(&packet[0], packet.size(), NULL)) {
+        Backoff(&tries);
+      }
+    }
+  }
+
+ private:
+  Queue* queue_;
+  int count_;
+  size_t size_;
+};
+
+// Reads |count| packets written by a QueueWriter and checks their order.
+// Returns the number of packets per second.
+template <class Queue>
+double ReadFromWriterThread(Queue* queue, int count, size_t size) {
+  QueueWriter<Queue> writer(queue, count, size);
+  Thread thread;
+  uint64 start = TimeNanos();
+  thread.Start(&writer);
+  std::vector<char> packet(size);
+  int in_order = 0;
+  for (int i = 0; i < count; ++i) {
+    size_t bytes = 0;
+    int tries = 0;
+    while (!queue->ReadFront(&packet[0], packet.size(), &bytes)) {
+      Backoff(&tries);
+    }
+    int index;
+    memcpy(&index, &packet[0], sizeof(index));
+    if (bytes == size && index == i) {
+      ++in_order;
+    }
+  }
+  uint64 elapsed = TimeNanos() - start;
+  thread.Stop();
+  EXPECT_EQ(count, in_order);
+  return count * 1e9 / elapsed;
+}
+
+TEST(SpscBufferQueueTest, TestTwoThreads) {
+  SpscBufferQueue queue(4, 100);
+  ReadFromWriterThread(&queue, 10000, 100);
+  EXPECT_EQ(0u, queue.size());
+}
+
+// Compares packets per second through both queues between two threads.
+TEST(SpscBufferQueueTest, Perf) {
+  const int kCount = 1000000;
+  const size_t kCapacity = 64;
+  const size_t kPacketSize = 200;
+  BufferQueue locked_queue(kCapacity, kPacketSize);
+  double locked = ReadFromWriterThread(&locked_queue, kCount, kPacketSize);
+  SpscBufferQueue spsc_queue(kCapacity, kPacketSize);
+  double spsc = ReadFromWriterThread(&spsc_queue, kCount, kPacketSize);
+  LOG(LS_INFO) << "BufferQueue: " << locked << " packets/s, SpscBufferQueue: "
+               << spsc << " packets/s";
+}
+
 }  // namespace rtc
@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/base/copyonwritebuffer.h"
+
+namespace rtc {
+
+CopyOnWriteBuffer::CopyOnWriteBuffer() : offset_(0), size_(0) {
+  assert(IsConsistent());
+}
+
+CopyOnWriteBuffer::CopyOnWriteBuffer(const CopyOnWriteBuffer& buf)
+    : storage_(buf.storage_), offset_(buf.offset_), size_(buf.size_) {
+  assert(IsConsistent());
+}
+
+CopyOnWriteBuffer::CopyOnWriteBuffer(CopyOnWriteBuffer&& buf)
+    : offset_(0), size_(0) {
+  swap(*this, buf);
+  assert(IsConsistent());
+}
+
+CopyOnWriteBuffer::CopyOnWriteBuffer(size_t size)
+    : CopyOnWriteBuffer(size, size, 0) {
+}
+
+CopyOnWriteBuffer::CopyOnWriteBuffer(size_t size, size_t capacity)
+    : CopyOnWriteBuffer(size, capacity, 0) {
+}
+
+CopyOnWriteBuffer::CopyOnWriteBuffer(size_t size, size_t capacity,
+                                     size_t headroom)
+    : offset_(0), size_(size) {
+  capacity = std::max(size, capacity);
+  if (headroom + capacity > 0) {
+    storage_ = new RefCountedObject<Storage>(headroom + capacity);
+    offset_ = headroom;
+  }
+  assert(IsConsistent());
+}
+
+CopyOnWriteBuffer::~CopyOnWriteBuffer() = default;
+
+bool CopyOnWriteBuffer::operator==(const CopyOnWriteBuffer& buf) const {
+  assert(IsConsistent());
+  return size_ == buf.size() &&
+         (cdata() == buf.cdata() || memcmp(cdata(), buf.cdata(), size_) == 0);
+}
+
+void CopyOnWriteBuffer::SetSize(size_t size) {
+  assert(IsConsistent());
+  if (size > size_) {
+    // Growing exposes bytes the caller is about to write, so the storage
+    // can't stay shared. Shrinking only changes this buffer's view.
+    if (size > capacity()) {
+      EnsureCapacity(size);
+    } else {
+      CloneDataIfReferenced(capacity());
+    }
+  }
+  size_ = size;
+  assert(IsConsistent());
+}
+
+void CopyOnWriteBuffer::EnsureCapacity(size_t capacity) {
+  assert(IsConsistent());
+  if (storage_ && capacity <= this->capacity())
+    return;
+
+  scoped_refptr<RefCountedObject<Storage>> storage(
+      new RefCountedObject<Storage>(offset_ + capacity));
+  if (size_ > 0)
+    std::memcpy(storage->data.get() + offset_, cdata(), size_);
+  storage_ = storage;
+  assert(IsConsistent());
+}
+
+void CopyOnWriteBuffer::Clear() {
+  storage_ = nullptr;
+  offset_ = 0;
+  size_ = 0;
+  assert(IsConsistent());
+}
+
+void CopyOnWriteBuffer::CloneDataIfReferenced(size_t capacity) {
+  if (!IsShared())
+    return;
+
+  scoped_refptr<RefCountedObject<Storage>> storage(
+      new RefCountedObject<Storage>(offset_ + capacity));
+  if (size_ > 0)
+    std::memcpy(storage->data.get() + offset_, cdata(), size_);
+  storage_ = storage;
+  assert(IsConsistent());
+}
+
+}  // namespace rtc
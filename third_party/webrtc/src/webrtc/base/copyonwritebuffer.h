@@ -0,0 +1,247 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_BASE_COPYONWRITEBUFFER_H_
+#define WEBRTC_BASE_COPYONWRITEBUFFER_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "webrtc/base/buffer.h"
+#include "webrtc/base/refcount.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/scoped_ref_ptr.h"
+
+namespace rtc {
+
+// A byte buffer with reference-counted storage. Copying a CopyOnWriteBuffer
+// only takes a reference; the data is copied the first time one of the
+// holders asks for non-const access while the storage is shared. This lets a
+// packet be written once and passed between threads and layers, e.g. from a
+// media engine to the worker thread, through SRTP and into the transport,
+// without copying.
+//
+// The storage may also reserve headroom in front of the data, so that lower
+// layers can prepend their headers in place, and tailroom behind it, so that
+// the data can grow, e.g. by an SRTP auth tag, without a reallocation.
+//
+// Like rtc::Buffer, the contents are not initialized when growing. A single
+// CopyOnWriteBuffer must not be used from several threads at once, but
+// buffers sharing storage may be used on different threads.
+class CopyOnWriteBuffer {
+ public:
+  // An empty buffer.
+  CopyOnWriteBuffer();
+  // Share the storage of an existing buffer.
+  CopyOnWriteBuffer(const CopyOnWriteBuffer& buf);
+  // Move the contents of an existing buffer.
+  CopyOnWriteBuffer(CopyOnWriteBuffer&& buf);
+
+  // Construct a buffer with the specified number of uninitialized bytes.
+  explicit CopyOnWriteBuffer(size_t size);
+  CopyOnWriteBuffer(size_t size, size_t capacity);
+
+  // Construct a buffer and copy the specified number of bytes into it. The
+  // source array may be (const) uint8_t*, int8_t*, or char*.
+  template <typename T, typename internal::ByteType<T>::t = 0>
+  CopyOnWriteBuffer(const T* data, size_t size)
+      : CopyOnWriteBuffer(data, size, size) {}
+  template <typename T, typename internal::ByteType<T>::t = 0>
+  CopyOnWriteBuffer(const T* data, size_t size, size_t capacity)
+      : CopyOnWriteBuffer(data, size, capacity, 0) {}
+  // As above, also reserving |headroom| bytes in front of the data.
+  template <typename T, typename internal::ByteType<T>::t = 0>
+  CopyOnWriteBuffer(const T* data, size_t size, size_t capacity,
+                    size_t headroom)
+      : CopyOnWriteBuffer(size, capacity, headroom) {
+    if (size > 0)
+      std::memcpy(storage_->data.get() + offset_, data, size);
+  }
+
+  // Construct a buffer from the contents of an array.
+  template <typename T, size_t N, typename internal::ByteType<T>::t = 0>
+  CopyOnWriteBuffer(const T(&array)[N])  // NOLINT: runtime/explicit
+      : CopyOnWriteBuffer(array, N) {}
+
+  ~CopyOnWriteBuffer();
+
+  // Get a pointer to the data. Just .data() will give you a (const) uint8_t*,
+  // but you may also use .data<int8_t>() and .data<char>(). The non-const
+  // version copies the data first if the storage is shared.
+  template <typename T = uint8_t, typename internal::ByteType<T>::t = 0>
+  const T* data() const {
+    return cdata<T>();
+  }
+  template <typename T = uint8_t, typename internal::ByteType<T>::t = 0>
+  T* data() {
+    assert(IsConsistent());
+    if (!storage_)
+      return nullptr;
+    CloneDataIfReferenced(capacity());
+    return reinterpret_cast<T*>(storage_->data.get() + offset_);
+  }
+  // Const access to the data, without copying, also from a non-const buffer.
+  template <typename T = uint8_t, typename internal::ByteType<T>::t = 0>
+  const T* cdata() const {
+    assert(IsConsistent());
+    if (!storage_)
+      return nullptr;
+    return reinterpret_cast<const T*>(storage_->data.get() + offset_);
+  }
+
+  size_t size() const {
+    assert(IsConsistent());
+    return size_;
+  }
+  // The number of bytes the data can grow to without a reallocation.
+  size_t capacity() const {
+    assert(IsConsistent());
+    return storage_ ? storage_->capacity - offset_ : 0;
+  }
+  // The number of bytes reserved in front of the data. Only the holder of an
+  // unshared buffer, i.e. after a call to the non-const data(), may write
+  // there.
+  size_t headroom() const {
+    assert(IsConsistent());
+    return offset_;
+  }
+  // True if the storage is shared with other buffers.
+  bool IsShared() const { return storage_ && !storage_->HasOneRef(); }
+
+  CopyOnWriteBuffer& operator=(const CopyOnWriteBuffer& buf) {
+    assert(IsConsistent());
+    assert(buf.IsConsistent());
+    if (&buf != this) {
+      storage_ = buf.storage_;
+      offset_ = buf.offset_;
+      size_ = buf.size_;
+    }
+    return *this;
+  }
+  CopyOnWriteBuffer& operator=(CopyOnWriteBuffer&& buf) {
+    assert(IsConsistent());
+    assert(buf.IsConsistent());
+    Clear();
+    swap(*this, buf);
+    return *this;
+  }
+
+  bool operator==(const CopyOnWriteBuffer& buf) const;
+  bool operator!=(const CopyOnWriteBuffer& buf) const {
+    return !(*this == buf);
+  }
+
+  uint8_t operator[](size_t index) const {
+    assert(index < size());
+    return cdata()[index];
+  }
+
+  // Replace the contents of the buffer. Accepts the same types as the
+  // constructors. Unshared storage is reused if it is big enough; shared
+  // storage is left to its other holders and replaced by storage of the same
+  // capacity.
+  template <typename T, typename internal::ByteType<T>::t = 0>
+  void SetData(const T* data, size_t size) {
+    assert(IsConsistent());
+    if (!storage_ || IsShared() || offset_ + size > storage_->capacity) {
+      storage_ = new RefCountedObject<Storage>(
+          offset_ + std::max(size, capacity()));
+    }
+    if (size > 0)
+      std::memcpy(storage_->data.get() + offset_, data, size);
+    size_ = size;
+    assert(IsConsistent());
+  }
+  template <typename T, size_t N, typename internal::ByteType<T>::t = 0>
+  void SetData(const T(&array)[N]) {
+    SetData(array, N);
+  }
+  void SetData(const CopyOnWriteBuffer& buf) {
+    if (&buf != this)
+      *this = buf;
+  }
+
+  // Append data to the buffer. Accepts the same types as the constructors.
+  template <typename T, typename internal::ByteType<T>::t = 0>
+  void AppendData(const T* data, size_t size) {
+    assert(IsConsistent());
+    const size_t old_size = size_;
+    SetSize(size_ + size);
+    if (size > 0)
+      std::memcpy(storage_->data.get() + offset_ + old_size, data, size);
+    assert(IsConsistent());
+  }
+  template <typename T, size_t N, typename internal::ByteType<T>::t = 0>
+  void AppendData(const T(&array)[N]) {
+    AppendData(array, N);
+  }
+  void AppendData(const CopyOnWriteBuffer& buf) {
+    AppendData(buf.cdata(), buf.size());
+  }
+
+  // Sets the size of the buffer. If the new size is smaller than the old, the
+  // buffer contents will be kept but truncated; if the new size is greater,
+  // the existing contents will be kept and the new space will be
+  // uninitialized.
+  void SetSize(size_t size);
+
+  // Ensure that the buffer size can be increased to at least capacity without
+  // further reallocation. (Of course, this operation might need to reallocate
+  // the buffer.)
+  void EnsureCapacity(size_t capacity);
+
+  // We can't call std::move(b), so call b.Pass() instead to do the same job.
+  CopyOnWriteBuffer&& Pass() {
+    assert(IsConsistent());
+    return static_cast<CopyOnWriteBuffer&&>(*this);
+  }
+
+  // Resets the buffer to zero size and capacity, releasing the storage.
+  void Clear();
+
+  // Swaps two buffers.
+  friend void swap(CopyOnWriteBuffer& a, CopyOnWriteBuffer& b) {
+    using std::swap;
+    swap(a.storage_, b.storage_);
+    swap(a.offset_, b.offset_);
+    swap(a.size_, b.size_);
+  }
+
+ private:
+  struct Storage {
+    explicit Storage(size_t capacity)
+        : data(new uint8_t[capacity]), capacity(capacity) {}
+    scoped_ptr<uint8_t[]> data;
+    const size_t capacity;
+  };
+
+  CopyOnWriteBuffer(size_t size, size_t capacity, size_t headroom);
+
+  // Gives this buffer its own storage of at least |capacity| bytes plus the
+  // current headroom, if the storage is shared with other buffers.
+  void CloneDataIfReferenced(size_t capacity);
+
+  // Precondition and postcondition for all methods.
+  bool IsConsistent() const {
+    return storage_ ? offset_ + size_ <= storage_->capacity
+                    : (offset_ == 0 && size_ == 0);
+  }
+
+  scoped_refptr<RefCountedObject<Storage>> storage_;
+  // Headroom in front of the data.
+  size_t offset_;
+  size_t size_;
+};
+
+}  // namespace rtc
+
+#endif  // WEBRTC_BASE_COPYONWRITEBUFFER_H_
@@ -0,0 +1,191 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/base/copyonwritebuffer.h"
+#include "webrtc/base/gunit.h"
+
+namespace rtc {
+
+namespace {
+
+// clang-format off
+const uint8_t kTestData[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7,
+                             0x8, 0x9, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf};
+// clang-format on
+
+void TestBuf(const CopyOnWriteBuffer& b1, size_t size, size_t capacity) {
+  EXPECT_EQ(b1.size(), size);
+  EXPECT_EQ(b1.capacity(), capacity);
+}
+
+}  // namespace
+
+TEST(CopyOnWriteBufferTest, TestConstructEmpty) {
+  TestBuf(CopyOnWriteBuffer(), 0, 0);
+  TestBuf(CopyOnWriteBuffer(CopyOnWriteBuffer()), 0, 0);
+  TestBuf(CopyOnWriteBuffer(0), 0, 0);
+  TestBuf(CopyOnWriteBuffer(0 + 0, 10), 0, 10);
+  TestBuf(CopyOnWriteBuffer(kTestData, 0), 0, 0);
+  TestBuf(CopyOnWriteBuffer(kTestData, 0, 20), 0, 20);
+}
+
+TEST(CopyOnWriteBufferTest, TestConstructData) {
+  CopyOnWriteBuffer buf(kTestData, 7, 14);
+  EXPECT_EQ(buf.size(), 7u);
+  EXPECT_EQ(buf.capacity(), 14u);
+  EXPECT_EQ(buf.headroom(), 0u);
+  EXPECT_EQ(0, memcmp(buf.cdata(), kTestData, 7));
+
+  CopyOnWriteBuffer array(kTestData);
+  EXPECT_EQ(array.size(), 16u);
+  EXPECT_EQ(0, memcmp(array.cdata(), kTestData, 16));
+}
+
+TEST(CopyOnWriteBufferTest, TestConstructWithHeadroom) {
+  CopyOnWriteBuffer buf(kTestData, 7, 14, 4);
+  EXPECT_EQ(buf.size(), 7u);
+  EXPECT_EQ(buf.capacity(), 14u);
+  EXPECT_EQ(buf.headroom(), 4u);
+  EXPECT_EQ(0, memcmp(buf.cdata(), kTestData, 7));
+
+  // The headroom can be written to in front of the data.
+  uint8_t* data = buf.data();
+  memset(data - 4, 0xff, 4);
+  EXPECT_EQ(0, memcmp(buf.cdata(), kTestData, 7));
+}
+
+TEST(CopyOnWriteBufferTest, TestCopySharesData) {
+  CopyOnWriteBuffer buf1(kTestData, 3, 10);
+  EXPECT_FALSE(buf1.IsShared());
+  CopyOnWriteBuffer buf2(buf1);
+  EXPECT_TRUE(buf1.IsShared());
+  EXPECT_TRUE(buf2.IsShared());
+  EXPECT_EQ(buf1.cdata(), buf2.cdata());
+  EXPECT_EQ(buf1, buf2);
+
+  // Const access doesn't copy.
+  const CopyOnWriteBuffer& const_buf = buf2;
+  EXPECT_EQ(buf1.cdata(), const_buf.data());
+  EXPECT_EQ(buf1[1], const_buf[1]);
+
+  CopyOnWriteBuffer buf3;
+  buf3 = buf1;
+  EXPECT_EQ(buf1.cdata(), buf3.cdata());
+}
+
+TEST(CopyOnWriteBufferTest, TestWriteCopiesSharedData) {
+  CopyOnWriteBuffer buf1(kTestData, 3, 10, 4), buf2(buf1);
+  const uint8_t* shared = buf1.cdata();
+
+  uint8_t* data = buf2.data();
+  EXPECT_NE(shared, data);
+  EXPECT_EQ(shared, buf1.cdata());
+  EXPECT_FALSE(buf1.IsShared());
+  EXPECT_FALSE(buf2.IsShared());
+  // The copy keeps the size, capacity and headroom.
+  TestBuf(buf2, 3, 10);
+  EXPECT_EQ(buf2.headroom(), 4u);
+
+  data[0] = 0xaa;
+  EXPECT_EQ(0x0, buf1[0]);
+  EXPECT_EQ(0xaa, buf2[0]);
+  EXPECT_NE(buf1, buf2);
+
+  // Writing to an unshared buffer doesn't copy.
+  EXPECT_EQ(data, buf2.data());
+}
+
+TEST(CopyOnWriteBufferTest, TestSetSize) {
+  CopyOnWriteBuffer buf1(kTestData, 8, 16), buf2(buf1);
+  const uint8_t* shared = buf1.cdata();
+
+  // Shrinking only changes the view.
+  buf2.SetSize(4);
+  EXPECT_EQ(shared, buf2.cdata());
+  EXPECT_EQ(buf1.size(), 8u);
+  TestBuf(buf2, 4, 16);
+
+  // Growing within the capacity unshares the storage.
+  buf2.SetSize(12);
+  EXPECT_NE(shared, buf2.cdata());
+  EXPECT_EQ(shared, buf1.cdata());
+  EXPECT_EQ(0, memcmp(buf2.cdata(), kTestData, 4));
+  TestBuf(buf2, 12, 16);
+
+  // Growing beyond the capacity reallocates.
+  buf2.SetSize(20);
+  TestBuf(buf2, 20, 20);
+  EXPECT_EQ(0, memcmp(buf2.cdata(), kTestData, 4));
+}
+
+TEST(CopyOnWriteBufferTest, TestEnsureCapacityKeepsHeadroom) {
+  CopyOnWriteBuffer buf(kTestData, 7, 7, 4);
+  buf.EnsureCapacity(32);
+  TestBuf(buf, 7, 32);
+  EXPECT_EQ(buf.headroom(), 4u);
+  EXPECT_EQ(0, memcmp(buf.cdata(), kTestData, 7));
+}
+
+TEST(CopyOnWriteBufferTest, TestAppendData) {
+  CopyOnWriteBuffer buf1(kTestData, 3, 16), buf2(buf1);
+  buf2.AppendData(kTestData + 3, 5);
+  EXPECT_EQ(buf1.size(), 3u);
+  EXPECT_EQ(buf2.size(), 8u);
+  EXPECT_EQ(0, memcmp(buf2.cdata(), kTestData, 8));
+
+  const uint8_t* data = buf2.cdata();
+  buf2.AppendData(kTestData + 8, 8);
+  EXPECT_EQ(data, buf2.cdata());
+  EXPECT_EQ(buf2, CopyOnWriteBuffer(kTestData));
+}
+
+TEST(CopyOnWriteBufferTest, TestSetDataReusesStorage) {
+  CopyOnWriteBuffer buf(kTestData, 4, 16, 4);
+  const uint8_t* data = buf.cdata();
+  buf.SetData(kTestData, 12);
+  EXPECT_EQ(data, buf.cdata());
+  EXPECT_EQ(buf.headroom(), 4u);
+  EXPECT_EQ(0, memcmp(buf.cdata(), kTestData, 12));
+
+  // Shared storage is left to the other holder; the capacity is kept.
+  CopyOnWriteBuffer other(buf);
+  buf.SetData(kTestData + 8, 8);
+  EXPECT_NE(data, buf.cdata());
+  EXPECT_EQ(data, other.cdata());
+  EXPECT_EQ(0, memcmp(other.cdata(), kTestData, 12));
+  TestBuf(buf, 8, 16);
+  EXPECT_EQ(buf.headroom(), 4u);
+}
+
+TEST(CopyOnWriteBufferTest, TestMoveAndSwap) {
+  CopyOnWriteBuffer buf1(kTestData, 3, 10, 2), buf2(kTestData, 6);
+  const uint8_t* data1 = buf1.cdata();
+  const uint8_t* data2 = buf2.cdata();
+  swap(buf1, buf2);
+  EXPECT_EQ(data1, buf2.cdata());
+  EXPECT_EQ(data2, buf1.cdata());
+  EXPECT_EQ(buf2.headroom(), 2u);
+
+  CopyOnWriteBuffer buf3(buf2.Pass());
+  EXPECT_EQ(data1, buf3.cdata());
+  EXPECT_FALSE(buf3.IsShared());
+  TestBuf(buf2, 0, 0);
+  EXPECT_EQ(buf2.cdata(), nullptr);
+
+  buf1 = buf3.Pass();
+  EXPECT_EQ(data1, buf1.cdata());
+  TestBuf(buf3, 0, 0);
+
+  buf1.Clear();
+  TestBuf(buf1, 0, 0);
+  EXPECT_EQ(buf1.headroom(), 0u);
+}
+
+}  // namespace rtc
@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/base/hmacsha1.h"
+
+#include <string.h>
+
+namespace rtc {
+
+namespace {
+
+const size_t kBlockSize = 64;
+
+#if SSL_USE_OPENSSL
+void Init(SHA_CTX* ctx) {
+  SHA1_Init(ctx);
+}
+void Update(SHA_CTX* ctx, const void* data, size_t len) {
+  SHA1_Update(ctx, data, len);
+}
+void Final(SHA_CTX* ctx, uint8* digest) {
+  SHA1_Final(digest, ctx);
+}
+#else
+void Init(SHA1_CTX* ctx) {
+  SHA1Init(ctx);
+}
+void Update(SHA1_CTX* ctx, const void* data, size_t len) {
+  SHA1Update(ctx, static_cast<const uint8*>(data), len);
+}
+void Final(SHA1_CTX* ctx, uint8* digest) {
+  SHA1Final(ctx, digest);
+}
+#endif
+
+}  // namespace
+
+HmacSha1::HmacSha1() {
+  SetKey(NULL, 0);
+}
+
+HmacSha1::HmacSha1(const void* key, size_t key_len) {
+  SetKey(key, key_len);
+}
+
+HmacSha1::HmacSha1(const std::string& key) {
+  SetKey(key.data(), key.size());
+}
+
+void HmacSha1::SetKey(const void* key, size_t key_len) {
+  // Keys longer than a block are replaced by their hash.
+  uint8 block[kBlockSize] = { 0 };
+  if (key_len > kBlockSize) {
+    Context ctx;
+    Init(&ctx);
+    Update(&ctx, key, key_len);
+    Final(&ctx, block);
+  } else if (key_len > 0) {
+    memcpy(block, key, key_len);
+  }
+
+  uint8 pad[kBlockSize];
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    pad[i] = block[i] ^ 0x36;
+  }
+  Init(&inner_);
+  Update(&inner_, pad, kBlockSize);
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    pad[i] = block[i] ^ 0x5c;
+  }
+  Init(&outer_);
+  Update(&outer_, pad, kBlockSize);
+}
+
+void HmacSha1::Compute(const void* input, size_t len, void* output) const {
+  Compute(input, len, NULL, 0, output);
+}
+
+void HmacSha1::Compute(const void* input1, size_t len1,
+                       const void* input2, size_t len2,
+                       void* output) const {
+  uint8 inner_digest[kSize];
+  Context ctx = inner_;
+  Update(&ctx, input1, len1);
+  if (len2 > 0) {
+    Update(&ctx, input2, len2);
+  }
+  Final(&ctx, inner_digest);
+
+  ctx = outer_;
+  Update(&ctx, inner_digest, kSize);
+  Final(&ctx, static_cast<uint8*>(output));
+}
+
+}  // namespace rtc
@@ -0,0 +1,68 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_BASE_HMACSHA1_H_
+#define WEBRTC_BASE_HMACSHA1_H_
+
+#include <string>
+
+#include "webrtc/base/basictypes.h"
+#include "webrtc/base/sslconfig.h"
+#if SSL_USE_OPENSSL
+#include <openssl/sha.h>
+#else
+#include "webrtc/base/sha1.h"
+#endif
+
+namespace rtc {
+
+// HMAC-SHA1 (RFC 2104) with a precomputed key. SetKey() hashes the inner and
+// outer key pads once; Compute() then starts from copies of those states, so
+// each MAC costs only the compressions for the input and the outer hash,
+// without any allocation. Useful for STUN MESSAGE-INTEGRITY, where the same
+// ICE password keys every message of a session.
+//
+// Compute() does not modify the object, so a keyed HmacSha1 can be shared by
+// several threads.
+class HmacSha1 {
+ public:
+  enum { kSize = 20 };
+
+  // Creates an object keyed with the empty key.
+  HmacSha1();
+  HmacSha1(const void* key, size_t key_len);
+  explicit HmacSha1(const std::string& key);
+
+  void SetKey(const void* key, size_t key_len);
+  void SetKey(const std::string& key) { SetKey(key.data(), key.size()); }
+
+  // Writes the HMAC of |len| bytes of |input| to |output|, which must hold
+  // kSize bytes.
+  void Compute(const void* input, size_t len, void* output) const;
+  // Like Compute(), over |input1| followed by |input2|, for callers that
+  // need to patch part of a message without copying all of it.
+  void Compute(const void* input1, size_t len1,
+               const void* input2, size_t len2,
+               void* output) const;
+
+ private:
+#if SSL_USE_OPENSSL
+  typedef SHA_CTX Context;
+#else
+  typedef SHA1_CTX Context;
+#endif
+
+  Context inner_;
+  Context outer_;
+};
+
+}  // namespace rtc
+
+#endif  // WEBRTC_BASE_HMACSHA1_H_
@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "webrtc/base/gunit.h"
+#include "webrtc/base/hmacsha1.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/messagedigest.h"
+#include "webrtc/base/stringencode.h"
+#include "webrtc/base/timeutils.h"
+
+namespace rtc {
+
+static std::string Hmac(const std::string& key, const std::string& input) {
+  char output[HmacSha1::kSize];
+  HmacSha1(key).Compute(input.data(), input.size(), output);
+  return hex_encode(output, sizeof(output));
+}
+
+// Test vectors from RFC 2202.
+TEST(HmacSha1Test, TestVectors) {
+  EXPECT_EQ("b617318655057264e28bc0b6fb378c8ef146be00",
+      Hmac(std::string(20, '\x0b'), "Hi There"));
+  EXPECT_EQ("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79",
+      Hmac("Jefe", "what do ya want for nothing?"));
+  EXPECT_EQ("125d7342b9ac11cd91a39af48aa17b4f63f175d3",
+      Hmac(std::string(20, '\xaa'), std::string(50, '\xdd')));
+  EXPECT_EQ("4c1a03424b55e07fe7f27be1d58bb9324a9a5a04",
+      Hmac(std::string(20, '\x0c'), "Test With Truncation"));
+  EXPECT_EQ("aa4ae5e15272d00e95705637ce8a3b55ed402112",
+      Hmac(std::string(80, '\xaa'),
+           "Test Using Larger Than Block-Size Key - Hash Key First"));
+  EXPECT_EQ("e8e99d0f45237d786d6bbaa7965c7808bbff1a91",
+      Hmac(std::string(80, '\xaa'),
+           "Test Using Larger Than Block-Size Key and Larger "
+           "Than One Block-Size Data"));
+}
+
+// A keyed object can be reused and rekeyed.
+TEST(HmacSha1Test, TestReuseAndRekey) {
+  HmacSha1 hmac;
+  char first[HmacSha1::kSize];
+  char second[HmacSha1::kSize];
+  hmac.Compute("abc", 3, first);
+  EXPECT_EQ(ComputeHmac(DIGEST_SHA_1, "", "abc"),
+            hex_encode(first, sizeof(first)));
+
+  hmac.SetKey("Jefe");
+  hmac.Compute("abc", 3, first);
+  hmac.Compute("abc", 3, second);
+  EXPECT_EQ(0, memcmp(first, second, sizeof(first)));
+  EXPECT_EQ(ComputeHmac(DIGEST_SHA_1, "Jefe", "abc"),
+            hex_encode(first, sizeof(first)));
+
+  // Split input.
+  hmac.Compute("a", 1, "bc", 2, second);
+  EXPECT_EQ(0, memcmp(first, second, sizeof(first)));
+}
+
+// Compares against ComputeHmac(), which rederives the key pads and allocates
+// a digest for every message, on inputs the size of a STUN binding request.
+TEST(HmacSha1Test, Perf) {
+  const int kIterations = 200000;
+  const std::string key("0123456789abcdefghijkl");
+  char input[80] = { 0 };
+  char output[HmacSha1::kSize];
+
+  uint32 start = Time();
+  for (int i = 0; i < kIterations; ++i) {
+    input[0] = static_cast<char>(i);
+    ComputeHmac(DIGEST_SHA_1, key.data(), key.size(), input, sizeof(input),
+                output, sizeof(output));
+  }
+  uint32 uncached_elapsed = TimeSince(start);
+
+  HmacSha1 hmac(key);
+  start = Time();
+  for (int i = 0; i < kIterations; ++i) {
+    input[0] = static_cast<char>(i);
+    hmac.Compute(input, sizeof(input), output);
+  }
+  uint32 cached_elapsed = TimeSince(start);
+
+  LOG(LS_INFO) << "ComputeHmac: "
+               << kIterations * 1000.0 / std::max(uncached_elapsed, 1U)
+               << " MACs/s, HmacSha1: "
+               << kIterations * 1000.0 / std::max(cached_elapsed, 1U)
+               << " MACs/s";
+}
+
+}  // namespace rtc
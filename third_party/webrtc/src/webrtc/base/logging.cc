@@ -37,6 +37,8 @@ static const char kLibjingle[] = "libjingle";
 #include <ostream>
 #include <vector>
 
+#include "webrtc/base/atomicops.h"
+#include "webrtc/base/event.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/platform_thread.h"
 #include "webrtc/base/scoped_ptr.h"
@@ -47,6 +49,9 @@ static const char kLibjingle[] = "libjingle";
 namespace rtc {
 namespace {
 
+// Thread safe streams beyond this number are called under the lock.
+const size_t kMaxUnlockedStreams = 4;
+
 // Return the filename portion of the string (that following the last slash).
 const char* FilenameFromPath(const char* file) {
   const char* end1 = ::strrchr(file, '/');
@@ -198,13 +203,29 @@ LogMessage::~LogMessage() {
   }
 
   uint32 before = Time();
-  // Must lock streams_ before accessing
-  CritScope cs(&crit_);
-  for (StreamList::iterator it = streams_.begin(); it != streams_.end(); ++it) {
-    if (severity_ >= it->second) {
-      it->first->OnLogMessage(str);
+  // Thread safe streams are called once the lock is released. Their entries
+  // stay in place until the calls are done, see RemoveLogToStream().
+  StreamAndSeverity* unlocked[kMaxUnlockedStreams];
+  size_t num_unlocked = 0;
+  {
+    // Must lock streams_ before accessing
+    CritScope cs(&crit_);
+    for (StreamAndSeverity& entry : streams_) {
+      if (severity_ < entry.min_sev) {
+        continue;
+      }
+      if (entry.thread_safe && num_unlocked < kMaxUnlockedStreams) {
+        AtomicOps::Increment(&entry.calls);
+        unlocked[num_unlocked++] = &entry;
+      } else {
+        entry.stream->OnLogMessage(str);
+      }
     }
   }
+  for (size_t i = 0; i < num_unlocked; ++i) {
+    unlocked[i]->stream->OnLogMessage(str);
+    AtomicOps::Decrement(&unlocked[i]->calls);
+  }
   uint32 delay = TimeSince(before);
   if (delay >= warn_slow_logs_delay_) {
     rtc::LogMessage slow_log_warning(__FILE__, __LINE__, LS_WARNING);
@@ -249,8 +270,8 @@ int LogMessage::GetLogToStream(LogSink* stream) {
   CritScope cs(&crit_);
   LoggingSeverity sev = LS_NONE;
   for (StreamList::iterator it = streams_.begin(); it != streams_.end(); ++it) {
-    if (!stream || stream == it->first) {
-      sev = std::min(sev, it->second);
+    if (!stream || stream == it->stream) {
+      sev = std::min(sev, it->min_sev);
     }
   }
   return sev;
@@ -258,19 +279,30 @@ int LogMessage::GetLogToStream(LogSink* stream) {
 
 void LogMessage::AddLogToStream(LogSink* stream, LoggingSeverity min_sev) {
   CritScope cs(&crit_);
-  streams_.push_back(std::make_pair(stream, min_sev));
+  streams_.push_back(StreamAndSeverity(stream, min_sev));
   UpdateMinLogSeverity();
 }
 
 void LogMessage::RemoveLogToStream(LogSink* stream) {
-  CritScope cs(&crit_);
-  for (StreamList::iterator it = streams_.begin(); it != streams_.end(); ++it) {
-    if (stream == it->first) {
-      streams_.erase(it);
-      break;
+  // Keeps the entry alive until calls made without the lock have returned.
+  StreamList removed;
+  {
+    CritScope cs(&crit_);
+    for (StreamList::iterator it = streams_.begin(); it != streams_.end();
+         ++it) {
+      if (stream == it->stream) {
+        removed.splice(removed.end(), streams_, it);
+        break;
+      }
     }
+    UpdateMinLogSeverity();
+  }
+  // The calls only copy the message, so polling is enough.
+  Event never_set(false, false);
+  while (!removed.empty() &&
+         AtomicOps::AcquireLoad(&removed.front().calls) != 0) {
+    never_set.Wait(1);
   }
-  UpdateMinLogSeverity();
 }
 
 void LogMessage::ConfigureLogging(const char* params) {
@@ -338,7 +370,7 @@ void LogMessage::ConfigureLogging(const char* params) {
 void LogMessage::UpdateMinLogSeverity() EXCLUSIVE_LOCKS_REQUIRED(crit_) {
   LoggingSeverity min_sev = dbg_sev_;
   for (StreamList::iterator it = streams_.begin(); it != streams_.end(); ++it) {
-    min_sev = std::min(dbg_sev_, it->second);
+    min_sev = std::min(dbg_sev_, it->min_sev);
   }
   min_sev_ = min_sev;
 }
@@ -127,6 +127,10 @@ class LogSink {
   LogSink() {}
   virtual ~LogSink() {}
   virtual void OnLogMessage(const std::string& message) = 0;
+  // Sinks that return true may be called on several threads at once, and
+  // are called without LogMessage's global lock, so that a logging thread
+  // doesn't wait while another one is in the sink.
+  virtual bool IsThreadSafe() const { return false; }
 };
 
 class LogMessage {
@@ -179,6 +183,7 @@ class LogMessage {
   //   GetLogToStream gets the severity for the specified stream, of if none
   //   is specified, the minimum stream severity.
   //   RemoveLogToStream removes the specified stream, without destroying it.
+  //   It waits for calls to a thread safe stream that are in progress.
   static int GetLogToStream(LogSink* stream = NULL);
   static void AddLogToStream(LogSink* stream, LoggingSeverity min_sev);
   static void RemoveLogToStream(LogSink* stream);
@@ -192,7 +197,16 @@ class LogMessage {
   static void ConfigureLogging(const char* params);
 
  private:
-  typedef std::pair<LogSink*, LoggingSeverity> StreamAndSeverity;
+  struct StreamAndSeverity {
+    StreamAndSeverity(LogSink* stream, LoggingSeverity min_sev)
+        : stream(stream), min_sev(min_sev),
+          thread_safe(stream->IsThreadSafe()), calls(0) {}
+    LogSink* stream;
+    LoggingSeverity min_sev;
+    bool thread_safe;
+    // Calls to a thread safe stream in progress outside |crit_|.
+    volatile int calls;
+  };
   typedef std::list<StreamAndSeverity> StreamList;
 
   // Updates min_sev_ appropriately when debug sinks change.
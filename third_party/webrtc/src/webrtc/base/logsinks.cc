@@ -10,9 +10,14 @@
 
 #include "webrtc/base/logsinks.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <string>
 
+#include "webrtc/base/atomicops.h"
 #include "webrtc/base/checks.h"
 
 namespace rtc {
@@ -61,4 +66,328 @@ CallSessionFileRotatingLogSink::CallSessionFileRotatingLogSink(
 CallSessionFileRotatingLogSink::~CallSessionFileRotatingLogSink() {
 }
 
+// A single-producer single-consumer ring of messages. Each message is stored
+// as a header with its length and sequence number, followed by its bytes. One
+// byte always stays free to tell a full ring from an empty one.
+class AsyncFileRotatingLogSink::Ring {
+ public:
+  explicit Ring(size_t capacity)
+      : size_(static_cast<int>(capacity + 1)),
+        data_(new char[capacity + 1]),
+        owned_(1),
+        read_pos_(0),
+        drain_end_(0),
+        write_pos_(0),
+        cached_read_pos_(0) {}
+
+  // Takes the ring for the calling thread if no other thread has it.
+  bool TryTake() { return AtomicOps::CompareAndSwap(&owned_, 0, 1) == 0; }
+  void Release() { AtomicOps::ReleaseStore(&owned_, 0); }
+
+  // Called by the owning thread. Returns false if |message| doesn't fit.
+  // Sets |*wake| when the ring has just filled up to the point where the
+  // writer should drain it.
+  bool Push(uint32 sequence, const std::string& message, bool* wake) {
+    const size_t record_size = sizeof(Header) + message.size();
+    const size_t capacity = static_cast<size_t>(size_ - 1);
+    const size_t wake_size = capacity / kWakeFraction;
+    int write = write_pos_;
+    size_t used = UsedBytes(cached_read_pos_, write);
+    if (used >= wake_size || record_size > capacity - used) {
+      // Only look at the writer's position, and its cache line, when the
+      // ring seems to need draining. Once the writer has caught up, this
+      // brings |used| back under |wake_size| so that the next time it gets
+      // there wakes the writer again.
+      cached_read_pos_ = AtomicOps::AcquireLoad(&read_pos_);
+      used = UsedBytes(cached_read_pos_, write);
+      if (record_size > capacity - used) {
+        return false;
+      }
+    }
+    Header header = { static_cast<uint32>(message.size()), sequence };
+    write = CopyIn(write, &header, sizeof(header));
+    write = CopyIn(write, message.data(), message.size());
+    AtomicOps::ReleaseStore(&write_pos_, write);
+    *wake = used < wake_size && used + record_size >= wake_size;
+    return true;
+  }
+
+  // Called by the writer thread: makes the messages queued so far available
+  // to Peek() and TakeNext().
+  void StartDrain() { drain_end_ = AtomicOps::AcquireLoad(&write_pos_); }
+  // Returns false if there is no message left to drain, otherwise gets the
+  // sequence number of the next one.
+  bool Peek(uint32* sequence) const {
+    if (read_pos_ == drain_end_) {
+      return false;
+    }
+    Header header;
+    CopyOut(read_pos_, &header, sizeof(header));
+    *sequence = header.sequence;
+    return true;
+  }
+  // Appends the next message to |batch| and hands its space back.
+  void TakeNext(std::string* batch) {
+    Header header;
+    int read = CopyOut(read_pos_, &header, sizeof(header));
+    size_t first = std::min(static_cast<size_t>(header.length),
+                            static_cast<size_t>(size_ - read));
+    batch->append(data_.get() + read, first);
+    batch->append(data_.get(), header.length - first);
+    // Hand the space back right away, the ring may be close to full.
+    AtomicOps::ReleaseStore(&read_pos_,
+                            static_cast<int>((read + header.length) % size_));
+  }
+
+ private:
+  // The writer is woken when a ring is this fraction full. Each wakeup costs
+  // a system call, but the writer holds the processor for less time when it
+  // has less to write, which matters where logging threads and the writer
+  // share a core.
+  static const size_t kWakeFraction = 8;
+
+  struct Header {
+    uint32 length;
+    uint32 sequence;
+  };
+
+  // Copy |size| bytes into or out of the ring at |pos|, wrapping around the
+  // end. Return the position after the copied bytes.
+  int CopyIn(int pos, const void* data, size_t size) {
+    size_t first = std::min(size, static_cast<size_t>(size_ - pos));
+    memcpy(data_.get() + pos, data, first);
+    memcpy(data_.get(), static_cast<const char*>(data) + first, size - first);
+    return static_cast<int>((pos + size) % size_);
+  }
+  int CopyOut(int pos, void* data, size_t size) const {
+    size_t first = std::min(size, static_cast<size_t>(size_ - pos));
+    memcpy(data, data_.get() + pos, first);
+    memcpy(static_cast<char*>(data) + first, data_.get(), size - first);
+    return static_cast<int>((pos + size) % size_);
+  }
+  // The number of bytes between |read| and |write|.
+  size_t UsedBytes(int read, int write) const {
+    return static_cast<size_t>(
+        (write >= read) ? write - read : write + size_ - read);
+  }
+
+  const int size_;
+  scoped_ptr<char[]> data_;
+  // Set while a thread logs into the ring.
+  volatile int owned_;
+  // Next byte to read, and the end of the current drain; written by the
+  // writer thread only.
+  volatile int read_pos_;
+  int drain_end_;
+  // Next byte to write; written by the owning thread only.
+  volatile int write_pos_;
+  // The owning thread's last look at |read_pos_|.
+  int cached_read_pos_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(Ring);
+};
+
+const size_t AsyncFileRotatingLogSink::kDefaultBufferSize;
+const int AsyncFileRotatingLogSink::kWriteIntervalMs;
+const size_t AsyncFileRotatingLogSink::kMaxBatchSize;
+
+AsyncFileRotatingLogSink::AsyncFileRotatingLogSink(
+    const std::string& log_dir_path,
+    const std::string& log_prefix,
+    size_t max_log_size,
+    size_t num_log_files,
+    size_t buffer_size)
+    : AsyncFileRotatingLogSink(new FileRotatingStream(log_dir_path,
+                                                      log_prefix,
+                                                      max_log_size,
+                                                      num_log_files),
+                               buffer_size) {
+}
+
+AsyncFileRotatingLogSink::AsyncFileRotatingLogSink(FileRotatingStream* stream,
+                                                   size_t buffer_size)
+    : stream_(stream),
+      buffer_size_(buffer_size),
+      started_(false),
+      wake_(false, false),
+      flushed_(false, false),
+      flush_requests_(0),
+      stop_(0),
+      next_sequence_(0),
+      dropped_messages_(0),
+      reported_drops_(0) {
+  RTC_DCHECK(stream);
+  RTC_DCHECK_GT(buffer_size, 0u);
+#if defined(WEBRTC_POSIX)
+  pthread_key_create(&ring_key_, &AsyncFileRotatingLogSink::ReleaseRing);
+#elif defined(WEBRTC_WIN)
+  ring_key_ = TlsAlloc();
+#endif
+}
+
+AsyncFileRotatingLogSink::~AsyncFileRotatingLogSink() {
+  AtomicOps::ReleaseStore(&stop_, 1);
+  wake_.Set();
+  thread_.Stop();
+  // Threads that exit from now on no longer release their rings.
+#if defined(WEBRTC_POSIX)
+  pthread_key_delete(ring_key_);
+#elif defined(WEBRTC_WIN)
+  TlsFree(ring_key_);
+#endif
+  CritScope cs(&rings_crit_);
+  for (Ring* ring : rings_) {
+    delete ring;
+  }
+}
+
+void AsyncFileRotatingLogSink::OnLogMessage(const std::string& message) {
+  if (!started_) {
+    std::cerr << "Init() must be called before adding this sink." << std::endl;
+    return;
+  }
+  Ring* ring = GetRing();
+  uint32 sequence =
+      static_cast<uint32>(AtomicOps::Increment(&next_sequence_));
+  bool wake;
+  if (!ring->Push(sequence, message, &wake)) {
+    AtomicOps::Increment(&dropped_messages_);
+    return;
+  }
+  // Signaling takes a lock, so only wake the writer before its next round
+  // once the ring has filled up some.
+  if (wake) {
+    wake_.Set();
+  }
+}
+
+bool AsyncFileRotatingLogSink::Init() {
+  RTC_DCHECK(!started_);
+  if (!stream_->Open()) {
+    return false;
+  }
+  started_ = thread_.Start(this);
+  return started_;
+}
+
+void AsyncFileRotatingLogSink::Flush() {
+  if (!started_) {
+    return;
+  }
+  AtomicOps::Increment(&flush_requests_);
+  wake_.Set();
+  flushed_.Wait(Event::kForever);
+}
+
+int AsyncFileRotatingLogSink::dropped_messages() const {
+  return AtomicOps::AcquireLoad(&dropped_messages_);
+}
+
+AsyncFileRotatingLogSink::Ring* AsyncFileRotatingLogSink::GetRing() {
+#if defined(WEBRTC_POSIX)
+  Ring* ring = static_cast<Ring*>(pthread_getspecific(ring_key_));
+#elif defined(WEBRTC_WIN)
+  Ring* ring = static_cast<Ring*>(TlsGetValue(ring_key_));
+#endif
+  if (ring) {
+    return ring;
+  }
+
+  {
+    CritScope cs(&rings_crit_);
+    for (Ring* released : rings_) {
+      if (released->TryTake()) {
+        ring = released;
+        break;
+      }
+    }
+    if (!ring) {
+      ring = new Ring(buffer_size_);
+      rings_.push_back(ring);
+    }
+  }
+#if defined(WEBRTC_POSIX)
+  pthread_setspecific(ring_key_, ring);
+#elif defined(WEBRTC_WIN)
+  TlsSetValue(ring_key_, ring);
+#endif
+  return ring;
+}
+
+void AsyncFileRotatingLogSink::ReleaseRing(void* ring) {
+  static_cast<Ring*>(ring)->Release();
+}
+
+void AsyncFileRotatingLogSink::Run(Thread* thread) {
+  int flushes_done = 0;
+  bool stopping = false;
+  while (!stopping) {
+    wake_.Wait(kWriteIntervalMs);
+    stopping = AtomicOps::AcquireLoad(&stop_) != 0;
+    // Messages queued before a Flush() call are visible once its request is.
+    int flush_requests = AtomicOps::AcquireLoad(&flush_requests_);
+    // One flush per batch keeps the file about as current as an unbuffered
+    // stream would, without a system call per message.
+    if (WriteBufferedMessages() || flush_requests != flushes_done) {
+      stream_->Flush();
+    }
+    if (flush_requests != flushes_done) {
+      flushes_done = flush_requests;
+      flushed_.Set();
+    }
+  }
+}
+
+bool AsyncFileRotatingLogSink::WriteBufferedMessages() {
+  {
+    CritScope cs(&rings_crit_);
+    draining_.assign(rings_.begin(), rings_.end());
+  }
+  for (Ring* ring : draining_) {
+    ring->StartDrain();
+  }
+
+  // Merge the rings by sequence number. There are only as many rings as
+  // threads that log, so a linear search for the next message will do.
+  // Messages are gathered into |batch_| first, since copying them costs far
+  // less than a stream write each.
+  bool wrote = false;
+  while (true) {
+    Ring* next = nullptr;
+    uint32 next_sequence = 0;
+    for (Ring* ring : draining_) {
+      uint32 sequence;
+      if (ring->Peek(&sequence) &&
+          (!next || static_cast<int32>(sequence - next_sequence) < 0)) {
+        next = ring;
+        next_sequence = sequence;
+      }
+    }
+    if (!next) {
+      break;
+    }
+    next->TakeNext(&batch_);
+    if (batch_.size() >= kMaxBatchSize) {
+      stream_->WriteAll(batch_.data(), batch_.size(), nullptr, nullptr);
+      batch_.clear();
+    }
+    wrote = true;
+  }
+
+  int dropped = AtomicOps::AcquireLoad(&dropped_messages_);
+  if (dropped != reported_drops_) {
+    std::ostringstream note;
+    note << "Log buffer full, dropped " << (dropped - reported_drops_)
+         << " messages." << std::endl;
+    batch_ += note.str();
+    reported_drops_ = dropped;
+    wrote = true;
+  }
+  if (!batch_.empty()) {
+    stream_->WriteAll(batch_.data(), batch_.size(), nullptr, nullptr);
+    batch_.clear();
+  }
+  return wrote;
+}
+
 }  // namespace rtc
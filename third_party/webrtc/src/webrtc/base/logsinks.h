@@ -12,11 +12,15 @@
 #define WEBRTC_BASE_FILE_ROTATING_LOG_SINK_H_
 
 #include <string>
+#include <vector>
 
 #include "webrtc/base/constructormagic.h"
+#include "webrtc/base/criticalsection.h"
+#include "webrtc/base/event.h"
 #include "webrtc/base/filerotatingstream.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
 
 namespace rtc {
 
@@ -63,6 +67,101 @@ class CallSessionFileRotatingLogSink : public FileRotatingLogSink {
   RTC_DISALLOW_COPY_AND_ASSIGN(CallSessionFileRotatingLogSink);
 };
 
+// Log sink that writes to a FileRotatingStream on a background thread, so
+// that logging threads never wait for the disk or for each other. Each thread
+// that logs gets a ring buffer of its own on its first message, which the
+// writer thread drains without locking; OnLogMessage() only copies the
+// message into it. If the ring is full, the message is dropped and counted
+// instead; the writer notes the number of dropped messages in the log.
+// Messages from different threads are written in the order they were queued.
+// LogMessage calls this sink without holding its lock. On POSIX, the ring of
+// a thread that exits is reused by the next thread that logs.
+// Init() must be called before adding this sink.
+class AsyncFileRotatingLogSink : public LogSink, private Runnable {
+ public:
+  static const size_t kDefaultBufferSize = 256 * 1024;
+
+  // |num_log_files| must be greater than 1 and |max_log_size| must be greater
+  // than 0. |buffer_size| is the size of each thread's ring; messages larger
+  // than that are always dropped.
+  AsyncFileRotatingLogSink(const std::string& log_dir_path,
+                           const std::string& log_prefix,
+                           size_t max_log_size,
+                           size_t num_log_files,
+                           size_t buffer_size = kDefaultBufferSize);
+  // Writes out what is still buffered before returning. The sink must have
+  // been removed from LogMessage.
+  ~AsyncFileRotatingLogSink() override;
+
+  // Queues the message for the writer thread.
+  void OnLogMessage(const std::string& message) override;
+  bool IsThreadSafe() const override { return true; }
+
+  // Deletes any existing files in the directory, creates a new log file and
+  // starts the writer thread.
+  virtual bool Init();
+
+  // Blocks until all messages queued so far have been written and flushed to
+  // disk. Must not be called on several threads at once.
+  void Flush();
+
+  // The number of messages dropped because a ring was full.
+  int dropped_messages() const;
+
+ protected:
+  AsyncFileRotatingLogSink(FileRotatingStream* stream, size_t buffer_size);
+
+ private:
+  class Ring;
+
+  // How often the writer thread drains the rings if it isn't woken up.
+  static const int kWriteIntervalMs = 100;
+  // The most the writer thread gathers before writing to the stream.
+  static const size_t kMaxBatchSize = 64 * 1024;
+
+  // Returns the calling thread's ring, which it takes on its first message.
+  Ring* GetRing();
+  // Called when a thread that has a ring exits.
+  static void ReleaseRing(void* ring);
+
+  // Runs on |thread_| until the sink is destroyed.
+  void Run(Thread* thread) override;
+  // Writes out all complete messages in the rings. Returns true if there
+  // were any.
+  bool WriteBufferedMessages();
+
+  scoped_ptr<FileRotatingStream> stream_;
+  const size_t buffer_size_;
+  Thread thread_;
+  bool started_;
+  // Wakes the writer thread early, on Flush() or when a ring fills up.
+  Event wake_;
+  Event flushed_;
+  volatile int flush_requests_;
+  volatile int stop_;
+
+  // Each thread's ring.
+#if defined(WEBRTC_POSIX)
+  pthread_key_t ring_key_;
+#elif defined(WEBRTC_WIN)
+  DWORD ring_key_;
+#endif
+  // Only taken when a thread takes a ring, and by the writer thread.
+  CriticalSection rings_crit_;
+  std::vector<Ring*> rings_ GUARDED_BY(rings_crit_);
+  // The writer thread's copy of |rings_|.
+  std::vector<Ring*> draining_;
+  // Messages the writer thread has taken from the rings but not written yet.
+  std::string batch_;
+  // Orders messages across rings.
+  volatile int next_sequence_;
+  volatile int dropped_messages_;
+  // Drops the writer thread has noted in the log so far.
+  int reported_drops_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(AsyncFileRotatingLogSink);
+};
+
 }  // namespace rtc
 
 #endif  // WEBRTC_BASE_FILE_ROTATING_LOG_SINK_H_
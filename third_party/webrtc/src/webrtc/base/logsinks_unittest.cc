@@ -0,0 +1,246 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "webrtc/base/fileutils.h"
+#include "webrtc/base/gunit.h"
+#include "webrtc/base/logsinks.h"
+#include "webrtc/base/pathutils.h"
+#include "webrtc/base/stringencode.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
+
+namespace rtc {
+
+namespace {
+
+const char kFilePrefix[] = "AsyncFileRotatingLogSinkTest";
+const size_t kMaxFileSize = 64 * 1024;
+const size_t kNumLogFiles = 3;
+
+}  // namespace
+
+class AsyncFileRotatingLogSinkTest : public ::testing::Test {
+ protected:
+  void Init(const std::string& dir_name) {
+    Pathname test_path;
+    ASSERT_TRUE(Filesystem::GetAppTempFolder(&test_path));
+    // Append per-test output path in order to run within gtest parallel.
+    test_path.AppendFolder(dir_name);
+    ASSERT_TRUE(Filesystem::CreateFolder(test_path));
+    dir_path_ = test_path.pathname();
+    ASSERT_TRUE(dir_path_.size());
+  }
+
+  void TearDown() override {
+    if (dir_path_.size() && Filesystem::IsFolder(dir_path_) &&
+        Filesystem::IsTemporaryPath(dir_path_)) {
+      Filesystem::DeleteFolderAndContents(dir_path_);
+    }
+  }
+
+  // Reads back everything written to the log files, oldest first.
+  std::string ReadLog() {
+    FileRotatingStream stream(dir_path_, kFilePrefix);
+    EXPECT_TRUE(stream.Open());
+    size_t size = 0;
+    EXPECT_TRUE(stream.GetSize(&size));
+    std::string contents(size, '\0');
+    if (size > 0) {
+      EXPECT_EQ(SR_SUCCESS,
+                stream.ReadAll(&contents[0], size, nullptr, nullptr));
+    }
+    return contents;
+  }
+
+  std::string dir_path_;
+};
+
+// Messages are written in order, also when they wrap around the end of the
+// ring buffer.
+TEST_F(AsyncFileRotatingLogSinkTest, WritesMessagesInOrder) {
+  Init("AsyncFileRotatingLogSinkTestWritesMessagesInOrder");
+  std::string expected;
+  {
+    AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kMaxFileSize,
+                                  kNumLogFiles, 100);
+    ASSERT_TRUE(sink.Init());
+    for (int i = 0; i < 50; ++i) {
+      std::string message = "Message " + ToString(i) + "\n";
+      sink.OnLogMessage(message);
+      expected += message;
+      if (i % 4 == 3) {
+        sink.Flush();
+      }
+    }
+    sink.Flush();
+    EXPECT_EQ(0, sink.dropped_messages());
+    EXPECT_EQ(expected, ReadLog());
+
+    // Whatever is still buffered is written when the sink goes away.
+    sink.OnLogMessage("Last\n");
+    expected += "Last\n";
+  }
+  EXPECT_EQ(expected, ReadLog());
+}
+
+// A message that doesn't fit is dropped, not waited for, and the drop is
+// noted in the log.
+TEST_F(AsyncFileRotatingLogSinkTest, DropsWhenFull) {
+  Init("AsyncFileRotatingLogSinkTestDropsWhenFull");
+  AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kMaxFileSize,
+                                kNumLogFiles, 64);
+  ASSERT_TRUE(sink.Init());
+  sink.OnLogMessage("Before\n");
+  sink.OnLogMessage(std::string(64, 'X'));
+  sink.OnLogMessage("After\n");
+  sink.Flush();
+  EXPECT_EQ(1, sink.dropped_messages());
+  EXPECT_EQ("Before\nAfter\nLog buffer full, dropped 1 messages.\n",
+            ReadLog());
+}
+
+// Each thread has its own ring, but messages are still written in the order
+// they were queued.
+TEST_F(AsyncFileRotatingLogSinkTest, WritesThreadsInOrder) {
+  Init("AsyncFileRotatingLogSinkTestWritesThreadsInOrder");
+  AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kMaxFileSize,
+                                kNumLogFiles);
+  ASSERT_TRUE(sink.Init());
+  Thread worker;
+  worker.Start();
+  sink.OnLogMessage("Main 1\n");
+  worker.Invoke<void>([&sink]() { sink.OnLogMessage("Worker 1\n"); });
+  sink.OnLogMessage("Main 2\n");
+  worker.Invoke<void>([&sink]() { sink.OnLogMessage("Worker 2\n"); });
+  sink.Flush();
+  EXPECT_EQ("Main 1\nWorker 1\nMain 2\nWorker 2\n", ReadLog());
+}
+
+// Threads log at the same time without losing or reordering their messages.
+TEST_F(AsyncFileRotatingLogSinkTest, LogsFromSeveralThreads) {
+  Init("AsyncFileRotatingLogSinkTestLogsFromSeveralThreads");
+  const int kNumThreads = 4;
+  const int kNumMessages = 1000;
+  AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kMaxFileSize * 16,
+                                kNumLogFiles);
+  ASSERT_TRUE(sink.Init());
+  {
+    scoped_ptr<Thread> threads[kNumThreads];
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads[t].reset(new Thread());
+      threads[t]->Start();
+      threads[t]->PostTask([&sink, t, kNumMessages]() {
+        for (int i = 0; i < kNumMessages; ++i) {
+          sink.OnLogMessage(ToString(t) + " " + ToString(i) + "\n");
+        }
+      });
+    }
+    // Stopping the threads waits for their tasks.
+  }
+  sink.Flush();
+  EXPECT_EQ(0, sink.dropped_messages());
+
+  std::istringstream log(ReadLog());
+  int next[kNumThreads] = {0};
+  int t, i;
+  while (log >> t >> i) {
+    ASSERT_TRUE(t >= 0 && t < kNumThreads);
+    EXPECT_EQ(next[t], i);
+    next[t] = i + 1;
+  }
+  for (t = 0; t < kNumThreads; ++t) {
+    EXPECT_EQ(kNumMessages, next[t]);
+  }
+}
+
+TEST_F(AsyncFileRotatingLogSinkTest, RequiresInit) {
+  Init("AsyncFileRotatingLogSinkTestRequiresInit");
+  AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kMaxFileSize,
+                                kNumLogFiles);
+  sink.OnLogMessage("Ignored\n");
+  sink.Flush();
+  EXPECT_EQ(0, sink.dropped_messages());
+}
+
+// Measures the cost of an LS_VERBOSE log call on a worker thread, with the
+// file written on the calling thread versus in the background. Formatting
+// dominates the average; the tail shows the time spent waiting for the disk
+// or for the writer thread.
+TEST_F(AsyncFileRotatingLogSinkTest, Perf) {
+  Init("AsyncFileRotatingLogSinkTestPerf");
+  const int kNumMessages = 20000;
+  // Large enough that neither sink rotates files during the test.
+  const size_t kPerfMaxFileSize = 16 * 1024 * 1024;
+  const std::string message(80, 'X');
+  const LoggingSeverity old_debug_sev = LogMessage::GetLogToDebug();
+  LogMessage::LogToDebug(LS_INFO);
+  Thread worker;
+  worker.Start();
+
+  // The duration of each call, sorted.
+  std::vector<uint64> call_ns(kNumMessages);
+  auto log_loop = [&message, &call_ns, kNumMessages]() {
+    uint64 before = TimeNanos();
+    for (int i = 0; i < kNumMessages; ++i) {
+      LOG(LS_VERBOSE) << message;
+      uint64 after = TimeNanos();
+      call_ns[i] = after - before;
+      before = after;
+    }
+    std::sort(call_ns.begin(), call_ns.end());
+  };
+  auto report = [&call_ns, kNumMessages](const char* name) {
+    uint64 total_ns = 0;
+    for (uint64 ns : call_ns) {
+      total_ns += ns;
+    }
+    LOG(LS_INFO) << name << ": average "
+                 << static_cast<double>(total_ns) / kNumMessages / 1000
+                 << " us, 99% " << call_ns[kNumMessages * 99 / 100] / 1000.0
+                 << " us, 99.9% "
+                 << call_ns[kNumMessages * 999 / 1000] / 1000.0
+                 << " us, max " << call_ns.back() / 1000.0 << " us";
+  };
+
+  {
+    FileRotatingLogSink sink(dir_path_, kFilePrefix, kPerfMaxFileSize,
+                             kNumLogFiles);
+    ASSERT_TRUE(sink.Init());
+    LogMessage::AddLogToStream(&sink, LS_VERBOSE);
+    worker.Invoke<void>(log_loop);
+    LogMessage::RemoveLogToStream(&sink);
+  }
+  report("LS_VERBOSE log call with FileRotatingLogSink");
+
+  int dropped;
+  {
+    AsyncFileRotatingLogSink sink(dir_path_, kFilePrefix, kPerfMaxFileSize,
+                                  kNumLogFiles);
+    ASSERT_TRUE(sink.Init());
+    LogMessage::AddLogToStream(&sink, LS_VERBOSE);
+    worker.Invoke<void>(log_loop);
+    LogMessage::RemoveLogToStream(&sink);
+    sink.Flush();
+    dropped = sink.dropped_messages();
+  }
+  report("LS_VERBOSE log call with AsyncFileRotatingLogSink");
+
+  worker.Stop();
+  LogMessage::LogToDebug(old_debug_sev);
+  LOG(LS_INFO) << dropped << " of " << kNumMessages
+               << " messages dropped by AsyncFileRotatingLogSink";
+}
+
+}  // namespace rtc
@@ -22,6 +22,7 @@
 typedef rtc::NullSocketServer DefaultSocketServer;
 #else
 #include "webrtc/base/physicalsocketserver.h"
+#include "webrtc/base/timerwheel.h"
 typedef rtc::PhysicalSocketServer DefaultSocketServer;
 #endif
 
@@ -29,6 +30,10 @@ namespace rtc {
 
 const uint32 kMaxMsgLatency = 150;  // 150 ms
 
+// Nodes kept for reuse by a queue, including those of finished tasks; a
+// larger backlog is freed as it drains.
+const size_t kMaxFreeMessageNodes = 256;
+
 //------------------------------------------------------------------
 // MessageQueueManager
 
@@ -118,7 +123,8 @@ void MessageQueueManager::ClearInternal(MessageHandler *handler) {
 
 MessageQueue::MessageQueue(SocketServer* ss)
     : ss_(ss), fStop_(false), fPeekKeep_(false),
-      dmsgq_next_num_(0) {
+      dmsgq_next_num_(0),
+      task_runner_(this) {
   if (!ss_) {
     // Currently, MessageQueue holds a socket server, and is the base class for
     // Thread.  It seems like it makes more sense for Thread to hold the socket
@@ -138,6 +144,7 @@ MessageQueue::~MessageQueue() {
   // is going away.
   SignalQueueDestroyed();
   MessageQueueManager::Remove(this);
+  timer_wheel_.reset();
   Clear(NULL);
   if (ss_) {
     ss_->SetMessageQueue(NULL);
@@ -334,6 +341,14 @@ void MessageQueue::DoDelayPost(int cmsDelay, uint32 tstamp,
   ss_->WakeUp();
 }
 
+TimerWheel* MessageQueue::timer_wheel() {
+  CritScope cs(&crit_);
+  if (!timer_wheel_) {
+    timer_wheel_.reset(new TimerWheel(this));
+  }
+  return timer_wheel_.get();
+}
+
 int MessageQueue::GetDelay() {
   CritScope cs(&crit_);
 
@@ -367,18 +382,7 @@ void MessageQueue::Clear(MessageHandler *phandler, uint32 id,
 
   // Remove from ordered message queue
 
-  for (MessageList::iterator it = msgq_.begin(); it != msgq_.end();) {
-    if (it->Match(phandler, id)) {
-      if (removed) {
-        removed->push_back(*it);
-      } else {
-        delete it->pdata;
-      }
-      it = msgq_.erase(it);
-    } else {
-      ++it;
-    }
-  }
+  msgq_.Remove(phandler, id, removed);
 
   // Remove from priority queue. Not directly iterable, so use this approach
 
@@ -403,4 +407,163 @@ void MessageQueue::Dispatch(Message *pmsg) {
   pmsg->phandler->OnMessage(pmsg);
 }
 
+QueuedTask* MessageQueue::NewTask() {
+  CritScope cs(&crit_);
+  return msgq_.NewTask();
+}
+
+void MessageQueue::PostQueuedTask(QueuedTask* task) {
+  if (fStop_) {
+    FreeTask(task);
+    return;
+  }
+
+  CritScope cs(&crit_);
+  Message msg;
+  msg.phandler = &task_runner_;
+  msg.pdata = task;
+  msgq_.push_back_task(msg);
+  ss_->WakeUp();
+}
+
+void MessageQueue::FreeTask(QueuedTask* task) {
+  // Destroy the callable outside the lock; its captures may post.
+  task->Reset();
+  CritScope cs(&crit_);
+  msgq_.FreeTask(task);
+}
+
+void MessageQueue::TaskRunner::OnMessage(Message* msg) {
+  QueuedTask* task = static_cast<QueuedTask*>(msg->pdata);
+  task->Run();
+  queue_->FreeTask(task);
+}
+
+//------------------------------------------------------------------
+// MessageQueue::ReadyQueue
+
+MessageQueue::ReadyQueue::ReadyQueue()
+    : head_(NULL), tail_(NULL), size_(0), free_(NULL), free_size_(0),
+      allocated_(0) {
+}
+
+MessageQueue::ReadyQueue::~ReadyQueue() {
+  while (head_) {
+    Node* node = head_;
+    head_ = node->next;
+    delete node;
+  }
+  while (free_) {
+    Node* node = free_;
+    free_ = node->next;
+    delete node;
+  }
+}
+
+void MessageQueue::ReadyQueue::push_back(const Message& msg) {
+  Node* node = NewNode();
+  node->msg = msg;
+  node->next = NULL;
+  if (tail_) {
+    tail_->next = node;
+  } else {
+    head_ = node;
+  }
+  tail_ = node;
+  ++size_;
+}
+
+void MessageQueue::ReadyQueue::push_back_task(const Message& msg) {
+  Node* node = static_cast<Node*>(static_cast<QueuedTask*>(msg.pdata));
+  node->msg = msg;
+  node->next = NULL;
+  if (tail_) {
+    tail_->next = node;
+  } else {
+    head_ = node;
+  }
+  tail_ = node;
+  ++size_;
+}
+
+void MessageQueue::ReadyQueue::pop_front() {
+  ASSERT(head_ != NULL);
+  Node* node = head_;
+  head_ = node->next;
+  if (!head_) {
+    tail_ = NULL;
+  }
+  --size_;
+  // A node that holds its message's task is freed after the task has run.
+  if (!HoldsTask(node)) {
+    FreeNode(node);
+  }
+}
+
+void MessageQueue::ReadyQueue::Remove(MessageHandler* phandler, uint32 id,
+                                      MessageList* removed) {
+  Node* prev = NULL;
+  Node* node = head_;
+  while (node) {
+    Node* next = node->next;
+    if (node->msg.Match(phandler, id)) {
+      if (prev) {
+        prev->next = next;
+      } else {
+        head_ = next;
+      }
+      if (tail_ == node) {
+        tail_ = prev;
+      }
+      --size_;
+      if (removed) {
+        removed->push_back(node->msg);
+        // Whoever deletes the task deletes its node.
+        if (!HoldsTask(node)) {
+          FreeNode(node);
+        }
+      } else if (HoldsTask(node)) {
+        node->Reset();
+        FreeNode(node);
+      } else {
+        delete node->msg.pdata;
+        FreeNode(node);
+      }
+    } else {
+      prev = node;
+    }
+    node = next;
+  }
+}
+
+QueuedTask* MessageQueue::ReadyQueue::NewTask() {
+  return NewNode();
+}
+
+void MessageQueue::ReadyQueue::FreeTask(QueuedTask* task) {
+  FreeNode(static_cast<Node*>(task));
+}
+
+MessageQueue::ReadyQueue::Node* MessageQueue::ReadyQueue::NewNode() {
+  Node* node = free_;
+  if (node) {
+    free_ = node->next;
+    --free_size_;
+  } else {
+    node = new Node;
+    ++allocated_;
+  }
+  return node;
+}
+
+void MessageQueue::ReadyQueue::FreeNode(Node* node) {
+  if (free_size_ >= kMaxFreeMessageNodes) {
+    delete node;
+    return;
+  }
+  node->next = free_;
+  free_ = node;
+  ++free_size_;
+}
+
 }  // namespace rtc
@@ -15,10 +15,14 @@
 
 #include <algorithm>
 #include <list>
+#include <new>
 #include <queue>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "webrtc/base/basictypes.h"
+#include "webrtc/base/common.h"
 #include "webrtc/base/constructormagic.h"
 #include "webrtc/base/criticalsection.h"
 #include "webrtc/base/messagehandler.h"
@@ -32,6 +36,7 @@ namespace rtc {
 
 struct Message;
 class MessageQueue;
+class TimerWheel;
 
 // MessageQueueManager does cleanup of of message queues
 
@@ -123,6 +128,126 @@ class DisposeData : public MessageData {
   T* data_;
 };
 
+// A thread safe free list of message data objects, for code that posts the
+// same kind of message at a high rate, e.g. one per packet. Get() an object,
+// post it, and Release() it from the handler instead of deleting it. Objects
+// that are deleted instead, e.g. by MessageQueue::Clear(), are simply not
+// reused. T must be default constructible and keeps its state, including
+// the capacity of any buffers, between uses.
+template <class T>
+class MessageDataPool {
+ public:
+  explicit MessageDataPool(size_t max_size)
+      : max_size_(max_size), allocated_(0) {
+    free_.reserve(max_size_);
+  }
+  ~MessageDataPool() {
+    for (T* data : free_) {
+      delete data;
+    }
+  }
+
+  T* Get() {
+    {
+      CritScope cs(&crit_);
+      if (!free_.empty()) {
+        T* data = free_.back();
+        free_.pop_back();
+        return data;
+      }
+      ++allocated_;
+    }
+    return new T();
+  }
+
+  void Release(T* data) {
+    {
+      CritScope cs(&crit_);
+      if (free_.size() < max_size_) {
+        free_.push_back(data);
+        return;
+      }
+    }
+    delete data;
+  }
+
+  // The number of objects allocated over the lifetime of the pool.
+  size_t allocated() const {
+    CritScope cs(&crit_);
+    return allocated_;
+  }
+
+ private:
+  const size_t max_size_;
+  size_t allocated_;
+  std::vector<T*> free_;
+  mutable CriticalSection crit_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(MessageDataPool);
+};
+
+// A callable posted with MessageQueue::PostTask(). Callables of up to
+// kInlineSize bytes, e.g. lambdas capturing a few pointers or a
+// scoped_refptr, are stored in the task itself; larger ones are allocated.
+// The queue embeds its tasks in its message nodes and recycles them, so
+// posting a small callable doesn't allocate once the queue has seen its usual
+// backlog.
+class QueuedTask : public MessageData {
+ public:
+  static const size_t kInlineSize = 48;
+
+  QueuedTask() : functor_(NULL), run_(NULL), destroy_(NULL) {}
+  ~QueuedTask() override { Reset(); }
+
+  template <class FunctorT>
+  void Set(FunctorT&& functor) {
+    typedef typename std::decay<FunctorT>::type F;
+    ASSERT(!functor_);
+    if (sizeof(F) <= kInlineSize &&
+        std::alignment_of<F>::value <= std::alignment_of<Storage>::value) {
+      functor_ = new (&storage_) F(std::forward<FunctorT>(functor));
+      destroy_ = &DestroyInline<F>;
+    } else {
+      functor_ = new F(std::forward<FunctorT>(functor));
+      destroy_ = &DestroyAllocated<F>;
+    }
+    run_ = &Run<F>;
+  }
+
+  void Run() { run_(functor_); }
+
+  // Destroys the callable, and with it anything it captured.
+  void Reset() {
+    if (functor_) {
+      destroy_(functor_);
+      functor_ = NULL;
+    }
+  }
+
+ private:
+  typedef std::aligned_storage<kInlineSize>::type Storage;
+
+  template <class F>
+  static void Run(void* functor) {
+    (*static_cast<F*>(functor))();
+  }
+  template <class F>
+  static void DestroyInline(void* functor) {
+    static_cast<F*>(functor)->~F();
+  }
+  template <class F>
+  static void DestroyAllocated(void* functor) {
+    delete static_cast<F*>(functor);
+  }
+
+  void* functor_;
+  void (*run_)(void*);
+  void (*destroy_)(void*);
+  Storage storage_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(QueuedTask);
+};
+
 const uint32 MQID_ANY = static_cast<uint32>(-1);
 const uint32 MQID_DISPOSE = static_cast<uint32>(-2);
 
@@ -202,12 +327,35 @@ class MessageQueue {
                       MessageData* pdata = NULL);
   virtual void Clear(MessageHandler *phandler, uint32 id = MQID_ANY,
                      MessageList* removed = NULL);
+
+  // Posts any callable taking no arguments, e.g. a lambda, to be run on this
+  // queue. Unlike Post() with a MessageData, this doesn't allocate for small
+  // callables; see QueuedTask. The callable is destroyed on this queue's
+  // thread after it has run, or wherever the queue is cleared.
+  template <class FunctorT>
+  void PostTask(FunctorT&& functor) {
+    QueuedTask* task = NewTask();
+    task->Set(std::forward<FunctorT>(functor));
+    PostQueuedTask(task);
+  }
+  template <class FunctorT>
+  void PostDelayedTask(int cmsDelay, FunctorT&& functor) {
+    QueuedTask* task = NewTask();
+    task->Set(std::forward<FunctorT>(functor));
+    PostDelayed(cmsDelay, &task_runner_, 0, task);
+  }
+
   virtual void Dispatch(Message *pmsg);
   virtual void ReceiveSends();
 
   // Amount of time until the next message can be retrieved
   virtual int GetDelay();
 
+  // The timer wheel shared by everything running on this queue, created on
+  // first use. See timerwheel.h; it must only be used from the thread that
+  // processes this queue.
+  TimerWheel* timer_wheel();
+
   bool empty() const { return size() == 0u; }
   size_t size() const {
     CritScope cs(&crit_);  // msgq_.size() is not thread safe.
@@ -232,6 +380,74 @@ class MessageQueue {
     void reheap() { make_heap(c.begin(), c.end(), comp); }
   };
 
+  // The FIFO of messages ready to be dispatched. It is an intrusive list
+  // whose nodes are kept on a free list once their message is taken off, so
+  // that posting doesn't allocate after the queue has seen its usual backlog.
+  // Each node has room for a QueuedTask. A task posted with PostTask() is
+  // queued in its own node, which stays with the task until it has run.
+  // Guarded by |crit_| like the rest of the queue.
+  class ReadyQueue {
+   public:
+    ReadyQueue();
+    ~ReadyQueue();
+
+    bool empty() const { return head_ == NULL; }
+    size_t size() const { return size_; }
+    const Message& front() const { return head_->msg; }
+    void push_back(const Message& msg);
+    // Queues |msg|, whose data is a task from NewTask(), in the task's node.
+    void push_back_task(const Message& msg);
+    void pop_front();
+    // Removes the messages that match |phandler| and |id|. They are added to
+    // |removed| if it is given, otherwise their data is deleted.
+    void Remove(MessageHandler* phandler, uint32 id, MessageList* removed);
+
+    // Returns an empty task in a node off the free list. Deleting the task
+    // deletes the node; FreeTask() puts it back on the free list.
+    QueuedTask* NewTask();
+    void FreeTask(QueuedTask* task);
+
+    // The number of nodes allocated over the lifetime of the queue.
+    size_t allocated() const { return allocated_; }
+
+   private:
+    struct Node : public QueuedTask {
+      Message msg;
+      Node* next;
+    };
+
+    Node* NewNode();
+    void FreeNode(Node* node);
+    // True if |node| holds the task of its message.
+    static bool HoldsTask(const Node* node) {
+      return node->msg.pdata == static_cast<const MessageData*>(node);
+    }
+
+    Node* head_;
+    Node* tail_;
+    size_t size_;
+    Node* free_;
+    size_t free_size_;
+    size_t allocated_;
+
+    RTC_DISALLOW_COPY_AND_ASSIGN(ReadyQueue);
+  };
+
+  // Runs the tasks posted with PostTask() and returns their nodes to the
+  // queue.
+  class TaskRunner : public MessageHandler {
+   public:
+    explicit TaskRunner(MessageQueue* queue) : queue_(queue) {}
+    void OnMessage(Message* msg) override;
+
+   private:
+    MessageQueue* queue_;
+  };
+
+  QueuedTask* NewTask();
+  void PostQueuedTask(QueuedTask* task);
+  void FreeTask(QueuedTask* task);
+
   void DoDelayPost(int cmsDelay, uint32 tstamp, MessageHandler *phandler,
                    uint32 id, MessageData* pdata);
 
@@ -242,9 +458,11 @@ class MessageQueue {
   bool fStop_;
   bool fPeekKeep_;
   Message msgPeek_;
-  MessageList msgq_;
+  ReadyQueue msgq_;
   PriorityQueue dmsgq_;
   uint32 dmsgq_next_num_;
+  scoped_ptr<TimerWheel> timer_wheel_;
+  TaskRunner task_runner_;
   mutable CriticalSection crit_;
 
  private:
@@ -53,6 +53,7 @@
 #include "webrtc/base/stream.h"
 #include "webrtc/base/stringencode.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 
 namespace rtc {
 namespace {
@@ -321,7 +322,8 @@ void NetworkManagerBase::MergeNetworkList(const NetworkList& new_networks,
 }
 
 BasicNetworkManager::BasicNetworkManager()
-    : thread_(NULL), sent_first_update_(false), start_count_(0),
+    : thread_(NULL), sent_first_update_(false), last_update_time_(0),
+      signal_pending_(false), start_count_(0),
       network_ignore_mask_(kDefaultNetworkIgnoreMask),
       ignore_non_default_routes_(false) {
 }
@@ -660,8 +662,16 @@ void BasicNetworkManager::StartUpdating() {
     // we should trigger network signal immediately for the new clients
     // to start allocating ports.
     if (sent_first_update_)
-      thread_->Post(this, kSignalNetworksMessage);
+      PostSignalNetworks();
+  } else if (sent_first_update_ &&
+             TimeSince(last_update_time_) < kNetworksUpdateIntervalMs) {
+    // The last enumeration is recent enough to be shared with the new
+    // clients, skip enumerating again until the next regular update.
+    PostSignalNetworks();
+    int next_update = kNetworksUpdateIntervalMs - TimeSince(last_update_time_);
+    thread_->PostDelayed(next_update, this, kUpdateNetworksMessage);
   } else {
+    sent_first_update_ = false;
     thread_->Post(this, kUpdateNetworksMessage);
   }
   ++start_count_;
@@ -675,7 +685,7 @@ void BasicNetworkManager::StopUpdating() {
   --start_count_;
   if (!start_count_) {
     thread_->Clear(this);
-    sent_first_update_ = false;
+    signal_pending_ = false;
   }
 }
 
@@ -686,6 +696,7 @@ void BasicNetworkManager::OnMessage(Message* msg) {
       break;
     }
     case kSignalNetworksMessage:  {
+      signal_pending_ = false;
       SignalNetworksChanged();
       break;
     }
@@ -694,6 +705,15 @@ void BasicNetworkManager::OnMessage(Message* msg) {
   }
 }
 
+void BasicNetworkManager::PostSignalNetworks() {
+  // Clients that start in the same batch, e.g. all sessions of a burst of new
+  // PeerConnections, share one signal.
+  if (!signal_pending_) {
+    signal_pending_ = true;
+    thread_->Post(this, kSignalNetworksMessage);
+  }
+}
+
 void BasicNetworkManager::DoUpdateNetworks() {
   if (!start_count_)
     return;
@@ -704,6 +724,7 @@ void BasicNetworkManager::DoUpdateNetworks() {
   if (!CreateNetworks(false, &list)) {
     SignalError();
   } else {
+    last_update_time_ = Time();
     bool changed;
     MergeNetworkList(list, &changed);
     if (changed || !sent_first_update_) {
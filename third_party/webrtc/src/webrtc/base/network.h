@@ -223,9 +223,17 @@ class BasicNetworkManager : public NetworkManagerBase,
   friend class NetworkTest;
 
   void DoUpdateNetworks();
+  void PostSignalNetworks();
 
   Thread* thread_;
+  // Set once |networks_| holds an enumeration that has been signaled. It
+  // survives StopUpdating(), so that a client starting again shortly after
+  // reuses the enumeration.
   bool sent_first_update_;
+  // Time of the last successful enumeration.
+  uint32 last_update_time_;
+  // Set while a SignalNetworksChanged for newly started clients is queued.
+  bool signal_pending_;
   int start_count_;
   std::vector<std::string> network_ignore_list_;
   int network_ignore_mask_;
@@ -28,10 +28,11 @@ namespace rtc {
 
 class NetworkTest : public testing::Test, public sigslot::has_slots<>  {
  public:
-  NetworkTest() : callback_called_(false) {}
+  NetworkTest() : callback_called_(false), callback_count_(0) {}
 
   void OnNetworksChanged() {
     callback_called_ = true;
+    ++callback_count_;
   }
 
   NetworkManager::Stats MergeNetworkList(
@@ -67,6 +68,7 @@ class NetworkTest : public testing::Test, public sigslot::has_slots<>  {
 
  protected:
   bool callback_called_;
+  int callback_count_;
 };
 
 // Test that the Network ctor works properly.
@@ -211,6 +213,40 @@ TEST_F(NetworkTest, TestUpdateNetworks) {
   EXPECT_TRUE(callback_called_);
 }
 
+// Clients starting together share one update, and a client starting shortly
+// after the last one stopped reuses the previous enumeration.
+TEST_F(NetworkTest, TestUpdateNetworksShared) {
+  BasicNetworkManager manager;
+  manager.SignalNetworksChanged.connect(
+      static_cast<NetworkTest*>(this), &NetworkTest::OnNetworksChanged);
+  manager.StartUpdating();
+  Thread::Current()->ProcessMessages(0);
+  EXPECT_EQ(1, callback_count_);
+
+  callback_count_ = 0;
+  manager.StartUpdating();
+  manager.StartUpdating();
+  manager.StartUpdating();
+  Thread::Current()->ProcessMessages(0);
+  EXPECT_EQ(1, callback_count_);
+
+  NetworkManager::NetworkList networks;
+  manager.GetNetworks(&networks);
+  for (int i = 0; i < 4; ++i) {
+    manager.StopUpdating();
+  }
+  EXPECT_FALSE(manager.started());
+
+  callback_count_ = 0;
+  manager.StartUpdating();
+  NetworkManager::NetworkList cached_networks;
+  manager.GetNetworks(&cached_networks);
+  EXPECT_EQ(networks, cached_networks);
+  Thread::Current()->ProcessMessages(0);
+  EXPECT_EQ(1, callback_count_);
+  manager.StopUpdating();
+}
+
 // Verify that MergeNetworkList() merges network lists properly.
 TEST_F(NetworkTest, TestBasicMergeNetworkList) {
   Network ipv4_network1("test_eth0", "Test Network Adapter 1",
@@ -19,16 +19,26 @@
 #include <openssl/bio.h>
 #include <openssl/crypto.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <openssl/rand.h>
 #include <openssl/tls1.h>
 #include <openssl/x509v3.h>
 
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
 #include <vector>
 
 #include "webrtc/base/common.h"
+#include "webrtc/base/criticalsection.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/safe_conversions.h"
 #include "webrtc/base/stream.h"
+#include "webrtc/base/stringencode.h"
 #include "webrtc/base/openssl.h"
 #include "webrtc/base/openssladapter.h"
 #include "webrtc/base/openssldigest.h"
@@ -53,6 +63,11 @@ struct SrtpCipherMapEntry {
 static SrtpCipherMapEntry SrtpCipherMap[] = {
     {CS_AES_CM_128_HMAC_SHA1_80, "SRTP_AES128_CM_SHA1_80"},
     {CS_AES_CM_128_HMAC_SHA1_32, "SRTP_AES128_CM_SHA1_32"},
+#if defined(SRTP_AEAD_AES_128_GCM)
+    // Only offered when the SSL library knows the RFC 7714 profiles.
+    {CS_AEAD_AES_128_GCM, "SRTP_AEAD_AES_128_GCM"},
+    {CS_AEAD_AES_256_GCM, "SRTP_AEAD_AES_256_GCM"},
+#endif
     {NULL, NULL}};
 #endif
 
@@ -179,6 +194,28 @@ static uint16_t kDefaultSslEcCipher12 =
 // StreamBIO
 //////////////////////////////////////////////////////////////////////
 
+// openssl defaults to mtu=256 unless the BIO reports one. The handshake
+// doesn't actually need to send packets above 1k, so this seems like a
+// sensible value that should work in most cases. Webrtc uses the same value
+// for video packets.
+static const size_t kDtlsMtu = 1200;
+
+// The state behind a stream BIO. While |packing| is set, which the adapter
+// does for the duration of a DTLS handshake, written records are collected
+// in |packet| and sent as one datagram once the next record wouldn't fit
+// into the MTU, or when the adapter calls BIO_stream_flush_packed() after
+// OpenSSL returns. OpenSSL only packs the first transmission of a flight
+// itself; this also packs retransmissions, which it writes one message at a
+// time.
+struct StreamBIO {
+  explicit StreamBIO(StreamInterface* stream)
+      : stream(stream), packing(false) {}
+
+  StreamInterface* stream;
+  bool packing;
+  Buffer packet;
+};
+
 static int stream_write(BIO* h, const char* buf, int num);
 static int stream_read(BIO* h, char* buf, int size);
 static int stream_puts(BIO* h, const char* str);
@@ -206,10 +243,33 @@ static BIO* BIO_new_stream(StreamInterface* stream) {
   BIO* ret = BIO_new(BIO_s_stream());
   if (ret == NULL)
     return NULL;
-  ret->ptr = stream;
+  ret->ptr = new StreamBIO(stream);
   return ret;
 }
 
+// Sends the records packed so far as one datagram.
+static void BIO_stream_flush_packed(BIO* b) {
+  StreamBIO* sb = static_cast<StreamBIO*>(b->ptr);
+  if (sb->packet.size() == 0)
+    return;
+  size_t written;
+  int error;
+  if (sb->stream->Write(sb->packet.data(), sb->packet.size(), &written,
+                        &error) != SR_SUCCESS) {
+    // Like any lost datagram, this is recovered by retransmitting the flight.
+    LOG(LS_WARNING) << "Failed to send " << sb->packet.size()
+                    << " bytes of DTLS handshake records";
+  }
+  sb->packet.SetSize(0);
+}
+
+static void BIO_stream_set_packing(BIO* b, bool packing) {
+  StreamBIO* sb = static_cast<StreamBIO*>(b->ptr);
+  if (!packing)
+    BIO_stream_flush_packed(b);
+  sb->packing = packing;
+}
+
 // bio methods return 1 (or at least non-zero) on success and 0 on failure.
 
 static int stream_new(BIO* b) {
@@ -223,13 +283,15 @@ static int stream_new(BIO* b) {
 static int stream_free(BIO* b) {
   if (b == NULL)
     return 0;
+  delete static_cast<StreamBIO*>(b->ptr);
+  b->ptr = NULL;
   return 1;
 }
 
 static int stream_read(BIO* b, char* out, int outl) {
   if (!out)
     return -1;
-  StreamInterface* stream = static_cast<StreamInterface*>(b->ptr);
+  StreamInterface* stream = static_cast<StreamBIO*>(b->ptr)->stream;
   BIO_clear_retry_flags(b);
   size_t read;
   int error;
@@ -247,11 +309,17 @@ static int stream_read(BIO* b, char* out, int outl) {
 static int stream_write(BIO* b, const char* in, int inl) {
   if (!in)
     return -1;
-  StreamInterface* stream = static_cast<StreamInterface*>(b->ptr);
+  StreamBIO* sb = static_cast<StreamBIO*>(b->ptr);
   BIO_clear_retry_flags(b);
+  if (sb->packing) {
+    if (sb->packet.size() + inl > kDtlsMtu)
+      BIO_stream_flush_packed(b);
+    sb->packet.AppendData(in, inl);
+    return inl;
+  }
   size_t written;
   int error;
-  StreamResult result = stream->Write(in, inl, &written, &error);
+  StreamResult result = sb->stream->Write(in, inl, &written, &error);
   if (result == SR_SUCCESS) {
     return checked_cast<int>(written);
   } else if (result == SR_BLOCK) {
@@ -277,18 +345,179 @@ static long stream_ctrl(BIO* b, int cmd, long num, void* ptr) {
     case BIO_CTRL_PENDING:
       return 0;
     case BIO_CTRL_FLUSH:
+      // OpenSSL flushes after every retransmitted message, so packed records
+      // are only sent by BIO_stream_flush_packed().
       return 1;
     case BIO_CTRL_DGRAM_QUERY_MTU:
-      // openssl defaults to mtu=256 unless we return something here.
-      // The handshake doesn't actually need to send packets above 1k,
-      // so this seems like a sensible value that should work in most cases.
-      // Webrtc uses the same value for video packets.
-      return 1200;
+      return kDtlsMtu;
     default:
       return 0;
   }
 }
 
+//////////////////////////////////////////////////////////////////////
+// Session resumption
+//////////////////////////////////////////////////////////////////////
+
+// How long a session may be resumed after the full handshake.
+static const int kSessionTimeoutSeconds = 10 * 60;
+// Bounds the memory held by the client session cache.
+static const size_t kMaxCachedSessions = 64;
+// Servers encrypt new tickets with the newest of |kNumTicketKeys| keys, and
+// replace the oldest key with a new one every |kTicketKeyRotationSeconds|.
+// A ticket stays readable until its key is dropped, which is at least as
+// long as the session may be resumed.
+static const int kNumTicketKeys = 3;
+static const int kTicketKeyRotationSeconds =
+    kSessionTimeoutSeconds / (kNumTicketKeys - 1);
+
+// Client sessions are shared by all adapters in the process and keyed by
+// SessionCacheKey(), so a new connection to the same peer can resume them.
+// The cache is ordered by last use, most recent first. Servers keep no
+// state: they resume from session tickets, which all adapters encrypt with
+// the keys in |g_ticket_keys|.
+typedef std::list<std::pair<std::string, SSL_SESSION*>> SessionList;
+typedef std::map<std::string, SessionList::iterator> SessionMap;
+struct TicketKey {
+  uint8_t name[16];
+  uint8_t aes_key[16];
+  uint8_t hmac_key[16];
+  time_t created;
+};
+static GlobalLockPod g_session_lock;
+static SessionList* g_session_list = NULL;
+static SessionMap* g_sessions = NULL;
+// Newest first; the first |g_num_ticket_keys| are valid.
+static TicketKey g_ticket_keys[kNumTicketKeys];
+static int g_num_ticket_keys = 0;
+
+static bool IsSessionExpired(SSL_SESSION* session, time_t now) {
+  return SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) <
+         now;
+}
+
+// Must be called with |g_session_lock| held.
+static void EraseCachedSession(SessionMap::iterator it) {
+  SSL_SESSION_free(it->second->second);
+  g_session_list->erase(it->second);
+  g_sessions->erase(it);
+}
+
+// Offers the cached session for |key| on |ssl|. Returns false if there is
+// none, or it has expired.
+static bool OfferCachedSession(SSL* ssl, const std::string& key) {
+  GlobalLockScope lock(&g_session_lock);
+  if (!g_sessions)
+    return false;
+  SessionMap::iterator it = g_sessions->find(key);
+  if (it == g_sessions->end())
+    return false;
+  SSL_SESSION* session = it->second->second;
+  if (IsSessionExpired(session, time(NULL))) {
+    EraseCachedSession(it);
+    return false;
+  }
+  g_session_list->splice(g_session_list->begin(), *g_session_list,
+                         it->second);
+  return SSL_set_session(ssl, session) == 1;
+}
+
+// Caches |session| for |key|, taking over the caller's reference. When the
+// cache is full, expired sessions are dropped first, then the least recently
+// used one.
+static void CacheSession(const std::string& key, SSL_SESSION* session) {
+  GlobalLockScope lock(&g_session_lock);
+  if (!g_sessions) {
+    g_session_list = new SessionList();
+    g_sessions = new SessionMap();
+  }
+  SessionMap::iterator it = g_sessions->find(key);
+  if (it != g_sessions->end())
+    EraseCachedSession(it);
+  if (g_sessions->size() >= kMaxCachedSessions) {
+    time_t now = time(NULL);
+    for (it = g_sessions->begin(); it != g_sessions->end();) {
+      if (IsSessionExpired(it->second->second, now))
+        EraseCachedSession(it++);
+      else
+        ++it;
+    }
+  }
+  if (g_sessions->size() >= kMaxCachedSessions)
+    EraseCachedSession(g_sessions->find(g_session_list->back().first));
+  g_session_list->push_front(std::make_pair(key, session));
+  (*g_sessions)[key] = g_session_list->begin();
+}
+
+static void UncacheSession(const std::string& key) {
+  GlobalLockScope lock(&g_session_lock);
+  if (!g_sessions)
+    return;
+  SessionMap::iterator it = g_sessions->find(key);
+  if (it != g_sessions->end())
+    EraseCachedSession(it);
+}
+
+// Adds a new ticket key, dropping the oldest one if there are
+// |kNumTicketKeys| already. Must be called with |g_session_lock| held.
+static bool AddTicketKey(time_t now) {
+  TicketKey key;
+  if (RAND_bytes(key.name, sizeof(key.name)) != 1 ||
+      RAND_bytes(key.aes_key, sizeof(key.aes_key)) != 1 ||
+      RAND_bytes(key.hmac_key, sizeof(key.hmac_key)) != 1) {
+    return false;
+  }
+  key.created = now;
+  g_num_ticket_keys = std::min(g_num_ticket_keys + 1, kNumTicketKeys);
+  for (int i = g_num_ticket_keys - 1; i > 0; --i)
+    g_ticket_keys[i] = g_ticket_keys[i - 1];
+  g_ticket_keys[0] = key;
+  return true;
+}
+
+// Called by OpenSSL to encrypt a new ticket (|encrypt| is 1) or to decrypt
+// one the client presents. Returns -1 on error, and in decrypt mode 0 if the
+// ticket's key was dropped, 1 if it is the newest key and 2 if the ticket
+// should be renewed with the newest key.
+static int TicketKeyCallback(SSL* ssl, uint8_t* key_name, uint8_t* iv,
+                             EVP_CIPHER_CTX* cipher_ctx, HMAC_CTX* hmac_ctx,
+                             int encrypt) {
+  GlobalLockScope lock(&g_session_lock);
+  time_t now = time(NULL);
+  if ((g_num_ticket_keys == 0 ||
+       now - g_ticket_keys[0].created >= kTicketKeyRotationSeconds) &&
+      !AddTicketKey(now)) {
+    return -1;
+  }
+
+  if (encrypt) {
+    const TicketKey& key = g_ticket_keys[0];
+    if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc())) != 1 ||
+        !EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key.aes_key,
+                            iv) ||
+        !HMAC_Init_ex(hmac_ctx, key.hmac_key, sizeof(key.hmac_key),
+                      EVP_sha256(), NULL)) {
+      return -1;
+    }
+    memcpy(key_name, key.name, sizeof(key.name));
+    return 1;
+  }
+
+  for (int i = 0; i < g_num_ticket_keys; ++i) {
+    const TicketKey& key = g_ticket_keys[i];
+    if (memcmp(key_name, key.name, sizeof(key.name)) != 0)
+      continue;
+    if (!HMAC_Init_ex(hmac_ctx, key.hmac_key, sizeof(key.hmac_key),
+                      EVP_sha256(), NULL) ||
+        !EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key.aes_key,
+                            iv)) {
+      return -1;
+    }
+    return (i == 0) ? 1 : 2;
+  }
+  return 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // OpenSSLStreamAdapter
 /////////////////////////////////////////////////////////////////////////////
@@ -383,6 +612,10 @@ bool OpenSSLStreamAdapter::GetSslCipherSuite(uint16_t* cipher) {
   return true;
 }
 
+bool OpenSSLStreamAdapter::IsResumedSession() {
+  return state_ == SSL_CONNECTED && SSL_session_reused(ssl_);
+}
+
 // Key Extractor interface
 bool OpenSSLStreamAdapter::ExportKeyingMaterial(const std::string& label,
                                                 const uint8* context,
@@ -658,6 +891,31 @@ void OpenSSLStreamAdapter::FlushInput(unsigned int left) {
   }
 }
 
+std::string OpenSSLStreamAdapter::SessionCacheKey() const {
+  if (!session_resumption_enabled() || !ssl_server_name_.empty() ||
+      peer_certificate_digest_algorithm_.empty() || !identity_) {
+    return std::string();
+  }
+
+  // A session can only be resumed with the same peer, which must again
+  // accept our certificate, and at the same protocol version.
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  size_t digest_length;
+  if (!identity_->certificate().ComputeDigest(DIGEST_SHA_256, digest,
+                                              sizeof(digest),
+                                              &digest_length)) {
+    return std::string();
+  }
+  std::string key = (ssl_mode_ == SSL_MODE_DTLS) ? "dtls:" : "tls:";
+  key += ToString(static_cast<int>(ssl_max_version_)) + ":";
+  key += peer_certificate_digest_algorithm_ + ":";
+  key += hex_encode(peer_certificate_digest_value_.data<char>(),
+                    peer_certificate_digest_value_.size());
+  key += ":" + hex_encode(reinterpret_cast<const char*>(digest),
+                          digest_length);
+  return key;
+}
+
 void OpenSSLStreamAdapter::Close() {
   Cleanup();
   ASSERT(state_ == SSL_CLOSED || state_ == SSL_ERROR);
@@ -762,6 +1020,7 @@ int OpenSSLStreamAdapter::BeginSSL() {
 
   // First set up the context
   ASSERT(ssl_ctx_ == NULL);
+  session_cache_key_ = SessionCacheKey();
   ssl_ctx_ = SetupSSLContext();
   if (!ssl_ctx_)
     return -1;
@@ -769,6 +1028,7 @@ int OpenSSLStreamAdapter::BeginSSL() {
   bio = BIO_new_stream(static_cast<StreamInterface*>(stream()));
   if (!bio)
     return -1;
+  BIO_stream_set_packing(bio, ssl_mode_ == SSL_MODE_DTLS);
 
   ssl_ = SSL_new(ssl_ctx_);
   if (!ssl_) {
@@ -778,6 +1038,11 @@ int OpenSSLStreamAdapter::BeginSSL() {
 
   SSL_set_app_data(ssl_, this);
 
+  if (role_ == SSL_CLIENT && !session_cache_key_.empty() &&
+      OfferCachedSession(ssl_, session_cache_key_)) {
+    LOG(LS_INFO) << "BeginSSL: offering to resume an earlier session";
+  }
+
   SSL_set_bio(ssl_, bio, bio);  // the SSL object owns the bio now.
 #ifndef OPENSSL_IS_BORINGSSL
   if (ssl_mode_ == SSL_MODE_DTLS) {
@@ -812,6 +1077,9 @@ int OpenSSLStreamAdapter::ContinueSSL() {
   Thread::Current()->Clear(this, MSG_TIMEOUT);
 
   int code = (role_ == SSL_CLIENT) ? SSL_connect(ssl_) : SSL_accept(ssl_);
+  // Send what this step of the handshake wrote. The stream BIO is the read
+  // BIO; OpenSSL may put a buffering BIO in front of it for writing.
+  BIO_stream_flush_packed(SSL_get_rbio(ssl_));
   int ssl_error;
   switch (ssl_error = SSL_get_error(ssl_, code)) {
     case SSL_ERROR_NONE:
@@ -823,6 +1091,22 @@ int OpenSSLStreamAdapter::ContinueSSL() {
         return -1;
       }
 
+      if (SSL_session_reused(ssl_)) {
+        // The verify callback doesn't run for a resumed session, so check the
+        // certificate the peer presented in the full handshake.
+        X509* cert = SSL_get_peer_certificate(ssl_);
+        bool verified = cert && VerifyPeerCertificate(cert);
+        X509_free(cert);
+        if (!verified) {
+          LOG(LS_ERROR) << "Resumed a session with a different peer";
+          return -1;
+        }
+        LOG(LS_INFO) << "Resumed an earlier session";
+      }
+      if (role_ == SSL_CLIENT && !session_cache_key_.empty())
+        CacheSession(session_cache_key_, SSL_get1_session(ssl_));
+
+      BIO_stream_set_packing(SSL_get_rbio(ssl_), false);
       state_ = SSL_CONNECTED;
       StreamAdapterInterface::OnEvent(stream(), SE_OPEN|SE_READ|SE_WRITE, 0);
       break;
@@ -845,6 +1129,9 @@ int OpenSSLStreamAdapter::ContinueSSL() {
     case SSL_ERROR_ZERO_RETURN:
     default:
       LOG(LS_VERBOSE) << " -- error " << code;
+      // Don't offer the session to this peer again.
+      if (role_ == SSL_CLIENT && !session_cache_key_.empty())
+        UncacheSession(session_cache_key_);
       return (ssl_error != 0) ? ssl_error : -1;
   }
 
@@ -870,6 +1157,8 @@ void OpenSSLStreamAdapter::Cleanup() {
   }
 
   if (ssl_) {
+    // Don't hold back an alert sent during the handshake.
+    BIO_stream_set_packing(SSL_get_rbio(ssl_), false);
     int ret = SSL_shutdown(ssl_);
     if (ret < 0) {
       LOG(LS_WARNING) << "SSL_shutdown failed, error = "
@@ -1026,6 +1315,23 @@ SSL_CTX* OpenSSLStreamAdapter::SetupSSLContext() {
   }
 #endif
 
+  if (!session_cache_key_.empty()) {
+    // Clients keep their sessions in the session cache; servers hand them out
+    // as tickets, which must be readable by the next adapter. OpenSSL refuses
+    // to resume a session with a verified peer unless it has a session id
+    // context.
+    static const unsigned char kSessionIdContext[] = "webrtc";
+    SSL_CTX_set_session_id_context(ctx, kSessionIdContext,
+                                   sizeof(kSessionIdContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_timeout(ctx, kSessionTimeoutSeconds);
+    if (role_ == SSL_SERVER)
+      SSL_CTX_set_tlsext_ticket_key_cb(ctx, &TicketKeyCallback);
+  } else {
+    // A ticket encrypted with this context's own key can't be used later.
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+  }
+
   return ctx;
 }
 
@@ -1053,30 +1359,38 @@ int OpenSSLStreamAdapter::SSLVerifyCallback(int ok, X509_STORE_CTX* store) {
     return 1;
   }
 
+  // Ignore any verification error if the digest matches, since there is no
+  // value in checking the validity of a self-signed cert issued by untrusted
+  // sources.
+  return stream->VerifyPeerCertificate(cert) ? 1 : 0;
+}
+
+bool OpenSSLStreamAdapter::VerifyPeerCertificate(X509* cert) {
+  if (peer_certificate_digest_algorithm_.empty()) {
+    return false;
+  }
+
   unsigned char digest[EVP_MAX_MD_SIZE];
   size_t digest_length;
   if (!OpenSSLCertificate::ComputeDigest(
            cert,
-           stream->peer_certificate_digest_algorithm_,
+           peer_certificate_digest_algorithm_,
            digest, sizeof(digest),
            &digest_length)) {
     LOG(LS_WARNING) << "Failed to compute peer cert digest.";
-    return 0;
+    return false;
   }
 
   Buffer computed_digest(digest, digest_length);
-  if (computed_digest != stream->peer_certificate_digest_value_) {
+  if (computed_digest != peer_certificate_digest_value_) {
     LOG(LS_WARNING) << "Rejected peer certificate due to mismatched digest.";
-    return 0;
+    return false;
   }
-  // Ignore any verification error if the digest matches, since there is no
-  // value in checking the validity of a self-signed cert issued by untrusted
-  // sources.
   LOG(LS_INFO) << "Accepted peer certificate.";
 
   // Record the peer's certificate.
-  stream->peer_certificate_.reset(new OpenSSLCertificate(cert));
-  return 1;
+  peer_certificate_.reset(new OpenSSLCertificate(cert));
+  return true;
 }
 
 // This code is taken from the "Network Security with OpenSSL"
@@ -1174,6 +1488,11 @@ uint16_t OpenSSLStreamAdapter::GetDefaultSslCipherForTest(
   }
 }
 
+void OpenSSLStreamAdapter::RotateSessionTicketKeysForTest() {
+  GlobalLockScope lock(&g_session_lock);
+  AddTicketKey(time(NULL));
+}
+
 }  // namespace rtc
 
 #endif  // HAVE_OPENSSL_SSL_H
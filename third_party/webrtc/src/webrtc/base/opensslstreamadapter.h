@@ -91,6 +91,7 @@ class OpenSSLStreamAdapter : public SSLStreamAdapter {
   static std::string GetSslCipherSuiteName(uint16_t cipher);
 
   bool GetSslCipherSuite(uint16_t* cipher) override;
+  bool IsResumedSession() override;
 
   // Key Extractor interface
   bool ExportKeyingMaterial(const std::string& label,
@@ -113,6 +114,8 @@ class OpenSSLStreamAdapter : public SSLStreamAdapter {
   static uint16_t GetDefaultSslCipherForTest(SSLProtocolVersion version,
                                              KeyType key_type);
 
+  static void RotateSessionTicketKeysForTest();
+
  protected:
   void OnEvent(StreamInterface* stream, int events, int err) override;
 
@@ -159,6 +162,10 @@ class OpenSSLStreamAdapter : public SSLStreamAdapter {
   // Flush the input buffers by reading left bytes (for DTLS)
   void FlushInput(unsigned int left);
 
+  // The key of our sessions in the process-wide client session cache, or
+  // empty if they are not to be resumed.
+  std::string SessionCacheKey() const;
+
   // SSL library configuration
   SSL_CTX* SetupSSLContext();
   // SSL verification check
@@ -170,6 +177,9 @@ class OpenSSLStreamAdapter : public SSLStreamAdapter {
   // the C style: zero means verification failure, non-zero means
   // passed.
   static int SSLVerifyCallback(int ok, X509_STORE_CTX* store);
+  // Checks |cert| against the expected peer certificate digest and records
+  // it as the peer's certificate if it matches.
+  bool VerifyPeerCertificate(X509* cert);
 
   SSLState state_;
   SSLRole role_;
@@ -206,6 +216,9 @@ class OpenSSLStreamAdapter : public SSLStreamAdapter {
 
   // Max. allowed protocol version
   SSLProtocolVersion ssl_max_version_;
+
+  // See SessionCacheKey(), set when the handshake begins.
+  std::string session_cache_key_;
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -24,8 +24,10 @@
 #include <fcntl.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
 #endif
 
 #if defined(WEBRTC_WIN)
@@ -96,6 +98,17 @@ static const int ICMP_HEADER_SIZE = 8u;
 static const int ICMP_PING_TIMEOUT_MILLIS = 10000u;
 #endif
 
+#if defined(WEBRTC_LINUX) && !defined(WEBRTC_ANDROID)
+// Maximum number of datagrams passed to one recvmmsg()/sendmmsg() call.
+static const size_t kMaxMmsgBatch = 64;
+#endif
+
+#if defined(WEBRTC_POSIX)
+// Maximum number of buffers passed to one sendmsg() call. POSIX guarantees
+// at least 16 (_XOPEN_IOV_MAX); Linux and Mac allow 1024.
+static const size_t kMaxSendIovecs = 64;
+#endif
+
 class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
  public:
   PhysicalSocket(PhysicalSocketServer* ss, SOCKET s = INVALID_SOCKET)
@@ -111,7 +124,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     EnsureWinsockInit();
 #endif
     if (s_ != INVALID_SOCKET) {
-      enabled_events_ = DE_READ | DE_WRITE;
+      SetEnabledEvents(DE_READ | DE_WRITE);
 
       int type = SOCK_STREAM;
       socklen_t len = sizeof(type);
@@ -131,7 +144,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     udp_ = (SOCK_DGRAM == type);
     UpdateLastError();
     if (udp_)
-      enabled_events_ = DE_READ | DE_WRITE;
+      SetEnabledEvents(DE_READ | DE_WRITE);
     return s_ != INVALID_SOCKET;
   }
 
@@ -213,12 +226,12 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
       state_ = CS_CONNECTED;
     } else if (IsBlockingError(GetError())) {
       state_ = CS_CONNECTING;
-      enabled_events_ |= DE_CONNECT;
+      EnableEvents(DE_CONNECT);
     } else {
       return SOCKET_ERROR;
     }
 
-    enabled_events_ |= DE_READ | DE_WRITE;
+    EnableEvents(DE_READ | DE_WRITE);
     return 0;
   }
 
@@ -280,11 +293,43 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     // We have seen minidumps where this may be false.
     ASSERT(sent <= static_cast<int>(cb));
     if ((sent < 0) && IsBlockingError(GetError())) {
-      enabled_events_ |= DE_WRITE;
+      EnableEvents(DE_WRITE);
     }
     return sent;
   }
 
+#if defined(WEBRTC_POSIX)
+  int SendGather(const IoBuffer* buffers, size_t count) override {
+    struct iovec iovs[kMaxSendIovecs];
+    count = std::min(count, kMaxSendIovecs);
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i) {
+      iovs[i].iov_base = const_cast<void*>(buffers[i].data);
+      iovs[i].iov_len = buffers[i].length;
+      length += buffers[i].length;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = count;
+    int sent = static_cast<int>(::sendmsg(s_, &msg,
+#if defined(WEBRTC_LINUX) && !defined(WEBRTC_ANDROID)
+        // Suppress SIGPIPE. See Send() for explanation.
+        MSG_NOSIGNAL
+#else
+        0
+#endif
+        ));
+    UpdateLastError();
+    MaybeRemapSendError();
+    ASSERT(sent <= static_cast<int>(length));
+    if ((sent < 0) && IsBlockingError(GetError())) {
+      EnableEvents(DE_WRITE);
+    }
+    return sent;
+  }
+#endif
+
   int SendTo(const void* buffer,
              size_t length,
              const SocketAddress& addr) override {
@@ -304,7 +349,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     // We have seen minidumps where this may be false.
     ASSERT(sent <= static_cast<int>(length));
     if ((sent < 0) && IsBlockingError(GetError())) {
-      enabled_events_ |= DE_WRITE;
+      EnableEvents(DE_WRITE);
     }
     return sent;
   }
@@ -319,7 +364,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
       LOG(LS_WARNING) << "EOF from socket; deferring close event";
       // Must turn this back on so that the select() loop will notice the close
       // event.
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
       SetError(EWOULDBLOCK);
       return SOCKET_ERROR;
     }
@@ -327,7 +372,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     int error = GetError();
     bool success = (received >= 0) || IsBlockingError(error);
     if (udp_ || success) {
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
     }
     if (!success) {
       LOG_F(LS_VERBOSE) << "Error = " << error;
@@ -347,7 +392,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     int error = GetError();
     bool success = (received >= 0) || IsBlockingError(error);
     if (udp_ || success) {
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
     }
     if (!success) {
       LOG_F(LS_VERBOSE) << "Error = " << error;
@@ -355,12 +400,82 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     return received;
   }
 
+#if defined(WEBRTC_LINUX) && !defined(WEBRTC_ANDROID)
+  int RecvFromBatch(Datagram* datagrams, size_t count) override {
+    struct mmsghdr msgs[kMaxMmsgBatch];
+    struct iovec iovs[kMaxMmsgBatch];
+    sockaddr_storage addrs[kMaxMmsgBatch];
+    count = std::min(count, kMaxMmsgBatch);
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (size_t i = 0; i < count; ++i) {
+      iovs[i].iov_base = datagrams[i].data;
+      iovs[i].iov_len = datagrams[i].size;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+    // MSG_TRUNC makes msg_len the full size of a truncated datagram.
+    int received = ::recvmmsg(s_, msgs, static_cast<unsigned int>(count),
+                              MSG_TRUNC, NULL);
+    UpdateLastError();
+    for (int i = 0; i < received; ++i) {
+      SocketAddressFromSockAddrStorage(addrs[i], &datagrams[i].addr);
+      datagrams[i].length = msgs[i].msg_len;
+    }
+    int error = GetError();
+    bool success = (received >= 0) || IsBlockingError(error);
+    if (udp_ || success) {
+      EnableEvents(DE_READ);
+    }
+    if (!success) {
+      LOG_F(LS_VERBOSE) << "Error = " << error;
+    }
+    return received;
+  }
+
+  int SendToBatch(const Datagram* datagrams, size_t count) override {
+    struct mmsghdr msgs[kMaxMmsgBatch];
+    struct iovec iovs[kMaxMmsgBatch];
+    sockaddr_storage addrs[kMaxMmsgBatch];
+    size_t total = 0;
+    while (total < count) {
+      size_t batch = std::min(count - total, kMaxMmsgBatch);
+      memset(msgs, 0, batch * sizeof(msgs[0]));
+      for (size_t i = 0; i < batch; ++i) {
+        const Datagram& datagram = datagrams[total + i];
+        iovs[i].iov_base = datagram.data;
+        iovs[i].iov_len = datagram.length;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(
+            datagram.addr.ToSockAddrStorage(&addrs[i]));
+      }
+      // sendmmsg() only reports an error for the first datagram; a short
+      // count means the next call will fail with the error.
+      int sent = ::sendmmsg(s_, msgs, static_cast<unsigned int>(batch),
+                            MSG_NOSIGNAL);
+      UpdateLastError();
+      if (sent <= 0) {
+        MaybeRemapSendError();
+        if ((sent < 0) && IsBlockingError(GetError())) {
+          EnableEvents(DE_WRITE);
+        }
+        break;
+      }
+      total += sent;
+    }
+    return (total == 0 && count != 0) ? -1 : static_cast<int>(total);
+  }
+#endif
+
   int Listen(int backlog) override {
     int err = ::listen(s_, backlog);
     UpdateLastError();
     if (err == 0) {
       state_ = CS_CONNECTING;
-      enabled_events_ |= DE_ACCEPT;
+      EnableEvents(DE_ACCEPT);
 #ifdef _DEBUG
       dbg_addr_ = "Listening @ ";
       dbg_addr_.append(GetLocalAddress().ToString());
@@ -377,7 +492,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     UpdateLastError();
     if (s == INVALID_SOCKET)
       return NULL;
-    enabled_events_ |= DE_ACCEPT;
+    EnableEvents(DE_ACCEPT);
     if (out_addr != NULL)
       SocketAddressFromSockAddrStorage(addr_storage, out_addr);
     return ss_->WrapSocket(s);
@@ -390,7 +505,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     UpdateLastError();
     s_ = INVALID_SOCKET;
     state_ = CS_CLOSED;
-    enabled_events_ = 0;
+    SetEnabledEvents(0);
     if (resolver_) {
       resolver_->Destroy(false);
       resolver_ = NULL;
@@ -487,6 +602,20 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     SetError(LAST_SYSTEM_ERROR);
   }
 
+  // All changes to |enabled_events_| go through here so that dispatchers can
+  // tell the socket server about them.
+  virtual void SetEnabledEvents(uint8 events) {
+    enabled_events_ = events;
+  }
+
+  void EnableEvents(uint8 events) {
+    SetEnabledEvents(enabled_events_ | events);
+  }
+
+  void DisableEvents(uint8 events) {
+    SetEnabledEvents(enabled_events_ & ~events);
+  }
+
   void MaybeRemapSendError() {
 #if defined(WEBRTC_MAC)
     // https://developer.apple.com/library/mac/documentation/Darwin/
@@ -532,6 +661,15 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
         return -1;
       case OPT_RTP_SENDTIME_EXTN_ID:
         return -1;  // No logging is necessary as this not a OS socket option.
+      case OPT_REUSEPORT:
+#if defined(SO_REUSEPORT)
+        *slevel = SOL_SOCKET;
+        *sopt = SO_REUSEPORT;
+        break;
+#else
+        LOG(LS_WARNING) << "Socket::OPT_REUSEPORT not supported.";
+        return -1;
+#endif
       default:
         ASSERT(false);
         return -1;
@@ -869,24 +1007,24 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     // Make sure we deliver connect/accept first. Otherwise, consumers may see
     // something like a READ followed by a CONNECT, which would be odd.
     if ((ff & DE_CONNECT) != 0) {
-      enabled_events_ &= ~DE_CONNECT;
+      DisableEvents(DE_CONNECT);
       SignalConnectEvent(this);
     }
     if ((ff & DE_ACCEPT) != 0) {
-      enabled_events_ &= ~DE_ACCEPT;
+      DisableEvents(DE_ACCEPT);
       SignalReadEvent(this);
     }
     if ((ff & DE_READ) != 0) {
-      enabled_events_ &= ~DE_READ;
+      DisableEvents(DE_READ);
       SignalReadEvent(this);
     }
     if ((ff & DE_WRITE) != 0) {
-      enabled_events_ &= ~DE_WRITE;
+      DisableEvents(DE_WRITE);
       SignalWriteEvent(this);
     }
     if ((ff & DE_CLOSE) != 0) {
       // The socket is now dead to us, so stop checking it.
-      enabled_events_ = 0;
+      SetEnabledEvents(0);
       SignalCloseEvent(this, err);
     }
   }
@@ -898,11 +1036,20 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     ss_->Remove(this);
     return PhysicalSocket::Close();
   }
+
+ protected:
+  void SetEnabledEvents(uint8 events) override {
+    if (events == enabled_events_)
+      return;
+    PhysicalSocket::SetEnabledEvents(events);
+    ss_->Update(this);
+  }
 };
 
 class FileDispatcher: public Dispatcher, public AsyncFile {
  public:
-  FileDispatcher(int fd, PhysicalSocketServer *ss) : ss_(ss), fd_(fd) {
+  FileDispatcher(int fd, PhysicalSocketServer *ss)
+      : ss_(ss), fd_(fd), flags_(0) {
     set_readable(true);
 
     ss_->Add(this);
@@ -937,12 +1084,14 @@ class FileDispatcher: public Dispatcher, public AsyncFile {
 
   void set_readable(bool value) override {
     flags_ = value ? (flags_ | DE_READ) : (flags_ & ~DE_READ);
+    ss_->Update(this);
   }
 
   bool writable() override { return (flags_ & DE_WRITE) != 0; }
 
   void set_writable(bool value) override {
     flags_ = value ? (flags_ | DE_WRITE) : (flags_ & ~DE_WRITE);
+    ss_->Update(this);
   }
 
  private:
@@ -1094,7 +1243,7 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     if (((ff & DE_CONNECT) != 0) && (id_ == cache_id)) {
       if (ff != DE_CONNECT)
         LOG(LS_VERBOSE) << "Signalled with DE_CONNECT: " << ff;
-      enabled_events_ &= ~DE_CONNECT;
+      DisableEvents(DE_CONNECT);
 #ifdef _DEBUG
       dbg_addr_ = "Connected @ ";
       dbg_addr_.append(GetRemoteAddress().ToString());
@@ -1102,15 +1251,15 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
       SignalConnectEvent(this);
     }
     if (((ff & DE_ACCEPT) != 0) && (id_ == cache_id)) {
-      enabled_events_ &= ~DE_ACCEPT;
+      DisableEvents(DE_ACCEPT);
       SignalReadEvent(this);
     }
     if ((ff & DE_READ) != 0) {
-      enabled_events_ &= ~DE_READ;
+      DisableEvents(DE_READ);
       SignalReadEvent(this);
     }
     if (((ff & DE_WRITE) != 0) && (id_ == cache_id)) {
-      enabled_events_ &= ~DE_WRITE;
+      DisableEvents(DE_WRITE);
       SignalWriteEvent(this);
     }
     if (((ff & DE_CLOSE) != 0) && (id_ == cache_id)) {
@@ -1163,8 +1312,37 @@ class Signaler : public EventDispatcher {
   bool *pf_;
 };
 
+#if defined(WEBRTC_LINUX)
+// Upper bound on the events returned by a single epoll_wait() call.
+static const size_t kMaxEpollEvents = 128;
+#endif
+
 PhysicalSocketServer::PhysicalSocketServer()
-    : fWait_(false) {
+    : PhysicalSocketServer(WAIT_SELECT) {
+}
+
+PhysicalSocketServer::PhysicalSocketServer(WaitMode mode)
+    :
+#if defined(WEBRTC_LINUX)
+      epoll_fd_(-1),
+      pending_epoll_events_(0),
+      processing_dispatcher_(NULL),
+#endif
+      wait_mode_(WAIT_SELECT),
+      fWait_(false) {
+  if (mode == WAIT_EPOLL) {
+#if defined(WEBRTC_LINUX)
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ != -1) {
+      wait_mode_ = WAIT_EPOLL;
+      epoll_events_.resize(kMaxEpollEvents);
+    } else {
+      LOG_ERR(LS_WARNING) << "epoll_create1 failed, falling back to select";
+    }
+#else
+    LOG(LS_WARNING) << "epoll is not supported, falling back to select";
+#endif
+  }
   signal_wakeup_ = new Signaler(this, &fWait_);
 #if defined(WEBRTC_WIN)
   socket_ev_ = WSACreateEvent();
@@ -1180,6 +1358,12 @@ PhysicalSocketServer::~PhysicalSocketServer() {
 #endif
   delete signal_wakeup_;
   ASSERT(dispatchers_.empty());
+#if defined(WEBRTC_LINUX)
+  ASSERT(epoll_dispatchers_.empty());
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+  }
+#endif
 }
 
 void PhysicalSocketServer::WakeUp() {
@@ -1226,6 +1410,16 @@ AsyncSocket* PhysicalSocketServer::WrapSocket(SOCKET s) {
 
 void PhysicalSocketServer::Add(Dispatcher *pdispatcher) {
   CritScope cs(&crit_);
+#if defined(WEBRTC_LINUX)
+  if (wait_mode_ == WAIT_EPOLL) {
+    // Like below, duplicates are ignored.
+    std::pair<EpollDispatcherMap::iterator, bool> result =
+        epoll_dispatchers_.insert(std::make_pair(pdispatcher, 0u));
+    if (result.second)
+      UpdateEpoll(pdispatcher, &result.first->second);
+    return;
+  }
+#endif
   // Prevent duplicates. This can cause dead dispatchers to stick around.
   DispatcherList::iterator pos = std::find(dispatchers_.begin(),
                                            dispatchers_.end(),
@@ -1237,6 +1431,33 @@ void PhysicalSocketServer::Add(Dispatcher *pdispatcher) {
 
 void PhysicalSocketServer::Remove(Dispatcher *pdispatcher) {
   CritScope cs(&crit_);
+#if defined(WEBRTC_LINUX)
+  if (wait_mode_ == WAIT_EPOLL) {
+    EpollDispatcherMap::iterator it = epoll_dispatchers_.find(pdispatcher);
+    if (it == epoll_dispatchers_.end()) {
+      LOG(LS_WARNING) << "PhysicalSocketServer asked to remove a unknown "
+                      << "dispatcher, potentially from a duplicate call to "
+                      << "Add.";
+      return;
+    }
+    if (it->second != 0) {
+      // The event argument is ignored but must be non-NULL on old kernels.
+      struct epoll_event event = {0};
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, pdispatcher->GetDescriptor(),
+                &event);
+    }
+    epoll_dispatchers_.erase(it);
+    // Events from the current epoll_wait() that haven't been handled yet must
+    // not reach the removed dispatcher.
+    for (size_t i = 0; i < pending_epoll_events_; ++i) {
+      if (epoll_events_[i].data.ptr == pdispatcher)
+        epoll_events_[i].data.ptr = NULL;
+    }
+    if (processing_dispatcher_ == pdispatcher)
+      processing_dispatcher_ = NULL;
+    return;
+  }
+#endif
   DispatcherList::iterator pos = std::find(dispatchers_.begin(),
                                            dispatchers_.end(),
                                            pdispatcher);
@@ -1258,8 +1479,81 @@ void PhysicalSocketServer::Remove(Dispatcher *pdispatcher) {
   }
 }
 
+void PhysicalSocketServer::Update(Dispatcher *pdispatcher) {
+#if defined(WEBRTC_LINUX)
+  if (wait_mode_ != WAIT_EPOLL)
+    return;
+  CritScope cs(&crit_);
+  // The dispatcher being processed is updated once its handler returns.
+  if (pdispatcher == processing_dispatcher_)
+    return;
+  EpollDispatcherMap::iterator it = epoll_dispatchers_.find(pdispatcher);
+  if (it != epoll_dispatchers_.end())
+    UpdateEpoll(pdispatcher, &it->second);
+#endif
+}
+
 #if defined(WEBRTC_POSIX)
+// Translates readiness of |pdispatcher|'s descriptor into dispatcher events
+// and delivers them.
+static void ProcessEvents(Dispatcher* pdispatcher,
+                          bool readable,
+                          bool writable) {
+  int fd = pdispatcher->GetDescriptor();
+  uint32 ff = 0;
+  int errcode = 0;
+
+  // Reap any error code, which can be signaled through reads or writes.
+  // TODO: Should we set errcode if getsockopt fails?
+  if (readable || writable) {
+    socklen_t len = sizeof(errcode);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &errcode, &len);
+  }
+
+  // Check readable descriptors. If we're waiting on an accept, signal
+  // that. Otherwise we're waiting for data, check to see if we're
+  // readable or really closed.
+  // TODO: Only peek at TCP descriptors.
+  if (readable) {
+    if (pdispatcher->GetRequestedEvents() & DE_ACCEPT) {
+      ff |= DE_ACCEPT;
+    } else if (errcode || pdispatcher->IsDescriptorClosed()) {
+      ff |= DE_CLOSE;
+    } else {
+      ff |= DE_READ;
+    }
+  }
+
+  // Check writable descriptors. If we're waiting on a connect, detect
+  // success versus failure by the reaped error code.
+  if (writable) {
+    if (pdispatcher->GetRequestedEvents() & DE_CONNECT) {
+      if (!errcode) {
+        ff |= DE_CONNECT;
+      } else {
+        ff |= DE_CLOSE;
+      }
+    } else {
+      ff |= DE_WRITE;
+    }
+  }
+
+  // Tell the descriptor about the event.
+  if (ff != 0) {
+    pdispatcher->OnPreEvent(ff);
+    pdispatcher->OnEvent(ff, errcode);
+  }
+}
+
 bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
+#if defined(WEBRTC_LINUX)
+  if (wait_mode_ == WAIT_EPOLL)
+    return WaitEpoll(cmsWait, process_io);
+#endif
+  return WaitSelect(cmsWait, process_io);
+}
+
+bool PhysicalSocketServer::WaitSelect(int cmsWait, bool process_io) {
   // Calculate timing information
 
   struct timeval *ptvWait = NULL;
@@ -1345,51 +1639,13 @@ bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
       for (size_t i = 0; i < dispatchers_.size(); ++i) {
         Dispatcher *pdispatcher = dispatchers_[i];
         int fd = pdispatcher->GetDescriptor();
-        uint32 ff = 0;
-        int errcode = 0;
-
-        // Reap any error code, which can be signaled through reads or writes.
-        // TODO: Should we set errcode if getsockopt fails?
-        if (FD_ISSET(fd, &fdsRead) || FD_ISSET(fd, &fdsWrite)) {
-          socklen_t len = sizeof(errcode);
-          ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &errcode, &len);
-        }
-
-        // Check readable descriptors. If we're waiting on an accept, signal
-        // that. Otherwise we're waiting for data, check to see if we're
-        // readable or really closed.
-        // TODO: Only peek at TCP descriptors.
-        if (FD_ISSET(fd, &fdsRead)) {
+        bool readable = FD_ISSET(fd, &fdsRead);
+        if (readable)
           FD_CLR(fd, &fdsRead);
-          if (pdispatcher->GetRequestedEvents() & DE_ACCEPT) {
-            ff |= DE_ACCEPT;
-          } else if (errcode || pdispatcher->IsDescriptorClosed()) {
-            ff |= DE_CLOSE;
-          } else {
-            ff |= DE_READ;
-          }
-        }
-
-        // Check writable descriptors. If we're waiting on a connect, detect
-        // success versus failure by the reaped error code.
-        if (FD_ISSET(fd, &fdsWrite)) {
+        bool writable = FD_ISSET(fd, &fdsWrite);
+        if (writable)
           FD_CLR(fd, &fdsWrite);
-          if (pdispatcher->GetRequestedEvents() & DE_CONNECT) {
-            if (!errcode) {
-              ff |= DE_CONNECT;
-            } else {
-              ff |= DE_CLOSE;
-            }
-          } else {
-            ff |= DE_WRITE;
-          }
-        }
-
-        // Tell the descriptor about the event.
-        if (ff != 0) {
-          pdispatcher->OnPreEvent(ff);
-          pdispatcher->OnEvent(ff, errcode);
-        }
+        ProcessEvents(pdispatcher, readable, writable);
       }
     }
 
@@ -1417,6 +1673,141 @@ bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
   return true;
 }
 
+bool PhysicalSocketServer::WaitPoll(int cmsWait, Dispatcher* pdispatcher) {
+  ASSERT(pdispatcher);
+  uint32 msStop = (cmsWait == kForever) ? 0 : TimeAfter(cmsWait);
+  int cmsNext = cmsWait;
+  struct pollfd fds = {0};
+  fds.fd = pdispatcher->GetDescriptor();
+  fds.events = POLLIN;
+
+  fWait_ = true;
+
+  while (fWait_) {
+    fds.revents = 0;
+    int n = poll(&fds, 1, cmsNext);
+    if (n < 0) {
+      if (errno != EINTR) {
+        LOG_E(LS_ERROR, EN, errno) << "poll";
+        return false;
+      }
+    } else if (n == 0) {
+      return true;
+    } else {
+      CritScope cr(&crit_);
+      ProcessEvents(pdispatcher, (fds.revents & (POLLIN | POLLERR | POLLHUP)),
+                    false);
+    }
+
+    if (cmsWait != kForever)
+      cmsNext = std::max(TimeUntil(msStop), 0);
+  }
+
+  return true;
+}
+
+#if defined(WEBRTC_LINUX)
+static uint32 GetEpollEvents(uint32 ff) {
+  uint32 events = 0;
+  if (ff & (DE_READ | DE_ACCEPT))
+    events |= EPOLLIN;
+  if (ff & (DE_WRITE | DE_CONNECT))
+    events |= EPOLLOUT;
+  return events;
+}
+
+void PhysicalSocketServer::UpdateEpoll(Dispatcher* pdispatcher,
+                                       uint32* registered_events) {
+  uint32 events = GetEpollEvents(pdispatcher->GetRequestedEvents());
+  if (events == *registered_events)
+    return;
+
+  // Descriptors without requested events are taken out of the epoll set, as
+  // EPOLLERR and EPOLLHUP would otherwise be reported for them over and over.
+  int op;
+  if (*registered_events == 0) {
+    op = EPOLL_CTL_ADD;
+  } else if (events == 0) {
+    op = EPOLL_CTL_DEL;
+  } else {
+    op = EPOLL_CTL_MOD;
+  }
+  struct epoll_event event = {0};
+  event.events = events;
+  event.data.ptr = pdispatcher;
+  int fd = pdispatcher->GetDescriptor();
+  if (epoll_ctl(epoll_fd_, op, fd, &event) == -1) {
+    LOG_E(LS_ERROR, EN, errno) << "epoll_ctl op=" << op << " fd=" << fd;
+    return;
+  }
+  *registered_events = events;
+}
+
+bool PhysicalSocketServer::WaitEpoll(int cmsWait, bool process_io) {
+  // Without |process_io| only the wakeup signal is of interest. Waiting on
+  // the epoll set would spin on sockets that are ready but can't be served.
+  if (!process_io)
+    return WaitPoll(cmsWait, signal_wakeup_);
+
+  uint32 msStop = (cmsWait == kForever) ? 0 : TimeAfter(cmsWait);
+  int cmsNext = cmsWait;
+
+  fWait_ = true;
+
+  while (fWait_) {
+    int n = epoll_wait(epoll_fd_, &epoll_events_[0],
+                       static_cast<int>(epoll_events_.size()), cmsNext);
+    if (n < 0) {
+      if (errno != EINTR) {
+        LOG_E(LS_ERROR, EN, errno) << "epoll_wait";
+        return false;
+      }
+      // Else ignore the error and keep going, see WaitSelect().
+    } else if (n == 0) {
+      // If timeout, return success
+      return true;
+    } else {
+      CritScope cr(&crit_);
+      pending_epoll_events_ = n;
+      for (int i = 0; i < n; ++i) {
+        const struct epoll_event& event = epoll_events_[i];
+        Dispatcher* pdispatcher = static_cast<Dispatcher*>(event.data.ptr);
+        if (!pdispatcher) {
+          // Removed by the handler of an earlier event.
+          continue;
+        }
+
+        // Errors and hangups are delivered through the events that were
+        // requested, the same way select() reports them.
+        uint32 requested = GetEpollEvents(pdispatcher->GetRequestedEvents());
+        bool error = (event.events & (EPOLLERR | EPOLLHUP)) != 0;
+        bool readable = (event.events & EPOLLIN) ||
+                        (error && (requested & EPOLLIN));
+        bool writable = (event.events & EPOLLOUT) ||
+                        (error && (requested & EPOLLOUT));
+
+        processing_dispatcher_ = pdispatcher;
+        ProcessEvents(pdispatcher, readable, writable);
+        // |processing_dispatcher_| is cleared if the handler removed it.
+        if (processing_dispatcher_) {
+          processing_dispatcher_ = NULL;
+          EpollDispatcherMap::iterator it =
+              epoll_dispatchers_.find(pdispatcher);
+          if (it != epoll_dispatchers_.end())
+            UpdateEpoll(pdispatcher, &it->second);
+        }
+      }
+      pending_epoll_events_ = 0;
+    }
+
+    if (cmsWait != kForever)
+      cmsNext = std::max(TimeUntil(msStop), 0);
+  }
+
+  return true;
+}
+#endif  // WEBRTC_LINUX
+
 static void GlobalSignalHandler(int signum) {
   PosixSignalHandler::Instance()->OnPosixSignalReceived(signum);
 }
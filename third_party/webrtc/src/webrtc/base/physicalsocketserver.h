@@ -11,6 +11,11 @@
 #ifndef WEBRTC_BASE_PHYSICALSOCKETSERVER_H__
 #define WEBRTC_BASE_PHYSICALSOCKETSERVER_H__
 
+#if defined(WEBRTC_LINUX)
+#include <sys/epoll.h>
+#endif
+
+#include <map>
 #include <vector>
 
 #include "webrtc/base/asyncfile.h"
@@ -57,9 +62,23 @@ class Dispatcher {
 // A socket server that provides the real sockets of the underlying OS.
 class PhysicalSocketServer : public SocketServer {
  public:
+  // How Wait() waits for I/O.
+  // WAIT_SELECT rebuilds the fd_sets from all dispatchers on every iteration
+  // and is limited to FD_SETSIZE descriptors.
+  // WAIT_EPOLL keeps the dispatchers registered with an epoll instance, so a
+  // wakeup costs O(ready descriptors) and there is no descriptor limit. It is
+  // only available on Linux; elsewhere it falls back to WAIT_SELECT.
+  enum WaitMode {
+    WAIT_SELECT,
+    WAIT_EPOLL,
+  };
+
   PhysicalSocketServer();
+  explicit PhysicalSocketServer(WaitMode mode);
   ~PhysicalSocketServer() override;
 
+  WaitMode wait_mode() const { return wait_mode_; }
+
   // SocketFactory:
   Socket* CreateSocket(int type) override;
   Socket* CreateSocket(int family, int type) override;
@@ -76,6 +95,8 @@ class PhysicalSocketServer : public SocketServer {
 
   void Add(Dispatcher* dispatcher);
   void Remove(Dispatcher* dispatcher);
+  // Called by dispatchers when the result of GetRequestedEvents() changes.
+  void Update(Dispatcher* dispatcher);
 
 #if defined(WEBRTC_POSIX)
   AsyncFile* CreateFile(int fd);
@@ -103,8 +124,30 @@ class PhysicalSocketServer : public SocketServer {
 #if defined(WEBRTC_POSIX)
   static bool InstallSignal(int signum, void (*handler)(int));
 
+  bool WaitSelect(int cmsWait, bool process_io);
+  bool WaitPoll(int cmsWait, Dispatcher* dispatcher);
+
   scoped_ptr<PosixSignalDispatcher> signal_dispatcher_;
 #endif
+#if defined(WEBRTC_LINUX)
+  // Maps each registered dispatcher to the events it is registered for with
+  // epoll; zero means its descriptor is not in the epoll set.
+  typedef std::map<Dispatcher*, uint32> EpollDispatcherMap;
+
+  bool WaitEpoll(int cmsWait, bool process_io);
+  void UpdateEpoll(Dispatcher* dispatcher, uint32* registered_events);
+
+  int epoll_fd_;
+  EpollDispatcherMap epoll_dispatchers_;
+  std::vector<struct epoll_event> epoll_events_;
+  // Number of entries of |epoll_events_| that are being processed.
+  size_t pending_epoll_events_;
+  // The dispatcher whose OnEvent() is running. Its registration is only
+  // updated once the handler returns, so that a read handler that disables
+  // and re-enables DE_READ doesn't cost two epoll_ctl() calls.
+  Dispatcher* processing_dispatcher_;
+#endif
+  WaitMode wait_mode_;
   DispatcherList dispatchers_;
   IteratorList iterators_;
   Signaler* signal_wakeup_;
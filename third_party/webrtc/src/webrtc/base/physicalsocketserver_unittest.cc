@@ -10,7 +10,12 @@
 
 #include <signal.h>
 #include <stdarg.h>
+#if defined(WEBRTC_POSIX)
+#include <sys/resource.h>
+#include <time.h>
+#endif
 
+#include "webrtc/base/event.h"
 #include "webrtc/base/gunit.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/physicalsocketserver.h"
@@ -18,6 +23,7 @@
 #include "webrtc/base/socket_unittest.h"
 #include "webrtc/base/testutils.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/test/testsupport/gtest_disable.h"
 
 namespace rtc {
@@ -234,6 +240,81 @@ TEST_F(PhysicalSocketTest, TestGetSetOptionsIPv6) {
   SocketTest::TestGetSetOptionsIPv6();
 }
 
+#if defined(WEBRTC_LINUX)
+
+// Runs the socket tests against a socket server that waits with epoll.
+class PhysicalSocketEpollTest : public SocketTest {
+ protected:
+  PhysicalSocketEpollTest()
+      : epoll_ss_(PhysicalSocketServer::WAIT_EPOLL), scope_(&epoll_ss_) {}
+
+  PhysicalSocketServer epoll_ss_;
+  SocketServerScope scope_;
+};
+
+TEST_F(PhysicalSocketEpollTest, TestWaitMode) {
+  EXPECT_EQ(PhysicalSocketServer::WAIT_EPOLL, epoll_ss_.wait_mode());
+  EXPECT_EQ(&epoll_ss_, Thread::Current()->socketserver());
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectIPv4) {
+  SocketTest::TestConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectWithDnsLookupIPv4) {
+  SocketTest::TestConnectWithDnsLookupIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectFailIPv4) {
+  SocketTest::TestConnectFailIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectWithClosedSocketIPv4) {
+  SocketTest::TestConnectWithClosedSocketIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectWhileNotClosedIPv4) {
+  SocketTest::TestConnectWhileNotClosedIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestServerCloseDuringConnectIPv4) {
+  SocketTest::TestServerCloseDuringConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestClientCloseDuringConnectIPv4) {
+  SocketTest::TestClientCloseDuringConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestServerCloseIPv4) {
+  SocketTest::TestServerCloseIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestCloseInClosedCallbackIPv4) {
+  SocketTest::TestCloseInClosedCallbackIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestSocketServerWaitIPv4) {
+  SocketTest::TestSocketServerWaitIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestTcpIPv4) {
+  SocketTest::TestTcpIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestUdpIPv4) {
+  SocketTest::TestUdpIPv4();
+}
+
+#if !defined(THREAD_SANITIZER) && !defined(MEMORY_SANITIZER)
+
+TEST_F(PhysicalSocketEpollTest, TestUdpReadyToSendIPv4) {
+  SocketTest::TestUdpReadyToSendIPv4();
+}
+
+#endif // if !defined(THREAD_SANITIZER) && !defined(MEMORY_SANITIZER)
+
+#endif  // defined(WEBRTC_LINUX)
+
 #if defined(WEBRTC_POSIX)
 
 class PosixSignalDeliveryTest : public testing::Test {
@@ -252,6 +333,10 @@ class PosixSignalDeliveryTest : public testing::Test {
     ss_.reset(NULL);
     signals_received_.clear();
     signaled_thread_ = NULL;
+    // Unmask any signals a test has blocked on this thread.
+    sigset_t mask;
+    sigemptyset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
   }
 
   bool ExpectSignal(int signum) {
@@ -357,6 +442,166 @@ TEST_F(PosixSignalDeliveryTest, SignalOnDifferentThread) {
   EXPECT_TRUE(ExpectNone());
 }
 
+#if defined(WEBRTC_LINUX)
+
+class PosixSignalDeliveryEpollTest : public PosixSignalDeliveryTest {
+ protected:
+  void SetUp() {
+    ss_.reset(new PhysicalSocketServer(PhysicalSocketServer::WAIT_EPOLL));
+  }
+};
+
+TEST_F(PosixSignalDeliveryEpollTest, RaiseThenWait) {
+  ASSERT_TRUE(ss_->SetPosixSignalHandler(SIGTERM, &RecordSignal));
+  raise(SIGTERM);
+  EXPECT_TRUE(ss_->Wait(0, true));
+  EXPECT_TRUE(ExpectSignal(SIGTERM));
+  EXPECT_TRUE(ExpectNone());
+}
+
+TEST_F(PosixSignalDeliveryEpollTest, SignalDuringWait) {
+  ss_->SetPosixSignalHandler(SIGALRM, &RecordSignal);
+  alarm(1);
+  EXPECT_TRUE(ss_->Wait(1500, true));
+  EXPECT_TRUE(ExpectSignal(SIGALRM));
+  EXPECT_TRUE(ExpectNone());
+}
+
+// Owns |num_sockets| bound loopback UDP sockets and measures how long it takes
+// from sending a datagram to a random one of them until Wait() has delivered
+// its read event.
+class WakeupBenchmark : public sigslot::has_slots<> {
+ public:
+  explicit WakeupBenchmark(PhysicalSocketServer* ss)
+      : ss_(ss), received_(false) {}
+
+  ~WakeupBenchmark() {
+    for (size_t i = 0; i < sockets_.size(); ++i) {
+      delete sockets_[i];
+    }
+  }
+
+  bool Init(int num_sockets) {
+    sender_.reset(ss_->CreateSocket(AF_INET, SOCK_DGRAM));
+    if (!sender_) {
+      return false;
+    }
+    for (int i = 0; i < num_sockets; ++i) {
+      AsyncSocket* socket = ss_->CreateAsyncSocket(AF_INET, SOCK_DGRAM);
+      if (!socket) {
+        return false;
+      }
+      sockets_.push_back(socket);
+      if (socket->Bind(SocketAddress(IPAddress(INADDR_LOOPBACK), 0)) != 0) {
+        return false;
+      }
+      socket->SignalReadEvent.connect(this, &WakeupBenchmark::OnReadEvent);
+    }
+    return true;
+  }
+
+  // Descriptors are allocated lowest first, so a new one is larger than any
+  // descriptor the sockets use.
+  static bool FitsInFdSet() {
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    if (probe < 0) {
+      return false;
+    }
+    close(probe);
+    return probe < FD_SETSIZE;
+  }
+
+  // Returns the average wakeup latency and the average CPU time spent per
+  // wakeup, in microseconds.
+  void Run(int iterations, double* latency_us, double* cpu_us) {
+    // Flush the initial write events of the new sockets.
+    ss_->Wait(0, true);
+    uint64 latency_ns = 0;
+    uint64 cpu_start_ns = ThreadCpuNanos();
+    uint32 index = 0;
+    char byte = 0;
+    for (int i = 0; i < iterations; ++i) {
+      // A simple LCG is good enough to avoid always hitting the same socket.
+      index = index * 1103515245 + 12345;
+      AsyncSocket* target = sockets_[(index >> 8) % sockets_.size()];
+      received_ = false;
+      uint64 start_ns = TimeNanos();
+      sender_->SendTo(&byte, sizeof(byte), target->GetLocalAddress());
+      while (!received_) {
+        ss_->Wait(Event::kForever, true);
+      }
+      latency_ns += TimeNanos() - start_ns;
+    }
+    uint64 cpu_ns = ThreadCpuNanos() - cpu_start_ns;
+    *latency_us = latency_ns / 1000.0 / iterations;
+    *cpu_us = cpu_ns / 1000.0 / iterations;
+  }
+
+ private:
+  static uint64 ThreadCpuNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64>(ts.tv_sec) * kNumNanosecsPerSec + ts.tv_nsec;
+  }
+
+  void OnReadEvent(AsyncSocket* socket) {
+    char byte;
+    socket->RecvFrom(&byte, sizeof(byte), NULL);
+    received_ = true;
+    ss_->WakeUp();
+  }
+
+  PhysicalSocketServer* ss_;
+  scoped_ptr<Socket> sender_;
+  std::vector<AsyncSocket*> sockets_;
+  bool received_;
+};
+
+// Compares select() and epoll as the number of idle sockets grows. select()
+// can't watch descriptors at or above FD_SETSIZE, so it is skipped for the
+// larger socket counts. Disabled by default since it needs a high descriptor
+// limit and takes a while.
+TEST(PhysicalSocketServerTest, DISABLED_WakeupPerf) {
+  const int kSocketCounts[] = { 100, 1000, 10000 };
+  const int kIterations = 2000;
+
+  struct rlimit limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  getrlimit(RLIMIT_NOFILE, &limit);
+
+  const PhysicalSocketServer::WaitMode kModes[] = {
+    PhysicalSocketServer::WAIT_SELECT, PhysicalSocketServer::WAIT_EPOLL
+  };
+  for (int i = 0; i < ARRAY_SIZE(kSocketCounts); ++i) {
+    const int num_sockets = kSocketCounts[i];
+    // Leave some room for the descriptors the process already has open.
+    if (static_cast<rlim_t>(num_sockets) + 64 > limit.rlim_cur) {
+      LOG(LS_WARNING) << "Skipping " << num_sockets << " sockets, descriptor "
+                      << "limit is " << limit.rlim_cur;
+      continue;
+    }
+    for (int j = 0; j < ARRAY_SIZE(kModes); ++j) {
+      PhysicalSocketServer ss(kModes[j]);
+      WakeupBenchmark benchmark(&ss);
+      ASSERT_TRUE(benchmark.Init(num_sockets));
+      if (kModes[j] == PhysicalSocketServer::WAIT_SELECT &&
+          !WakeupBenchmark::FitsInFdSet()) {
+        continue;
+      }
+      double latency_us, cpu_us;
+      benchmark.Run(kIterations, &latency_us, &cpu_us);
+      bool epoll = kModes[j] == PhysicalSocketServer::WAIT_EPOLL;
+      LOG(LS_INFO) << (epoll ? "epoll" : "select") << ", "
+                   << num_sockets << " sockets: " << latency_us
+                   << " us/wakeup, " << cpu_us << " us CPU/wakeup";
+    }
+  }
+}
+
+#endif  // defined(WEBRTC_LINUX)
+
 #endif
 
 }  // namespace rtc
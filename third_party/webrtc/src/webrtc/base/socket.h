@@ -12,6 +12,9 @@
 #define WEBRTC_BASE_SOCKET_H__
 
 #include <errno.h>
+#include <string.h>
+
+#include <vector>
 
 #if defined(WEBRTC_POSIX)
 #include <sys/types.h>
@@ -144,6 +147,87 @@ class Socket {
   virtual int SendTo(const void *pv, size_t cb, const SocketAddress& addr) = 0;
   virtual int Recv(void *pv, size_t cb) = 0;
   virtual int RecvFrom(void *pv, size_t cb, SocketAddress *paddr) = 0;
+
+  // One datagram of a batched send or receive. On receive, |size| is the
+  // capacity of |data|; |length| and |addr| are filled in. A |length| larger
+  // than |size| means the datagram was truncated. On send, |length| bytes of
+  // |data| are sent to |addr|.
+  struct Datagram {
+    Datagram() : data(NULL), size(0), length(0) {}
+    char* data;
+    size_t size;
+    size_t length;
+    SocketAddress addr;
+  };
+
+  // Receives up to |count| datagrams with as few system calls as possible.
+  // Returns the number received, or -1 if none could be received. The default
+  // implementation receives one datagram.
+  virtual int RecvFromBatch(Datagram* datagrams, size_t count) {
+    if (count == 0)
+      return 0;
+    int received = RecvFrom(datagrams[0].data, datagrams[0].size,
+                            &datagrams[0].addr);
+    if (received < 0)
+      return received;
+    datagrams[0].length = static_cast<size_t>(received);
+    return 1;
+  }
+
+  // Sends |count| datagrams in order, stopping at the first one that fails.
+  // Returns the number sent, or -1 if the first one failed.
+  virtual int SendToBatch(const Datagram* datagrams, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      if (SendTo(datagrams[i].data, datagrams[i].length,
+                 datagrams[i].addr) < 0) {
+        return (i == 0) ? -1 : static_cast<int>(i);
+      }
+    }
+    return static_cast<int>(count);
+  }
+
+  // One piece of a gathered send on a stream socket.
+  struct IoBuffer {
+    IoBuffer() : data(NULL), length(0) {}
+    IoBuffer(const void* data, size_t length) : data(data), length(length) {}
+    const void* data;
+    size_t length;
+  };
+
+  // Sends |count| buffers back to back, like a Send() of their concatenation
+  // but without copying them together first where the socket supports it.
+  // Returns the number of bytes sent, or -1 if nothing could be sent. The
+  // default implementation joins the buffers and calls Send() once, since
+  // wrapping sockets such as SSL adapters and proxies turn each Send() into
+  // a record or segment of its own.
+  virtual int SendGather(const IoBuffer* buffers, size_t count) {
+    size_t total = 0;
+    const IoBuffer* last = NULL;
+    size_t num_buffers = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (buffers[i].length > 0) {
+        total += buffers[i].length;
+        last = &buffers[i];
+        ++num_buffers;
+      }
+    }
+    if (num_buffers <= 1)
+      return last ? Send(last->data, last->length) : 0;
+
+    char stack_buffer[kMaxStackGatherSize];
+    std::vector<char> heap_buffer;
+    char* joined = stack_buffer;
+    if (total > sizeof(stack_buffer)) {
+      heap_buffer.resize(total);
+      joined = &heap_buffer[0];
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(joined + offset, buffers[i].data, buffers[i].length);
+      offset += buffers[i].length;
+    }
+    return Send(joined, total);
+  }
   virtual int Listen(int backlog) = 0;
   virtual Socket *Accept(SocketAddress *paddr) = 0;
   virtual int Close() = 0;
@@ -173,6 +257,8 @@ class Socket {
     OPT_RTP_SENDTIME_EXTN_ID,  // This is a non-traditional socket option param.
                                // This is specific to libjingle and will be used
                                // if SendTime option is needed at socket level.
+    OPT_REUSEPORT,   // Whether other sockets may bind the same address;
+                     // must be set before Bind.
   };
   virtual int GetOption(Option opt, int* value) = 0;
   virtual int SetOption(Option opt, int value) = 0;
@@ -181,6 +267,9 @@ class Socket {
   Socket() {}
 
  private:
+  // Gathered sends up to this size are joined on the stack.
+  static const size_t kMaxStackGatherSize = 2048;
+
   RTC_DISALLOW_COPY_AND_ASSIGN(Socket);
 };
 
@@ -33,15 +33,45 @@ namespace rtc {
 // webrtc:5043.
 const char CS_AES_CM_128_HMAC_SHA1_80[] = "AES_CM_128_HMAC_SHA1_80";
 const char CS_AES_CM_128_HMAC_SHA1_32[] = "AES_CM_128_HMAC_SHA1_32";
+const char CS_AEAD_AES_128_GCM[] = "AEAD_AES_128_GCM";
+const char CS_AEAD_AES_256_GCM[] = "AEAD_AES_256_GCM";
 
 uint16_t GetSrtpCryptoSuiteFromName(const std::string& cipher) {
   if (cipher == CS_AES_CM_128_HMAC_SHA1_32)
     return SRTP_AES128_CM_SHA1_32;
   if (cipher == CS_AES_CM_128_HMAC_SHA1_80)
     return SRTP_AES128_CM_SHA1_80;
+  if (cipher == CS_AEAD_AES_128_GCM)
+    return SRTP_AEAD_AES_128_GCM;
+  if (cipher == CS_AEAD_AES_256_GCM)
+    return SRTP_AEAD_AES_256_GCM;
   return 0;
 }
 
+bool GetSrtpKeyAndSaltLengths(const std::string& cipher,
+                              int* key_length, int* salt_length) {
+  if (cipher == CS_AES_CM_128_HMAC_SHA1_32 ||
+      cipher == CS_AES_CM_128_HMAC_SHA1_80) {
+    // SRTP_AES128_CM_HMAC_SHA1_32 and SRTP_AES128_CM_HMAC_SHA1_80 are defined
+    // in RFC 5764 to use a 128 bits key and 112 bits salt for the cipher.
+    *key_length = 16;
+    *salt_length = 14;
+  } else if (cipher == CS_AEAD_AES_128_GCM) {
+    // SRTP_AEAD_AES_128_GCM is defined in RFC 7714 to use a 128 bits key and
+    // a 96 bits salt for the cipher.
+    *key_length = 16;
+    *salt_length = 12;
+  } else if (cipher == CS_AEAD_AES_256_GCM) {
+    // SRTP_AEAD_AES_256_GCM is defined in RFC 7714 to use a 256 bits key and
+    // a 96 bits salt for the cipher.
+    *key_length = 32;
+    *salt_length = 12;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 SSLStreamAdapter* SSLStreamAdapter::Create(StreamInterface* stream) {
 #if SSL_USE_SCHANNEL
   return NULL;
@@ -56,6 +86,10 @@ bool SSLStreamAdapter::GetSslCipherSuite(uint16_t* cipher) {
   return false;
 }
 
+bool SSLStreamAdapter::IsResumedSession() {
+  return false;
+}
+
 bool SSLStreamAdapter::ExportKeyingMaterial(const std::string& label,
                                             const uint8* context,
                                             size_t context_len,
@@ -84,6 +118,7 @@ uint16_t SSLStreamAdapter::GetDefaultSslCipherForTest(
     KeyType key_type) {
   return 0;
 }
+void SSLStreamAdapter::RotateSessionTicketKeysForTest() {}
 #elif SSL_USE_OPENSSL
 bool SSLStreamAdapter::HaveDtls() {
   return OpenSSLStreamAdapter::HaveDtls();
@@ -100,6 +135,10 @@ uint16_t SSLStreamAdapter::GetDefaultSslCipherForTest(
   return OpenSSLStreamAdapter::GetDefaultSslCipherForTest(version, key_type);
 }
 
+void SSLStreamAdapter::RotateSessionTicketKeysForTest() {
+  OpenSSLStreamAdapter::RotateSessionTicketKeysForTest();
+}
+
 std::string SSLStreamAdapter::GetSslCipherSuiteName(uint16_t cipher) {
   return OpenSSLStreamAdapter::GetSslCipherSuiteName(cipher);
 }
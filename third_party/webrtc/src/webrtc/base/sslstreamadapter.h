@@ -22,6 +22,8 @@ namespace rtc {
 // Constants for SRTP profiles.
 const uint16_t SRTP_AES128_CM_SHA1_80 = 0x0001;
 const uint16_t SRTP_AES128_CM_SHA1_32 = 0x0002;
+const uint16_t SRTP_AEAD_AES_128_GCM = 0x0007;
+const uint16_t SRTP_AEAD_AES_256_GCM = 0x0008;
 
 // Cipher suite to use for SRTP. Typically a 80-bit HMAC will be used, except
 // in applications (voice) where the additional bandwidth may be significant.
@@ -30,12 +32,24 @@ const uint16_t SRTP_AES128_CM_SHA1_32 = 0x0002;
 extern const char CS_AES_CM_128_HMAC_SHA1_80[];
 // 128-bit AES with 32-bit SHA-1 HMAC.
 extern const char CS_AES_CM_128_HMAC_SHA1_32[];
+// AEAD suites from RFC 7714. AES-GCM encrypts and authenticates in one pass
+// with a 128-bit tag, for both SRTP and SRTCP, and is usually much cheaper
+// than AES-CM plus HMAC-SHA1 on CPUs with AES and carry-less multiply
+// instructions.
+extern const char CS_AEAD_AES_128_GCM[];
+extern const char CS_AEAD_AES_256_GCM[];
 
 // Returns the DTLS-SRTP protection profile ID, as defined in
 // https://tools.ietf.org/html/rfc5764#section-4.1.2, for the given SRTP
 // Crypto-suite, as defined in https://tools.ietf.org/html/rfc4568#section-6.2
 uint16_t GetSrtpCryptoSuiteFromName(const std::string& cipher_rfc_name);
 
+// Returns the length in bytes of the master key and master salt used by the
+// given SRTP crypto-suite, or false if the suite is unknown. DTLS-SRTP exports
+// twice this much keying material, see RFC 5764, section 4.2.
+bool GetSrtpKeyAndSaltLengths(const std::string& cipher_rfc_name,
+                              int* key_length, int* salt_length);
+
 // SSLStreamAdapter : A StreamInterfaceAdapter that does SSL/TLS.
 // After SSL has been started, the stream will only open on successful
 // SSL verification of certificates, and the communication is
@@ -73,7 +87,7 @@ class SSLStreamAdapter : public StreamAdapterInterface {
 
   explicit SSLStreamAdapter(StreamInterface* stream)
       : StreamAdapterInterface(stream), ignore_bad_cert_(false),
-        client_auth_enabled_(true) { }
+        client_auth_enabled_(true), session_resumption_enabled_(false) { }
 
   void set_ignore_bad_cert(bool ignore) { ignore_bad_cert_ = ignore; }
   bool ignore_bad_cert() const { return ignore_bad_cert_; }
@@ -81,6 +95,20 @@ class SSLStreamAdapter : public StreamAdapterInterface {
   void set_client_auth_enabled(bool enabled) { client_auth_enabled_ = enabled; }
   bool client_auth_enabled() const { return client_auth_enabled_; }
 
+  // In peer-to-peer mode, lets the handshake resume a session established
+  // earlier in this process with the same peer certificate and identity,
+  // which saves the public key operations and a round trip for the client.
+  // The peer certificate digest is still checked for resumed sessions.
+  // Servers encrypt session tickets with process-wide keys that are
+  // replaced every few minutes; a ticket is readable for at least the
+  // session lifetime of 10 minutes.
+  void set_session_resumption_enabled(bool enabled) {
+    session_resumption_enabled_ = enabled;
+  }
+  bool session_resumption_enabled() const {
+    return session_resumption_enabled_;
+  }
+
   // Specify our SSL identity: key and certificate. Mostly this is
   // only used in the peer-to-peer mode (unless we actually want to
   // provide a client certificate to a server).
@@ -154,6 +182,10 @@ class SSLStreamAdapter : public StreamAdapterInterface {
   // connection (e.g. 0x2F for "TLS_RSA_WITH_AES_128_CBC_SHA").
   virtual bool GetSslCipherSuite(uint16_t* cipher);
 
+  // Returns true if the connection was established by resuming an earlier
+  // session, see set_session_resumption_enabled().
+  virtual bool IsResumedSession();
+
   // Key Exporter interface from RFC 5705
   // Arguments are:
   // label               -- the exporter label.
@@ -188,6 +220,10 @@ class SSLStreamAdapter : public StreamAdapterInterface {
   static uint16_t GetDefaultSslCipherForTest(SSLProtocolVersion version,
                                              KeyType key_type);
 
+  // Replaces the oldest session ticket key with a new one, as happens
+  // periodically, see set_session_resumption_enabled(). For unit tests.
+  static void RotateSessionTicketKeysForTest();
+
   // TODO(guoweis): Move this away from a static class method. Currently this is
   // introduced such that any caller could depend on sslstreamadapter.h without
   // depending on specific SSL implementation.
@@ -203,6 +239,9 @@ class SSLStreamAdapter : public StreamAdapterInterface {
   // handshake. If no certificate is given, handshake fails. This applies to
   // server mode only.
   bool client_auth_enabled_;
+
+  // If true, sessions may be resumed across adapters. Off by default.
+  bool session_resumption_enabled_;
 };
 
 }  // namespace rtc
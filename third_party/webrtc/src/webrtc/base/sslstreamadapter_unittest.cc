@@ -21,6 +21,7 @@
 #include "webrtc/base/sslidentity.h"
 #include "webrtc/base/sslstreamadapter.h"
 #include "webrtc/base/stream.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/test/testsupport/gtest_disable.h"
 
 using ::testing::WithParamInterface;
@@ -31,6 +32,8 @@ using ::testing::tuple;
 static const int kBlockSize = 4096;
 static const char kAES_CM_HMAC_SHA1_80[] = "AES_CM_128_HMAC_SHA1_80";
 static const char kAES_CM_HMAC_SHA1_32[] = "AES_CM_128_HMAC_SHA1_32";
+static const char kAEAD_AES_128_GCM[] = "AEAD_AES_128_GCM";
+static const char kAEAD_AES_256_GCM[] = "AEAD_AES_256_GCM";
 static const char kExporterLabel[] = "label";
 static const unsigned char kExporterContext[] = "context";
 static int kExporterContextLen = sizeof(kExporterContext);
@@ -183,7 +186,8 @@ class SSLStreamAdapterTestBase : public testing::Test,
         damage_(false),
         dtls_(dtls),
         handshake_wait_(5000),
-        identities_set_(false) {
+        identities_set_(false),
+        handshake_packets_(0) {
     // Set use of the test RNG to get predictable loss patterns.
     rtc::SetRandomTestMode(true);
 
@@ -241,6 +245,46 @@ class SSLStreamAdapterTestBase : public testing::Test,
     server_ssl_->SetIdentity(server_identity_);
   }
 
+  // Replaces the adapters with new ones using the same identities, like a
+  // new connection between the same peers.
+  void Reconnect() {
+    rtc::SSLIdentity* client_identity = client_identity_->GetReference();
+    rtc::SSLIdentity* server_identity = server_identity_->GetReference();
+    client_ssl_.reset();
+    server_ssl_.reset();
+
+    // Drop what the old adapters sent when they were closed.
+    char buf[kFifoBufferSize];
+    while (client_buffer_.Read(buf, sizeof(buf), NULL, NULL) ==
+           rtc::SR_SUCCESS) {
+    }
+    while (server_buffer_.Read(buf, sizeof(buf), NULL, NULL) ==
+           rtc::SR_SUCCESS) {
+    }
+
+    client_stream_ =
+        new SSLDummyStream(this, "c2s", &client_buffer_, &server_buffer_);
+    server_stream_ =
+        new SSLDummyStream(this, "s2c", &server_buffer_, &client_buffer_);
+
+    client_ssl_.reset(rtc::SSLStreamAdapter::Create(client_stream_));
+    server_ssl_.reset(rtc::SSLStreamAdapter::Create(server_stream_));
+
+    client_ssl_->SignalEvent.connect(this, &SSLStreamAdapterTestBase::OnEvent);
+    server_ssl_->SignalEvent.connect(this, &SSLStreamAdapterTestBase::OnEvent);
+
+    client_identity_ = client_identity;
+    server_identity_ = server_identity;
+    client_ssl_->SetIdentity(client_identity_);
+    server_ssl_->SetIdentity(server_identity_);
+    identities_set_ = false;
+  }
+
+  void SetSessionResumption(bool enabled) {
+    client_ssl_->set_session_resumption_enabled(enabled);
+    server_ssl_->set_session_resumption_enabled(enabled);
+  }
+
   virtual void OnEvent(rtc::StreamInterface *stream, int sig, int err) {
     LOG(LS_INFO) << "SSLStreamAdapterTestBase::OnEvent sig=" << sig;
 
@@ -333,6 +377,12 @@ class SSLStreamAdapterTestBase : public testing::Test,
   rtc::StreamResult DataWritten(SSLDummyStream *from, const void *data,
                                       size_t data_len, size_t *written,
                                       int *error) {
+    if (data_len > 0) {
+      unsigned char content_type = *static_cast<const unsigned char*>(data);
+      if (content_type == 20 || content_type == 22)
+        ++handshake_packets_;
+    }
+
     // Randomly drop loss_ percent of packets
     if (rtc::CreateRandomId() % 100 < static_cast<uint32>(loss_)) {
       LOG(LS_INFO) << "Randomly dropping packet, size=" << data_len;
@@ -458,6 +508,9 @@ class SSLStreamAdapterTestBase : public testing::Test,
   bool dtls_;
   int handshake_wait_;
   bool identities_set_;
+  // Datagrams starting with a ChangeCipherSpec or handshake record, not
+  // counting those dropped by SetLoseFirstPacket().
+  int handshake_packets_;
 };
 
 class SSLStreamAdapterTestTLS
@@ -621,7 +674,7 @@ class SSLStreamAdapterTestDTLS
     for (;;) {
       r = stream->Read(buffer, 2000, &bread, &err2);
 
-      if (r == rtc::SR_ERROR) {
+      if (r == rtc::SR_ERROR || r == rtc::SR_EOS) {
         // Unfortunately, errors are the way that the stream adapter
         // signals close right now
         stream->Close();
@@ -753,6 +806,155 @@ TEST_P(SSLStreamAdapterTestDTLS, TestDTLSConnect) {
   TestHandshake();
 };
 
+// Test that a retransmitted flight is packed into as few datagrams as the
+// first transmission, rather than sent one handshake message at a time.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSRetransmittedFlightIsPacked) {
+  MAYBE_SKIP_TEST(HaveDtls);
+  SetLoseFirstPacket(true);
+  TestHandshake();
+  // ClientHello and the server's first flight are lost and retransmitted,
+  // then each side sends its second flight.
+  EXPECT_EQ(4, handshake_packets_);
+};
+
+// Test that a second connection between the same peers resumes the session
+// of the first, and still negotiates DTLS-SRTP.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSessionResumption) {
+  MAYBE_SKIP_TEST(HaveDtlsSrtp);
+  std::vector<std::string> ciphers;
+  ciphers.push_back(kAES_CM_HMAC_SHA1_80);
+  SetSessionResumption(true);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsResumedSession());
+  EXPECT_FALSE(server_ssl_->IsResumedSession());
+
+  Reconnect();
+  SetSessionResumption(true);
+  SetDtlsSrtpCiphers(ciphers, true);
+  SetDtlsSrtpCiphers(ciphers, false);
+  handshake_packets_ = 0;
+  TestHandshake();
+  EXPECT_TRUE(client_ssl_->IsResumedSession());
+  EXPECT_TRUE(server_ssl_->IsResumedSession());
+  // ClientHello, the server's flight and the client's Finished.
+  EXPECT_EQ(3, handshake_packets_);
+
+  rtc::SSLCertificate* cert;
+  ASSERT_TRUE(GetPeerCertificate(true, &cert));
+  delete cert;
+  ASSERT_TRUE(GetPeerCertificate(false, &cert));
+  delete cert;
+
+  std::string client_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(true, &client_cipher));
+  std::string server_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(false, &server_cipher));
+  ASSERT_EQ(client_cipher, server_cipher);
+  ASSERT_EQ(client_cipher, kAES_CM_HMAC_SHA1_80);
+};
+
+// Test that tickets stay usable while their key is kept, and that a renewed
+// ticket survives the rotation that drops its original key.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSessionResumptionKeyRotation) {
+  MAYBE_SKIP_TEST(HaveDtls);
+  SetSessionResumption(true);
+  TestHandshake();
+
+  rtc::SSLStreamAdapter::RotateSessionTicketKeysForTest();
+  Reconnect();
+  SetSessionResumption(true);
+  TestHandshake();
+  EXPECT_TRUE(client_ssl_->IsResumedSession());
+  EXPECT_TRUE(server_ssl_->IsResumedSession());
+
+  rtc::SSLStreamAdapter::RotateSessionTicketKeysForTest();
+  rtc::SSLStreamAdapter::RotateSessionTicketKeysForTest();
+  Reconnect();
+  SetSessionResumption(true);
+  TestHandshake();
+  EXPECT_TRUE(client_ssl_->IsResumedSession());
+
+  // Once all keys have been replaced, the ticket can't be read anymore.
+  for (int i = 0; i < 3; ++i)
+    rtc::SSLStreamAdapter::RotateSessionTicketKeysForTest();
+  Reconnect();
+  SetSessionResumption(true);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsResumedSession());
+  EXPECT_FALSE(server_ssl_->IsResumedSession());
+};
+
+// Test that sessions are not resumed unless enabled on both sides.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSessionResumptionDisabled) {
+  MAYBE_SKIP_TEST(HaveDtls);
+  SetSessionResumption(true);
+  TestHandshake();
+
+  Reconnect();
+  client_ssl_->set_session_resumption_enabled(true);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsResumedSession());
+  EXPECT_FALSE(server_ssl_->IsResumedSession());
+};
+
+// Test that a session is not resumed with a peer the server no longer
+// expects, even though the client offers it.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSessionResumptionChecksPeer) {
+  MAYBE_SKIP_TEST(HaveDtls);
+  SetSessionResumption(true);
+  TestHandshake();
+
+  Reconnect();
+  SetSessionResumption(true);
+  unsigned char digest[20];
+  size_t digest_len;
+  ASSERT_TRUE(server_identity_->certificate().ComputeDigest(
+      rtc::DIGEST_SHA_1, digest, sizeof(digest), &digest_len));
+  ASSERT_TRUE(client_ssl_->SetPeerCertificateDigest(rtc::DIGEST_SHA_1, digest,
+                                                    digest_len));
+  ASSERT_TRUE(client_identity_->certificate().ComputeDigest(
+      rtc::DIGEST_SHA_1, digest, sizeof(digest), &digest_len));
+  digest[0]++;
+  ASSERT_TRUE(server_ssl_->SetPeerCertificateDigest(rtc::DIGEST_SHA_1, digest,
+                                                    digest_len));
+  identities_set_ = true;
+
+  server_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+  client_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+  server_ssl_->SetServerRole();
+  ASSERT_EQ(0, server_ssl_->StartSSLWithPeer());
+  ASSERT_EQ(0, client_ssl_->StartSSLWithPeer());
+  EXPECT_EQ_WAIT(rtc::SS_CLOSED, server_ssl_->GetState(), handshake_wait_);
+};
+
+// Measures how many handshakes per second a single thread completes, with
+// full and with resumed handshakes.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSHandshakeRate) {
+  MAYBE_SKIP_TEST(HaveDtls);
+  const int kHandshakes = 20;
+  SetSessionResumption(true);
+  TestHandshake();
+
+  int rates[2];
+  for (int resumed = 0; resumed < 2; ++resumed) {
+    uint32_t start = rtc::Time();
+    for (int i = 0; i < kHandshakes; ++i) {
+      Reconnect();
+      SetSessionResumption(resumed != 0);
+      TestHandshake();
+      ASSERT_EQ(resumed != 0, client_ssl_->IsResumedSession());
+    }
+    uint32_t elapsed = std::max<uint32_t>(1, rtc::TimeSince(start));
+    rates[resumed] = kHandshakes * 1000 / elapsed;
+  }
+
+  const char* kKeyTypeNames[] = {"RSA", "ECDSA"};
+  LOG(LS_INFO) << "DTLS handshakes per second, "
+               << kKeyTypeNames[::testing::get<0>(GetParam())] << " client, "
+               << kKeyTypeNames[::testing::get<1>(GetParam())]
+               << " server: full " << rates[0] << ", resumed " << rates[1];
+};
+
 // Test that we can make a handshake work if the first packet in
 // each direction is lost. This gives us predictable loss
 // rather than having to tune random
@@ -878,6 +1080,68 @@ TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSrtpMixed) {
   ASSERT_EQ(client_cipher, kAES_CM_HMAC_SHA1_80);
 };
 
+// Test DTLS-SRTP with the AEAD ciphers, preferred over AES-CM when both
+// sides offer them.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSrtpGcm) {
+  MAYBE_SKIP_TEST(HaveDtlsSrtp);
+  std::vector<std::string> ciphers;
+  ciphers.push_back(kAEAD_AES_256_GCM);
+  ciphers.push_back(kAEAD_AES_128_GCM);
+  ciphers.push_back(kAES_CM_HMAC_SHA1_80);
+  SetDtlsSrtpCiphers(ciphers, true);
+  SetDtlsSrtpCiphers(ciphers, false);
+  TestHandshake();
+
+  std::string client_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(true, &client_cipher));
+  std::string server_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(false, &server_cipher));
+
+  ASSERT_EQ(client_cipher, server_cipher);
+  ASSERT_EQ(client_cipher, kAEAD_AES_256_GCM);
+};
+
+// Test DTLS-SRTP falls back to AES-CM when only one side offers GCM.
+TEST_P(SSLStreamAdapterTestDTLS, TestDTLSSrtpGcmFallback) {
+  MAYBE_SKIP_TEST(HaveDtlsSrtp);
+  std::vector<std::string> gcm;
+  gcm.push_back(kAEAD_AES_128_GCM);
+  gcm.push_back(kAES_CM_HMAC_SHA1_80);
+  std::vector<std::string> cm;
+  cm.push_back(kAES_CM_HMAC_SHA1_80);
+  SetDtlsSrtpCiphers(gcm, true);
+  SetDtlsSrtpCiphers(cm, false);
+  TestHandshake();
+
+  std::string client_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(true, &client_cipher));
+  std::string server_cipher;
+  ASSERT_TRUE(GetDtlsSrtpCipher(false, &server_cipher));
+
+  ASSERT_EQ(client_cipher, server_cipher);
+  ASSERT_EQ(client_cipher, kAES_CM_HMAC_SHA1_80);
+};
+
+TEST(SSLStreamAdapterTest, TestSrtpKeyAndSaltLengths) {
+  int key_len;
+  int salt_len;
+  ASSERT_TRUE(rtc::GetSrtpKeyAndSaltLengths(kAES_CM_HMAC_SHA1_80, &key_len,
+                                            &salt_len));
+  EXPECT_EQ(16, key_len);
+  EXPECT_EQ(14, salt_len);
+  ASSERT_TRUE(rtc::GetSrtpKeyAndSaltLengths(kAEAD_AES_128_GCM, &key_len,
+                                            &salt_len));
+  EXPECT_EQ(16, key_len);
+  EXPECT_EQ(12, salt_len);
+  ASSERT_TRUE(rtc::GetSrtpKeyAndSaltLengths(kAEAD_AES_256_GCM, &key_len,
+                                            &salt_len));
+  EXPECT_EQ(32, key_len);
+  EXPECT_EQ(12, salt_len);
+  EXPECT_FALSE(rtc::GetSrtpKeyAndSaltLengths("bogus", &key_len, &salt_len));
+  EXPECT_EQ(rtc::SRTP_AEAD_AES_256_GCM,
+            rtc::GetSrtpCryptoSuiteFromName(kAEAD_AES_256_GCM));
+}
+
 // Test an exporter
 TEST_P(SSLStreamAdapterTestDTLS, TestDTLSExporter) {
   MAYBE_SKIP_TEST(HaveExporter);
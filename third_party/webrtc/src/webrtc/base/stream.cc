@@ -717,7 +717,9 @@ bool FifoBuffer::SetCapacity(size_t size) {
 
   if (size != buffer_length_) {
     char* buffer = new char[size];
-    const size_t copy = data_length_;
+    // When growing, also keep what was written ahead with WriteOffset() but
+    // not yet consumed.
+    const size_t copy = (size > buffer_length_) ? buffer_length_ : data_length_;
     const size_t tail_copy = std::min(copy, buffer_length_ - read_position_);
     memcpy(buffer, &buffer_[read_position_], tail_copy);
     memcpy(buffer + tail_copy, &buffer_[0], copy - tail_copy);
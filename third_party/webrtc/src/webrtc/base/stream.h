@@ -504,7 +504,9 @@ class FifoBuffer : public StreamInterface {
   ~FifoBuffer() override;
   // Gets the amount of data currently readable from the buffer.
   bool GetBuffered(size_t* data_len) const;
-  // Resizes the buffer to the specified capacity. Fails if data_length_ > size
+  // Resizes the buffer to the specified capacity. Fails if data_length_ > size.
+  // Growing the buffer preserves data written with WriteOffset() beyond the
+  // buffered data.
   bool SetCapacity(size_t length);
 
   // Read into |buffer| with an offset from the current read position, offset
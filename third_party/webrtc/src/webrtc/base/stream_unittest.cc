@@ -372,4 +372,27 @@ TEST(FifoBufferTest, WriteOffsetAndReadOffset) {
   EXPECT_EQ(SR_BLOCK, buf.ReadOffset(out, 10, 16, NULL));
 }
 
+TEST(FifoBufferTest, SetCapacityKeepsDataWrittenAhead) {
+  const size_t kSize = 16;
+  const char in[kSize + 1] = "0123456789ABCDEF";
+  char out[kSize];
+  FifoBuffer buf(kSize);
+
+  // Wrap the read position, then write 4 bytes ahead of the 6 buffered ones.
+  EXPECT_EQ(SR_SUCCESS, buf.Write(in, 12, NULL, NULL));
+  buf.ConsumeReadData(8);
+  EXPECT_EQ(SR_SUCCESS, buf.Write(in, 2, NULL, NULL));
+  EXPECT_EQ(SR_SUCCESS, buf.WriteOffset(in + 8, 4, 4, NULL));
+
+  EXPECT_TRUE(buf.SetCapacity(kSize * 2));
+  buf.ConsumeWriteBuffer(8);
+
+  size_t read;
+  EXPECT_EQ(SR_SUCCESS, buf.Read(out, kSize, &read, NULL));
+  EXPECT_EQ(14u, read);
+  EXPECT_EQ(0, memcmp(out, in + 8, 4));
+  EXPECT_EQ(0, memcmp(out + 4, in, 2));
+  EXPECT_EQ(0, memcmp(out + 10, in + 8, 4));
+}
+
 }  // namespace rtc
@@ -403,7 +403,12 @@ void Thread::Send(MessageHandler *phandler, uint32 id, MessageData *pdata) {
 
   AssertBlockingIsAllowedOnCurrentThread();
 
-  AutoThread thread;
+  // Wrap the calling thread only if it isn't known yet. An AutoThread comes
+  // with its own socket server, far too much to set up for every call.
+  scoped_ptr<AutoThread> auto_thread;
+  if (!Thread::Current()) {
+    auto_thread.reset(new AutoThread());
+  }
   Thread *current_thread = Thread::Current();
   ASSERT(current_thread != NULL);  // AutoThread ensures this
 
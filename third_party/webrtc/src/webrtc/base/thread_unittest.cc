@@ -8,13 +8,17 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <vector>
+
 #include "webrtc/base/asyncinvoker.h"
 #include "webrtc/base/asyncudpsocket.h"
 #include "webrtc/base/event.h"
 #include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
 #include "webrtc/base/physicalsocketserver.h"
 #include "webrtc/base/socketaddress.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/test/testsupport/gtest_disable.h"
 
 #if defined(WEBRTC_WIN)
@@ -373,6 +377,104 @@ TEST(ThreadTest, ThreeThreadsInvoke) {
   EXPECT_TRUE_WAIT(thread_a_called.Get(), 2000);
 }
 
+// Keeps count of how many copies of it are alive.
+class LiveCounter {
+ public:
+  explicit LiveCounter(int* count) : count_(count) { ++*count_; }
+  LiveCounter(const LiveCounter& other) : count_(other.count_) { ++*count_; }
+  ~LiveCounter() { --*count_; }
+
+ private:
+  int* count_;
+};
+
+TEST(ThreadTest, PostTask) {
+  Thread thread;
+  thread.Start();
+  std::vector<int> order;
+  for (int i = 0; i < 10; ++i) {
+    thread.PostTask([&order, i]() { order.push_back(i); });
+  }
+  // Too large to be stored inline.
+  char large[QueuedTask::kInlineSize * 2] = { 10 };
+  thread.PostTask([&order, large]() { order.push_back(large[0]); });
+  Event done(false, false);
+  thread.PostTask([&done]() { done.Set(); });
+  EXPECT_TRUE(done.Wait(1000));
+  ASSERT_EQ(11U, order.size());
+  for (int i = 0; i < 11; ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+TEST(ThreadTest, PostTaskReleasesCaptures) {
+  int alive = 0;
+  Thread thread;
+  {
+    LiveCounter counter(&alive);
+    thread.PostTask([counter]() {});
+    char large[QueuedTask::kInlineSize * 2] = { 0 };
+    thread.PostTask([counter, large]() {});
+    thread.PostDelayedTask(10000, [counter]() {});
+  }
+  EXPECT_EQ(3, alive);
+  // Tasks that never ran are destroyed with the queue's messages.
+  thread.Clear(NULL);
+  EXPECT_EQ(0, alive);
+
+  thread.Start();
+  {
+    LiveCounter counter(&alive);
+    thread.PostTask([counter]() {});
+  }
+  Event done(false, false);
+  thread.PostTask([&done]() { done.Set(); });
+  EXPECT_TRUE(done.Wait(1000));
+  // The previous task was destroyed right after it ran.
+  EXPECT_EQ(0, alive);
+}
+
+// Compares posting small lambdas with PostTask() to AsyncInvoker, which
+// allocates a closure and message data per call, and measures the Invoke()
+// round trip.
+TEST(ThreadTest, PostTaskPerf) {
+  const int kTasks = 200000;
+  const int kInvokes = 20000;
+  Thread thread;
+  thread.Start();
+  int count = 0;
+  Event done(false, false);
+
+  AsyncInvoker invoker;
+  uint64 start = TimeNanos();
+  for (int i = 0; i < kTasks; ++i) {
+    invoker.AsyncInvoke<void>(&thread, [&count]() { ++count; });
+  }
+  invoker.AsyncInvoke<void>(&thread, [&done]() { done.Set(); });
+  EXPECT_TRUE(done.Wait(10000));
+  uint64 invoker_ns = TimeNanos() - start;
+
+  start = TimeNanos();
+  for (int i = 0; i < kTasks; ++i) {
+    thread.PostTask([&count]() { ++count; });
+  }
+  thread.PostTask([&done]() { done.Set(); });
+  EXPECT_TRUE(done.Wait(10000));
+  uint64 task_ns = TimeNanos() - start;
+  EXPECT_EQ(2 * kTasks, count);
+
+  start = TimeNanos();
+  for (int i = 0; i < kInvokes; ++i) {
+    thread.Invoke<void>([&count]() { ++count; });
+  }
+  uint64 invoke_ns = TimeNanos() - start;
+
+  LOG(LS_INFO) << "AsyncInvoker: " << kTasks * 1e9 / invoker_ns
+               << " tasks/s, PostTask: " << kTasks * 1e9 / task_ns
+               << " tasks/s, Invoke: " << invoke_ns / 1e3 / kInvokes
+               << " us per call";
+}
+
 class AsyncInvokeTest : public testing::Test {
  public:
   void IntCallback(int value) {
@@ -0,0 +1,248 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/base/timerwheel.h"
+
+#include <algorithm>
+
+#include "webrtc/base/common.h"
+#include "webrtc/base/messagequeue.h"
+#include "webrtc/base/timeutils.h"
+
+namespace rtc {
+
+TimerWheel::Timer::Timer(MessageHandler* handler, uint32 id)
+    : handler_(handler), id_(id), wheel_(NULL), expiry_(0),
+      prev_(NULL), next_(NULL) {
+}
+
+TimerWheel::Timer::Timer()
+    : handler_(NULL), id_(0), wheel_(NULL), expiry_(0),
+      prev_(this), next_(this) {
+}
+
+TimerWheel::Timer::~Timer() {
+  Cancel();
+}
+
+void TimerWheel::Timer::Cancel() {
+  if (wheel_) {
+    wheel_->Cancel(this);
+  }
+}
+
+void TimerWheel::Timer::Unlink() {
+  prev_->next_ = next_;
+  next_->prev_ = prev_;
+  prev_ = next_ = NULL;
+  wheel_ = NULL;
+}
+
+TimerWheel::TimerWheel(MessageQueue* queue, int tick_ms)
+    : queue_(queue),
+      tick_ms_(tick_ms),
+      last_time_(Time()),
+      elapsed_ms_(0),
+      tick_(0),
+      size_(0),
+      dispatching_(false) {
+  ASSERT(tick_ms_ > 0);
+}
+
+TimerWheel::~TimerWheel() {
+  // Leave the remaining timers unscheduled, so that they don't refer back to
+  // the wheel when they are destroyed.
+  for (int i = 0; i < kLevel0Size; ++i) {
+    while (level0_[i].next_ != &level0_[i]) {
+      level0_[i].next_->Unlink();
+    }
+  }
+  for (int level = 0; level < kNumLevels - 1; ++level) {
+    for (int i = 0; i < kLevelNSize; ++i) {
+      while (levels_[level][i].next_ != &levels_[level][i]) {
+        levels_[level][i].next_->Unlink();
+      }
+    }
+  }
+  while (expired_.next_ != &expired_) {
+    expired_.next_->Unlink();
+  }
+}
+
+void TimerWheel::Schedule(Timer* timer, int delay_ms) {
+  ASSERT(timer->handler_ != NULL);
+  timer->Cancel();
+  if (delay_ms < 0) {
+    delay_ms = 0;
+  }
+
+  uint64 now = Now();
+  if (size_ == 0 && tick_ <= now / tick_ms_) {
+    // Nothing can be due, skip the ticks that passed while the wheel was idle.
+    tick_ = now / tick_ms_ + 1;
+  }
+  uint64 expiry = (now + delay_ms + tick_ms_ - 1) / tick_ms_;
+  timer->wheel_ = this;
+  timer->expiry_ = std::max(expiry, tick_);
+  Insert(timer);
+  ++size_;
+
+  // Timers scheduled while dispatching are picked up once it is done.
+  if (!dispatching_ &&
+      (wakeups_.empty() || timer->expiry_ < *wakeups_.begin())) {
+    ScheduleWakeup();
+  }
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  ASSERT(timer->wheel_ == this);
+  timer->Unlink();
+  --size_;
+}
+
+void TimerWheel::OnMessage(Message* msg) {
+  // Wakeups are delivered in order, so this is the earliest one.
+  if (!wakeups_.empty()) {
+    wakeups_.erase(wakeups_.begin());
+  }
+  Advance();
+  while (!wakeups_.empty() && *wakeups_.begin() < tick_) {
+    wakeups_.erase(wakeups_.begin());
+  }
+  ScheduleWakeup();
+}
+
+TimerWheel::Slot* TimerWheel::FindSlot(uint64 expiry) {
+  ASSERT(expiry >= tick_);
+  uint64 delta = expiry - tick_;
+  if (delta < kLevel0Size) {
+    return &level0_[expiry & (kLevel0Size - 1)];
+  }
+  int shift = kLevel0Bits;
+  for (int level = 0; level < kNumLevels - 2; ++level) {
+    if (delta < (static_cast<uint64>(1) << (shift + kLevelNBits))) {
+      return &levels_[level][(expiry >> shift) & (kLevelNSize - 1)];
+    }
+    shift += kLevelNBits;
+  }
+  return &levels_[kNumLevels - 2][(expiry >> shift) & (kLevelNSize - 1)];
+}
+
+void TimerWheel::Insert(Timer* timer) {
+  // Timers beyond the range of the wheel wait in its last slot and are
+  // placed again as it comes around.
+  const uint64 kMaxDelta =
+      (static_cast<uint64>(1) << (kLevel0Bits + (kNumLevels - 1) *
+                                  kLevelNBits)) - 1;
+  uint64 expiry = std::min(timer->expiry_, tick_ + kMaxDelta);
+  Slot* slot = FindSlot(expiry);
+  timer->prev_ = slot->prev_;
+  timer->next_ = slot;
+  slot->prev_->next_ = timer;
+  slot->prev_ = timer;
+}
+
+void TimerWheel::Cascade(int level, int index) {
+  Slot* slot = &levels_[level][index];
+  while (slot->next_ != slot) {
+    Timer* timer = slot->next_;
+    slot->next_ = timer->next_;
+    timer->next_->prev_ = slot;
+    Insert(timer);
+  }
+}
+
+uint64 TimerWheel::Now() {
+  uint32 now = Time();
+  int32 diff = TimeDiff(now, last_time_);
+  if (diff > 0) {
+    elapsed_ms_ += diff;
+  }
+  last_time_ = now;
+  return elapsed_ms_;
+}
+
+void TimerWheel::Advance() {
+  uint64 now_tick = Now() / tick_ms_;
+  dispatching_ = true;
+  while (tick_ <= now_tick && size_ > 0) {
+    int index = static_cast<int>(tick_ & (kLevel0Size - 1));
+    if (index == 0) {
+      // Level 0 wrapped around, bring in the timers for its next rotation.
+      int shift = kLevel0Bits;
+      for (int level = 0; level < kNumLevels - 1; ++level) {
+        int level_index =
+            static_cast<int>((tick_ >> shift) & (kLevelNSize - 1));
+        Cascade(level, level_index);
+        if (level_index != 0) {
+          break;
+        }
+        shift += kLevelNBits;
+      }
+    }
+
+    Slot* slot = &level0_[index];
+    ++tick_;
+    if (slot->next_ == slot) {
+      continue;
+    }
+    expired_.next_ = slot->next_;
+    expired_.prev_ = slot->prev_;
+    expired_.next_->prev_ = &expired_;
+    expired_.prev_->next_ = &expired_;
+    slot->next_ = slot->prev_ = slot;
+
+    // Handlers may schedule or cancel any timer, including the expired ones
+    // that haven't been dispatched yet.
+    while (expired_.next_ != &expired_) {
+      Timer* timer = expired_.next_;
+      Cancel(timer);
+      Message msg;
+      msg.phandler = timer->handler_;
+      msg.message_id = timer->id_;
+      msg.phandler->OnMessage(&msg);
+    }
+  }
+  if (size_ == 0) {
+    tick_ = std::max(tick_, now_tick + 1);
+  }
+  dispatching_ = false;
+}
+
+uint64 TimerWheel::NextWakeupTick() {
+  // Level 0 only holds timers for the current rotation, so either one of
+  // them is next, or the cascade at the start of the next rotation.
+  for (uint64 tick = tick_; ; ++tick) {
+    Slot* slot = &level0_[tick & (kLevel0Size - 1)];
+    if (slot->next_ != slot) {
+      return tick;
+    }
+    if (((tick + 1) & (kLevel0Size - 1)) == 0) {
+      return tick + 1;
+    }
+  }
+}
+
+void TimerWheel::ScheduleWakeup() {
+  if (size_ == 0) {
+    return;
+  }
+  uint64 tick = NextWakeupTick();
+  if (!wakeups_.empty() && *wakeups_.begin() <= tick) {
+    return;
+  }
+  uint64 now = Now();
+  uint64 when = tick * tick_ms_;
+  int delay = (when > now) ? static_cast<int>(when - now) : 0;
+  wakeups_.insert(tick);
+  queue_->PostDelayed(delay, this);
+}
+
+}  // namespace rtc
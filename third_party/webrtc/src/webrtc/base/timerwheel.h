@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_BASE_TIMERWHEEL_H_
+#define WEBRTC_BASE_TIMERWHEEL_H_
+
+#include <set>
+
+#include "webrtc/base/basictypes.h"
+#include "webrtc/base/constructormagic.h"
+#include "webrtc/base/messagehandler.h"
+
+namespace rtc {
+
+class MessageQueue;
+
+// A hierarchical timer wheel for large numbers of short, frequently
+// rescheduled timers, such as ICE connectivity checks and STUN retransmits.
+// Scheduling and cancelling a timer is O(1), and all timers that expire in
+// the same tick are dispatched in one pass from a single delayed message on
+// the owning queue, instead of one entry per timer in the queue's delayed
+// message heap. Expiry is rounded up to the tick, so timers never fire early
+// but may fire up to one tick late.
+//
+// A TimerWheel, and all timers scheduled on it, must only be used from the
+// thread that processes its MessageQueue. Use MessageQueue::timer_wheel() to
+// get the wheel shared by everything running on a thread.
+class TimerWheel : public MessageHandler {
+ public:
+  // A timer that, when it expires, calls |handler|->OnMessage() with a
+  // message with id |id| and no data. The timer is not owned by the wheel
+  // and is cancelled when destroyed.
+  class Timer {
+   public:
+    Timer(MessageHandler* handler, uint32 id);
+    ~Timer();
+
+    bool IsScheduled() const { return wheel_ != NULL; }
+    void Cancel();
+
+   private:
+    friend class TimerWheel;
+
+    // Constructs an empty list head for the wheel's slots.
+    Timer();
+    void Unlink();
+
+    MessageHandler* handler_;
+    uint32 id_;
+    TimerWheel* wheel_;
+    uint64 expiry_;
+    Timer* prev_;
+    Timer* next_;
+
+    RTC_DISALLOW_COPY_AND_ASSIGN(Timer);
+  };
+
+  static const int kDefaultTickMs = 10;
+
+  explicit TimerWheel(MessageQueue* queue, int tick_ms = kDefaultTickMs);
+  ~TimerWheel() override;
+
+  int tick_ms() const { return tick_ms_; }
+  // Number of timers currently scheduled.
+  size_t size() const { return size_; }
+
+  // Schedules |timer| to fire after at least |delay_ms| milliseconds. A timer
+  // that is already scheduled, on this or another wheel, is moved.
+  void Schedule(Timer* timer, int delay_ms);
+  void Cancel(Timer* timer);
+
+  void OnMessage(Message* msg) override;
+
+ private:
+  // Level 0 has one slot per tick, every other level one slot per full
+  // rotation of the level below it.
+  static const int kLevel0Bits = 8;
+  static const int kLevelNBits = 6;
+  static const int kNumLevels = 4;
+  static const int kLevel0Size = 1 << kLevel0Bits;
+  static const int kLevelNSize = 1 << kLevelNBits;
+
+  // Each slot is the head of a circular list of timers.
+  typedef Timer Slot;
+
+  Slot* FindSlot(uint64 expiry);
+  void Insert(Timer* timer);
+  void Cascade(int level, int index);
+  // Milliseconds since the wheel was created.
+  uint64 Now();
+  // Expires every tick up to the current time.
+  void Advance();
+  // Returns the next tick the wheel needs to be serviced at.
+  uint64 NextWakeupTick();
+  void ScheduleWakeup();
+
+  MessageQueue* queue_;
+  const int tick_ms_;
+  uint32 last_time_;
+  uint64 elapsed_ms_;
+  // The next tick to be expired.
+  uint64 tick_;
+  size_t size_;
+  Slot level0_[kLevel0Size];
+  Slot levels_[kNumLevels - 1][kLevelNSize];
+  // Timers being dispatched by Advance().
+  Slot expired_;
+  bool dispatching_;
+  // Ticks for which a wakeup message has been posted.
+  std::set<uint64> wakeups_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace rtc
+
+#endif  // WEBRTC_BASE_TIMERWHEEL_H_
@@ -0,0 +1,258 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+
+#include "webrtc/base/gunit.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timerwheel.h"
+#include "webrtc/base/timeutils.h"
+
+using rtc::Message;
+using rtc::MessageHandler;
+using rtc::Thread;
+using rtc::TimerWheel;
+
+namespace {
+
+const int kTimeoutMs = 5000;
+
+class TimerTarget : public MessageHandler {
+ public:
+  TimerTarget() : count_(0), last_id_(0), fired_at_(0) {}
+
+  void OnMessage(Message* msg) override {
+    ++count_;
+    last_id_ = msg->message_id;
+    fired_at_ = rtc::Time();
+    order_.push_back(msg->message_id);
+  }
+
+  int count_;
+  uint32 last_id_;
+  uint32 fired_at_;
+  std::vector<uint32> order_;
+};
+
+// Cancels another timer when it fires.
+class Canceller : public MessageHandler {
+ public:
+  explicit Canceller(TimerWheel::Timer* victim) : victim_(victim) {}
+  void OnMessage(Message* msg) override { victim_->Cancel(); }
+
+ private:
+  TimerWheel::Timer* victim_;
+};
+
+// Reschedules its own timer a number of times.
+class Repeater : public MessageHandler {
+ public:
+  Repeater(TimerWheel* wheel, int times)
+      : wheel_(wheel), timer_(this, 0), remaining_(times) {}
+  void Start() { wheel_->Schedule(&timer_, 0); }
+  void OnMessage(Message* msg) override {
+    if (--remaining_ > 0) {
+      wheel_->Schedule(&timer_, 5);
+    }
+  }
+  int remaining() const { return remaining_; }
+
+ private:
+  TimerWheel* wheel_;
+  TimerWheel::Timer timer_;
+  int remaining_;
+};
+
+}  // namespace
+
+TEST(TimerWheelTest, TestFireAfterDelay) {
+  TimerWheel wheel(Thread::Current(), 5);
+  TimerTarget target;
+  TimerWheel::Timer timer1(&target, 1);
+  TimerWheel::Timer timer2(&target, 2);
+  TimerWheel::Timer timer3(&target, 3);
+
+  uint32 start = rtc::Time();
+  wheel.Schedule(&timer2, 50);
+  wheel.Schedule(&timer1, 20);
+  wheel.Schedule(&timer3, 50);
+  EXPECT_EQ(3U, wheel.size());
+  EXPECT_TRUE(timer1.IsScheduled());
+
+  EXPECT_EQ_WAIT(1, target.count_, kTimeoutMs);
+  EXPECT_EQ(1U, target.last_id_);
+  EXPECT_GE(rtc::TimeDiff(target.fired_at_, start), 20);
+  EXPECT_FALSE(timer1.IsScheduled());
+
+  EXPECT_EQ_WAIT(3, target.count_, kTimeoutMs);
+  EXPECT_GE(rtc::TimeDiff(target.fired_at_, start), 50);
+  // Timers due in the same tick fire in the order they were scheduled.
+  ASSERT_EQ(3U, target.order_.size());
+  EXPECT_EQ(2U, target.order_[1]);
+  EXPECT_EQ(3U, target.order_[2]);
+  EXPECT_EQ(0U, wheel.size());
+}
+
+TEST(TimerWheelTest, TestCancelAndReschedule) {
+  TimerWheel wheel(Thread::Current(), 5);
+  TimerTarget target;
+  TimerWheel::Timer timer1(&target, 1);
+  TimerWheel::Timer timer2(&target, 2);
+
+  wheel.Schedule(&timer1, 10);
+  wheel.Schedule(&timer2, 10);
+  timer1.Cancel();
+  EXPECT_FALSE(timer1.IsScheduled());
+  EXPECT_EQ(1U, wheel.size());
+
+  // Rescheduling replaces the pending expiry.
+  uint32 start = rtc::Time();
+  wheel.Schedule(&timer2, 100);
+  EXPECT_EQ(1U, wheel.size());
+  EXPECT_EQ_WAIT(1, target.count_, kTimeoutMs);
+  EXPECT_EQ(2U, target.last_id_);
+  EXPECT_GE(rtc::TimeDiff(target.fired_at_, start), 100);
+
+  Thread::Current()->ProcessMessages(50);
+  EXPECT_EQ(1, target.count_);
+}
+
+// Timers beyond the first level of the wheel are cascaded down and still
+// fire on time.
+TEST(TimerWheelTest, TestCascade) {
+  TimerWheel wheel(Thread::Current(), 1);
+  TimerTarget target;
+  TimerWheel::Timer timer1(&target, 1);
+  TimerWheel::Timer timer2(&target, 2);
+  TimerWheel::Timer timer3(&target, 3);
+
+  uint32 start = rtc::Time();
+  wheel.Schedule(&timer2, 700);
+  wheel.Schedule(&timer1, 300);
+  wheel.Schedule(&timer3, 10);
+  EXPECT_EQ_WAIT(1, target.count_, kTimeoutMs);
+  EXPECT_EQ(3U, target.last_id_);
+  EXPECT_EQ_WAIT(2, target.count_, kTimeoutMs);
+  EXPECT_EQ(1U, target.last_id_);
+  EXPECT_GE(rtc::TimeDiff(target.fired_at_, start), 300);
+  EXPECT_EQ_WAIT(3, target.count_, kTimeoutMs);
+  EXPECT_EQ(2U, target.last_id_);
+  EXPECT_GE(rtc::TimeDiff(target.fired_at_, start), 700);
+}
+
+// A handler may cancel a timer that expired in the same tick but hasn't been
+// dispatched yet.
+TEST(TimerWheelTest, TestCancelFromHandler) {
+  TimerWheel wheel(Thread::Current(), 5);
+  TimerTarget target;
+  TimerWheel::Timer victim(&target, 1);
+  Canceller canceller(&victim);
+  TimerWheel::Timer timer(&canceller, 0);
+  TimerWheel::Timer last(&target, 2);
+
+  wheel.Schedule(&timer, 10);
+  wheel.Schedule(&victim, 10);
+  wheel.Schedule(&last, 10);
+  EXPECT_EQ_WAIT(1, target.count_, kTimeoutMs);
+  EXPECT_EQ(2U, target.last_id_);
+  EXPECT_EQ(0U, wheel.size());
+}
+
+TEST(TimerWheelTest, TestRescheduleFromHandler) {
+  TimerWheel wheel(Thread::Current(), 1);
+  Repeater repeater(&wheel, 10);
+  repeater.Start();
+  EXPECT_EQ_WAIT(0, repeater.remaining(), kTimeoutMs);
+  EXPECT_EQ(0U, wheel.size());
+}
+
+TEST(TimerWheelTest, TestDestroyTimerOrWheel) {
+  TimerTarget target;
+  rtc::scoped_ptr<TimerWheel> wheel(new TimerWheel(Thread::Current(), 5));
+  rtc::scoped_ptr<TimerWheel::Timer> timer1(
+      new TimerWheel::Timer(&target, 1));
+  TimerWheel::Timer timer2(&target, 2);
+  wheel->Schedule(timer1.get(), 10);
+  wheel->Schedule(&timer2, 10);
+
+  timer1.reset();
+  EXPECT_EQ(1U, wheel->size());
+  wheel.reset();
+  EXPECT_FALSE(timer2.IsScheduled());
+  Thread::Current()->ProcessMessages(50);
+  EXPECT_EQ(0, target.count_);
+}
+
+TEST(TimerWheelTest, TestSharedWheel) {
+  TimerWheel* wheel = Thread::Current()->timer_wheel();
+  ASSERT_TRUE(wheel != NULL);
+  EXPECT_EQ(wheel, Thread::Current()->timer_wheel());
+
+  TimerTarget target;
+  TimerWheel::Timer timer(&target, 1);
+  wheel->Schedule(&timer, 10);
+  EXPECT_EQ_WAIT(1, target.count_, kTimeoutMs);
+}
+
+// Compares many handlers keeping a retransmit timer each, the way STUN
+// requests and ICE channels do, on the wheel and in the message queue.
+TEST(TimerWheelTest, SchedulePerf) {
+  const int kNumTimers = 5000;
+  const int kRounds = 2;
+  Thread* thread = Thread::Current();
+
+  std::vector<TimerTarget> targets(kNumTimers);
+  uint32 start = rtc::Time();
+  for (int round = 0; round < kRounds; ++round) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      thread->PostDelayed(1000 + i % 500, &targets[i]);
+    }
+    // Every request is answered and cancels its retransmit.
+    for (int i = 0; i < kNumTimers; ++i) {
+      thread->Clear(&targets[i]);
+    }
+  }
+  int queue_ms = rtc::TimeSince(start);
+
+  TimerWheel wheel(thread);
+  std::vector<TimerWheel::Timer*> timers;
+  for (int i = 0; i < kNumTimers; ++i) {
+    timers.push_back(new TimerWheel::Timer(&targets[i], 0));
+  }
+  start = rtc::Time();
+  for (int round = 0; round < kRounds; ++round) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      wheel.Schedule(timers[i], 1000 + i % 500);
+    }
+    for (int i = 0; i < kNumTimers; ++i) {
+      timers[i]->Cancel();
+    }
+  }
+  int wheel_ms = rtc::TimeSince(start);
+
+  // Fire them all in one batch.
+  for (int i = 0; i < kNumTimers; ++i) {
+    wheel.Schedule(timers[i], 10);
+  }
+  start = rtc::Time();
+  EXPECT_TRUE_WAIT(wheel.size() == 0U, kTimeoutMs);
+  int fire_ms = rtc::TimeSince(start);
+  for (int i = 0; i < kNumTimers; ++i) {
+    EXPECT_EQ(1, targets[i].count_);
+    delete timers[i];
+  }
+
+  LOG(LS_INFO) << kRounds << "x" << kNumTimers << " schedule/cancel: "
+               << "message queue " << queue_ms << " ms, timer wheel "
+               << wheel_ms << " ms; " << kNumTimers << " timers fired in "
+               << fire_ms << " ms";
+}
@@ -15,13 +15,14 @@
 #include <iostream>
 
 #include "webrtc/p2p/base/stunserver.h"
+#include "webrtc/base/stringencode.h"
 #include "webrtc/base/thread.h"
 
 using namespace cricket;
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "usage: stunserver address" << std::endl;
+  if (argc != 2 && argc != 3) {
+    std::cerr << "usage: stunserver address [threads]" << std::endl;
     return 1;
   }
 
@@ -31,8 +32,28 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  int num_threads = 1;
+  if (argc == 3 && (!rtc::FromString(argv[2], &num_threads) ||
+                    num_threads < 1)) {
+    std::cerr << "Invalid number of threads: " << argv[2] << std::endl;
+    return 1;
+  }
+
   rtc::Thread *pthMain = rtc::Thread::Current();
 
+  if (num_threads > 1) {
+    ShardedStunServer server(num_threads);
+    if (server.Listen(server_addr).IsNil()) {
+      std::cerr << "Failed to create a UDP socket" << std::endl;
+      return 1;
+    }
+
+    std::cout << "Listening at " << server_addr.ToString() << " on "
+              << num_threads << " threads" << std::endl;
+    pthMain->Run();
+    return 0;
+  }
+
   rtc::AsyncUDPSocket* server_socket =
       rtc::AsyncUDPSocket::Create(pthMain->socketserver(), server_addr);
   if (!server_socket) {
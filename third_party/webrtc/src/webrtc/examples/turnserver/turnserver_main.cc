@@ -42,8 +42,8 @@ class TurnFileAuth : public cricket::TurnAuthInterface {
 };
 
 int main(int argc, char **argv) {
-  if (argc != 5) {
-    std::cerr << "usage: turnserver int-addr ext-ip realm auth-file"
+  if (argc != 5 && argc != 6) {
+    std::cerr << "usage: turnserver int-addr ext-ip realm auth-file [threads]"
               << std::endl;
     return 1;
   }
@@ -60,7 +60,33 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  int num_threads = 1;
+  if (argc == 6 && (!rtc::FromString(argv[5], &num_threads) ||
+                    num_threads < 1)) {
+    std::cerr << "Invalid number of threads: " << argv[5] << std::endl;
+    return 1;
+  }
+
   rtc::Thread* main = rtc::Thread::Current();
+  TurnFileAuth auth(argv[4]);
+  if (num_threads > 1) {
+    cricket::ShardedTurnServer server(num_threads);
+    server.set_realm(argv[3]);
+    server.set_software(kSoftware);
+    server.set_auth_hook(&auth);
+    server.SetExternalAddress(rtc::SocketAddress(ext_addr, 0));
+    if (server.AddInternalSocket(int_addr, cricket::PROTO_UDP).IsNil()) {
+      std::cerr << "Failed to create a UDP socket bound at"
+                << int_addr.ToString() << std::endl;
+      return 1;
+    }
+
+    std::cout << "Listening internally at " << int_addr.ToString()
+              << " on " << num_threads << " threads" << std::endl;
+    main->Run();
+    return 0;
+  }
+
   rtc::AsyncUDPSocket* int_socket =
       rtc::AsyncUDPSocket::Create(main->socketserver(), int_addr);
   if (!int_socket) {
@@ -70,7 +96,6 @@ int main(int argc, char **argv) {
   }
 
   cricket::TurnServer server(main);
-  TurnFileAuth auth(argv[4]);
   server.set_realm(argv[3]);
   server.set_software(kSoftware);
   server.set_auth_hook(&auth);
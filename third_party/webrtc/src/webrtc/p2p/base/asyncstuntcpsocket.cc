@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "webrtc/p2p/base/stun.h"
+#include "webrtc/base/arraysize.h"
 #include "webrtc/base/common.h"
 #include "webrtc/base/logging.h"
 
@@ -55,10 +56,6 @@ int AsyncStunTCPSocket::Send(const void *pv, size_t cb,
     return -1;
   }
 
-  // If we are blocking on send, then silently drop this packet
-  if (!IsOutBufferEmpty())
-    return static_cast<int>(cb);
-
   int pad_bytes;
   size_t expected_pkt_len = GetExpectedLength(pv, cb, &pad_bytes);
 
@@ -66,16 +63,14 @@ int AsyncStunTCPSocket::Send(const void *pv, size_t cb,
   if (cb != expected_pkt_len)
     return -1;
 
-  AppendToOutBuffer(pv, cb);
-
   ASSERT(pad_bytes < 4);
   char padding[4] = {0};
-  AppendToOutBuffer(padding, pad_bytes);
-
-  int res = FlushOutBuffer();
+  rtc::Socket::IoBuffer pieces[] = {
+    rtc::Socket::IoBuffer(pv, cb),
+    rtc::Socket::IoBuffer(padding, pad_bytes),
+  };
+  int res = SendPacket(pieces, arraysize(pieces));
   if (res <= 0) {
-    // drop packet if we made no progress
-    ClearOutBuffer();
     return res;
   }
 
@@ -83,7 +78,7 @@ int AsyncStunTCPSocket::Send(const void *pv, size_t cb,
   return static_cast<int>(cb);
 }
 
-void AsyncStunTCPSocket::ProcessInput(char* data, size_t* len) {
+size_t AsyncStunTCPSocket::ProcessInput(const char* data, size_t len) {
   rtc::SocketAddress remote_addr(GetRemoteAddress());
   // STUN packet - First 4 bytes. Total header size is 20 bytes.
   // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -95,27 +90,23 @@ void AsyncStunTCPSocket::ProcessInput(char* data, size_t* len) {
   // |         Channel Number        |            Length             |
   // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 
-  while (true) {
-    // We need at least 4 bytes to read the STUN or ChannelData packet length.
-    if (*len < kPacketLenOffset + kPacketLenSize)
-      return;
-
+  size_t processed = 0;
+  // We need at least 4 bytes to read the STUN or ChannelData packet length.
+  while (len - processed >= kPacketLenOffset + kPacketLenSize) {
     int pad_bytes;
-    size_t expected_pkt_len = GetExpectedLength(data, *len, &pad_bytes);
+    size_t expected_pkt_len =
+        GetExpectedLength(data + processed, len - processed, &pad_bytes);
     size_t actual_length = expected_pkt_len + pad_bytes;
 
-    if (*len < actual_length) {
-      return;
+    if (len - processed < actual_length) {
+      break;
     }
 
-    SignalReadPacket(this, data, expected_pkt_len, remote_addr,
+    SignalReadPacket(this, data + processed, expected_pkt_len, remote_addr,
                      rtc::CreatePacketTime(0));
-
-    *len -= actual_length;
-    if (*len > 0) {
-      memmove(data, data + actual_length, *len);
-    }
+    processed += actual_length;
   }
+  return processed;
 }
 
 void AsyncStunTCPSocket::HandleIncomingConnection(
@@ -32,7 +32,7 @@ class AsyncStunTCPSocket : public rtc::AsyncTCPSocketBase {
 
   virtual int Send(const void* pv, size_t cb,
                    const rtc::PacketOptions& options);
-  virtual void ProcessInput(char* data, size_t* len);
+  virtual size_t ProcessInput(const char* data, size_t len);
   virtual void HandleIncomingConnection(rtc::AsyncSocket* socket);
 
  private:
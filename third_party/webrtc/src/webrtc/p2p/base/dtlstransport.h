@@ -35,7 +35,8 @@ class DtlsTransport : public Base {
       : Base(name, allocator),
         certificate_(certificate),
         secure_role_(rtc::SSL_CLIENT),
-        ssl_max_version_(rtc::SSL_PROTOCOL_DTLS_10) {}
+        ssl_max_version_(rtc::SSL_PROTOCOL_DTLS_10),
+        session_resumption_enabled_(false) {}
 
   ~DtlsTransport() {
     Base::DestroyAllChannels();
@@ -59,6 +60,11 @@ class DtlsTransport : public Base {
     return true;
   }
 
+  bool SetDtlsSessionResumption(bool enabled) override {
+    session_resumption_enabled_ = enabled;
+    return true;
+  }
+
   bool ApplyLocalTransportDescription(TransportChannelImpl* channel,
                                       std::string* error_desc) override {
     rtc::SSLFingerprint* local_fp =
@@ -201,6 +207,7 @@ class DtlsTransport : public Base {
     DtlsTransportChannelWrapper* channel = new DtlsTransportChannelWrapper(
         this, Base::CreateTransportChannel(component));
     channel->SetSslMaxProtocolVersion(ssl_max_version_);
+    channel->SetSessionResumption(session_resumption_enabled_);
     return channel;
   }
 
@@ -242,6 +249,7 @@ class DtlsTransport : public Base {
   rtc::scoped_refptr<rtc::RTCCertificate> certificate_;
   rtc::SSLRole secure_role_;
   rtc::SSLProtocolVersion ssl_max_version_;
+  bool session_resumption_enabled_;
   rtc::scoped_ptr<rtc::SSLFingerprint> remote_fingerprint_;
 };
 
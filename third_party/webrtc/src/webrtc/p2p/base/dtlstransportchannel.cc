@@ -96,7 +96,8 @@ DtlsTransportChannelWrapper::DtlsTransportChannelWrapper(
       downward_(NULL),
       dtls_state_(STATE_NONE),
       ssl_role_(rtc::SSL_CLIENT),
-      ssl_max_version_(rtc::SSL_PROTOCOL_DTLS_10) {
+      ssl_max_version_(rtc::SSL_PROTOCOL_DTLS_10),
+      session_resumption_enabled_(false) {
   channel_->SignalWritableState.connect(this,
       &DtlsTransportChannelWrapper::OnWritableState);
   channel_->SignalReadPacket.connect(this,
@@ -168,6 +169,17 @@ bool DtlsTransportChannelWrapper::SetSslMaxProtocolVersion(
   return true;
 }
 
+bool DtlsTransportChannelWrapper::SetSessionResumption(bool enabled) {
+  if (dtls_state_ != STATE_NONE) {
+    LOG(LS_ERROR) << "Not changing session resumption "
+                  << "while DTLS is negotiating";
+    return false;
+  }
+
+  session_resumption_enabled_ = enabled;
+  return true;
+}
+
 bool DtlsTransportChannelWrapper::SetSslRole(rtc::SSLRole role) {
   if (dtls_state_ == STATE_OPEN) {
     if (ssl_role_ != role) {
@@ -260,6 +272,7 @@ bool DtlsTransportChannelWrapper::SetupDtls() {
   dtls_->SetMode(rtc::SSL_MODE_DTLS);
   dtls_->SetMaxProtocolVersion(ssl_max_version_);
   dtls_->SetServerRole(ssl_role_);
+  dtls_->set_session_resumption_enabled(session_resumption_enabled_);
   dtls_->SignalEvent.connect(this, &DtlsTransportChannelWrapper::OnDtlsEvent);
   if (!dtls_->SetPeerCertificateDigest(
           remote_fingerprint_algorithm_,
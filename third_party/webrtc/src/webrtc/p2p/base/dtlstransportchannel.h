@@ -129,6 +129,11 @@ class DtlsTransportChannelWrapper : public TransportChannelImpl {
 
   virtual bool SetSslMaxProtocolVersion(rtc::SSLProtocolVersion version);
 
+  // Lets a new connection between endpoints that keep their certificates,
+  // e.g. when a call is reestablished, skip the public key operations by
+  // resuming an earlier DTLS session. Off by default.
+  bool SetSessionResumption(bool enabled);
+
   // Set up the ciphers to use for DTLS-SRTP. If this method is not called
   // before DTLS starts, or |ciphers| is empty, SRTP keys won't be negotiated.
   // This method should be called before SetupDtls.
@@ -181,6 +186,9 @@ class DtlsTransportChannelWrapper : public TransportChannelImpl {
                                const std::string& ice_pwd) override {
     channel_->SetRemoteIceCredentials(ice_ufrag, ice_pwd);
   }
+  void SetIceMode(IceMode mode) override {
+    channel_->SetIceMode(mode);
+  }
   void SetRemoteIceMode(IceMode mode) override {
     channel_->SetRemoteIceMode(mode);
   }
@@ -231,6 +239,7 @@ class DtlsTransportChannelWrapper : public TransportChannelImpl {
   rtc::scoped_refptr<rtc::RTCCertificate> local_certificate_;
   rtc::SSLRole ssl_role_;
   rtc::SSLProtocolVersion ssl_max_version_;
+  bool session_resumption_enabled_;
   rtc::Buffer remote_fingerprint_value_;
   std::string remote_fingerprint_algorithm_;
 
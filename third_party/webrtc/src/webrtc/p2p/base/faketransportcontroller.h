@@ -52,6 +52,7 @@ class FakeTransportChannel : public TransportChannelImpl,
   ~FakeTransportChannel() { Reset(); }
 
   uint64 IceTiebreaker() const { return tiebreaker_; }
+  IceMode ice_mode() const { return ice_mode_; }
   IceMode remote_ice_mode() const { return remote_ice_mode_; }
   const std::string& ice_ufrag() const { return ice_ufrag_; }
   const std::string& ice_pwd() const { return ice_pwd_; }
@@ -96,6 +97,7 @@ class FakeTransportChannel : public TransportChannelImpl,
     remote_ice_pwd_ = ice_pwd;
   }
 
+  void SetIceMode(IceMode mode) override { ice_mode_ = mode; }
   void SetRemoteIceMode(IceMode mode) override { remote_ice_mode_ = mode; }
   bool SetRemoteFingerprint(const std::string& alg,
                             const uint8* digest,
@@ -202,11 +204,11 @@ class FakeTransportChannel : public TransportChannelImpl,
       return -1;
     }
 
-    PacketMessageData* packet = new PacketMessageData(data, len);
     if (async_) {
-      rtc::Thread::Current()->Post(this, 0, packet);
+      rtc::Thread::Current()->Post(this, 0, new PacketMessageData(data, len));
     } else {
-      rtc::Thread::Current()->Send(this, 0, packet);
+      // Delivered before returning, so the packet doesn't need to be copied.
+      dest_->SignalReadPacket(dest_, data, len, rtc::CreatePacketTime(0), 0);
     }
     return static_cast<int>(len);
   }
@@ -308,6 +310,11 @@ class FakeTransportChannel : public TransportChannelImpl,
     return ssl_max_version_;
   }
 
+  void set_dtls_session_resumption(bool enabled) {
+    dtls_session_resumption_ = enabled;
+  }
+  bool dtls_session_resumption() const { return dtls_session_resumption_; }
+
  private:
   enum State { STATE_INIT, STATE_CONNECTING, STATE_CONNECTED };
   Transport* transport_;
@@ -328,8 +335,10 @@ class FakeTransportChannel : public TransportChannelImpl,
   std::string ice_pwd_;
   std::string remote_ice_ufrag_;
   std::string remote_ice_pwd_;
+  IceMode ice_mode_ = ICEMODE_FULL;
   IceMode remote_ice_mode_ = ICEMODE_FULL;
   rtc::SSLProtocolVersion ssl_max_version_ = rtc::SSL_PROTOCOL_DTLS_10;
+  bool dtls_session_resumption_ = false;
   rtc::SSLFingerprint dtls_fingerprint_;
   rtc::SSLRole ssl_role_ = rtc::SSL_CLIENT;
   size_t connection_count_ = 0;
@@ -403,6 +412,14 @@ class FakeTransport : public Transport {
     return ssl_max_version_;
   }
 
+  bool SetDtlsSessionResumption(bool enabled) override {
+    dtls_session_resumption_ = enabled;
+    for (const auto& kv : channels_) {
+      kv.second->set_dtls_session_resumption(dtls_session_resumption_);
+    }
+    return true;
+  }
+
   using Transport::local_description;
   using Transport::remote_description;
 
@@ -414,6 +431,7 @@ class FakeTransport : public Transport {
     FakeTransportChannel* channel =
         new FakeTransportChannel(this, name(), component);
     channel->set_ssl_max_protocol_version(ssl_max_version_);
+    channel->set_dtls_session_resumption(dtls_session_resumption_);
     channel->SetAsync(async_);
     SetChannelDestination(component, channel);
     channels_[component] = channel;
@@ -451,6 +469,7 @@ class FakeTransport : public Transport {
   bool async_ = false;
   rtc::scoped_refptr<rtc::RTCCertificate> certificate_;
   rtc::SSLProtocolVersion ssl_max_version_ = rtc::SSL_PROTOCOL_DTLS_10;
+  bool dtls_session_resumption_ = false;
 };
 
 // Fake TransportController class, which can be passed into a BaseChannel object
@@ -123,47 +123,6 @@ int CompareConnectionStates(cricket::Connection* a, cricket::Connection* b) {
   return 0;
 }
 
-int CompareConnections(cricket::Connection* a, cricket::Connection* b) {
-  int state_cmp = CompareConnectionStates(a, b);
-  if (state_cmp != 0) {
-    return state_cmp;
-  }
-  // Compare the candidate information.
-  return CompareConnectionCandidates(a, b);
-}
-
-// Wraps the comparison connection into a less than operator that puts higher
-// priority writable connections first.
-class ConnectionCompare {
- public:
-  bool operator()(const cricket::Connection *ca,
-                  const cricket::Connection *cb) {
-    cricket::Connection* a = const_cast<cricket::Connection*>(ca);
-    cricket::Connection* b = const_cast<cricket::Connection*>(cb);
-
-    // Compare first on writability and static preferences.
-    int cmp = CompareConnections(a, b);
-    if (cmp > 0)
-      return true;
-    if (cmp < 0)
-      return false;
-
-    // Otherwise, sort based on latency estimate.
-    return a->rtt() < b->rtt();
-
-    // Should we bother checking for the last connection that last received
-    // data? It would help rendezvous on the connection that is also receiving
-    // packets.
-    //
-    // TODO: Yes we should definitely do this.  The TCP protocol gains
-    // efficiency by being used bidirectionally, as opposed to two separate
-    // unidirectional streams.  This test should probably occur before
-    // comparison of local prefs (assuming combined prefs are the same).  We
-    // need to be careful though, not to bounce back and forth with both sides
-    // trying to rendevous with the other.
-  }
-};
-
 // Determines whether we should switch between two connections, based first on
 // connection states, static preferences, and then (if those are equal) on
 // latency estimates.
@@ -200,6 +159,64 @@ bool ShouldSwitch(cricket::Connection* a_conn,
 
 namespace cricket {
 
+P2PTransportChannel::SortKey::SortKey()
+    : write_state(-1),
+      receiving(false),
+      connected(false),
+      priority(0),
+      generation(0),
+      rtt(0) {
+}
+
+P2PTransportChannel::SortKey::SortKey(Connection* conn)
+    : write_state(conn->write_state()),
+      receiving(conn->receiving()),
+      connected(conn->connected()),
+      priority(conn->priority()),
+      generation(conn->remote_candidate().generation() +
+                 conn->port()->generation()),
+      rtt(conn->rtt()) {
+}
+
+bool P2PTransportChannel::SortKey::operator==(const SortKey& other) const {
+  return write_state == other.write_state && receiving == other.receiving &&
+         connected == other.connected && priority == other.priority &&
+         generation == other.generation && rtt == other.rtt;
+}
+
+// Puts higher priority writable connections first. This must agree with
+// CompareConnectionStates() and CompareConnectionCandidates().
+bool P2PTransportChannel::SortKey::Precedes(const SortKey& other) const {
+  // Compare first on writability and static preferences.
+  if (write_state != other.write_state)
+    return write_state < other.write_state;
+  if (receiving != other.receiving)
+    return receiving;
+  if (write_state == Connection::STATE_WRITABLE &&
+      connected != other.connected) {
+    return connected;
+  }
+  if (priority != other.priority)
+    return priority > other.priority;
+  int generation_cmp = static_cast<int>(generation - other.generation);
+  if (generation_cmp != 0)
+    return generation_cmp > 0;
+
+  // Otherwise, sort based on latency estimate.
+  return rtt < other.rtt;
+
+  // Should we bother checking for the last connection that last received
+  // data? It would help rendezvous on the connection that is also receiving
+  // packets.
+  //
+  // TODO: Yes we should definitely do this.  The TCP protocol gains
+  // efficiency by being used bidirectionally, as opposed to two separate
+  // unidirectional streams.  This test should probably occur before
+  // comparison of local prefs (assuming combined prefs are the same).  We
+  // need to be careful though, not to bounce back and forth with both sides
+  // trying to rendevous with the other.
+}
+
 P2PTransportChannel::P2PTransportChannel(const std::string& transport_name,
                                          int component,
                                          P2PTransport* transport,
@@ -214,13 +231,15 @@ P2PTransportChannel::P2PTransportChannel(const std::string& transport_name,
       pending_best_connection_(NULL),
       sort_dirty_(false),
       was_writable_(false),
+      ice_mode_(ICEMODE_FULL),
       remote_ice_mode_(ICEMODE_FULL),
       ice_role_(ICEROLE_UNKNOWN),
       tiebreaker_(0),
       remote_candidate_generation_(0),
       gathering_state_(kIceGatheringNew),
       check_receiving_delay_(MIN_CHECK_RECEIVING_DELAY * 5),
-      receiving_timeout_(MIN_CHECK_RECEIVING_DELAY * 50) {}
+      receiving_timeout_(MIN_CHECK_RECEIVING_DELAY * 50),
+      check_and_ping_timer_(this, MSG_CHECK_AND_PING) {}
 
 P2PTransportChannel::~P2PTransportChannel() {
   ASSERT(worker_thread_ == rtc::Thread::Current());
@@ -234,6 +253,11 @@ P2PTransportChannel::~P2PTransportChannel() {
 void P2PTransportChannel::AddAllocatorSession(PortAllocatorSession* session) {
   session->set_generation(static_cast<uint32>(allocator_sessions_.size()));
   allocator_sessions_.push_back(session);
+  if (ice_mode_ == ICEMODE_LITE) {
+    // A lite implementation only has host candidates.
+    session->set_flags(session->flags() | PORTALLOCATOR_DISABLE_STUN |
+                       PORTALLOCATOR_DISABLE_RELAY);
+  }
 
   // We now only want to apply new candidates that we receive to the ports
   // created by this new session because these are replacing those of the
@@ -249,7 +273,10 @@ void P2PTransportChannel::AddAllocatorSession(PortAllocatorSession* session) {
 }
 
 void P2PTransportChannel::AddConnection(Connection* connection) {
+  // The invalid key makes the next sort insert it in place.
   connections_.push_back(connection);
+  sort_keys_.push_back(SortKey());
+  connection->set_ice_mode(ice_mode_);
   connection->set_remote_ice_mode(remote_ice_mode_);
   connection->set_receiving_timeout(receiving_timeout_);
   connection->SignalReadPacket.connect(
@@ -354,6 +381,15 @@ void P2PTransportChannel::SetRemoteIceCredentials(const std::string& ice_ufrag,
   }
 }
 
+void P2PTransportChannel::SetIceMode(IceMode mode) {
+  ASSERT(worker_thread_ == rtc::Thread::Current());
+  if (!allocator_sessions_.empty() && ice_mode_ != mode) {
+    LOG(LS_WARNING) << "Changing the ICE mode after gathering has started "
+                    << "only applies to new connections.";
+  }
+  ice_mode_ = mode;
+}
+
 void P2PTransportChannel::SetRemoteIceMode(IceMode mode) {
   remote_ice_mode_ = mode;
 }
@@ -386,8 +422,9 @@ void P2PTransportChannel::Connect() {
     return;
   }
 
-  // Start checking and pinging as the ports come in.
-  thread()->Post(this, MSG_CHECK_AND_PING);
+  // Start checking and pinging as the ports come in. Like every later check,
+  // this goes through the timer wheel.
+  thread()->timer_wheel()->Schedule(&check_and_ping_timer_, 0);
 }
 
 void P2PTransportChannel::MaybeStartGathering() {
@@ -721,6 +758,13 @@ bool P2PTransportChannel::CreateConnections(const Candidate& remote_candidate,
 bool P2PTransportChannel::CreateConnection(PortInterface* port,
                                            const Candidate& remote_candidate,
                                            PortInterface* origin_port) {
+  // A lite implementation doesn't form pairs on its own; connections are
+  // only created in OnUnknownAddress when the peer checks one of our
+  // candidates.
+  if (ice_mode_ == ICEMODE_LITE) {
+    return false;
+  }
+
   // Look for an existing connection with this remote address.  If one is not
   // found, then we can create a new connection for this address.
   Connection* connection = port->GetConnection(remote_candidate.address());
@@ -943,8 +987,7 @@ void P2PTransportChannel::SortConnections() {
   // that amongst equal preference, writable connections, this will choose the
   // one whose estimated latency is lowest.  So it is the only one that we
   // need to consider switching to.
-  ConnectionCompare cmp;
-  std::stable_sort(connections_.begin(), connections_.end(), cmp);
+  ReorderConnections();
   LOG(LS_VERBOSE) << "Sorting " << connections_.size()
                   << " available connections:";
   for (uint32 i = 0; i < connections_.size(); ++i) {
@@ -993,6 +1036,42 @@ void P2PTransportChannel::SortConnections() {
   UpdateChannelState();
 }
 
+// Restores the order of |connections_|. Most sorts follow a change to one or
+// two connections, so rather than sorting everything, the connections whose
+// keys changed are taken out and reinserted with a binary search; the others
+// are still in order relative to each other.
+void P2PTransportChannel::ReorderConnections() {
+  std::vector<Connection*> moved;
+  std::vector<SortKey> moved_keys;
+  size_t kept = 0;
+  for (size_t i = 0; i < connections_.size(); ++i) {
+    SortKey key(connections_[i]);
+    if (key == sort_keys_[i]) {
+      connections_[kept] = connections_[i];
+      sort_keys_[kept] = key;
+      ++kept;
+    } else {
+      moved.push_back(connections_[i]);
+      moved_keys.push_back(key);
+    }
+  }
+  if (moved.empty()) {
+    return;
+  }
+  connections_.resize(kept);
+  sort_keys_.resize(kept);
+
+  for (size_t i = 0; i < moved.size(); ++i) {
+    // Insert after any equal keys, like a stable sort would.
+    std::vector<SortKey>::iterator pos = std::upper_bound(
+        sort_keys_.begin(), sort_keys_.end(), moved_keys[i],
+        [](const SortKey& a, const SortKey& b) { return a.Precedes(b); });
+    connections_.insert(connections_.begin() + (pos - sort_keys_.begin()),
+                        moved[i]);
+    sort_keys_.insert(pos, moved_keys[i]);
+  }
+}
+
 Connection* P2PTransportChannel::best_nominated_connection() const {
   return (best_connection_ && best_connection_->nominated()) ? best_connection_
                                                              : nullptr;
@@ -1007,7 +1086,7 @@ void P2PTransportChannel::PruneConnections() {
   // resources and they may represent very distinct paths over which we can
   // switch. If the |premier| connection is not connected, we may be
   // reconnecting a TCP connection and temporarily do not prune connections in
-  // this network. See the big comment in CompareConnections.
+  // this network. See the big comment in CompareConnectionStates.
 
   // Get a list of the networks that we are using.
   std::set<rtc::Network*> networks;
@@ -1154,6 +1233,12 @@ void P2PTransportChannel::OnCheckAndPing() {
   // Make sure the states of the connections are up-to-date (since this affects
   // which ones are pingable).
   UpdateConnectionStates();
+  if (ice_mode_ == ICEMODE_LITE) {
+    // Lite implementations never send checks, only the state timers run.
+    thread()->timer_wheel()->Schedule(&check_and_ping_timer_,
+                                      check_receiving_delay_);
+    return;
+  }
   // When the best connection is either not receiving or not writable,
   // switch to weak ping delay.
   int ping_delay = weak() ? WEAK_PING_DELAY : STRONG_PING_DELAY;
@@ -1164,7 +1249,7 @@ void P2PTransportChannel::OnCheckAndPing() {
     }
   }
   int check_delay = std::min(ping_delay, check_receiving_delay_);
-  thread()->PostDelayed(check_delay, this, MSG_CHECK_AND_PING);
+  thread()->timer_wheel()->Schedule(&check_and_ping_timer_, check_delay);
 }
 
 // Is the connection in a state for us to even consider pinging the other side?
@@ -1196,7 +1281,11 @@ bool P2PTransportChannel::IsPingable(Connection* conn) {
 // past the maximum acceptable ping delay. When reconnecting a TCP connection,
 // the best connection is disconnected, although still WRITABLE while
 // reconnecting. The newly created connection should be selected as the ping
-// target to become writable instead. See the big comment in CompareConnections.
+// target to become writable instead. See the big comment in
+// CompareConnectionStates.
+// This scans all connections, as does UpdateConnectionStates() right before
+// it on every check, so an index ordered by ping time wouldn't make a check
+// any cheaper.
 Connection* P2PTransportChannel::FindNextPingableConnection() {
   uint32 now = rtc::Time();
   if (best_connection_ && best_connection_->connected() &&
@@ -1296,6 +1385,7 @@ void P2PTransportChannel::OnConnectionDestroyed(Connection* connection) {
   std::vector<Connection*>::iterator iter =
       std::find(connections_.begin(), connections_.end(), connection);
   ASSERT(iter != connections_.end());
+  sort_keys_.erase(sort_keys_.begin() + (iter - connections_.begin()));
   connections_.erase(iter);
 
   LOG_J(LS_INFO, this) << "Removed connection ("
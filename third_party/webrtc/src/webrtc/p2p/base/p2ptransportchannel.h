@@ -31,6 +31,7 @@
 #include "webrtc/p2p/base/transportchannelimpl.h"
 #include "webrtc/base/asyncpacketsocket.h"
 #include "webrtc/base/sigslot.h"
+#include "webrtc/base/timerwheel.h"
 
 namespace cricket {
 
@@ -67,6 +68,10 @@ class P2PTransportChannel : public TransportChannelImpl,
                          const std::string& ice_pwd) override;
   void SetRemoteIceCredentials(const std::string& ice_ufrag,
                                const std::string& ice_pwd) override;
+  // In ICEMODE_LITE the channel only gathers host candidates, never sends
+  // connectivity checks of its own and considers a pair valid once it has
+  // answered a check from the peer (RFC 5245, section 2.7).
+  void SetIceMode(IceMode mode) override;
   void SetRemoteIceMode(IceMode mode) override;
   void Connect() override;
   void MaybeStartGathering() override;
@@ -95,6 +100,7 @@ class P2PTransportChannel : public TransportChannelImpl,
   // |ports_| should not be changed from outside.
   const std::vector<PortInterface*>& ports() { return ports_; }
 
+  IceMode ice_mode() const { return ice_mode_; }
   IceMode remote_ice_mode() const { return remote_ice_mode_; }
 
   // DTLS methods.
@@ -157,6 +163,24 @@ class P2PTransportChannel : public TransportChannelImpl,
   Connection* FindNextPingableConnection();
 
  private:
+  // Snapshot of the connection state that |connections_| is sorted by, see
+  // Precedes(). A connection is only moved when its key changes.
+  struct SortKey {
+    // An invalid key, which never matches a real one.
+    SortKey();
+    explicit SortKey(Connection* conn);
+    bool operator==(const SortKey& other) const;
+    // Whether a connection with this key sorts ahead of one with |other|.
+    bool Precedes(const SortKey& other) const;
+
+    int write_state;
+    bool receiving;
+    bool connected;
+    uint64 priority;
+    uint32 generation;
+    uint32 rtt;
+  };
+
   rtc::Thread* thread() { return worker_thread_; }
   PortAllocatorSession* allocator_session() {
     return allocator_sessions_.back();
@@ -168,6 +192,7 @@ class P2PTransportChannel : public TransportChannelImpl,
   void UpdateConnectionStates();
   void RequestSort();
   void SortConnections();
+  void ReorderConnections();
   void SwitchBestConnectionTo(Connection* conn);
   void UpdateChannelState();
   void HandleWritable();
@@ -227,6 +252,8 @@ class P2PTransportChannel : public TransportChannelImpl,
   std::vector<PortAllocatorSession*> allocator_sessions_;
   std::vector<PortInterface *> ports_;
   std::vector<Connection *> connections_;
+  // Sort key of each entry in |connections_| as of the last sort.
+  std::vector<SortKey> sort_keys_;
   Connection* best_connection_;
   // Connection selected by the controlling agent. This should be used only
   // at controlled side when protocol type is RFC5245.
@@ -241,6 +268,7 @@ class P2PTransportChannel : public TransportChannelImpl,
   std::string ice_pwd_;
   std::string remote_ice_ufrag_;
   std::string remote_ice_pwd_;
+  IceMode ice_mode_;
   IceMode remote_ice_mode_;
   IceRole ice_role_;
   uint64 tiebreaker_;
@@ -249,6 +277,9 @@ class P2PTransportChannel : public TransportChannelImpl,
 
   int check_receiving_delay_;
   int receiving_timeout_;
+  // Checks and pings run off the thread's shared timer wheel, so that all
+  // channels due in the same tick are serviced in one pass.
+  rtc::TimerWheel::Timer check_and_ping_timer_;
   uint32 last_ping_sent_ms_ = 0;
   bool gather_continually_ = false;
 
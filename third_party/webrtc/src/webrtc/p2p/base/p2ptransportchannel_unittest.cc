@@ -2159,3 +2159,126 @@ TEST_F(P2PTransportChannelPingTest, TestConnectionPrunedAgain) {
   EXPECT_TRUE_WAIT(!conn2->active(), 1000);
   EXPECT_EQ(cricket::TransportChannelState::STATE_COMPLETED, ch.GetState());
 }
+
+// Connections stay sorted as their states change one at a time: writable
+// ones first, each group by priority.
+TEST_F(P2PTransportChannelPingTest, TestConnectionOrderFollowsStateChanges) {
+  cricket::FakePortAllocator pa(rtc::Thread::Current(), nullptr);
+  cricket::P2PTransportChannel ch("connection order", 1, nullptr, &pa);
+  PrepareChannel(&ch);
+  // The controlled side doesn't prune before a nomination, so every
+  // connection stays in the list.
+  ch.SetIceRole(cricket::ICEROLE_CONTROLLED);
+  ch.Connect();
+  ch.MaybeStartGathering();
+  const int kNumCandidates = 20;
+  for (int i = 0; i < kNumCandidates; ++i) {
+    ch.AddRemoteCandidate(
+        CreateCandidate("1.1.1." + rtc::ToString(i + 1), 1, (i * 7) % 20 + 1));
+  }
+  ASSERT_TRUE(WaitForConnectionTo(&ch, "1.1.1." + rtc::ToString(kNumCandidates),
+                                  1) != nullptr);
+
+  for (int i = 0; i < kNumCandidates; i += 3) {
+    GetConnectionTo(&ch, "1.1.1." + rtc::ToString(i + 1), 1)
+        ->ReceivedPingResponse();
+    rtc::Thread::Current()->ProcessMessages(0);
+
+    cricket::ConnectionInfos infos;
+    ASSERT_TRUE(ch.GetStats(&infos));
+    ASSERT_EQ(static_cast<size_t>(kNumCandidates), infos.size());
+    for (size_t j = 1; j < infos.size(); ++j) {
+      const cricket::ConnectionInfo& prev = infos[j - 1];
+      const cricket::ConnectionInfo& cur = infos[j];
+      EXPECT_TRUE(prev.writable >= cur.writable);
+      if (prev.writable == cur.writable) {
+        EXPECT_GT(prev.remote_candidate.priority(),
+                  cur.remote_candidate.priority());
+      }
+    }
+  }
+}
+
+// Drives a channel with many candidate pairs through setup, with a re-sort
+// after every state change.
+TEST_F(P2PTransportChannelPingTest, ConnectionSetupPerf) {
+  cricket::FakePortAllocator pa(rtc::Thread::Current(), nullptr);
+  cricket::P2PTransportChannel ch("setup perf", 1, nullptr, &pa);
+  PrepareChannel(&ch);
+  ch.SetIceRole(cricket::ICEROLE_CONTROLLED);
+  ch.Connect();
+  ch.MaybeStartGathering();
+  const int kNumCandidates = 160;
+  uint32 start = rtc::Time();
+  for (int i = 0; i < kNumCandidates; ++i) {
+    ch.AddRemoteCandidate(CreateCandidate(
+        "10.0." + rtc::ToString(i / 200) + "." + rtc::ToString(i % 200 + 1),
+        1000 + i, (i * 37) % kNumCandidates + 1));
+  }
+  ASSERT_EQ(static_cast<size_t>(kNumCandidates),
+            GetPort(&ch)->connections().size());
+  uint32 add_elapsed = rtc::TimeSince(start);
+
+  // Connections alternately become writable and get pruned, one at a time.
+  start = rtc::Time();
+  for (int round = 0; round < 10; ++round) {
+    for (const auto& kv : GetPort(&ch)->connections()) {
+      if (round % 2 == 0) {
+        kv.second->ReceivedPingResponse();
+      } else {
+        kv.second->Prune();
+      }
+      rtc::Thread::Current()->ProcessMessages(0);
+    }
+  }
+  uint32 update_elapsed = rtc::TimeSince(start);
+  EXPECT_TRUE(ch.best_connection() != nullptr);
+
+  LOG(LS_INFO) << kNumCandidates << " candidate pairs: added in "
+               << add_elapsed << " ms, " << 10 * kNumCandidates
+               << " state changes with re-sort in " << update_elapsed << " ms";
+}
+
+// In ICE-lite mode the channel doesn't pair remote candidates or ping on its
+// own. A connection is created and becomes writable when a check from the
+// peer is answered, and becomes unwritable when the checks stop.
+TEST_F(P2PTransportChannelPingTest, TestIceLite) {
+  cricket::FakePortAllocator pa(rtc::Thread::Current(), nullptr);
+  cricket::P2PTransportChannel ch("ice lite", 1, nullptr, &pa);
+  PrepareChannel(&ch);
+  ch.SetIceRole(cricket::ICEROLE_CONTROLLED);
+  ch.SetIceMode(cricket::ICEMODE_LITE);
+  ch.SetIceConfig(CreateIceConfig(500, false));
+  ch.Connect();
+  ch.MaybeStartGathering();
+  ch.AddRemoteCandidate(CreateCandidate("1.1.1.1", 1, 1));
+  cricket::Port* port = GetPort(&ch);
+  ASSERT_TRUE(port != nullptr);
+  EXPECT_TRUE(GetConnectionTo(&ch, "1.1.1.1", 1) == nullptr);
+
+  cricket::IceMessage request;
+  request.SetType(cricket::STUN_BINDING_REQUEST);
+  request.AddAttribute(new cricket::StunByteStringAttribute(
+      cricket::STUN_ATTR_USERNAME, kIceUfrag[1]));
+  uint32 prflx_priority = cricket::ICE_TYPE_PREFERENCE_PRFLX << 24;
+  request.AddAttribute(new cricket::StunUInt32Attribute(
+      cricket::STUN_ATTR_PRIORITY, prflx_priority));
+  request.AddAttribute(
+      new cricket::StunByteStringAttribute(cricket::STUN_ATTR_USE_CANDIDATE));
+  port->SignalUnknownAddress(port, rtc::SocketAddress("1.1.1.1", 1),
+                             cricket::PROTO_UDP, &request, kIceUfrag[1], false);
+  cricket::Connection* conn1 = WaitForConnectionTo(&ch, "1.1.1.1", 1);
+  ASSERT_TRUE(conn1 != nullptr);
+  EXPECT_TRUE(conn1->writable());
+  EXPECT_EQ(conn1, ch.best_connection());
+  EXPECT_TRUE_WAIT(ch.writable(), 1000);
+
+  // Without further checks from the peer the connection stops being writable,
+  // and we never sent a check of our own.
+  EXPECT_TRUE_WAIT(!conn1->writable(), 3000);
+  EXPECT_EQ(0U, conn1->last_ping_sent());
+
+  // The next check brings it back.
+  conn1->ReceivedPing();
+  EXPECT_TRUE(conn1->writable());
+}
@@ -77,6 +77,10 @@ const int RTT_RATIO = 3;  // 3 : 1
 
 // The delay before we begin checking if this port is useless.
 const int kPortTimeoutDelay = 30 * 1000;  // 30 seconds
+
+// Header, RETRANSMIT-COUNT, an IPv6 XOR-MAPPED-ADDRESS, MESSAGE-INTEGRITY and
+// FINGERPRINT.
+const size_t kStunBindingResponseMaxSize = 20 + 8 + 24 + 24 + 8;
 }
 
 namespace cricket {
@@ -197,6 +201,7 @@ void Port::Construct() {
     ice_username_fragment_ = rtc::CreateRandomString(ICE_UFRAG_LENGTH);
     password_ = rtc::CreateRandomString(ICE_PWD_LENGTH);
   }
+  password_hmac_.SetKey(password_);
   LOG_J(LS_INFO, this) << "Port created";
 }
 
@@ -375,7 +380,7 @@ bool Port::GetStunMessage(const char* data, size_t size,
     }
 
     // If ICE, and the MESSAGE-INTEGRITY is bad, fail with a 401 Unauthorized
-    if (!stun_msg->ValidateMessageIntegrity(data, size, password_)) {
+    if (!stun_msg->ValidateMessageIntegrity(data, size, password_hmac_)) {
       LOG_J(LS_ERROR, this) << "Received STUN request with bad M-I "
                             << "from " << addr.ToSensitiveString()
                             << ", password_=" << password_;
@@ -541,17 +546,18 @@ void Port::SendBindingResponse(StunMessage* request,
     return;
   }
 
-  // Fill in the response message.
-  StunMessage response;
-  response.SetType(STUN_BINDING_RESPONSE);
-  response.SetTransactionID(request->transaction_id());
+  // Fill in the response message. Responses go out for every ping, so they
+  // are built on the stack rather than as a StunMessage.
+  const std::string& transaction_id = request->transaction_id();
+  char buf[kStunBindingResponseMaxSize];
+  StunMessageBuilder response(buf, sizeof(buf), STUN_BINDING_RESPONSE,
+                              transaction_id.data(), transaction_id.size());
   const StunUInt32Attribute* retransmit_attr =
       request->GetUInt32(STUN_ATTR_RETRANSMIT_COUNT);
   if (retransmit_attr) {
     // Inherit the incoming retransmit value in the response so the other side
     // can see our view of lost pings.
-    response.AddAttribute(new StunUInt32Attribute(
-        STUN_ATTR_RETRANSMIT_COUNT, retransmit_attr->value()));
+    response.AddUInt32(STUN_ATTR_RETRANSMIT_COUNT, retransmit_attr->value());
 
     if (retransmit_attr->value() > CONNECTION_WRITE_CONNECT_FAILURES) {
       LOG_J(LS_INFO, this)
@@ -560,26 +566,32 @@ void Port::SendBindingResponse(StunMessage* request,
     }
   }
 
-  response.AddAttribute(
-      new StunXorAddressAttribute(STUN_ATTR_XOR_MAPPED_ADDRESS, addr));
-  response.AddMessageIntegrity(password_);
+  response.AddXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, addr);
+  response.AddMessageIntegrity(password_hmac_);
   response.AddFingerprint();
+  if (!response.ok()) {
+    // Nothing we add should overflow the buffer, but never send a truncated
+    // or empty response.
+    LOG_J(LS_ERROR, this)
+        << "Failed to build STUN ping response"
+        << ", to=" << addr.ToSensitiveString()
+        << ", id=" << rtc::hex_encode(transaction_id);
+    return;
+  }
 
   // The fact that we received a successful request means that this connection
   // (if one exists) should now be receiving.
   Connection* conn = GetConnection(addr);
 
   // Send the response message.
-  rtc::ByteBuffer buf;
-  response.Write(&buf);
   rtc::PacketOptions options(DefaultDscpValue());
-  auto err = SendTo(buf.Data(), buf.Length(), addr, options, false);
+  auto err = SendTo(response.data(), response.length(), addr, options, false);
   if (err < 0) {
     LOG_J(LS_ERROR, this)
         << "Failed to send STUN ping response"
         << ", to=" << addr.ToSensitiveString()
         << ", err=" << err
-        << ", id=" << rtc::hex_encode(response.transaction_id());
+        << ", id=" << rtc::hex_encode(transaction_id);
   } else {
     // Log at LS_INFO if we send a stun ping response on an unwritable
     // connection.
@@ -588,7 +600,7 @@ void Port::SendBindingResponse(StunMessage* request,
     LOG_JV(sev, this)
         << "Sent STUN ping response"
         << ", to=" << addr.ToSensitiveString()
-        << ", id=" << rtc::hex_encode(response.transaction_id());
+        << ", id=" << rtc::hex_encode(transaction_id);
   }
 
   ASSERT(conn != NULL);
@@ -617,7 +629,7 @@ void Port::SendBindingErrorResponse(StunMessage* request,
   // because we don't have enough information to determine the shared secret.
   if (error_code != STUN_ERROR_BAD_REQUEST &&
       error_code != STUN_ERROR_UNAUTHORIZED)
-    response.AddMessageIntegrity(password_);
+    response.AddMessageIntegrity(password_hmac_);
   response.AddFingerprint();
 
   // Send the response message.
@@ -733,7 +745,7 @@ class ConnectionRequest : public StunRequest {
         new StunUInt32Attribute(STUN_ATTR_PRIORITY, prflx_priority));
 
     // Adding Message Integrity attribute.
-    request->AddMessageIntegrity(connection_->remote_candidate().password());
+    request->AddMessageIntegrity(connection_->remote_password_hmac());
     // Adding Fingerprint.
     request->AddFingerprint();
   }
@@ -781,6 +793,7 @@ Connection::Connection(Port* port,
       pruned_(false),
       use_candidate_attr_(false),
       nominated_(false),
+      ice_mode_(ICEMODE_FULL),
       remote_ice_mode_(ICEMODE_FULL),
       requests_(port->thread()),
       rtt_(DEFAULT_RTT),
@@ -962,8 +975,8 @@ void Connection::OnReadPacket(
       // id's match.
       case STUN_BINDING_RESPONSE:
       case STUN_BINDING_ERROR_RESPONSE:
-        if (msg->ValidateMessageIntegrity(
-                data, size, remote_candidate().password())) {
+        if (msg->ValidateMessageIntegrity(data, size,
+                                          remote_password_hmac())) {
           requests_.CheckResponse(msg.get());
         }
         // Otherwise silently discard the response message.
@@ -1080,6 +1093,21 @@ void Connection::UpdateState(uint32 now) {
   uint32 last_recv_time = last_received();
   bool receiving = now <= last_recv_time + receiving_timeout_;
   set_receiving(receiving);
+
+  // A lite connection has no pings of its own to time out, so its write state
+  // follows the checks received from the peer instead.
+  if (ice_mode_ == ICEMODE_LITE) {
+    if (write_state_ == STATE_WRITABLE && !receiving) {
+      LOG_J(LS_INFO, this) << "Unwritable after "
+                           << now - last_recv_time
+                           << " ms without receiving a ping";
+      set_write_state(STATE_WRITE_UNRELIABLE);
+    }
+    if (write_state_ == STATE_WRITE_UNRELIABLE &&
+        now > last_recv_time + CONNECTION_WRITE_TIMEOUT) {
+      set_write_state(STATE_WRITE_TIMEOUT);
+    }
+  }
   if (dead(now)) {
     Destroy();
   }
@@ -1098,6 +1126,12 @@ void Connection::Ping(uint32 now) {
 void Connection::ReceivedPing() {
   set_receiving(true);
   last_ping_received_ = rtc::Time();
+  if (ice_mode_ == ICEMODE_LITE) {
+    // We just answered a valid check from the peer, which is all a lite
+    // implementation needs to consider the pair usable.
+    set_write_state(STATE_WRITABLE);
+    set_state(STATE_SUCCEEDED);
+  }
 }
 
 void Connection::ReceivedPingResponse() {
@@ -1279,6 +1313,14 @@ void Connection::MaybeSetRemoteIceCredentials(const std::string& ice_ufrag,
   }
 }
 
+const rtc::HmacSha1& Connection::remote_password_hmac() {
+  if (remote_password_hmac_key_ != remote_candidate_.password()) {
+    remote_password_hmac_key_ = remote_candidate_.password();
+    remote_password_hmac_.SetKey(remote_password_hmac_key_);
+  }
+  return remote_password_hmac_;
+}
+
 void Connection::MaybeUpdatePeerReflexiveCandidate(
     const Candidate& new_candidate) {
   if (remote_candidate_.type() == PRFLX_PORT_TYPE &&
@@ -23,6 +23,7 @@
 #include "webrtc/p2p/base/stunrequest.h"
 #include "webrtc/p2p/base/transport.h"
 #include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/hmacsha1.h"
 #include "webrtc/base/network.h"
 #include "webrtc/base/proxyinfo.h"
 #include "webrtc/base/ratetracker.h"
@@ -367,6 +368,8 @@ class Port : public PortInterface, public rtc::MessageHandler,
   // username_fragment().
   std::string ice_username_fragment_;
   std::string password_;
+  // |password_| as a precomputed MESSAGE-INTEGRITY key.
+  rtc::HmacSha1 password_hmac_;
   std::vector<Candidate> candidates_;
   AddressMap connections_;
   int timeout_delay_;
@@ -497,6 +500,12 @@ class Connection : public rtc::MessageHandler,
   bool nominated() const { return nominated_; }
   void set_nominated(bool nominated) { nominated_ = nominated; }
 
+  // In ICEMODE_LITE the connection never pings, so it becomes writable when
+  // it receives a valid ping and stays writable only while it keeps receiving.
+  void set_ice_mode(IceMode mode) {
+    ice_mode_ = mode;
+  }
+
   void set_remote_ice_mode(IceMode mode) {
     remote_ice_mode_ = mode;
   }
@@ -541,6 +550,7 @@ class Connection : public rtc::MessageHandler,
 
   State state() const { return state_; }
 
+  IceMode ice_mode() const { return ice_mode_; }
   IceMode remote_ice_mode() const { return remote_ice_mode_; }
 
   // Update the ICE password of the remote candidate if |ice_ufrag| matches
@@ -582,9 +592,15 @@ class Connection : public rtc::MessageHandler,
 
   void OnMessage(rtc::Message *pmsg);
 
+  // Returns the remote ICE password as a precomputed MESSAGE-INTEGRITY key,
+  // rekeying it if the password has changed.
+  const rtc::HmacSha1& remote_password_hmac();
+
   Port* port_;
   size_t local_candidate_index_;
   Candidate remote_candidate_;
+  rtc::HmacSha1 remote_password_hmac_;
+  std::string remote_password_hmac_key_;
   WriteState write_state_;
   bool receiving_;
   bool connected_;
@@ -597,6 +613,7 @@ class Connection : public rtc::MessageHandler,
   // Whether this connection has been nominated by the controlling side via
   // the use_candidate attribute.
   bool nominated_;
+  IceMode ice_mode_;
   IceMode remote_ice_mode_;
   StunRequestManager requests_;
   uint32 rtt_;
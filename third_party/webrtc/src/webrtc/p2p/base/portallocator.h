@@ -53,6 +53,9 @@ enum {
   // Disallow use of UDP when connecting to a relay server. Since proxy servers
   // usually don't handle UDP, using UDP will leak the IP address.
   PORTALLOCATOR_DISABLE_UDP_RELAY = 0x1000,
+  // Start all allocation phases (UDP, relay, TCP) at once instead of one per
+  // step_delay().
+  PORTALLOCATOR_ENABLE_PARALLEL_PHASES = 0x2000,
 };
 
 const uint32 kDefaultPortAllocatorFlags = 0;
@@ -10,6 +10,7 @@
 
 #include "webrtc/p2p/base/pseudotcp.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -112,6 +113,12 @@ const uint32 DEF_ACK_DELAY = 100; // 100 milliseconds
 
 const uint8 FLAG_CTL = 0x02;
 const uint8 FLAG_RST = 0x04;
+// Once both sides have sent TCP_OPT_SACK_PERMITTED, pure ACKs may carry SACK
+// blocks (RFC 2018) instead of data. The payload of a segment with this flag
+// holds up to MAX_SACK_BLOCKS pairs of 32-bit left and right edges.
+const uint8 FLAG_SACK = 0x40;
+const uint32 MAX_SACK_BLOCKS = 4;
+const uint32 SACK_BLOCK_SIZE = 8;
 
 const uint8 CTL_CONNECT = 0;
 
@@ -120,6 +127,15 @@ const uint8 TCP_OPT_EOL = 0;  // End of list.
 const uint8 TCP_OPT_NOOP = 1;  // No-op.
 const uint8 TCP_OPT_MSS = 2;  // Maximum segment size.
 const uint8 TCP_OPT_WND_SCALE = 3;  // Window scale factor.
+const uint8 TCP_OPT_SACK_PERMITTED = 4;  // SACK permitted.
+
+// Number of duplicate ACKs, or segments' worth of SACKed data above a hole,
+// that mark it as lost.
+const uint32 DUP_THRESH = 3;
+
+// CUBIC constants (RFC 8312).
+const double CUBIC_C = 0.4;
+const double CUBIC_BETA = 0.7;
 
 const long DEFAULT_TIMEOUT = 4000; // If there are no pending clocks, wake up every 4 seconds
 const long CLOSED_TIMEOUT = 60 * 1000; // If the connection is closed, once per minute
@@ -222,6 +238,7 @@ PseudoTcp::PseudoTcp(IPseudoTcpNotify* notify, uint32 conv)
   m_conv = conv;
   m_rcv_wnd = m_rbuf_len;
   m_rwnd_scale = m_swnd_scale = 0;
+  m_rcv_rtt = m_rcv_space_seq = m_rcv_space_time = 0;
   m_snd_nxt = 0;
   m_snd_wnd = 1;
   m_snd_una = m_rcv_nxt = 0;
@@ -245,6 +262,13 @@ PseudoTcp::PseudoTcp(IPseudoTcpNotify* notify, uint32 conv)
   m_dup_acks = 0;
   m_recover = 0;
 
+  m_use_sack = false;
+  m_sack_high = m_retran_data = 0;
+  m_rto_recovery = false;
+
+  m_cubic_wmax = m_cubic_epoch = m_cubic_origin = 0;
+  m_cubic_k = m_cubic_west = 0;
+
   m_ts_recent = m_ts_lastack = 0;
 
   m_rx_rto = DEF_RTO;
@@ -252,7 +276,10 @@ PseudoTcp::PseudoTcp(IPseudoTcpNotify* notify, uint32 conv)
 
   m_use_nagling = true;
   m_ack_delay = DEF_ACK_DELAY;
+  m_autotune_max = 0;
+  m_congestion_control = CC_NEWRENO;
   m_support_wnd_scale = true;
+  m_support_sack = true;
 }
 
 PseudoTcp::~PseudoTcp() {
@@ -303,11 +330,22 @@ void PseudoTcp::NotifyClock(uint32 now) {
         return;
       }
 
-      uint32 nInFlight = m_snd_nxt - m_snd_una;
-      m_ssthresh = std::max(nInFlight / 2, 2 * m_mss);
-      //LOG(LS_INFO) << "m_ssthresh: " << m_ssthresh << "  nInFlight: " << nInFlight << "  m_mss: " << m_mss;
+      onCongestionEvent();
       m_cwnd = m_mss;
 
+      if (m_use_sack) {
+        // Everything outstanding that wasn't SACKed is lost. Recover it in
+        // slow start rather than one hole per timeout.
+        for (SList::iterator it = m_slist.begin(); it != m_slist.end(); ++it) {
+          it->bRecoveryXmit = false;
+        }
+        m_slist.front().bRecoveryXmit = true;
+        m_retran_data = m_slist.front().len;
+        m_recover = m_snd_nxt;
+        m_dup_acks = DUP_THRESH;
+        m_rto_recovery = true;
+      }
+
       // Back off retransmit timer.  Note: the limit is lower when connecting.
       uint32 rto_limit = (m_state < TCP_ESTABLISHED) ? DEF_RTO : MAX_RTO;
       m_rx_rto = std::min(rto_limit, m_rx_rto * 2);
@@ -371,6 +409,10 @@ void PseudoTcp::GetOption(Option opt, int* value) {
     *value = m_sbuf_len;
   } else if (opt == OPT_RCVBUF) {
     *value = m_rbuf_len;
+  } else if (opt == OPT_AUTOTUNE_MAX) {
+    *value = m_autotune_max;
+  } else if (opt == OPT_CONGESTION_CONTROL) {
+    *value = m_congestion_control;
   } else {
     ASSERT(false);
   }
@@ -386,6 +428,14 @@ void PseudoTcp::SetOption(Option opt, int value) {
   } else if (opt == OPT_RCVBUF) {
     ASSERT(m_state == TCP_LISTEN);
     resizeReceiveBuffer(value);
+  } else if (opt == OPT_AUTOTUNE_MAX) {
+    ASSERT(m_state == TCP_LISTEN);
+    // The window scale factor must be large enough for the biggest buffer.
+    m_autotune_max = value;
+    resizeReceiveBuffer(m_rbuf_len);
+  } else if (opt == OPT_CONGESTION_CONTROL) {
+    ASSERT(value == CC_NEWRENO || value == CC_CUBIC);
+    m_congestion_control = static_cast<CongestionControl>(value);
   } else {
     ASSERT(false);
   }
@@ -535,6 +585,15 @@ IPseudoTcpNotify::WriteResult PseudoTcp::packet(uint32 seq, uint8 flags,
     ASSERT(static_cast<uint32>(bytes_read) == len);
   }
 
+  // Pure ACKs tell the peer about out-of-order data we hold.
+  uint32 sack_len = 0;
+  if (!len && m_use_sack) {
+    sack_len = writeSackBlocks(buffer.get() + HEADER_SIZE);
+    if (sack_len) {
+      buffer[13] |= FLAG_SACK;
+    }
+  }
+
 #if _DEBUGMSG >= _DBG_VERBOSE
   LOG(LS_INFO) << "<-- <CONV=" << m_conv
                << "><FLG=" << static_cast<unsigned>(flags)
@@ -547,7 +606,8 @@ IPseudoTcpNotify::WriteResult PseudoTcp::packet(uint32 seq, uint8 flags,
 #endif // _DEBUGMSG
 
   IPseudoTcpNotify::WriteResult wres = m_notify->TcpWritePacket(
-      this, reinterpret_cast<char *>(buffer.get()), len + HEADER_SIZE);
+      this, reinterpret_cast<char *>(buffer.get()),
+      len + sack_len + HEADER_SIZE);
   // Note: When len is 0, this is an ACK packet.  We don't read the return value for those,
   // and thus we won't retry.  So go ahead and treat the packet as a success (basically simulate
   // as if it were dropped), which will prevent our timers from being messed up.
@@ -581,6 +641,18 @@ bool PseudoTcp::parse(const uint8* buffer, uint32 size) {
   seg.data = reinterpret_cast<const char *>(buffer) + HEADER_SIZE;
   seg.len = size - HEADER_SIZE;
 
+  seg.sack = NULL;
+  seg.sack_blocks = 0;
+  if (seg.flags & FLAG_SACK) {
+    // The payload holds SACK blocks, not data.
+    if (seg.len % SACK_BLOCK_SIZE == 0 &&
+        seg.len <= MAX_SACK_BLOCKS * SACK_BLOCK_SIZE) {
+      seg.sack = seg.data;
+      seg.sack_blocks = seg.len / SACK_BLOCK_SIZE;
+    }
+    seg.len = 0;
+  }
+
 #if _DEBUGMSG >= _DBG_VERBOSE
   LOG(LS_INFO) << "--> <CONV=" << seg.conv
                << "><FLG=" << static_cast<unsigned>(seg.flags)
@@ -695,8 +767,10 @@ bool PseudoTcp::process(Segment& seg) {
     }
   }
 
-  // Update timestamp
-  if ((seg.seq <= m_ts_lastack) && (m_ts_lastack < seg.seq + seg.len)) {
+  // Update timestamp. Pure ACKs count too (RFC 7323), so that a receiver
+  // that doesn't send data can still measure the round-trip time.
+  if ((seg.seq <= m_ts_lastack) &&
+      ((m_ts_lastack < seg.seq + seg.len) || (seg.len == 0))) {
     m_ts_recent = seg.tsval;
   }
 
@@ -739,26 +813,42 @@ bool PseudoTcp::process(Segment& seg) {
 
     for (uint32 nFree = nAcked; nFree > 0; ) {
       ASSERT(!m_slist.empty());
-      if (nFree < m_slist.front().len) {
-        m_slist.front().len -= nFree;
+      SSegment& front = m_slist.front();
+      uint32 nFreed = std::min(nFree, front.len);
+      if (front.bRecoveryXmit && !front.bSacked) {
+        m_retran_data -= std::min(m_retran_data, nFreed);
+      }
+      if (nFree < front.len) {
+        front.seq += nFree;
+        front.len -= nFree;
         nFree = 0;
       } else {
-        if (m_slist.front().len > m_largest) {
-          m_largest = m_slist.front().len;
+        if (front.len > m_largest) {
+          m_largest = front.len;
         }
-        nFree -= m_slist.front().len;
+        nFree -= front.len;
         m_slist.pop_front();
       }
     }
 
-    if (m_dup_acks >= 3) {
+    if (m_dup_acks >= DUP_THRESH) {
       if (m_snd_una >= m_recover) { // NewReno
-        uint32 nInFlight = m_snd_nxt - m_snd_una;
-        m_cwnd = std::min(m_ssthresh, nInFlight + m_mss);  // (Fast Retransmit)
+        if (!m_rto_recovery) {
+          uint32 nInFlight = m_snd_nxt - m_snd_una;
+          m_cwnd = std::min(m_ssthresh, nInFlight + m_mss);  // (Fast Retransmit)
+        }
 #if _DEBUGMSG >= _DBG_NORMAL
         LOG(LS_INFO) << "exit recovery";
 #endif // _DEBUGMSG
         m_dup_acks = 0;
+        m_retran_data = 0;
+        m_rto_recovery = false;
+      } else if (m_use_sack) {
+        // Holes are retransmitted from attemptSend(). After a timeout the
+        // window is still in slow start.
+        if (m_rto_recovery) {
+          increaseCongestionWindow(nAcked, now);
+        }
       } else {
 #if _DEBUGMSG >= _DBG_NORMAL
         LOG(LS_INFO) << "recovery retransmit";
@@ -771,13 +861,9 @@ bool PseudoTcp::process(Segment& seg) {
       }
     } else {
       m_dup_acks = 0;
-      // Slow start, congestion avoidance
-      if (m_cwnd < m_ssthresh) {
-        m_cwnd += m_mss;
-      } else {
-        m_cwnd += std::max<uint32>(1, m_mss * m_mss / m_cwnd);
-      }
+      increaseCongestionWindow(nAcked, now);
     }
+    autotuneSendBuffer();
   } else if (seg.ack == m_snd_una) {
     // !?! Note, tcp says don't do this... but otherwise how does a closed window become open?
     m_snd_wnd = static_cast<uint32>(seg.wnd) << m_swnd_scale;
@@ -787,7 +873,7 @@ bool PseudoTcp::process(Segment& seg) {
       // it's a dup ack, but with a data payload, so don't modify m_dup_acks
     } else if (m_snd_una != m_snd_nxt) {
       m_dup_acks += 1;
-      if (m_dup_acks == 3) { // (Fast Retransmit)
+      if (m_dup_acks == DUP_THRESH) { // (Fast Retransmit)
 #if _DEBUGMSG >= _DBG_NORMAL
         LOG(LS_INFO) << "enter recovery";
         LOG(LS_INFO) << "recovery retransmit";
@@ -797,11 +883,17 @@ bool PseudoTcp::process(Segment& seg) {
           return false;
         }
         m_recover = m_snd_nxt;
-        uint32 nInFlight = m_snd_nxt - m_snd_una;
-        m_ssthresh = std::max(nInFlight / 2, 2 * m_mss);
-        //LOG(LS_INFO) << "m_ssthresh: " << m_ssthresh << "  nInFlight: " << nInFlight << "  m_mss: " << m_mss;
-        m_cwnd = m_ssthresh + 3 * m_mss;
-      } else if (m_dup_acks > 3) {
+        onCongestionEvent();
+        if (m_use_sack) {
+          // The SACK scoreboard tells what is still in flight, so the window
+          // isn't inflated (RFC 6675).
+          m_slist.front().bRecoveryXmit = true;
+          m_retran_data = m_slist.front().len;
+          m_cwnd = m_ssthresh;
+        } else {
+          m_cwnd = m_ssthresh + 3 * m_mss;
+        }
+      } else if ((m_dup_acks > DUP_THRESH) && !m_use_sack) {
         m_cwnd += m_mss;
       }
     } else {
@@ -809,6 +901,10 @@ bool PseudoTcp::process(Segment& seg) {
     }
   }
 
+  if (seg.sack_blocks > 0 && m_use_sack) {
+    processSack(seg);
+  }
+
   // !?! A bit hacky
   if ((m_state == TCP_SYN_RECEIVED) && !bConnect) {
     m_state = TCP_ESTABLISHED;
@@ -920,6 +1016,7 @@ bool PseudoTcp::process(Segment& seg) {
           }
           it = m_rlist.erase(it);
         }
+        autotuneReceiveBuffer(now, seg.tsecr);
       } else {
 #if _DEBUGMSG >= _DBG_NORMAL
         LOG(LS_INFO) << "Saving " << seg.len << " bytes (" << seg.seq << " -> " << seg.seq + seg.len << ")";
@@ -998,13 +1095,7 @@ bool PseudoTcp::transmit(const SList::iterator& seg, uint32 now) {
   if (nTransmit < seg->len) {
     LOG_F(LS_VERBOSE) << "mss reduced to " << m_mss;
 
-    SSegment subseg(seg->seq + nTransmit, seg->len - nTransmit, seg->bCtrl);
-    //subseg.tstamp = seg->tstamp;
-    subseg.xmit = seg->xmit;
-    seg->len = nTransmit;
-
-    SList::iterator next = seg;
-    m_slist.insert(++next, subseg);
+    splitSegment(seg, nTransmit);
   }
 
   if (seg->xmit == 0) {
@@ -1019,11 +1110,25 @@ bool PseudoTcp::transmit(const SList::iterator& seg, uint32 now) {
   return true;
 }
 
+void PseudoTcp::splitSegment(const SList::iterator& seg, uint32 len) {
+  ASSERT(len < seg->len);
+  SSegment subseg(seg->seq + len, seg->len - len, seg->bCtrl);
+  //subseg.tstamp = seg->tstamp;
+  subseg.xmit = seg->xmit;
+  subseg.bSacked = seg->bSacked;
+  subseg.bRecoveryXmit = seg->bRecoveryXmit;
+  seg->len = len;
+
+  SList::iterator next = seg;
+  m_slist.insert(++next, subseg);
+}
+
 void PseudoTcp::attemptSend(SendFlags sflags) {
   uint32 now = Now();
 
   if (rtc::TimeDiff(now, m_lastsend) > static_cast<long>(m_rx_rto)) {
     m_cwnd = m_mss;
+    m_cubic_epoch = 0;
   }
 
 #if _DEBUGMSG
@@ -1040,6 +1145,30 @@ void PseudoTcp::attemptSend(SendFlags sflags) {
     uint32 nInFlight = m_snd_nxt - m_snd_una;
     uint32 nUseable = (nInFlight < nWindow) ? (nWindow - nInFlight) : 0;
 
+    if (m_use_sack && (m_dup_acks >= DUP_THRESH)) {
+      // During SACK recovery only data that is still in the network counts
+      // against the congestion window: what was sent beyond the highest SACK,
+      // or since the timeout, and the retransmissions (FACK).
+      uint32 nPipe = m_retran_data + m_snd_nxt -
+          (m_rto_recovery ? m_recover : std::max(m_snd_una, m_sack_high));
+      if (nPipe < cwnd) {
+        SList::iterator lost = nextLostSegment();
+        if (lost != m_slist.end()) {
+          if (!transmit(lost, now)) {
+            LOG_F(LS_VERBOSE) << "transmit failed";
+            return;
+          }
+          lost->bRecoveryXmit = true;
+          m_retran_data += lost->len;
+          sflags = sfNone;
+          continue;
+        }
+      }
+      uint32 nReceiveWindow =
+          (nInFlight < m_snd_wnd) ? (m_snd_wnd - nInFlight) : 0;
+      nUseable = std::min(nReceiveWindow, (nPipe < cwnd) ? cwnd - nPipe : 0);
+    }
+
     size_t snd_buffered = 0;
     m_sbuf.GetBuffered(&snd_buffered);
     uint32 nAvailable =
@@ -1101,9 +1230,7 @@ void PseudoTcp::attemptSend(SendFlags sflags) {
 
     // If the segment is too large, break it into two
     if (seg->len > nAvailable) {
-      SSegment subseg(seg->seq + nAvailable, seg->len - nAvailable, seg->bCtrl);
-      seg->len = nAvailable;
-      m_slist.insert(++it, subseg);
+      splitSegment(seg, nAvailable);
     }
 
     if (!transmit(seg, now)) {
@@ -1156,6 +1283,11 @@ PseudoTcp::disableWindowScale() {
   m_support_wnd_scale = false;
 }
 
+void
+PseudoTcp::disableSack() {
+  m_support_sack = false;
+}
+
 void
 PseudoTcp::queueConnectMessage() {
   rtc::ByteBuffer buf(rtc::ByteBuffer::ORDER_NETWORK);
@@ -1166,6 +1298,10 @@ PseudoTcp::queueConnectMessage() {
     buf.WriteUInt8(1);
     buf.WriteUInt8(m_rwnd_scale);
   }
+  if (m_support_sack) {
+    buf.WriteUInt8(TCP_OPT_SACK_PERMITTED);
+    buf.WriteUInt8(0);
+  }
   m_snd_wnd = static_cast<uint32>(buf.Length());
   queue(buf.Data(), static_cast<uint32>(buf.Length()), true);
 }
@@ -1212,10 +1348,15 @@ PseudoTcp::parseOptions(const char* data, uint32 len) {
     if (m_rwnd_scale > 0) {
       // Peer doesn't support TCP options and window scaling.
       // Revert receive buffer size to default value.
+      m_autotune_max = 0;
       resizeReceiveBuffer(DEFAULT_RCV_BUF_SIZE);
       m_swnd_scale = 0;
     }
   }
+
+  m_use_sack = m_support_sack &&
+      (options_specified.find(TCP_OPT_SACK_PERMITTED) !=
+       options_specified.end());
 }
 
 void
@@ -1230,7 +1371,9 @@ PseudoTcp::applyOption(char kind, const char* data, uint32 len) {
       LOG_F(WARNING) << "Invalid window scale option received.";
       return;
     }
-    applyWindowScaleOption(data[0]);
+    if (m_support_wnd_scale) {
+      applyWindowScaleOption(data[0]);
+    }
   }
 }
 
@@ -1250,14 +1393,16 @@ PseudoTcp::resizeReceiveBuffer(uint32 new_size) {
   uint8 scale_factor = 0;
 
   // Determine the scale factor such that the scaled window size can fit
-  // in a 16-bit unsigned integer.
-  while (new_size > 0xFFFF) {
+  // in a 16-bit unsigned integer. The factor can't change once connected,
+  // so with auto-tuning it has to fit the largest buffer.
+  uint32 max_size = std::max(new_size, m_autotune_max);
+  while (max_size > 0xFFFF) {
     ++scale_factor;
-    new_size >>= 1;
+    max_size >>= 1;
   }
 
   // Determine the proper size of the buffer.
-  new_size <<= scale_factor;
+  new_size = (new_size >> scale_factor) << scale_factor;
   bool result = m_rbuf.SetCapacity(new_size);
 
   // Make sure the new buffer is large enough to contain data in the old
@@ -1268,11 +1413,224 @@ PseudoTcp::resizeReceiveBuffer(uint32 new_size) {
   RTC_UNUSED(result);
   m_rbuf_len = new_size;
   m_rwnd_scale = scale_factor;
-  m_ssthresh = new_size;
+  m_ssthresh = std::max(new_size, m_autotune_max);
 
   size_t available_space = 0;
   m_rbuf.GetWriteRemaining(&available_space);
   m_rcv_wnd = static_cast<uint32>(available_space);
 }
 
+void
+PseudoTcp::autotuneReceiveBuffer(uint32 now, uint32 tsecr) {
+  if (m_rbuf_len >= m_autotune_max) {
+    return;
+  }
+
+  // The peer echoes the timestamp of our latest ACK, so new data arrives
+  // about one round trip after it. Favor the smaller samples, larger ones
+  // come from data the peer held back.
+  if (tsecr) {
+    int32 rtt = rtc::TimeDiff(now, tsecr);
+    if (rtt >= 0) {
+      uint32 unsigned_rtt = static_cast<uint32>(rtt);
+      if (m_rcv_rtt == 0 || unsigned_rtt < m_rcv_rtt) {
+        m_rcv_rtt = std::max<uint32>(1, unsigned_rtt);
+      } else {
+        m_rcv_rtt = (7 * m_rcv_rtt + unsigned_rtt) / 8;
+      }
+    }
+  }
+  if (m_rcv_rtt == 0) {
+    return;
+  }
+
+  if (m_rcv_space_time == 0) {
+    m_rcv_space_time = now;
+    m_rcv_space_seq = m_rcv_nxt;
+    return;
+  }
+  if (rtc::TimeDiff(now, m_rcv_space_time) < static_cast<int32>(m_rcv_rtt)) {
+    return;
+  }
+
+  // A peer limited by our window delivers up to a full buffer per round trip.
+  // Leave it room to double that, as it would in slow start.
+  uint32 received = m_rcv_nxt - m_rcv_space_seq;
+  m_rcv_space_time = now;
+  m_rcv_space_seq = m_rcv_nxt;
+
+  uint32 new_size = std::min(m_autotune_max, 2 * received);
+  new_size = (new_size >> m_rwnd_scale) << m_rwnd_scale;
+  if (new_size <= m_rbuf_len) {
+    return;
+  }
+
+  // Out-of-order data written ahead in |m_rbuf| is kept.
+  bool result = m_rbuf.SetCapacity(new_size);
+  ASSERT(result);
+  RTC_UNUSED(result);
+  LOG(LS_VERBOSE) << "Receive buffer " << m_rbuf_len << " -> " << new_size;
+  m_rcv_wnd += new_size - m_rbuf_len;
+  m_rbuf_len = new_size;
+}
+
+void
+PseudoTcp::autotuneSendBuffer() {
+  // Keep room for the data in flight and as much again for the application
+  // to refill while it is acknowledged.
+  uint32 new_size =
+      std::min(m_autotune_max, 2 * std::min(m_cwnd, m_snd_wnd));
+  if (new_size > m_sbuf_len) {
+    LOG(LS_VERBOSE) << "Send buffer " << m_sbuf_len << " -> " << new_size;
+    resizeSendBuffer(new_size);
+  }
+}
+
+uint32
+PseudoTcp::writeSackBlocks(uint8* buf) const {
+  // The receiver never discards data it has SACKed, so the sender's
+  // scoreboard accumulates. Report the lowest blocks, they border the holes
+  // the sender must fill first.
+  uint32 blocks = 0;
+  uint32 left = 0, right = 0;
+  for (RList::const_iterator it = m_rlist.begin(); it != m_rlist.end(); ++it) {
+    if (blocks > 0 && it->seq <= right) {
+      right = std::max(right, it->seq + it->len);
+      long_to_bytes(right, buf + (blocks - 1) * SACK_BLOCK_SIZE + 4);
+      continue;
+    }
+    if (blocks == MAX_SACK_BLOCKS) {
+      break;
+    }
+    left = it->seq;
+    right = it->seq + it->len;
+    long_to_bytes(left, buf + blocks * SACK_BLOCK_SIZE);
+    long_to_bytes(right, buf + blocks * SACK_BLOCK_SIZE + 4);
+    ++blocks;
+  }
+  return blocks * SACK_BLOCK_SIZE;
+}
+
+void
+PseudoTcp::processSack(const Segment& seg) {
+  SList::iterator it = m_slist.begin();
+  uint32 last_right = 0;
+  for (uint32 i = 0; i < seg.sack_blocks; ++i) {
+    uint32 left = bytes_to_long(seg.sack + i * SACK_BLOCK_SIZE);
+    uint32 right = bytes_to_long(seg.sack + i * SACK_BLOCK_SIZE + 4);
+    left = std::max(left, m_snd_una);
+    right = std::min(right, m_snd_nxt);
+    if (left >= right) {
+      continue;
+    }
+    m_sack_high = std::max(m_sack_high, right);
+
+    // Blocks usually come in order; continue where the last one ended.
+    if (left < last_right) {
+      it = m_slist.begin();
+    }
+    last_right = right;
+
+    for (; (it != m_slist.end()) && (it->xmit > 0) && (it->seq < right);
+         ++it) {
+      if (it->bSacked || (it->seq + it->len <= left)) {
+        continue;
+      }
+      if (it->seq < left) {
+        // The block starts inside this segment, the next one is covered.
+        splitSegment(it, left - it->seq);
+        continue;
+      }
+      if (it->seq + it->len > right) {
+        splitSegment(it, right - it->seq);
+      }
+      it->bSacked = true;
+      if (it->bRecoveryXmit) {
+        m_retran_data -= std::min(m_retran_data, it->len);
+      }
+    }
+  }
+}
+
+PseudoTcp::SList::iterator
+PseudoTcp::nextLostSegment() {
+  for (SList::iterator it = m_slist.begin();
+       (it != m_slist.end()) && (it->xmit > 0); ++it) {
+    if (m_rto_recovery) {
+      if (it->seq >= m_recover) {
+        break;
+      }
+    } else if (it->seq + it->len + DUP_THRESH * m_mss > m_sack_high) {
+      break;
+    }
+    if (!it->bSacked && !it->bRecoveryXmit) {
+      return it;
+    }
+  }
+  return m_slist.end();
+}
+
+void
+PseudoTcp::onCongestionEvent() {
+  if (m_congestion_control == CC_CUBIC) {
+    // Fast convergence: release bandwidth when the window keeps shrinking.
+    if (m_cwnd < m_cubic_wmax) {
+      m_cubic_wmax = static_cast<uint32>(m_cwnd * (1 + CUBIC_BETA) / 2);
+    } else {
+      m_cubic_wmax = m_cwnd;
+    }
+    m_cubic_epoch = 0;
+    m_ssthresh = std::max(static_cast<uint32>(m_cwnd * CUBIC_BETA), 2 * m_mss);
+  } else {
+    uint32 nInFlight = m_snd_nxt - m_snd_una;
+    m_ssthresh = std::max(nInFlight / 2, 2 * m_mss);
+  }
+}
+
+void
+PseudoTcp::increaseCongestionWindow(uint32 nAcked, uint32 now) {
+  // Slow start
+  if (m_cwnd < m_ssthresh) {
+    m_cwnd += m_mss;
+    return;
+  }
+
+  // Congestion avoidance
+  if (m_congestion_control != CC_CUBIC) {
+    m_cwnd += std::max<uint32>(1, m_mss * m_mss / m_cwnd);
+    return;
+  }
+
+  if (m_cubic_epoch == 0) {
+    m_cubic_epoch = now;
+    if (m_cwnd < m_cubic_wmax) {
+      m_cubic_k = cbrt((m_cubic_wmax - m_cwnd) / (CUBIC_C * m_mss));
+      m_cubic_origin = m_cubic_wmax;
+    } else {
+      m_cubic_k = 0;
+      m_cubic_origin = m_cwnd;
+    }
+    m_cubic_west = m_cwnd;
+  }
+
+  // The window CUBIC aims for one round trip from now.
+  double t = (rtc::TimeDiff(now, m_cubic_epoch) + m_rx_srtt) / 1000.0;
+  double target = m_cubic_origin +
+      CUBIC_C * (t - m_cubic_k) * (t - m_cubic_k) * (t - m_cubic_k) * m_mss;
+
+  // Grow at least as fast as Reno would with the same reduction.
+  m_cubic_west += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) * m_mss * nAcked /
+                  m_cwnd;
+  target = std::max(target, m_cubic_west);
+
+  // At most 1.5 times the window per round trip.
+  target = std::min(target, 1.5 * m_cwnd);
+  if (target > m_cwnd) {
+    m_cwnd += std::max<uint32>(
+        1, static_cast<uint32>((target - m_cwnd) * nAcked / m_cwnd));
+  } else {
+    m_cwnd += std::max<uint32>(1, m_mss * m_mss / (100 * m_cwnd));
+  }
+}
+
 }  // namespace cricket
@@ -82,13 +82,20 @@ class PseudoTcp {
   // instance's behaviour for the kind of data it will carry.
   // If an unrecognized option is set or got, an assertion will fire.
   //
-  // Setting options for OPT_RCVBUF or OPT_SNDBUF after Connect() is called
-  // will result in an assertion.
+  // Setting options for OPT_RCVBUF, OPT_SNDBUF or OPT_AUTOTUNE_MAX after
+  // Connect() is called will result in an assertion.
   enum Option {
     OPT_NODELAY,      // Whether to enable Nagle's algorithm (0 == off)
     OPT_ACKDELAY,     // The Delayed ACK timeout (0 == off).
     OPT_RCVBUF,       // Set the receive buffer size, in bytes.
     OPT_SNDBUF,       // Set the send buffer size, in bytes.
+    OPT_AUTOTUNE_MAX,  // Grow both buffers on demand up to this size, in
+                       // bytes (0 == off).
+    OPT_CONGESTION_CONTROL,  // One of CongestionControl.
+  };
+  enum CongestionControl {
+    CC_NEWRENO,  // RFC 6582, the default.
+    CC_CUBIC,    // RFC 8312, for paths with a large bandwidth-delay product.
   };
   void GetOption(Option opt, int* value);
   void SetOption(Option opt, int value);
@@ -117,16 +124,24 @@ class PseudoTcp {
     const char * data;
     uint32 len;
     uint32 tsval, tsecr;
+    // SACK blocks, as pairs of left and right edges in network order.
+    const char * sack;
+    uint32 sack_blocks;
   };
 
   struct SSegment {
     SSegment(uint32 s, uint32 l, bool c)
-        : seq(s), len(l), /*tstamp(0),*/ xmit(0), bCtrl(c) {
+        : seq(s), len(l), /*tstamp(0),*/ xmit(0), bCtrl(c), bSacked(false),
+          bRecoveryXmit(false) {
     }
     uint32 seq, len;
     //uint32 tstamp;
     uint8 xmit;
     bool bCtrl;
+    // Selectively acknowledged by the peer.
+    bool bSacked;
+    // Retransmitted during the current SACK recovery.
+    bool bRecoveryXmit;
   };
   typedef std::list<SSegment> SList;
 
@@ -157,6 +172,9 @@ class PseudoTcp {
   bool process(Segment& seg);
   bool transmit(const SList::iterator& seg, uint32 now);
 
+  // Splits |seg| after its first |len| bytes.
+  void splitSegment(const SList::iterator& seg, uint32 len);
+
   void adjustMTU();
 
  protected:
@@ -167,6 +185,10 @@ class PseudoTcp {
   // support for testing backward compatibility.
   void disableWindowScale();
 
+  // This method is only used in tests, to disable SACK support for testing
+  // backward compatibility.
+  void disableSack();
+
  private:
   // Queue the connect message with TCP options.
   void queueConnectMessage();
@@ -187,6 +209,28 @@ class PseudoTcp {
   // window scale factor |m_swnd_scale| accordingly.
   void resizeReceiveBuffer(uint32 new_size);
 
+  // Grow the receive buffer when the peer delivers more than half of it per
+  // round trip, and the send buffer when it can't hold two windows.
+  void autotuneReceiveBuffer(uint32 now, uint32 tsecr);
+  void autotuneSendBuffer();
+
+  // Write the SACK blocks describing |m_rlist| to |buf|. Returns the number
+  // of bytes written.
+  uint32 writeSackBlocks(uint8* buf) const;
+
+  // Mark the segments covered by the SACK blocks in |seg|.
+  void processSack(const Segment& seg);
+
+  // Returns the first segment to retransmit during SACK recovery, or
+  // m_slist.end().
+  SList::iterator nextLostSegment();
+
+  // Set the slow start threshold after a loss.
+  void onCongestionEvent();
+
+  // Open the congestion window for |nAcked| newly acknowledged bytes.
+  void increaseCongestionWindow(uint32 nAcked, uint32 now);
+
   IPseudoTcpNotify* m_notify;
   enum Shutdown { SD_NONE, SD_GRACEFUL, SD_FORCEFUL } m_shutdown;
   int m_error;
@@ -204,6 +248,10 @@ class PseudoTcp {
   uint8 m_rwnd_scale;  // Window scale factor.
   rtc::FifoBuffer m_rbuf;
 
+  // Receive buffer auto-tuning: round-trip time as seen by the receiver, and
+  // the start of the current measurement.
+  uint32 m_rcv_rtt, m_rcv_space_seq, m_rcv_space_time;
+
   // Outgoing data
   SList m_slist;
   uint32 m_sbuf_len, m_snd_nxt, m_snd_wnd, m_lastsend, m_snd_una;
@@ -223,17 +271,33 @@ class PseudoTcp {
 
   // Congestion avoidance, Fast retransmit/recovery, Delayed ACKs
   uint32 m_ssthresh, m_cwnd;
-  uint8 m_dup_acks;
+  uint32 m_dup_acks;
   uint32 m_recover;
   uint32 m_t_ack;
 
+  // SACK recovery: the highest SACKed sequence number, the bytes
+  // retransmitted and not yet acknowledged, and whether a retransmit timeout
+  // made everything outstanding count as lost.
+  bool m_use_sack;
+  uint32 m_sack_high, m_retran_data;
+  bool m_rto_recovery;
+
+  // CUBIC state: the window before the last reduction, the start, origin and
+  // inflection time (in seconds) of the current growth epoch, and the window
+  // Reno would have reached in the same time.
+  uint32 m_cubic_wmax, m_cubic_epoch, m_cubic_origin;
+  double m_cubic_k, m_cubic_west;
+
   // Configuration options
   bool m_use_nagling;
   uint32 m_ack_delay;
+  uint32 m_autotune_max;
+  CongestionControl m_congestion_control;
 
-  // This is used by unit tests to test backward compatibility of
-  // PseudoTcp implementations that don't support window scaling.
+  // These are used by unit tests to test backward compatibility of
+  // PseudoTcp implementations that don't support window scaling or SACK.
   bool m_support_wnd_scale;
+  bool m_support_sack;
 };
 
 }  // namespace cricket
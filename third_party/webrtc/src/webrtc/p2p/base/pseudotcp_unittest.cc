@@ -38,6 +38,10 @@ class PseudoTcpForTest : public cricket::PseudoTcp {
   void disableWindowScale() {
     PseudoTcp::disableWindowScale();
   }
+
+  void disableSack() {
+    PseudoTcp::disableSack();
+  }
 };
 
 class PseudoTcpTestBase : public testing::Test,
@@ -98,6 +102,20 @@ class PseudoTcpTestBase : public testing::Test,
   void DisableLocalWindowScale() {
     local_.disableWindowScale();
   }
+  void DisableRemoteSack() {
+    remote_.disableSack();
+  }
+  void SetOptAutotuneMax(int size) {
+    local_.SetOption(PseudoTcp::OPT_AUTOTUNE_MAX, size);
+    remote_.SetOption(PseudoTcp::OPT_AUTOTUNE_MAX, size);
+  }
+  void SetLocalOptAutotuneMax(int size) {
+    local_.SetOption(PseudoTcp::OPT_AUTOTUNE_MAX, size);
+  }
+  void SetOptCongestionControl(PseudoTcp::CongestionControl cc) {
+    local_.SetOption(PseudoTcp::OPT_CONGESTION_CONTROL, cc);
+    remote_.SetOption(PseudoTcp::OPT_CONGESTION_CONTROL, cc);
+  }
 
  protected:
   int Connect() {
@@ -725,6 +743,84 @@ TEST_F(PseudoTcpTest, TestSendVerySmallReceiveBuffer) {
   TestTransfer(100000);
 }
 
+// Test a receive buffer that grows with the bandwidth-delay product.
+TEST_F(PseudoTcpTest, TestSendWithAutotune) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  SetOptAutotuneMax(4 * 1024 * 1024);
+  TestTransfer(1000000);
+  int rcvbuf = 0;
+  remote_.GetOption(PseudoTcp::OPT_RCVBUF, &rcvbuf);
+  EXPECT_GT(rcvbuf, 60 * 1024);
+}
+
+// Test auto-tuning with a receiver that doesn't support scaling.
+TEST_F(PseudoTcpTest, TestSendWithAutotuneRemoteNoWindowScale) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetLocalOptAutotuneMax(4 * 1024 * 1024);
+  DisableRemoteWindowScale();
+  TestTransfer(1000000);
+}
+
+// Test loss recovery with a peer that doesn't support SACK.
+TEST_F(PseudoTcpTest, TestSendWithLossRemoteNoSack) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetLoss(10);
+  DisableRemoteSack();
+  TestTransfer(100000);
+}
+
+// Test sending data with 10% packet loss using CUBIC.
+TEST_F(PseudoTcpTest, TestSendWithLossAndCubic) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  SetLoss(10);
+  SetOptCongestionControl(PseudoTcp::CC_CUBIC);
+  TestTransfer(100000);
+}
+
+// Throughput benchmarks over a link with 50 ms delay each way. Compare the
+// logged rates with the default buffers and NewReno against auto-tuned
+// buffers and CUBIC, with and without 1% loss. Loss caps both at a few
+// Mbps, so less data is sent there.
+TEST_F(PseudoTcpTest, TestThroughputDefault) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  TestTransfer(2000000);
+}
+
+TEST_F(PseudoTcpTest, TestThroughputAutotuneAndCubic) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  SetOptAutotuneMax(4 * 1024 * 1024);
+  SetOptCongestionControl(PseudoTcp::CC_CUBIC);
+  TestTransfer(2000000);
+}
+
+TEST_F(PseudoTcpTest, TestThroughputDefaultWithLoss) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  SetLoss(1);
+  TestTransfer(1000000);
+}
+
+TEST_F(PseudoTcpTest, TestThroughputAutotuneAndCubicWithLoss) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetDelay(50);
+  SetLoss(1);
+  SetOptAutotuneMax(4 * 1024 * 1024);
+  SetOptCongestionControl(PseudoTcp::CC_CUBIC);
+  TestTransfer(1000000);
+}
+
 // Ping-pong (request/response) tests
 
 // Test sending <= 1x MTU of data in each ping/pong.  Should take <10ms.
@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/p2p/base/servershards.h"
+
+#include "webrtc/base/bind.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/physicalsocketserver.h"
+
+namespace cricket {
+
+ServerShards::ServerShards(int num_shards, const char* name) : name_(name) {
+  ASSERT(num_shards > 0);
+  for (int i = 0; i < num_shards; ++i) {
+    Shard* shard = new Shard();
+    shard->socket_server.reset(new rtc::PhysicalSocketServer(
+        rtc::PhysicalSocketServer::WAIT_EPOLL));
+    shard->thread.reset(new rtc::Thread(shard->socket_server.get()));
+    shard->thread->SetName(name_, shard);
+    shard->thread->Start();
+    shards_.push_back(shard);
+  }
+}
+
+ServerShards::~ServerShards() {
+  for (Shard* shard : shards_) {
+    shard->thread->Stop();
+    delete shard;
+  }
+}
+
+rtc::SocketAddress ServerShards::Listen(const rtc::SocketAddress& address,
+                                        int type,
+                                        const AdoptSocketCallback& adopt) {
+  bool reuse_port = size() > 1;
+  rtc::SocketAddress bound_address;
+  if (!thread(0)->Invoke<bool>(rtc::Bind(&ServerShards::BindSocket, this, 0,
+                                         address, type, reuse_port, adopt,
+                                         &bound_address))) {
+    return rtc::SocketAddress();
+  }
+
+  // The other shards join the first one on the same address, including the
+  // port it picked.
+  for (int i = 1; i < size(); ++i) {
+    rtc::SocketAddress shard_address;
+    if (!thread(i)->Invoke<bool>(rtc::Bind(&ServerShards::BindSocket, this, i,
+                                           bound_address, type, reuse_port,
+                                           adopt, &shard_address))) {
+      LOG(LS_WARNING) << "Only " << i << " of " << size() << " " << name_
+                      << " threads listen on " << bound_address.ToString();
+      break;
+    }
+  }
+  return bound_address;
+}
+
+bool ServerShards::BindSocket(int index,
+                              const rtc::SocketAddress& address,
+                              int type,
+                              bool reuse_port,
+                              AdoptSocketCallback adopt,
+                              rtc::SocketAddress* bound_address) {
+  rtc::scoped_ptr<rtc::AsyncSocket> socket(
+      shards_[index]->socket_server->CreateAsyncSocket(address.family(),
+                                                       type));
+  if (!socket ||
+      (reuse_port && socket->SetOption(rtc::Socket::OPT_REUSEPORT, 1) != 0) ||
+      socket->Bind(address) != 0) {
+    return false;
+  }
+  *bound_address = socket->GetLocalAddress();
+  return adopt(index, socket.release());
+}
+
+}  // namespace cricket
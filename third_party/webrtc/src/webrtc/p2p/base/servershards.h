@@ -0,0 +1,73 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_P2P_BASE_SERVERSHARDS_H_
+#define WEBRTC_P2P_BASE_SERVERSHARDS_H_
+
+#include <vector>
+
+#include "webrtc/base/asyncsocket.h"
+#include "webrtc/base/callback.h"
+#include "webrtc/base/constructormagic.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/socketaddress.h"
+#include "webrtc/base/socketserver.h"
+#include "webrtc/base/thread.h"
+
+namespace cricket {
+
+// The threads of a server that is spread over several cores. Every shard
+// binds the same addresses with SO_REUSEPORT and the kernel hashes each
+// client's 5-tuple to one of them, so the shards share no state. Each shard
+// may serve thousands of sockets, so it waits with epoll where available.
+class ServerShards {
+ public:
+  // Called on the shard's thread with the index of the shard and a socket
+  // bound to the shared address. Takes ownership of the socket and returns
+  // false if it can't be used.
+  typedef rtc::Callback2<bool, int, rtc::AsyncSocket*> AdoptSocketCallback;
+
+  // |name| is used for the threads and in log messages.
+  ServerShards(int num_shards, const char* name);
+  // Stops the threads. Anything running on them must be destroyed first.
+  ~ServerShards();
+
+  int size() const { return static_cast<int>(shards_.size()); }
+  rtc::Thread* thread(int index) const { return shards_[index]->thread.get(); }
+
+  // Binds a socket of |type| to |address| on every shard that can share it
+  // and hands it to |adopt|. With port 0, all shards get the port picked for
+  // the first one. Where SO_REUSEPORT isn't available only the first shard
+  // listens. Returns the bound address, or a nil address if the first shard
+  // failed.
+  rtc::SocketAddress Listen(const rtc::SocketAddress& address,
+                            int type,
+                            const AdoptSocketCallback& adopt);
+
+ private:
+  struct Shard {
+    rtc::scoped_ptr<rtc::SocketServer> socket_server;
+    rtc::scoped_ptr<rtc::Thread> thread;
+  };
+
+  // Runs on the shard's thread.
+  bool BindSocket(int index, const rtc::SocketAddress& address, int type,
+                  bool reuse_port, AdoptSocketCallback adopt,
+                  rtc::SocketAddress* bound_address);
+
+  const char* name_;
+  std::vector<Shard*> shards_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(ServerShards);
+};
+
+}  // namespace cricket
+
+#endif  // WEBRTC_P2P_BASE_SERVERSHARDS_H_
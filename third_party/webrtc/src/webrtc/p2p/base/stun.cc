@@ -12,12 +12,14 @@
 
 #include <string.h>
 
+#include <algorithm>
+
 #include "webrtc/base/byteorder.h"
 #include "webrtc/base/common.h"
 #include "webrtc/base/crc32.h"
+#include "webrtc/base/hmacsha1.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/messagedigest.h"
-#include "webrtc/base/scoped_ptr.h"
 #include "webrtc/base/stringencode.h"
 
 using rtc::ByteBuffer;
@@ -47,13 +49,11 @@ StunMessage::StunMessage()
       length_(0),
       transaction_id_(EMPTY_TRANSACTION_ID) {
   ASSERT(IsValidTransactionId(transaction_id_));
-  attrs_ = new std::vector<StunAttribute*>();
 }
 
 StunMessage::~StunMessage() {
-  for (size_t i = 0; i < attrs_->size(); i++)
-    delete (*attrs_)[i];
-  delete attrs_;
+  for (size_t i = 0; i < attrs_.size(); i++)
+    delete attrs_[i];
 }
 
 bool StunMessage::IsLegacy() const {
@@ -76,7 +76,7 @@ bool StunMessage::AddAttribute(StunAttribute* attr) {
   if (attr->value_type() != GetAttributeValueType(attr->type())) {
     return false;
   }
-  attrs_->push_back(attr);
+  attrs_.push_back(attr);
   attr->SetOwner(this);
   size_t attr_length = attr->length();
   if (attr_length % 4 != 0) {
@@ -129,8 +129,13 @@ const StunUInt16ListAttribute* StunMessage::GetUnknownAttributes() const {
 // procedure outlined in RFC 5389, section 15.4.
 bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
                                            const std::string& password) {
+  return ValidateMessageIntegrity(data, size, rtc::HmacSha1(password));
+}
+
+bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
+                                           const rtc::HmacSha1& hmac) {
   // Verifying the size of the message.
-  if ((size % 4) != 0) {
+  if ((size % 4) != 0 || size < kStunHeaderSize) {
     return false;
   }
 
@@ -143,7 +148,7 @@ bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
   // Finding Message Integrity attribute in stun message.
   size_t current_pos = kStunHeaderSize;
   bool has_message_integrity_attr = false;
-  while (current_pos < size) {
+  while (current_pos + kStunAttributeHeaderSize <= size) {
     uint16 attr_type, attr_length;
     // Getting attribute type and length.
     attr_type = rtc::GetBE16(&data[current_pos]);
@@ -152,7 +157,7 @@ bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
     // If M-I, sanity check it, and break out.
     if (attr_type == STUN_ATTR_MESSAGE_INTEGRITY) {
       if (attr_length != kStunMessageIntegritySize ||
-          current_pos + attr_length > size) {
+          current_pos + kStunAttributeHeaderSize + attr_length > size) {
         return false;
       }
       has_message_integrity_attr = true;
@@ -170,10 +175,12 @@ bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
     return false;
   }
 
-  // Getting length of the message to calculate Message Integrity.
+  // The HMAC covers the message up to the M-I attribute, with the length in
+  // the header adjusted to end right after M-I. Patch a copy of the header
+  // only; the rest is hashed in place.
   size_t mi_pos = current_pos;
-  rtc::scoped_ptr<char[]> temp_data(new char[current_pos]);
-  memcpy(temp_data.get(), data, current_pos);
+  char header[kStunHeaderSize];
+  memcpy(header, data, kStunHeaderSize);
   if (size > mi_pos + kStunAttributeHeaderSize + kStunMessageIntegritySize) {
     // Stun message has other attributes after message integrity.
     // Adjust the length parameter in stun message to calculate HMAC.
@@ -181,37 +188,35 @@ bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
         (mi_pos + kStunAttributeHeaderSize + kStunMessageIntegritySize);
     size_t new_adjusted_len = size - extra_offset - kStunHeaderSize;
 
-    // Writing new length of the STUN message @ Message Length in temp buffer.
+    // Writing new length of the STUN message @ Message Length in the header.
     //      0                   1                   2                   3
     //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
     //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     //     |0 0|     STUN Message Type     |         Message Length        |
     //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    rtc::SetBE16(temp_data.get() + 2,
-                       static_cast<uint16>(new_adjusted_len));
+    rtc::SetBE16(header + 2, static_cast<uint16>(new_adjusted_len));
   }
 
-  char hmac[kStunMessageIntegritySize];
-  size_t ret = rtc::ComputeHmac(rtc::DIGEST_SHA_1,
-                                      password.c_str(), password.size(),
-                                      temp_data.get(), mi_pos,
-                                      hmac, sizeof(hmac));
-  ASSERT(ret == sizeof(hmac));
-  if (ret != sizeof(hmac))
-    return false;
+  char computed[kStunMessageIntegritySize];
+  hmac.Compute(header, kStunHeaderSize, data + kStunHeaderSize,
+               mi_pos - kStunHeaderSize, computed);
 
   // Comparing the calculated HMAC with the one present in the message.
   return memcmp(data + current_pos + kStunAttributeHeaderSize,
-                hmac,
-                sizeof(hmac)) == 0;
+                computed,
+                sizeof(computed)) == 0;
 }
 
 bool StunMessage::AddMessageIntegrity(const std::string& password) {
-  return AddMessageIntegrity(password.c_str(), password.size());
+  return AddMessageIntegrity(rtc::HmacSha1(password));
 }
 
 bool StunMessage::AddMessageIntegrity(const char* key,
                                       size_t keylen) {
+  return AddMessageIntegrity(rtc::HmacSha1(key, keylen));
+}
+
+bool StunMessage::AddMessageIntegrity(const rtc::HmacSha1& hmac) {
   // Add the attribute with a dummy value. Since this is a known attribute, it
   // can't fail.
   StunByteStringAttribute* msg_integrity_attr =
@@ -224,22 +229,13 @@ bool StunMessage::AddMessageIntegrity(const char* key,
   if (!Write(&buf))
     return false;
 
-  int msg_len_for_hmac = static_cast<int>(
-      buf.Length() - kStunAttributeHeaderSize - msg_integrity_attr->length());
-  char hmac[kStunMessageIntegritySize];
-  size_t ret = rtc::ComputeHmac(rtc::DIGEST_SHA_1,
-                                      key, keylen,
-                                      buf.Data(), msg_len_for_hmac,
-                                      hmac, sizeof(hmac));
-  ASSERT(ret == sizeof(hmac));
-  if (ret != sizeof(hmac)) {
-    LOG(LS_ERROR) << "HMAC computation failed. Message-Integrity "
-                  << "has dummy value.";
-    return false;
-  }
+  size_t msg_len_for_hmac =
+      buf.Length() - kStunAttributeHeaderSize - msg_integrity_attr->length();
+  char computed[kStunMessageIntegritySize];
+  hmac.Compute(buf.Data(), msg_len_for_hmac, computed);
 
   // Insert correct HMAC into the attribute.
-  msg_integrity_attr->CopyBytes(hmac, sizeof(hmac));
+  msg_integrity_attr->CopyBytes(computed, sizeof(computed));
   return true;
 }
 
@@ -328,7 +324,7 @@ bool StunMessage::Read(ByteBuffer* buf) {
   if (length_ != buf->Length())
     return false;
 
-  attrs_->resize(0);
+  attrs_.resize(0);
 
   size_t rest = buf->Length() - length_;
   while (buf->Length() > rest) {
@@ -349,7 +345,7 @@ bool StunMessage::Read(ByteBuffer* buf) {
     } else {
       if (!attr->Read(buf))
         return false;
-      attrs_->push_back(attr);
+      attrs_.push_back(attr);
     }
   }
 
@@ -364,10 +360,10 @@ bool StunMessage::Write(ByteBuffer* buf) const {
     buf->WriteUInt32(kStunMagicCookie);
   buf->WriteString(transaction_id_);
 
-  for (size_t i = 0; i < attrs_->size(); ++i) {
-    buf->WriteUInt16((*attrs_)[i]->type());
-    buf->WriteUInt16(static_cast<uint16>((*attrs_)[i]->length()));
-    if (!(*attrs_)[i]->Write(buf))
+  for (size_t i = 0; i < attrs_.size(); ++i) {
+    buf->WriteUInt16(attrs_[i]->type());
+    buf->WriteUInt16(static_cast<uint16>(attrs_[i]->length()));
+    if (!attrs_[i]->Write(buf))
       return false;
   }
 
@@ -400,9 +396,9 @@ StunAttribute* StunMessage::CreateAttribute(int type, size_t length) /*const*/ {
 }
 
 const StunAttribute* StunMessage::GetAttribute(int type) const {
-  for (size_t i = 0; i < attrs_->size(); ++i) {
-    if ((*attrs_)[i]->type() == type)
-      return (*attrs_)[i];
+  for (size_t i = 0; i < attrs_.size(); ++i) {
+    if (attrs_[i]->type() == type)
+      return attrs_[i];
   }
   return NULL;
 }
@@ -864,6 +860,342 @@ bool StunUInt16ListAttribute::Write(ByteBuffer* buf) const {
   return true;
 }
 
+// StunMessageView
+
+// The magic cookie in network byte order, used to XOR addresses.
+static const uint8 kStunMagicCookieBytes[kStunMagicCookieLength] = {
+  0x21, 0x12, 0xA4, 0x42
+};
+
+// An address attribute starts with a reserved byte, the family and the port.
+static const size_t kStunAddressHeaderSize = 4;
+
+const size_t StunMessageView::kMaxAttributes;
+
+StunMessageView::StunMessageView()
+    : data_(NULL), size_(0), type_(0), legacy_(false), num_attrs_(0) {
+}
+
+bool StunMessageView::Parse(const char* data, size_t size) {
+  data_ = NULL;
+  size_ = 0;
+  num_attrs_ = 0;
+
+  if (size < kStunHeaderSize)
+    return false;
+  uint16 type = rtc::GetBE16(data);
+  if (type & 0x8000) {
+    // RTP or RTCP, see StunMessage::Read().
+    return false;
+  }
+  if (rtc::GetBE16(data + 2) + kStunHeaderSize != size)
+    return false;
+
+  size_t pos = kStunHeaderSize;
+  while (pos < size) {
+    if (size - pos < kStunAttributeHeaderSize || num_attrs_ == kMaxAttributes)
+      return false;
+    Attribute& attr = attrs_[num_attrs_];
+    attr.type = rtc::GetBE16(data + pos);
+    attr.length = rtc::GetBE16(data + pos + 2);
+    pos += kStunAttributeHeaderSize;
+    if (size - pos < attr.length)
+      return false;
+    attr.offset = static_cast<uint32>(pos);
+    ++num_attrs_;
+    // Like StunMessage::Read(), accept a missing padding at the end.
+    size_t padded_length = (attr.length + 3) & ~3;
+    pos += std::min(padded_length, size - pos);
+  }
+
+  data_ = data;
+  size_ = size;
+  type_ = type;
+  legacy_ = (rtc::GetBE32(data + 4) != kStunMagicCookie);
+  return true;
+}
+
+const char* StunMessageView::transaction_id() const {
+  return data_ + (legacy_ ? 4 : kStunTransactionIdOffset);
+}
+
+size_t StunMessageView::transaction_id_length() const {
+  return legacy_ ? kStunLegacyTransactionIdLength : kStunTransactionIdLength;
+}
+
+std::string StunMessageView::transaction_id_string() const {
+  return std::string(transaction_id(), transaction_id_length());
+}
+
+const StunMessageView::Attribute* StunMessageView::FindAttribute(
+    int type) const {
+  for (size_t i = 0; i < num_attrs_; ++i) {
+    if (attrs_[i].type == type)
+      return &attrs_[i];
+  }
+  return NULL;
+}
+
+bool StunMessageView::GetAttribute(int type, const char** value,
+                                   size_t* length) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr)
+    return false;
+  *value = data_ + attr->offset;
+  *length = attr->length;
+  return true;
+}
+
+bool StunMessageView::GetUInt32(int type, uint32* value) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr || attr->length != StunUInt32Attribute::SIZE)
+    return false;
+  *value = rtc::GetBE32(data_ + attr->offset);
+  return true;
+}
+
+bool StunMessageView::GetUInt64(int type, uint64* value) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr || attr->length != StunUInt64Attribute::SIZE)
+    return false;
+  *value = rtc::GetBE64(data_ + attr->offset);
+  return true;
+}
+
+bool StunMessageView::GetAddress(int type, rtc::SocketAddress* addr) const {
+  const Attribute* attr = FindAttribute(type);
+  // The family and port come first; the family's address length is checked
+  // below, before the address is read.
+  if (!attr || attr->length < kStunAddressHeaderSize)
+    return false;
+  const char* value = data_ + attr->offset;
+  uint16 port = rtc::GetBE16(value + 2);
+  if (value[1] == STUN_ADDRESS_IPV4 &&
+      attr->length == StunAddressAttribute::SIZE_IP4) {
+    in_addr v4addr;
+    memcpy(&v4addr, value + 4, sizeof(v4addr));
+    addr->SetIP(rtc::IPAddress(v4addr));
+  } else if (value[1] == STUN_ADDRESS_IPV6 &&
+             attr->length == StunAddressAttribute::SIZE_IP6) {
+    in6_addr v6addr;
+    memcpy(&v6addr, value + 4, sizeof(v6addr));
+    addr->SetIP(rtc::IPAddress(v6addr));
+  } else {
+    return false;
+  }
+  addr->SetPort(port);
+  return true;
+}
+
+bool StunMessageView::GetXorAddress(int type, rtc::SocketAddress* addr) const {
+  const Attribute* attr = FindAttribute(type);
+  // The family and port come first; the family's address length is checked
+  // below, before the address is read.
+  if (!attr || attr->length < kStunAddressHeaderSize)
+    return false;
+  const char* value = data_ + attr->offset;
+  uint16 port = rtc::GetBE16(value + 2) ^ (kStunMagicCookie >> 16);
+  if (value[1] == STUN_ADDRESS_IPV4 &&
+      attr->length == StunAddressAttribute::SIZE_IP4) {
+    uint8 bytes[4];
+    for (size_t i = 0; i < sizeof(bytes); ++i)
+      bytes[i] = value[4 + i] ^ kStunMagicCookieBytes[i];
+    in_addr v4addr;
+    memcpy(&v4addr, bytes, sizeof(v4addr));
+    addr->SetIP(rtc::IPAddress(v4addr));
+  } else if (value[1] == STUN_ADDRESS_IPV6 &&
+             attr->length == StunAddressAttribute::SIZE_IP6 && !legacy_) {
+    // XORed with the magic cookie and the transaction ID, which follow each
+    // other in the header.
+    uint8 bytes[16];
+    for (size_t i = 0; i < sizeof(bytes); ++i)
+      bytes[i] = value[4 + i] ^ data_[4 + i];
+    in6_addr v6addr;
+    memcpy(&v6addr, bytes, sizeof(v6addr));
+    addr->SetIP(rtc::IPAddress(v6addr));
+  } else {
+    return false;
+  }
+  addr->SetPort(port);
+  return true;
+}
+
+bool StunMessageView::ValidateMessageIntegrity(
+    const std::string& password) const {
+  return ValidateMessageIntegrity(rtc::HmacSha1(password));
+}
+
+bool StunMessageView::ValidateMessageIntegrity(
+    const rtc::HmacSha1& hmac) const {
+  return data_ && StunMessage::ValidateMessageIntegrity(data_, size_, hmac);
+}
+
+bool StunMessageView::ValidateFingerprint() const {
+  return data_ && StunMessage::ValidateFingerprint(data_, size_);
+}
+
+// StunMessageBuilder
+
+StunMessageBuilder::StunMessageBuilder(char* buf, size_t capacity, int type,
+                                       const char* transaction_id,
+                                       size_t transaction_id_length)
+    : buf_(buf),
+      capacity_(capacity),
+      length_(kStunHeaderSize),
+      legacy_(transaction_id_length == kStunLegacyTransactionIdLength),
+      ok_(true) {
+  if (capacity_ < kStunHeaderSize ||
+      (!legacy_ && transaction_id_length != kStunTransactionIdLength)) {
+    ASSERT(capacity_ >= kStunHeaderSize);
+    ok_ = false;
+    return;
+  }
+  rtc::SetBE16(buf_, static_cast<uint16>(type));
+  rtc::SetBE16(buf_ + 2, 0);
+  if (legacy_) {
+    memcpy(buf_ + 4, transaction_id, kStunLegacyTransactionIdLength);
+  } else {
+    rtc::SetBE32(buf_ + 4, kStunMagicCookie);
+    memcpy(buf_ + kStunTransactionIdOffset, transaction_id,
+           kStunTransactionIdLength);
+  }
+}
+
+char* StunMessageBuilder::AddAttribute(int type, size_t length) {
+  size_t padded_length = (length + 3) & ~3;
+  size_t needed = kStunAttributeHeaderSize + padded_length;
+  if (!ok_ || capacity_ - length_ < needed ||
+      length_ + needed - kStunHeaderSize > 0xffff) {
+    ok_ = false;
+    return NULL;
+  }
+  char* attr = buf_ + length_;
+  rtc::SetBE16(attr, static_cast<uint16>(type));
+  rtc::SetBE16(attr + 2, static_cast<uint16>(length));
+  memset(attr + kStunAttributeHeaderSize + length, 0, padded_length - length);
+  length_ += needed;
+  rtc::SetBE16(buf_ + 2, static_cast<uint16>(length_ - kStunHeaderSize));
+  return attr + kStunAttributeHeaderSize;
+}
+
+bool StunMessageBuilder::AddUInt32(int type, uint32 value) {
+  char* p = AddAttribute(type, StunUInt32Attribute::SIZE);
+  if (!p)
+    return false;
+  rtc::SetBE32(p, value);
+  return true;
+}
+
+bool StunMessageBuilder::AddUInt64(int type, uint64 value) {
+  char* p = AddAttribute(type, StunUInt64Attribute::SIZE);
+  if (!p)
+    return false;
+  rtc::SetBE64(p, value);
+  return true;
+}
+
+bool StunMessageBuilder::AddByteString(int type, const char* value,
+                                       size_t length) {
+  char* p = AddAttribute(type, length);
+  if (!p)
+    return false;
+  memcpy(p, value, length);
+  return true;
+}
+
+bool StunMessageBuilder::AddAddress(int type, const rtc::SocketAddress& addr) {
+  char* p;
+  switch (addr.family()) {
+    case AF_INET: {
+      p = AddAttribute(type, StunAddressAttribute::SIZE_IP4);
+      if (!p)
+        return false;
+      p[1] = STUN_ADDRESS_IPV4;
+      in_addr v4addr = addr.ipaddr().ipv4_address();
+      memcpy(p + 4, &v4addr, sizeof(v4addr));
+      break;
+    }
+    case AF_INET6: {
+      p = AddAttribute(type, StunAddressAttribute::SIZE_IP6);
+      if (!p)
+        return false;
+      p[1] = STUN_ADDRESS_IPV6;
+      in6_addr v6addr = addr.ipaddr().ipv6_address();
+      memcpy(p + 4, &v6addr, sizeof(v6addr));
+      break;
+    }
+    default:
+      LOG(LS_ERROR) << "Error writing address attribute: unknown family.";
+      ok_ = false;
+      return false;
+  }
+  p[0] = 0;
+  rtc::SetBE16(p + 2, addr.port());
+  return true;
+}
+
+bool StunMessageBuilder::AddXorAddress(int type,
+                                       const rtc::SocketAddress& addr) {
+  if (addr.family() == AF_INET6 && legacy_) {
+    // There's no transaction ID to XOR with.
+    ok_ = false;
+    return false;
+  }
+  if (!AddAddress(type, addr))
+    return false;
+  // XOR what AddAddress() wrote. For IPv6 the magic cookie and transaction
+  // ID follow each other in the header.
+  char* value = buf_ + length_ - (addr.family() == AF_INET ?
+      StunAddressAttribute::SIZE_IP4 : StunAddressAttribute::SIZE_IP6);
+  rtc::SetBE16(value + 2, addr.port() ^ (kStunMagicCookie >> 16));
+  if (addr.family() == AF_INET) {
+    for (size_t i = 0; i < 4; ++i)
+      value[4 + i] ^= kStunMagicCookieBytes[i];
+  } else {
+    for (size_t i = 0; i < 16; ++i)
+      value[4 + i] ^= buf_[4 + i];
+  }
+  return true;
+}
+
+bool StunMessageBuilder::AddErrorCode(int code, const char* reason) {
+  size_t reason_length = strlen(reason);
+  char* p = AddAttribute(STUN_ATTR_ERROR_CODE,
+                         StunErrorCodeAttribute::MIN_SIZE + reason_length);
+  if (!p)
+    return false;
+  p[0] = 0;
+  p[1] = 0;
+  p[2] = static_cast<char>(code / 100);
+  p[3] = static_cast<char>(code % 100);
+  memcpy(p + StunErrorCodeAttribute::MIN_SIZE, reason, reason_length);
+  return true;
+}
+
+bool StunMessageBuilder::AddMessageIntegrity(const char* key, size_t keylen) {
+  return AddMessageIntegrity(rtc::HmacSha1(key, keylen));
+}
+
+bool StunMessageBuilder::AddMessageIntegrity(const rtc::HmacSha1& hmac) {
+  char* p = AddAttribute(STUN_ATTR_MESSAGE_INTEGRITY,
+                         kStunMessageIntegritySize);
+  if (!p)
+    return false;
+  // The HMAC covers everything before the attribute, with the length in the
+  // header already including it.
+  hmac.Compute(buf_, p - kStunAttributeHeaderSize - buf_, p);
+  return true;
+}
+
+bool StunMessageBuilder::AddFingerprint() {
+  char* p = AddAttribute(STUN_ATTR_FINGERPRINT, StunUInt32Attribute::SIZE);
+  if (!p)
+    return false;
+  uint32 crc = rtc::ComputeCrc32(buf_, p - kStunAttributeHeaderSize - buf_);
+  rtc::SetBE32(p, crc ^ STUN_FINGERPRINT_XOR_VALUE);
+  return true;
+}
+
 int GetStunSuccessResponseType(int req_type) {
   return IsStunRequestType(req_type) ? (req_type | 0x100) : -1;
 }
@@ -19,6 +19,8 @@
 
 #include "webrtc/base/basictypes.h"
 #include "webrtc/base/bytebuffer.h"
+#include "webrtc/base/constructormagic.h"
+#include "webrtc/base/hmacsha1.h"
 #include "webrtc/base/socketaddress.h"
 
 namespace cricket {
@@ -168,9 +170,13 @@ class StunMessage {
   // padding data (which we discard when reading a StunMessage).
   static bool ValidateMessageIntegrity(const char* data, size_t size,
                                        const std::string& password);
+  // Same, with a precomputed key; cheaper when one key checks many messages.
+  static bool ValidateMessageIntegrity(const char* data, size_t size,
+                                       const rtc::HmacSha1& hmac);
   // Adds a MESSAGE-INTEGRITY attribute that is valid for the current message.
   bool AddMessageIntegrity(const std::string& password);
   bool AddMessageIntegrity(const char* key, size_t keylen);
+  bool AddMessageIntegrity(const rtc::HmacSha1& hmac);
 
   // Verifies that a given buffer is STUN by checking for a correct FINGERPRINT.
   static bool ValidateFingerprint(const char* data, size_t size);
@@ -201,7 +207,7 @@ class StunMessage {
   uint16 type_;
   uint16 length_;
   std::string transaction_id_;
-  std::vector<StunAttribute*>* attrs_;
+  std::vector<StunAttribute*> attrs_;
 };
 
 // Base class for all STUN/TURN attributes.
@@ -464,6 +470,104 @@ class StunUInt16ListAttribute : public StunAttribute {
   std::vector<uint16>* attr_types_;
 };
 
+// Parses a STUN message in place, without copying or allocating, for code that
+// handles a lot of STUN traffic and only needs a few attributes. The buffer
+// must outlive the view. Attribute values are not type checked; use
+// StunMessage when the full message is needed.
+class StunMessageView {
+ public:
+  // Messages with more attributes than this fail to parse.
+  static const size_t kMaxAttributes = 32;
+
+  StunMessageView();
+
+  // Parses |size| bytes at |data|. Returns false if they don't hold exactly
+  // one well-formed STUN message (RFC 5389 or RFC 3489).
+  bool Parse(const char* data, size_t size);
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  int type() const { return type_; }
+  bool IsLegacy() const { return legacy_; }
+  // The transaction ID is kStunTransactionIdLength bytes long, or
+  // kStunLegacyTransactionIdLength for legacy messages.
+  const char* transaction_id() const;
+  size_t transaction_id_length() const;
+  std::string transaction_id_string() const;
+  size_t num_attributes() const { return num_attrs_; }
+
+  // Each getter finds the first attribute of |type| and returns false if
+  // there is none or it has the wrong size.
+  bool GetAttribute(int type, const char** value, size_t* length) const;
+  bool GetUInt32(int type, uint32* value) const;
+  bool GetUInt64(int type, uint64* value) const;
+  bool GetAddress(int type, rtc::SocketAddress* addr) const;
+  bool GetXorAddress(int type, rtc::SocketAddress* addr) const;
+
+  // See StunMessage::ValidateMessageIntegrity() and ValidateFingerprint().
+  bool ValidateMessageIntegrity(const std::string& password) const;
+  bool ValidateMessageIntegrity(const rtc::HmacSha1& hmac) const;
+  bool ValidateFingerprint() const;
+
+ private:
+  struct Attribute {
+    uint16 type;
+    uint16 length;
+    // Offset of the value from the start of the message.
+    uint32 offset;
+  };
+
+  const Attribute* FindAttribute(int type) const;
+
+  const char* data_;
+  size_t size_;
+  uint16 type_;
+  bool legacy_;
+  Attribute attrs_[kMaxAttributes];
+  size_t num_attrs_;
+};
+
+// Serializes a STUN message straight into a caller-provided buffer, without
+// allocating. Attributes are written in the order they are added, so
+// AddMessageIntegrity() and AddFingerprint() must come last. Once an
+// attribute doesn't fit, all further calls fail.
+class StunMessageBuilder {
+ public:
+  // Writes the message header. |transaction_id| is |transaction_id_length|
+  // bytes long, either kStunTransactionIdLength or, for a legacy message
+  // without magic cookie, kStunLegacyTransactionIdLength.
+  StunMessageBuilder(char* buf, size_t capacity, int type,
+                     const char* transaction_id, size_t transaction_id_length);
+
+  bool ok() const { return ok_; }
+  const char* data() const { return buf_; }
+  // Number of bytes written so far, or 0 if the builder failed.
+  size_t length() const { return ok_ ? length_ : 0; }
+
+  bool AddUInt32(int type, uint32 value);
+  bool AddUInt64(int type, uint64 value);
+  bool AddByteString(int type, const char* value, size_t length);
+  bool AddAddress(int type, const rtc::SocketAddress& addr);
+  bool AddXorAddress(int type, const rtc::SocketAddress& addr);
+  bool AddErrorCode(int code, const char* reason);
+  bool AddMessageIntegrity(const char* key, size_t keylen);
+  bool AddMessageIntegrity(const rtc::HmacSha1& hmac);
+  bool AddFingerprint();
+
+ private:
+  // Reserves room for an attribute, updates the length in the header and
+  // returns where the value goes, or NULL if it doesn't fit.
+  char* AddAttribute(int type, size_t length);
+
+  char* buf_;
+  size_t capacity_;
+  size_t length_;
+  bool legacy_;
+  bool ok_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(StunMessageBuilder);
+};
+
 // Returns the (successful) response type for the given request type.
 // Returns -1 if |request_type| is not a valid request type.
 int GetStunSuccessResponseType(int request_type);
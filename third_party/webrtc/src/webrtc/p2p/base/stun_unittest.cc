@@ -8,7 +8,9 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "webrtc/p2p/base/stun.h"
 #include "webrtc/base/bytebuffer.h"
@@ -17,6 +19,7 @@
 #include "webrtc/base/messagedigest.h"
 #include "webrtc/base/scoped_ptr.h"
 #include "webrtc/base/socketaddress.h"
+#include "webrtc/base/timeutils.h"
 
 namespace cricket {
 
@@ -1143,6 +1146,15 @@ TEST_F(StunTest, ValidateMessageIntegrity) {
       reinterpret_cast<const char*>(kRfc5769SampleRequest),
       sizeof(kRfc5769SampleRequest),
       "InvalidPassword"));
+  // Same, with a precomputed key.
+  EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(
+      reinterpret_cast<const char*>(kRfc5769SampleRequest),
+      sizeof(kRfc5769SampleRequest),
+      rtc::HmacSha1(kRfc5769SampleMsgPassword)));
+  EXPECT_FALSE(StunMessage::ValidateMessageIntegrity(
+      reinterpret_cast<const char*>(kRfc5769SampleRequest),
+      sizeof(kRfc5769SampleRequest),
+      rtc::HmacSha1("InvalidPassword")));
 
   EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(
       reinterpret_cast<const char*>(kRfc5769SampleResponse),
@@ -1443,4 +1455,296 @@ TEST_F(StunTest, ReadRelayMessage) {
   EXPECT_EQ(0, memcmp(outstring2.c_str(), input, len2));
 }
 
+// Parse the RFC5769 sample request in place.
+TEST_F(StunTest, ViewRfc5769RequestMessage) {
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleRequest),
+                         sizeof(kRfc5769SampleRequest)));
+  EXPECT_EQ(STUN_BINDING_REQUEST, view.type());
+  EXPECT_FALSE(view.IsLegacy());
+  ASSERT_EQ(kStunTransactionIdLength, view.transaction_id_length());
+  EXPECT_EQ(0, memcmp(view.transaction_id(), kRfc5769SampleMsgTransactionId,
+                      kStunTransactionIdLength));
+  EXPECT_EQ(6U, view.num_attributes());
+
+  const char* value;
+  size_t length;
+  ASSERT_TRUE(view.GetAttribute(STUN_ATTR_USERNAME, &value, &length));
+  EXPECT_EQ(kRfc5769SampleMsgUsername, std::string(value, length));
+  ASSERT_TRUE(view.GetAttribute(STUN_ATTR_SOFTWARE, &value, &length));
+  EXPECT_EQ(kRfc5769SampleMsgClientSoftware, std::string(value, length));
+  uint32 fingerprint;
+  ASSERT_TRUE(view.GetUInt32(STUN_ATTR_FINGERPRINT, &fingerprint));
+  EXPECT_EQ(0xe57a3bcf, fingerprint);
+  EXPECT_FALSE(view.GetAttribute(STUN_ATTR_REALM, &value, &length));
+  // SOFTWARE isn't a 32-bit value.
+  EXPECT_FALSE(view.GetUInt32(STUN_ATTR_SOFTWARE, &fingerprint));
+
+  EXPECT_TRUE(view.ValidateMessageIntegrity(kRfc5769SampleMsgPassword));
+  EXPECT_FALSE(view.ValidateMessageIntegrity("InvalidPassword"));
+  EXPECT_TRUE(view.ValidateFingerprint());
+}
+
+TEST_F(StunTest, ViewRfc5769ResponseMessages) {
+  StunMessageView view;
+  rtc::SocketAddress addr;
+  ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleResponse),
+                         sizeof(kRfc5769SampleResponse)));
+  EXPECT_EQ(STUN_BINDING_RESPONSE, view.type());
+  ASSERT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kRfc5769SampleMsgMappedAddress, addr);
+
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kRfc5769SampleResponseIPv6),
+      sizeof(kRfc5769SampleResponseIPv6)));
+  ASSERT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kRfc5769SampleMsgIPv6MappedAddress, addr);
+}
+
+TEST_F(StunTest, ViewAddressAttributes) {
+  StunMessageView view;
+  rtc::SocketAddress addr;
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithIPv4MappedAddress),
+      sizeof(kStunMessageWithIPv4MappedAddress)));
+  ASSERT_TRUE(view.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kTestMessagePort4, addr.port());
+  EXPECT_EQ(rtc::IPAddress(kIPv4TestAddress1), addr.ipaddr());
+
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithIPv6XorMappedAddress),
+      sizeof(kStunMessageWithIPv6XorMappedAddress)));
+  ASSERT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kTestMessagePort1, addr.port());
+  EXPECT_EQ(rtc::IPAddress(kIPv6TestAddress1), addr.ipaddr());
+}
+
+TEST_F(StunTest, ViewFailsOnInvalidMessages) {
+  StunMessageView view;
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithZeroLength),
+      kRealLengthOfInvalidLengthTestCases));
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithSmallLength),
+      kRealLengthOfInvalidLengthTestCases));
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithExcessLength),
+      kRealLengthOfInvalidLengthTestCases));
+  EXPECT_FALSE(view.Parse(reinterpret_cast<const char*>(kRtcpPacket),
+                          sizeof(kRtcpPacket)));
+  // A truncated message.
+  EXPECT_FALSE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleRequest),
+                          sizeof(kRfc5769SampleRequest) - 4));
+}
+
+// Address attributes too short for the family and port are rejected without
+// reading past them.
+TEST_F(StunTest, ViewRejectsShortAddressAttributes) {
+  static const unsigned char kMessage[] = {
+    0x01, 0x01, 0x00, 0x0c,  // binding response, 12 bytes of attributes
+    0x21, 0x12, 0xa4, 0x42,
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c,
+    0x00, 0x01, 0x00, 0x03,  // MAPPED-ADDRESS, 3 bytes
+    0x00, 0x01, 0xff, 0x00,
+    0x00, 0x20, 0x00, 0x00,  // XOR-MAPPED-ADDRESS, empty, at the very end
+  };
+  // A copy of exactly the message's size, so that reading past the end is
+  // caught by memory checkers.
+  std::vector<char> data(kMessage, kMessage + sizeof(kMessage));
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(&data[0], data.size()));
+  rtc::SocketAddress addr;
+  EXPECT_FALSE(view.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+  EXPECT_FALSE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_FALSE(view.GetAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+}
+
+// Builds the same message with StunMessage and StunMessageBuilder.
+static void CheckBuilderMatchesStunMessage(const rtc::SocketAddress& addr) {
+  const std::string transaction_id(
+      reinterpret_cast<const char*>(kRfc5769SampleMsgTransactionId),
+      kStunTransactionIdLength);
+  IceMessage msg;
+  msg.SetType(STUN_BINDING_RESPONSE);
+  msg.SetTransactionID(transaction_id);
+  msg.AddAttribute(
+      new StunByteStringAttribute(STUN_ATTR_SOFTWARE, "test vector"));
+  msg.AddAttribute(new StunUInt32Attribute(STUN_ATTR_RETRANSMIT_COUNT, 3));
+  msg.AddAttribute(
+      new StunUInt64Attribute(STUN_ATTR_ICE_CONTROLLING, 0x0102030405060708ULL));
+  msg.AddAttribute(new StunXorAddressAttribute(STUN_ATTR_XOR_MAPPED_ADDRESS,
+                                               addr));
+  msg.AddAttribute(new StunAddressAttribute(STUN_ATTR_MAPPED_ADDRESS, addr));
+  EXPECT_TRUE(msg.AddMessageIntegrity(kRfc5769SampleMsgPassword));
+  EXPECT_TRUE(msg.AddFingerprint());
+  rtc::ByteBuffer expected;
+  EXPECT_TRUE(msg.Write(&expected));
+
+  char buf[256];
+  StunMessageBuilder builder(buf, sizeof(buf), STUN_BINDING_RESPONSE,
+                             transaction_id.data(), transaction_id.size());
+  EXPECT_TRUE(builder.AddByteString(STUN_ATTR_SOFTWARE, "test vector", 11));
+  EXPECT_TRUE(builder.AddUInt32(STUN_ATTR_RETRANSMIT_COUNT, 3));
+  EXPECT_TRUE(builder.AddUInt64(STUN_ATTR_ICE_CONTROLLING,
+                                0x0102030405060708ULL));
+  EXPECT_TRUE(builder.AddXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, addr));
+  EXPECT_TRUE(builder.AddAddress(STUN_ATTR_MAPPED_ADDRESS, addr));
+  EXPECT_TRUE(builder.AddMessageIntegrity(
+      kRfc5769SampleMsgPassword, strlen(kRfc5769SampleMsgPassword)));
+  EXPECT_TRUE(builder.AddFingerprint());
+  ASSERT_TRUE(builder.ok());
+  ASSERT_EQ(expected.Length(), builder.length());
+  EXPECT_EQ(0, memcmp(expected.Data(), builder.data(), builder.length()));
+}
+
+TEST_F(StunTest, BuilderMatchesStunMessage) {
+  CheckBuilderMatchesStunMessage(kRfc5769SampleMsgMappedAddress);
+  CheckBuilderMatchesStunMessage(kRfc5769SampleMsgIPv6MappedAddress);
+}
+
+TEST_F(StunTest, BuilderErrorCode) {
+  StunMessage msg;
+  msg.SetType(STUN_BINDING_ERROR_RESPONSE);
+  StunErrorCodeAttribute* error_code = StunAttribute::CreateErrorCode();
+  error_code->SetCode(STUN_ERROR_UNAUTHORIZED);
+  error_code->SetReason(STUN_ERROR_REASON_UNAUTHORIZED);
+  msg.AddAttribute(error_code);
+  rtc::ByteBuffer expected;
+  EXPECT_TRUE(msg.Write(&expected));
+
+  char buf[128];
+  StunMessageBuilder builder(buf, sizeof(buf), STUN_BINDING_ERROR_RESPONSE,
+                             msg.transaction_id().data(),
+                             msg.transaction_id().size());
+  EXPECT_TRUE(builder.AddErrorCode(STUN_ERROR_UNAUTHORIZED,
+                                   STUN_ERROR_REASON_UNAUTHORIZED));
+  ASSERT_EQ(expected.Length(), builder.length());
+  EXPECT_EQ(0, memcmp(expected.Data(), builder.data(), builder.length()));
+}
+
+// The builder fails instead of overrunning its buffer.
+TEST_F(StunTest, BuilderOverflow) {
+  const char kTransactionId[] = "0123456789ab";
+  char buf[kStunHeaderSize + 8];
+  StunMessageBuilder builder(buf, sizeof(buf), STUN_BINDING_REQUEST,
+                             kTransactionId, kStunTransactionIdLength);
+  EXPECT_EQ(kStunHeaderSize, builder.length());
+  EXPECT_TRUE(builder.AddUInt32(STUN_ATTR_PRIORITY, 1));
+  EXPECT_FALSE(builder.AddFingerprint());
+  EXPECT_FALSE(builder.ok());
+  EXPECT_EQ(0U, builder.length());
+}
+
+// Compares handling a binding request and building the response with
+// StunMessage and with StunMessageView/StunMessageBuilder.
+TEST_F(StunTest, BindingRequestPerf) {
+  const int kIterations = 20000;
+  const std::string kPassword(kRfc5769SampleMsgPassword);
+  const rtc::SocketAddress kAddr(kRfc5769SampleMsgMappedAddress);
+
+  IceMessage request;
+  request.SetType(STUN_BINDING_REQUEST);
+  request.SetTransactionID("0123456789ab");
+  request.AddAttribute(
+      new StunByteStringAttribute(STUN_ATTR_USERNAME, "abcd:efgh"));
+  request.AddAttribute(new StunUInt32Attribute(STUN_ATTR_PRIORITY, 12345));
+  request.AddAttribute(new StunUInt64Attribute(STUN_ATTR_ICE_CONTROLLING, 1));
+  request.AddMessageIntegrity(kPassword);
+  request.AddFingerprint();
+  rtc::ByteBuffer request_buf;
+  request.Write(&request_buf);
+  const char* data = request_buf.Data();
+  size_t size = request_buf.Length();
+
+  size_t total = 0;
+  uint32 start = rtc::Time();
+  for (int i = 0; i < kIterations; ++i) {
+    IceMessage msg;
+    rtc::ByteBuffer buf(data, size);
+    ASSERT_TRUE(msg.Read(&buf));
+    ASSERT_TRUE(msg.GetByteString(STUN_ATTR_USERNAME) != NULL);
+    ASSERT_TRUE(StunMessage::ValidateMessageIntegrity(data, size, kPassword));
+    StunMessage response;
+    response.SetType(STUN_BINDING_RESPONSE);
+    response.SetTransactionID(msg.transaction_id());
+    response.AddAttribute(
+        new StunXorAddressAttribute(STUN_ATTR_XOR_MAPPED_ADDRESS, kAddr));
+    response.AddMessageIntegrity(kPassword);
+    response.AddFingerprint();
+    rtc::ByteBuffer out;
+    response.Write(&out);
+    total += out.Length();
+  }
+  uint32 message_elapsed = rtc::TimeSince(start);
+
+  start = rtc::Time();
+  for (int i = 0; i < kIterations; ++i) {
+    StunMessageView msg;
+    ASSERT_TRUE(msg.Parse(data, size));
+    const char* username;
+    size_t username_length;
+    ASSERT_TRUE(msg.GetAttribute(STUN_ATTR_USERNAME, &username,
+                                 &username_length));
+    ASSERT_TRUE(msg.ValidateMessageIntegrity(kPassword));
+    char out[128];
+    StunMessageBuilder response(out, sizeof(out), STUN_BINDING_RESPONSE,
+                                msg.transaction_id(),
+                                msg.transaction_id_length());
+    response.AddXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, kAddr);
+    response.AddMessageIntegrity(kPassword.data(), kPassword.size());
+    response.AddFingerprint();
+    total += response.length();
+  }
+  uint32 view_elapsed = rtc::TimeSince(start);
+
+  LOG(LS_INFO) << "StunMessage: "
+               << kIterations * 1000.0 / std::max(message_elapsed, 1U)
+               << " requests/s, view and builder: "
+               << kIterations * 1000.0 / std::max(view_elapsed, 1U)
+               << " requests/s (" << total << " bytes)";
+}
+
+// Validates MESSAGE-INTEGRITY and FINGERPRINT of a typical ~100 byte binding
+// request, keying the HMAC per message and with a precomputed key.
+TEST_F(StunTest, IntegrityAndFingerprintPerf) {
+  const int kIterations = 100000;
+  const std::string kPassword("abcdefghijklmnopqrstuv");
+
+  IceMessage request;
+  request.SetType(STUN_BINDING_REQUEST);
+  request.SetTransactionID("0123456789ab");
+  request.AddAttribute(
+      new StunByteStringAttribute(STUN_ATTR_USERNAME, "abcd:efgh"));
+  request.AddAttribute(new StunUInt32Attribute(STUN_ATTR_PRIORITY, 12345));
+  request.AddAttribute(new StunUInt64Attribute(STUN_ATTR_ICE_CONTROLLING, 1));
+  request.AddAttribute(new StunByteStringAttribute(STUN_ATTR_USE_CANDIDATE));
+  request.AddMessageIntegrity(kPassword);
+  request.AddFingerprint();
+  rtc::ByteBuffer buf;
+  request.Write(&buf);
+  const char* data = buf.Data();
+  size_t size = buf.Length();
+
+  uint32 start = rtc::Time();
+  for (int i = 0; i < kIterations; ++i) {
+    ASSERT_TRUE(StunMessage::ValidateFingerprint(data, size));
+    ASSERT_TRUE(StunMessage::ValidateMessageIntegrity(data, size, kPassword));
+  }
+  uint32 password_elapsed = rtc::TimeSince(start);
+
+  rtc::HmacSha1 hmac(kPassword);
+  start = rtc::Time();
+  for (int i = 0; i < kIterations; ++i) {
+    ASSERT_TRUE(StunMessage::ValidateFingerprint(data, size));
+    ASSERT_TRUE(StunMessage::ValidateMessageIntegrity(data, size, hmac));
+  }
+  uint32 hmac_elapsed = rtc::TimeSince(start);
+
+  LOG(LS_INFO) << size << " byte requests, keyed per message: "
+               << kIterations * 1000.0 / std::max(password_elapsed, 1U)
+               << " checks/s, precomputed key: "
+               << kIterations * 1000.0 / std::max(hmac_elapsed, 1U)
+               << " checks/s";
+}
+
 }  // namespace cricket
@@ -109,6 +109,89 @@ class StunBindingRequest : public StunRequest {
   uint32 start_time_;
 };
 
+StunResultCache::StunResultCache(int ttl_ms)
+    : ttl_(ttl_ms), purge_size_(0) {
+}
+
+StunResultCache::LookupResult StunResultCache::Lookup(
+    const rtc::SocketAddress& local,
+    const rtc::SocketAddress& server,
+    rtc::SocketAddress* mapped) {
+  uint32 now = rtc::Time();
+  EntryMap::iterator it = entries_.find(Key(local, server));
+  if (it != entries_.end() && rtc::TimeIsLater(now, it->second.expires)) {
+    if (it->second.pending) {
+      return kPending;
+    }
+    *mapped = it->second.mapped;
+    return kHit;
+  }
+
+  // Unknown, expired, or the port that was querying went quiet. Hand the
+  // query to the caller.
+  if (it == entries_.end()) {
+    MaybePurge();
+    it = entries_.insert(std::make_pair(Key(local, server), Entry())).first;
+  }
+  it->second.pending = true;
+  it->second.expires = now + kPendingTimeoutMs;
+  return kMiss;
+}
+
+void StunResultCache::AddResult(const rtc::SocketAddress& local,
+                                const rtc::SocketAddress& server,
+                                const rtc::SocketAddress& mapped) {
+  Entry& entry = entries_[Key(local, server)];
+  bool was_pending = entry.pending;
+  entry.pending = false;
+  entry.mapped = mapped;
+  entry.expires = rtc::TimeAfter(ttl_);
+  if (was_pending) {
+    SignalResult(local, server);
+  }
+}
+
+void StunResultCache::AddFailure(const rtc::SocketAddress& local,
+                                 const rtc::SocketAddress& server) {
+  EntryMap::iterator it = entries_.find(Key(local, server));
+  if (it == entries_.end() || !it->second.pending) {
+    // A cached result stays valid until it expires.
+    return;
+  }
+  // Remember the failure too, so that the waiting ports don't all retry.
+  it->second.pending = false;
+  it->second.mapped.Clear();
+  it->second.expires = rtc::TimeAfter(ttl_);
+  SignalResult(local, server);
+}
+
+void StunResultCache::Abandon(const rtc::SocketAddress& local,
+                              const rtc::SocketAddress& server) {
+  EntryMap::iterator it = entries_.find(Key(local, server));
+  if (it == entries_.end() || !it->second.pending) {
+    return;
+  }
+  entries_.erase(it);
+  SignalResult(local, server);
+}
+
+void StunResultCache::MaybePurge() {
+  // Ports with sockets of their own add entries that are never looked up
+  // again, so drop expired entries whenever the map has doubled.
+  if (entries_.size() < purge_size_) {
+    return;
+  }
+  uint32 now = rtc::Time();
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
+    if (!rtc::TimeIsLater(now, it->second.expires)) {
+      entries_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  purge_size_ = std::max<size_t>(64, 2 * entries_.size());
+}
+
 UDPPort::AddressResolver::AddressResolver(
     rtc::PacketSocketFactory* factory)
     : socket_factory_(factory) {}
@@ -174,6 +257,8 @@ UDPPort::UDPPort(rtc::Thread* thread,
       error_(0),
       ready_(false),
       stun_keepalive_delay_(KEEPALIVE_DELAY),
+      stun_result_cache_(NULL),
+      stun_cache_connected_(false),
       emit_localhost_for_anyaddress_(emit_localhost_for_anyaddress) {
   requests_.set_origin(origin);
 }
@@ -195,6 +280,8 @@ UDPPort::UDPPort(rtc::Thread* thread,
       error_(0),
       ready_(false),
       stun_keepalive_delay_(KEEPALIVE_DELAY),
+      stun_result_cache_(NULL),
+      stun_cache_connected_(false),
       emit_localhost_for_anyaddress_(emit_localhost_for_anyaddress) {
   requests_.set_origin(origin);
 }
@@ -217,6 +304,10 @@ bool UDPPort::Init() {
 }
 
 UDPPort::~UDPPort() {
+  // Let ports waiting on our queries ask again.
+  for (const rtc::SocketAddress& server : stun_cache_queries_) {
+    stun_result_cache_->Abandon(stun_cache_local_addr_, server);
+  }
   if (!SharedSocket())
     delete socket_;
 }
@@ -375,6 +466,30 @@ void UDPPort::SendStunBindingRequest(
   } else if (socket_->GetState() == rtc::AsyncPacketSocket::STATE_BOUND) {
     // Check if |server_addr_| is compatible with the port's ip.
     if (IsCompatibleAddress(stun_addr)) {
+      if (stun_result_cache_) {
+        rtc::SocketAddress mapped;
+        switch (stun_result_cache_->Lookup(socket_->GetLocalAddress(),
+                                           stun_addr, &mapped)) {
+          case StunResultCache::kHit:
+            if (mapped.IsNil()) {
+              OnStunBindingOrResolveRequestFailed(stun_addr);
+            } else {
+              OnStunBindingRequestSucceeded(stun_addr, mapped);
+            }
+            return;
+          case StunResultCache::kPending:
+            if (!stun_cache_connected_) {
+              stun_cache_connected_ = true;
+              stun_result_cache_->SignalResult.connect(
+                  this, &UDPPort::OnStunCacheResult);
+            }
+            return;
+          case StunResultCache::kMiss:
+            stun_cache_local_addr_ = socket_->GetLocalAddress();
+            stun_cache_queries_.insert(stun_addr);
+            break;
+        }
+      }
       requests_.Send(new StunBindingRequest(this, true, stun_addr));
     } else {
       // Since we can't send stun messages to the server, we should mark this
@@ -388,6 +503,12 @@ void UDPPort::SendStunBindingRequest(
 void UDPPort::OnStunBindingRequestSucceeded(
     const rtc::SocketAddress& stun_server_addr,
     const rtc::SocketAddress& stun_reflected_addr) {
+  if (stun_cache_queries_.find(stun_server_addr) !=
+          stun_cache_queries_.end()) {
+    // Keep-alive responses refresh the cached result too.
+    stun_result_cache_->AddResult(stun_cache_local_addr_, stun_server_addr,
+                                  stun_reflected_addr);
+  }
   if (bind_request_succeeded_servers_.find(stun_server_addr) !=
           bind_request_succeeded_servers_.end()) {
     return;
@@ -418,6 +539,10 @@ void UDPPort::OnStunBindingRequestSucceeded(
 
 void UDPPort::OnStunBindingOrResolveRequestFailed(
     const rtc::SocketAddress& stun_server_addr) {
+  if (stun_cache_queries_.find(stun_server_addr) !=
+          stun_cache_queries_.end()) {
+    stun_result_cache_->AddFailure(stun_cache_local_addr_, stun_server_addr);
+  }
   if (bind_request_failed_servers_.find(stun_server_addr) !=
           bind_request_failed_servers_.end()) {
     return;
@@ -426,6 +551,21 @@ void UDPPort::OnStunBindingOrResolveRequestFailed(
   MaybeSetPortCompleteOrError();
 }
 
+void UDPPort::OnStunCacheResult(const rtc::SocketAddress& local_addr,
+                                const rtc::SocketAddress& stun_server_addr) {
+  if (local_addr != socket_->GetLocalAddress() ||
+      server_addresses_.find(stun_server_addr) == server_addresses_.end() ||
+      stun_cache_queries_.find(stun_server_addr) !=
+          stun_cache_queries_.end() ||
+      bind_request_succeeded_servers_.find(stun_server_addr) !=
+          bind_request_succeeded_servers_.end() ||
+      bind_request_failed_servers_.find(stun_server_addr) !=
+          bind_request_failed_servers_.end()) {
+    return;
+  }
+  SendStunBindingRequest(stun_server_addr);
+}
+
 void UDPPort::MaybeSetPortCompleteOrError() {
   if (ready_)
     return;
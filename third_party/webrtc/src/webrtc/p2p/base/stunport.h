@@ -11,7 +11,9 @@
 #ifndef WEBRTC_P2P_BASE_STUNPORT_H_
 #define WEBRTC_P2P_BASE_STUNPORT_H_
 
+#include <map>
 #include <string>
+#include <utility>
 
 #include "webrtc/p2p/base/port.h"
 #include "webrtc/p2p/base/stunrequest.h"
@@ -25,6 +27,69 @@ class SignalThread;
 
 namespace cricket {
 
+// Caches server-reflexive addresses by local socket address and STUN server,
+// so that ports on the same local socket, such as the sessions sharing a
+// UDPMux socket, need only one binding request per STUN server. Only one port
+// at a time queries a given server for a given socket; others asking
+// meanwhile are told the query is pending and get the result through
+// SignalResult. Must be used on a single thread.
+class StunResultCache {
+ public:
+  enum LookupResult {
+    // No result; the caller must query the server and report the outcome
+    // with AddResult() or AddFailure().
+    kMiss,
+    // Another port is querying the server.
+    kPending,
+    // |mapped| holds a result younger than the TTL; it is nil if the query
+    // failed.
+    kHit,
+  };
+
+  explicit StunResultCache(int ttl_ms);
+
+  int ttl() const { return ttl_; }
+  void set_ttl(int ttl_ms) { ttl_ = ttl_ms; }
+  size_t size() const { return entries_.size(); }
+
+  LookupResult Lookup(const rtc::SocketAddress& local,
+                      const rtc::SocketAddress& server,
+                      rtc::SocketAddress* mapped);
+  void AddResult(const rtc::SocketAddress& local,
+                 const rtc::SocketAddress& server,
+                 const rtc::SocketAddress& mapped);
+  void AddFailure(const rtc::SocketAddress& local,
+                  const rtc::SocketAddress& server);
+  // Forgets a pending query without a result, e.g. because the port making
+  // it is going away.
+  void Abandon(const rtc::SocketAddress& local,
+               const rtc::SocketAddress& server);
+
+  // Fired with the local and server address when a pending query completes
+  // or is abandoned. Waiting ports should call Lookup() again.
+  sigslot::signal2<const rtc::SocketAddress&,
+                   const rtc::SocketAddress&> SignalResult;
+
+ private:
+  // How long a port may take to report back on a query it was handed.
+  static const int kPendingTimeoutMs = 10 * 1000;
+
+  struct Entry {
+    Entry() : pending(false), expires(0) {}
+    bool pending;
+    rtc::SocketAddress mapped;
+    uint32 expires;
+  };
+  typedef std::pair<rtc::SocketAddress, rtc::SocketAddress> Key;
+  typedef std::map<Key, Entry> EntryMap;
+
+  void MaybePurge();
+
+  int ttl_;
+  EntryMap entries_;
+  size_t purge_size_;
+};
+
 // Communicates using the address on the outside of a NAT.
 class UDPPort : public Port {
  public:
@@ -98,6 +163,12 @@ class UDPPort : public Port {
     return true;
   }
 
+  // Shares binding results with other ports through |cache|, which must
+  // outlive the port.
+  void set_stun_result_cache(StunResultCache* cache) {
+    stun_result_cache_ = cache;
+  }
+
   void set_stun_keepalive_delay(int delay) {
     stun_keepalive_delay_ = delay;
   }
@@ -188,6 +259,8 @@ class UDPPort : public Port {
       const rtc::SocketAddress& stun_reflected_addr);
   void OnStunBindingOrResolveRequestFailed(
       const rtc::SocketAddress& stun_server_addr);
+  void OnStunCacheResult(const rtc::SocketAddress& local_addr,
+                         const rtc::SocketAddress& stun_server_addr);
 
   // Sends STUN requests to the server.
   void OnSendPacket(const void* data, size_t size, StunRequest* req);
@@ -207,6 +280,14 @@ class UDPPort : public Port {
   rtc::scoped_ptr<AddressResolver> resolver_;
   bool ready_;
   int stun_keepalive_delay_;
+  StunResultCache* stun_result_cache_;
+  // Servers this port queries on behalf of |stun_result_cache_|, and the
+  // local address it queries from; a shared socket may be gone by the time
+  // the port is destroyed.
+  ServerAddresses stun_cache_queries_;
+  rtc::SocketAddress stun_cache_local_addr_;
+  // Set once the port waits for another port's query.
+  bool stun_cache_connected_;
 
   // This is true when PORTALLOCATOR_ENABLE_LOCALHOST_CANDIDATE is specified.
   bool emit_localhost_for_anyaddress_;
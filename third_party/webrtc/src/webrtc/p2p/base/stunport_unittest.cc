@@ -44,6 +44,7 @@ class StunPortTest : public testing::Test,
         ss_scope_(ss_.get()),
         network_("unittest", "unittest", rtc::IPAddress(INADDR_ANY), 32),
         socket_factory_(rtc::Thread::Current()),
+        stun_result_cache_(60 * 1000),
         stun_server_1_(cricket::TestStunServer::Create(
           rtc::Thread::Current(), kStunAddr1)),
         stun_server_2_(cricket::TestStunServer::Create(
@@ -52,6 +53,11 @@ class StunPortTest : public testing::Test,
   }
 
   const cricket::Port* port() const { return stun_port_.get(); }
+  cricket::UDPPort* stun_port() { return stun_port_.get(); }
+  rtc::AsyncPacketSocket* socket() { return socket_.get(); }
+  cricket::StunResultCache* stun_result_cache() {
+    return &stun_result_cache_;
+  }
   bool done() const { return done_; }
   bool error() const { return error_; }
 
@@ -143,6 +149,8 @@ class StunPortTest : public testing::Test,
   rtc::SocketServerScope ss_scope_;
   rtc::Network network_;
   rtc::BasicPacketSocketFactory socket_factory_;
+  // Outlives the port, which unregisters from it.
+  cricket::StunResultCache stun_result_cache_;
   rtc::scoped_ptr<cricket::UDPPort> stun_port_;
   rtc::scoped_ptr<cricket::TestStunServer> stun_server_1_;
   rtc::scoped_ptr<cricket::TestStunServer> stun_server_2_;
@@ -285,3 +293,50 @@ TEST_F(StunPortTest, TestTwoCandidatesWithTwoStunServersAcrossNat) {
   EXPECT_EQ(port()->Candidates()[0].relay_protocol(), "");
   EXPECT_EQ(port()->Candidates()[1].relay_protocol(), "");
 }
+
+// Test that a second port on the same socket takes its mapped address from
+// the cache, and waits for the first one while its query is in flight.
+TEST_F(StunPortTest, TestStunResultCache) {
+  const SocketAddress kStunMappedAddr("77.77.77.77", 0);
+  stun_server_1()->set_fake_stun_addr(kStunMappedAddr);
+  cricket::StunResultCache& cache = *stun_result_cache();
+  SocketAddress mapped;
+  EXPECT_EQ(cricket::StunResultCache::kMiss,
+            cache.Lookup(kLocalAddr, kStunAddr1, &mapped));
+  EXPECT_EQ(cricket::StunResultCache::kPending,
+            cache.Lookup(kLocalAddr, kStunAddr1, &mapped));
+  cache.Abandon(kLocalAddr, kStunAddr1);
+  EXPECT_EQ(0U, cache.size());
+
+  CreateSharedStunPort(kStunAddr1);
+  stun_port()->set_stun_result_cache(&cache);
+  PrepareAddress();
+  EXPECT_TRUE_WAIT(done(), kTimeoutMs);
+  // The host candidate and the srflx one.
+  ASSERT_EQ(2U, port()->Candidates().size());
+  EXPECT_EQ(kStunMappedAddr.ipaddr(),
+            port()->Candidates()[1].address().ipaddr());
+  EXPECT_EQ(cricket::StunResultCache::kHit,
+            cache.Lookup(socket()->GetLocalAddress(), kStunAddr1, &mapped));
+  EXPECT_EQ(kStunMappedAddr.ipaddr(), mapped.ipaddr());
+}
+
+TEST_F(StunPortTest, TestStunResultCacheFailure) {
+  cricket::StunResultCache cache(60 * 1000);
+  SocketAddress mapped;
+  EXPECT_EQ(cricket::StunResultCache::kMiss,
+            cache.Lookup(kLocalAddr, kBadAddr, &mapped));
+  cache.AddFailure(kLocalAddr, kBadAddr);
+  EXPECT_EQ(cricket::StunResultCache::kHit,
+            cache.Lookup(kLocalAddr, kBadAddr, &mapped));
+  EXPECT_TRUE(mapped.IsNil());
+
+  // A cached result expires after the TTL.
+  cache.set_ttl(0);
+  EXPECT_EQ(cricket::StunResultCache::kMiss,
+            cache.Lookup(kLocalAddr, kStunAddr1, &mapped));
+  cache.AddResult(kLocalAddr, kStunAddr1, kStunAddr2);
+  rtc::Thread::Current()->ProcessMessages(10);
+  EXPECT_EQ(cricket::StunResultCache::kMiss,
+            cache.Lookup(kLocalAddr, kStunAddr1, &mapped));
+}
@@ -47,7 +47,7 @@ void StunRequestManager::SendDelayed(StunRequest* request, int delay) {
   request->Construct();
   requests_[request->id()] = request;
   if (delay > 0) {
-    thread_->PostDelayed(delay, request, MSG_STUN_SEND, NULL);
+    thread_->timer_wheel()->Schedule(&request->timer_, delay);
   } else {
     thread_->Send(request, MSG_STUN_SEND, NULL);
   }
@@ -59,7 +59,7 @@ void StunRequestManager::Remove(StunRequest* request) {
   if (iter != requests_.end()) {
     ASSERT(iter->second == request);
     requests_.erase(iter);
-    thread_->Clear(request);
+    request->timer_.Cancel();
   }
 }
 
@@ -130,14 +130,14 @@ bool StunRequestManager::CheckResponse(const char* data, size_t size) {
 
 StunRequest::StunRequest()
     : count_(0), timeout_(false), manager_(0),
-      msg_(new StunMessage()), tstamp_(0) {
+      msg_(new StunMessage()), tstamp_(0), timer_(this, MSG_STUN_SEND) {
   msg_->SetTransactionID(
       rtc::CreateRandomString(kStunTransactionIdLength));
 }
 
 StunRequest::StunRequest(StunMessage* request)
     : count_(0), timeout_(false), manager_(0),
-      msg_(request), tstamp_(0) {
+      msg_(request), tstamp_(0), timer_(this, MSG_STUN_SEND) {
   msg_->SetTransactionID(
       rtc::CreateRandomString(kStunTransactionIdLength));
 }
@@ -146,7 +146,6 @@ StunRequest::~StunRequest() {
   ASSERT(manager_ != NULL);
   if (manager_) {
     manager_->Remove(this);
-    manager_->thread_->Clear(this);
   }
   delete msg_;
 }
@@ -198,7 +197,7 @@ void StunRequest::OnMessage(rtc::Message* pmsg) {
   manager_->SignalSendPacket(buf.Data(), buf.Length(), this);
 
   OnSent();
-  manager_->thread_->PostDelayed(resend_delay(), this, MSG_STUN_SEND, NULL);
+  manager_->thread_->timer_wheel()->Schedule(&timer_, resend_delay());
 }
 
 void StunRequest::OnSent() {
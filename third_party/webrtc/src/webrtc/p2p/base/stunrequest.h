@@ -16,6 +16,7 @@
 #include "webrtc/p2p/base/stun.h"
 #include "webrtc/base/sigslot.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timerwheel.h"
 
 namespace cricket {
 
@@ -119,6 +120,9 @@ class StunRequest : public rtc::MessageHandler {
   StunRequestManager* manager_;
   StunMessage* msg_;
   uint32 tstamp_;
+  // Resends run off the thread's shared timer wheel, which unlike the
+  // thread's delayed messages is cheap to cancel when a response arrives.
+  rtc::TimerWheel::Timer timer_;
 
   friend class StunRequestManager;
 };
@@ -10,13 +10,18 @@
 
 #include "webrtc/p2p/base/stunserver.h"
 
-#include "webrtc/base/bytebuffer.h"
+#include "webrtc/base/bind.h"
 #include "webrtc/base/logging.h"
 
 namespace cricket {
 
+// Large enough for any response we send: a header plus an IPv6 address or
+// an error code.
+static const size_t kMaxResponseSize = 128;
+
 StunServer::StunServer(rtc::AsyncUDPSocket* socket) : socket_(socket) {
   socket_->SignalReadPacket.connect(this, &StunServer::OnPacket);
+  socket_->SetSendBatching(true);
 }
 
 StunServer::~StunServer() {
@@ -28,9 +33,8 @@ void StunServer::OnPacket(
     const rtc::SocketAddress& remote_addr,
     const rtc::PacketTime& packet_time) {
   // Parse the STUN message; eat any messages that fail to parse.
-  rtc::ByteBuffer bbuf(buf, size);
-  StunMessage msg;
-  if (!msg.Read(&bbuf)) {
+  StunMessageView msg;
+  if (!msg.Parse(buf, size)) {
     return;
   }
 
@@ -40,7 +44,7 @@ void StunServer::OnPacket(
   // Send the message to the appropriate handler function.
   switch (msg.type()) {
     case STUN_BINDING_REQUEST:
-      OnBindingRequest(&msg, remote_addr);
+      OnBindingRequest(msg, remote_addr);
       break;
 
     default:
@@ -49,51 +53,82 @@ void StunServer::OnPacket(
 }
 
 void StunServer::OnBindingRequest(
-    StunMessage* msg, const rtc::SocketAddress& remote_addr) {
-  StunMessage response;
-  GetStunBindReqponse(msg, remote_addr, &response);
-  SendResponse(response, remote_addr);
+    const StunMessageView& msg, const rtc::SocketAddress& remote_addr) {
+  SendBindingResponse(msg, remote_addr, remote_addr);
 }
 
 void StunServer::SendErrorResponse(
-    const StunMessage& msg, const rtc::SocketAddress& addr,
+    const StunMessageView& msg, const rtc::SocketAddress& addr,
     int error_code, const char* error_desc) {
-  StunMessage err_msg;
-  err_msg.SetType(GetStunErrorResponseType(msg.type()));
-  err_msg.SetTransactionID(msg.transaction_id());
+  int type = GetStunErrorResponseType(msg.type());
+  if (type < 0) {
+    // Only requests get a response.
+    return;
+  }
+  char buf[kMaxResponseSize];
+  StunMessageBuilder builder(buf, sizeof(buf), type, msg.transaction_id(),
+                             msg.transaction_id_length());
+  builder.AddErrorCode(error_code, error_desc);
+  SendResponse(builder, addr);
+}
 
-  StunErrorCodeAttribute* err_code = StunAttribute::CreateErrorCode();
-  err_code->SetCode(error_code);
-  err_code->SetReason(error_desc);
-  err_msg.AddAttribute(err_code);
+void StunServer::SendBindingResponse(const StunMessageView& request,
+                                     const rtc::SocketAddress& mapped_addr,
+                                     const rtc::SocketAddress& addr) {
+  char buf[kMaxResponseSize];
+  StunMessageBuilder builder(buf, sizeof(buf), STUN_BINDING_RESPONSE,
+                             request.transaction_id(),
+                             request.transaction_id_length());
 
-  SendResponse(err_msg, addr);
+  // Tell the user the address that we received their request from.
+  if (!request.IsLegacy()) {
+    builder.AddAddress(STUN_ATTR_MAPPED_ADDRESS, mapped_addr);
+  } else {
+    builder.AddXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, mapped_addr);
+  }
+  SendResponse(builder, addr);
 }
 
 void StunServer::SendResponse(
-    const StunMessage& msg, const rtc::SocketAddress& addr) {
-  rtc::ByteBuffer buf;
-  msg.Write(&buf);
+    const StunMessageBuilder& builder, const rtc::SocketAddress& addr) {
+  if (!builder.ok()) {
+    LOG(LS_WARNING) << "Failed to build STUN response to "
+                    << addr.ToSensitiveString();
+    return;
+  }
   rtc::PacketOptions options;
-  if (socket_->SendTo(buf.Data(), buf.Length(), addr, options) < 0)
+  if (socket_->SendTo(builder.data(), builder.length(), addr, options) < 0)
     LOG_ERR(LS_ERROR) << "sendto";
 }
 
-void StunServer::GetStunBindReqponse(StunMessage* request,
-                                     const rtc::SocketAddress& remote_addr,
-                                     StunMessage* response) const {
-  response->SetType(STUN_BINDING_RESPONSE);
-  response->SetTransactionID(request->transaction_id());
+ShardedStunServer::ShardedStunServer(int num_shards)
+    : shards_(num_shards, "StunServerShard"), servers_(num_shards) {
+}
 
-  // Tell the user the address that we received their request from.
-  StunAddressAttribute* mapped_addr;
-  if (!request->IsLegacy()) {
-    mapped_addr = StunAttribute::CreateAddress(STUN_ATTR_MAPPED_ADDRESS);
-  } else {
-    mapped_addr = StunAttribute::CreateXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS);
+ShardedStunServer::~ShardedStunServer() {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&ShardedStunServer::DestroyServer, this, i));
   }
-  mapped_addr->SetAddress(remote_addr);
-  response->AddAttribute(mapped_addr);
+}
+
+rtc::SocketAddress ShardedStunServer::Listen(
+    const rtc::SocketAddress& address) {
+  return shards_.Listen(address, SOCK_DGRAM,
+                        [this](int index, rtc::AsyncSocket* socket) {
+                          return CreateServer(index, socket);
+                        });
+}
+
+bool ShardedStunServer::CreateServer(int index, rtc::AsyncSocket* socket) {
+  ASSERT(!servers_[index]);
+  servers_[index] = new StunServer(new rtc::AsyncUDPSocket(socket));
+  return true;
+}
+
+void ShardedStunServer::DestroyServer(int index) {
+  delete servers_[index];
+  servers_[index] = nullptr;
 }
 
 }  // namespace cricket
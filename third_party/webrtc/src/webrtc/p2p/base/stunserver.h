@@ -11,14 +11,22 @@
 #ifndef WEBRTC_P2P_BASE_STUNSERVER_H_
 #define WEBRTC_P2P_BASE_STUNSERVER_H_
 
+#include <vector>
+
+#include "webrtc/p2p/base/servershards.h"
 #include "webrtc/p2p/base/stun.h"
 #include "webrtc/base/asyncudpsocket.h"
+#include "webrtc/base/constructormagic.h"
 #include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
 
 namespace cricket {
 
 const int STUN_SERVER_PORT = 3478;
 
+// Answers STUN binding requests. Requests are parsed in place and responses
+// are written into a stack buffer, so a request costs no heap allocation.
+// Responses to the requests of one receive batch are sent in one batch.
 class StunServer : public sigslot::has_slots<> {
  public:
   // Creates a STUN server, which will listen on the given socket.
@@ -34,7 +42,7 @@ class StunServer : public sigslot::has_slots<> {
       const rtc::PacketTime& packet_time);
 
   // Handlers for the different types of STUN/TURN requests:
-  virtual void OnBindingRequest(StunMessage* msg,
+  virtual void OnBindingRequest(const StunMessageView& msg,
       const rtc::SocketAddress& addr);
   void OnAllocateRequest(StunMessage* msg,
       const rtc::SocketAddress& addr);
@@ -45,22 +53,49 @@ class StunServer : public sigslot::has_slots<> {
 
   // Sends an error response to the given message back to the user.
   void SendErrorResponse(
-      const StunMessage& msg, const rtc::SocketAddress& addr,
+      const StunMessageView& msg, const rtc::SocketAddress& addr,
       int error_code, const char* error_desc);
 
-  // Sends the given message to the appropriate destination.
-  void SendResponse(const StunMessage& msg,
-       const rtc::SocketAddress& addr);
+  // Sends a binding response to |request|, reporting |mapped_addr| as the
+  // address the request came from, to |addr|.
+  void SendBindingResponse(const StunMessageView& request,
+                           const rtc::SocketAddress& mapped_addr,
+                           const rtc::SocketAddress& addr);
 
-  // A helper method to compose a STUN binding response.
-  void GetStunBindReqponse(StunMessage* request,
-                           const rtc::SocketAddress& remote_addr,
-                           StunMessage* response) const;
+  // Sends the message in |builder| to the given destination.
+  void SendResponse(const StunMessageBuilder& builder,
+                    const rtc::SocketAddress& addr);
 
  private:
   rtc::scoped_ptr<rtc::AsyncUDPSocket> socket_;
 };
 
+// Runs a StunServer on each of |num_shards| threads. Every shard owns its
+// own socket on the same address, see ServerShards.
+class ShardedStunServer {
+ public:
+  explicit ShardedStunServer(int num_shards);
+  ~ShardedStunServer();
+
+  int num_shards() const { return shards_.size(); }
+
+  // Starts listening on |address| on every shard that can share it. With
+  // port 0, all shards get the port picked for the first one. Returns the
+  // bound address, or a nil address if the first shard failed to bind. May
+  // only be called once.
+  rtc::SocketAddress Listen(const rtc::SocketAddress& address);
+
+ private:
+  // These run on the shard's thread.
+  bool CreateServer(int index, rtc::AsyncSocket* socket);
+  void DestroyServer(int index);
+
+  ServerShards shards_;
+  std::vector<StunServer*> servers_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(ShardedStunServer);
+};
+
 }  // namespace cricket
 
 #endif  // WEBRTC_P2P_BASE_STUNSERVER_H_
@@ -8,14 +8,18 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "webrtc/p2p/base/stunserver.h"
+#include "webrtc/base/byteorder.h"
 #include "webrtc/base/gunit.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/physicalsocketserver.h"
 #include "webrtc/base/testclient.h"
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/base/virtualsocketserver.h"
 
 using namespace cricket;
@@ -102,6 +106,26 @@ TEST_F(StunServerTest, TestGood) {
 
 #endif // if !defined(THREAD_SANITIZER)
 
+TEST_F(StunServerTest, TestUnsupportedRequest) {
+  StunMessage req;
+  req.SetType(STUN_ALLOCATE_REQUEST);
+  req.SetTransactionID("0123456789ab");
+  Send(req);
+
+  rtc::scoped_ptr<StunMessage> msg(Receive());
+  ASSERT_TRUE(msg);
+  EXPECT_EQ(STUN_ALLOCATE_ERROR_RESPONSE, msg->type());
+  EXPECT_EQ(req.transaction_id(), msg->transaction_id());
+  const StunErrorCodeAttribute* error = msg->GetErrorCode();
+  ASSERT_TRUE(error != NULL);
+  EXPECT_EQ(600, error->code());
+
+  // Indications don't get a response.
+  req.SetType(STUN_BINDING_INDICATION);
+  Send(req);
+  EXPECT_TRUE(ReceiveFails());
+}
+
 TEST_F(StunServerTest, TestBad) {
   const char* bad = "this is a completely nonsensical message whose only "
                     "purpose is to make the parser go 'ack'.  it doesn't "
@@ -110,3 +134,152 @@ TEST_F(StunServerTest, TestBad) {
 
   ASSERT_TRUE(ReceiveFails());
 }
+
+namespace {
+
+const rtc::SocketAddress kLoopbackAddr("127.0.0.1", 0);
+const int kTimeoutMs = 10000;
+
+// Sends binding requests from its own socket and counts the responses that
+// carry its address.
+class StunTestClient : public sigslot::has_slots<> {
+ public:
+  explicit StunTestClient(const rtc::SocketAddress& server)
+      : server_(server),
+        socket_(rtc::AsyncUDPSocket::Create(
+            rtc::Thread::Current()->socketserver(), kLoopbackAddr)),
+        next_id_(0),
+        received_(0),
+        wake_up_at_(0) {
+    socket_->SignalReadPacket.connect(this, &StunTestClient::OnReadPacket);
+  }
+
+  int received() const { return received_; }
+  // Wakes up the socket server when |count| responses have been received.
+  void WakeUpAt(int count) { wake_up_at_ = count; }
+
+  void SendRequest() {
+    char buf[kStunHeaderSize];
+    char id[kStunTransactionIdLength] = {0};
+    rtc::SetBE32(id, ++next_id_);
+    StunMessageBuilder builder(buf, sizeof(buf), STUN_BINDING_REQUEST, id,
+                               sizeof(id));
+    socket_->SendTo(builder.data(), builder.length(), server_,
+                    rtc::PacketOptions());
+  }
+
+ private:
+  void OnReadPacket(rtc::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const rtc::SocketAddress& remote_addr,
+                    const rtc::PacketTime& packet_time) {
+    StunMessageView msg;
+    rtc::SocketAddress mapped_addr;
+    if (!msg.Parse(data, size) || msg.type() != STUN_BINDING_RESPONSE ||
+        !msg.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &mapped_addr) ||
+        mapped_addr != socket_->GetLocalAddress()) {
+      return;
+    }
+    if (++received_ == wake_up_at_) {
+      rtc::Thread::Current()->socketserver()->WakeUp();
+    }
+  }
+
+  rtc::SocketAddress server_;
+  rtc::scoped_ptr<rtc::AsyncPacketSocket> socket_;
+  uint32 next_id_;
+  int received_;
+  int wake_up_at_;
+};
+
+}  // namespace
+
+// Runs over real loopback sockets, SO_REUSEPORT needs them.
+class ShardedStunServerTest : public testing::Test {
+ public:
+  ShardedStunServerTest() : ss_scope_(&pss_) {}
+
+ protected:
+  // Starts a server with |num_shards| shards and |num_clients| clients.
+  void Start(int num_shards, int num_clients) {
+    server_.reset(new ShardedStunServer(num_shards));
+    rtc::SocketAddress server_addr = server_->Listen(kLoopbackAddr);
+    ASSERT_FALSE(server_addr.IsNil());
+    for (int i = 0; i < num_clients; ++i) {
+      clients_.push_back(new StunTestClient(server_addr));
+    }
+  }
+
+  void TearDown() override {
+    for (StunTestClient* client : clients_) {
+      delete client;
+    }
+    clients_.clear();
+    server_.reset();
+  }
+
+  rtc::PhysicalSocketServer pss_;
+  rtc::SocketServerScope ss_scope_;
+  rtc::scoped_ptr<ShardedStunServer> server_;
+  std::vector<StunTestClient*> clients_;
+};
+
+TEST_F(ShardedStunServerTest, TestBindingRequests) {
+  const int kNumClients = 16;
+  Start(2, kNumClients);
+  EXPECT_EQ(2, server_->num_shards());
+  for (StunTestClient* client : clients_) {
+    client->SendRequest();
+  }
+  for (StunTestClient* client : clients_) {
+    EXPECT_EQ_WAIT(1, client->received(), kTimeoutMs);
+  }
+}
+
+// Answers binding requests from a few clients as fast as possible, with one
+// shard and with several. Disabled by default since it's a loopback
+// benchmark rather than a check.
+TEST_F(ShardedStunServerTest, DISABLED_BindingRequestPerf) {
+  const int kNumClients = 8;
+  const int kBurst = 32;
+  const int kRounds = 250;
+  const int kShards[] = {1, 4};
+
+  for (int num_shards : kShards) {
+    Start(num_shards, kNumClients);
+    // Every client keeps a burst of requests in flight and waits for the
+    // answers before sending the next, so that nothing is lost in the
+    // socket buffers.
+    uint64 start = rtc::TimeNanos();
+    int received = 0;
+    for (int round = 0; round < kRounds; ++round) {
+      for (StunTestClient* client : clients_) {
+        for (int i = 0; i < kBurst; ++i) {
+          client->SendRequest();
+        }
+        client->WakeUpAt(client->received() + kBurst);
+      }
+      uint32 deadline = rtc::Time() + kTimeoutMs;
+      received = 0;
+      for (StunTestClient* client : clients_) {
+        while (client->received() < (round + 1) * kBurst &&
+               rtc::TimeIsLater(rtc::Time(), deadline)) {
+          pss_.Wait(rtc::TimeUntil(deadline), true);
+        }
+        received += client->received();
+      }
+      if (received < (round + 1) * kBurst * kNumClients) {
+        break;
+      }
+    }
+    uint64 elapsed_ns = std::max<uint64>(1, rtc::TimeNanos() - start);
+
+    const int kExpected = kNumClients * kBurst * kRounds;
+    EXPECT_EQ(kExpected, received);
+    LOG(LS_INFO) << num_shards << " shard(s): " << received
+                 << " binding requests answered in "
+                 << elapsed_ns / rtc::kNumNanosecsPerMillisec << " ms ("
+                 << received * rtc::kNumNanosecsPerSec / elapsed_ns
+                 << " pps)";
+    TearDown();
+  }
+}
@@ -343,6 +343,7 @@ bool Transport::AddRemoteCandidates(const std::vector<Candidate>& candidates,
 
 bool Transport::ApplyLocalTransportDescription(TransportChannelImpl* ch,
                                                std::string* error_desc) {
+  ch->SetIceMode(local_description_->ice_mode);
   ch->SetIceCredentials(local_description_->ice_ufrag,
                         local_description_->ice_pwd);
   return true;
@@ -374,6 +375,14 @@ bool Transport::NegotiateTransportDescription(ContentAction local_role,
     SetIceRole(ICEROLE_CONTROLLING);
   }
 
+  // Conversely, a lite end point must be controlled when the remote end point
+  // does full ICE (RFC 5245, section 5.2).
+  if (ice_role_ == ICEROLE_CONTROLLING &&
+      local_description_->ice_mode == ICEMODE_LITE &&
+      remote_description_->ice_mode == ICEMODE_FULL) {
+    SetIceRole(ICEROLE_CONTROLLED);
+  }
+
   // Update remote ice_mode to all existing channels.
   remote_ice_mode_ = remote_description_->ice_mode;
 
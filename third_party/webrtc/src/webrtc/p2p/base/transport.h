@@ -233,6 +233,9 @@ class Transport : public sigslot::has_slots<> {
     return false;
   }
 
+  // Must be called before channel is starting to connect.
+  virtual bool SetDtlsSessionResumption(bool enabled) { return false; }
+
  protected:
   // These are called by Create/DestroyChannel above in order to create or
   // destroy the appropriate type of channel.
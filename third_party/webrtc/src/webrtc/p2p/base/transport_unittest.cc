@@ -217,6 +217,27 @@ TEST_F(TransportTest, TestSetRemoteIceLiteInAnswer) {
   EXPECT_EQ(cricket::ICEMODE_LITE, channel_->remote_ice_mode());
 }
 
+// Tests that a local ice-lite end point becomes controlled when the remote
+// end point does full ICE, and that the mode is passed to the channel.
+TEST_F(TransportTest, TestSetLocalIceLite) {
+  transport_->SetIceRole(cricket::ICEROLE_CONTROLLING);
+  cricket::TransportDescription local_desc(
+      std::vector<std::string>(),
+      kIceUfrag1, kIcePwd1, cricket::ICEMODE_LITE,
+      cricket::CONNECTIONROLE_ACTPASS, NULL, cricket::Candidates());
+  ASSERT_TRUE(transport_->SetLocalTransportDescription(local_desc,
+                                                       cricket::CA_OFFER,
+                                                       NULL));
+  EXPECT_TRUE(SetupChannel());
+  EXPECT_EQ(cricket::ICEMODE_LITE, channel_->ice_mode());
+  cricket::TransportDescription remote_desc(kIceUfrag2, kIcePwd2);
+  ASSERT_TRUE(transport_->SetRemoteTransportDescription(remote_desc,
+                                                        cricket::CA_ANSWER,
+                                                        NULL));
+  EXPECT_EQ(cricket::ICEROLE_CONTROLLED, transport_->ice_role());
+  EXPECT_EQ(cricket::ICEROLE_CONTROLLED, channel_->GetIceRole());
+}
+
 TEST_F(TransportTest, TestGetStats) {
   EXPECT_TRUE(SetupChannel());
   cricket::TransportStats stats;
@@ -56,7 +56,9 @@ class TransportChannelImpl : public TransportChannel {
   virtual void SetRemoteIceCredentials(const std::string& ice_ufrag,
                                        const std::string& ice_pwd) = 0;
 
-  // SetRemoteIceMode must be implemented only by the ICE transport channels.
+  // SetIceMode and SetRemoteIceMode must be implemented only by the ICE
+  // transport channels.
+  virtual void SetIceMode(IceMode mode) = 0;
   virtual void SetRemoteIceMode(IceMode mode) = 0;
 
   virtual void SetIceConfig(const IceConfig& config) = 0;
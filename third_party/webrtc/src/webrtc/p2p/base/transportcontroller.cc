@@ -56,6 +56,11 @@ bool TransportController::SetSslMaxProtocolVersion(
       &TransportController::SetSslMaxProtocolVersion_w, this, version));
 }
 
+bool TransportController::SetDtlsSessionResumption(bool enabled) {
+  return worker_thread_->Invoke<bool>(rtc::Bind(
+      &TransportController::SetDtlsSessionResumption_w, this, enabled));
+}
+
 void TransportController::SetIceConfig(const IceConfig& config) {
   worker_thread_->Invoke<void>(
       rtc::Bind(&TransportController::SetIceConfig_w, this, config));
@@ -283,6 +288,7 @@ Transport* TransportController::GetOrCreateTransport_w(
   // The stuff below happens outside of CreateTransport_w so that unit tests
   // can override CreateTransport_w to return a different type of transport.
   transport->SetSslMaxProtocolVersion(ssl_max_version_);
+  transport->SetDtlsSessionResumption(dtls_session_resumption_);
   transport->SetIceConfig(ice_config_);
   transport->SetIceRole(ice_role_);
   transport->SetIceTiebreaker(ice_tiebreaker_);
@@ -327,6 +333,17 @@ bool TransportController::SetSslMaxProtocolVersion_w(
   return true;
 }
 
+bool TransportController::SetDtlsSessionResumption_w(bool enabled) {
+  RTC_DCHECK(worker_thread_->IsCurrent());
+
+  if (!transports_.empty()) {
+    return false;
+  }
+
+  dtls_session_resumption_ = enabled;
+  return true;
+}
+
 void TransportController::SetIceConfig_w(const IceConfig& config) {
   RTC_DCHECK(worker_thread_->IsCurrent());
   ice_config_ = config;
@@ -44,6 +44,8 @@ class TransportController : public sigslot::has_slots<>,
   // TODO(deadbeef): Make this an argument to the constructor once BaseSession
   // and WebRtcSession are combined
   bool SetSslMaxProtocolVersion(rtc::SSLProtocolVersion version);
+  // Can only be set before transports are created.
+  bool SetDtlsSessionResumption(bool enabled);
 
   void SetIceConfig(const IceConfig& config);
   void SetIceRole(IceRole ice_role);
@@ -158,6 +160,7 @@ class TransportController : public sigslot::has_slots<>,
   void DestroyAllTransports_w();
 
   bool SetSslMaxProtocolVersion_w(rtc::SSLProtocolVersion version);
+  bool SetDtlsSessionResumption_w(bool enabled);
   void SetIceConfig_w(const IceConfig& config);
   void SetIceRole_w(IceRole ice_role);
   bool GetSslRole_w(rtc::SSLRole* role);
@@ -203,6 +206,7 @@ class TransportController : public sigslot::has_slots<>,
 
   PortAllocator* const port_allocator_ = nullptr;
   rtc::SSLProtocolVersion ssl_max_version_ = rtc::SSL_PROTOCOL_DTLS_10;
+  bool dtls_session_resumption_ = false;
 
   // Aggregate state for TransportChannelImpls.
   IceConnectionState connection_state_ = kIceConnectionConnecting;
@@ -225,6 +225,19 @@ TEST_F(TransportControllerTest, TestSetSslMaxProtocolVersion) {
       rtc::SSL_PROTOCOL_DTLS_10));
 }
 
+TEST_F(TransportControllerTest, TestSetDtlsSessionResumption) {
+  FakeTransportChannel* channel1 = CreateChannel("audio", 1);
+  ASSERT_NE(nullptr, channel1);
+  EXPECT_FALSE(channel1->dtls_session_resumption());
+  EXPECT_FALSE(transport_controller_->SetDtlsSessionResumption(true));
+  DestroyChannel("audio", 1);
+
+  EXPECT_TRUE(transport_controller_->SetDtlsSessionResumption(true));
+  FakeTransportChannel* channel2 = CreateChannel("video", 1);
+  ASSERT_NE(nullptr, channel2);
+  EXPECT_TRUE(channel2->dtls_session_resumption());
+}
+
 TEST_F(TransportControllerTest, TestSetIceRole) {
   FakeTransportChannel* channel1 = CreateChannel("audio", 1);
   ASSERT_NE(nullptr, channel1);
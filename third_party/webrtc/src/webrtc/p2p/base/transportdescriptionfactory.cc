@@ -19,7 +19,8 @@
 namespace cricket {
 
 TransportDescriptionFactory::TransportDescriptionFactory()
-    : secure_(SEC_DISABLED) {
+    : secure_(SEC_DISABLED),
+      ice_mode_(ICEMODE_FULL) {
 }
 
 TransportDescription* TransportDescriptionFactory::CreateOffer(
@@ -35,6 +36,7 @@ TransportDescription* TransportDescriptionFactory::CreateOffer(
     desc->ice_ufrag = current_description->ice_ufrag;
     desc->ice_pwd = current_description->ice_pwd;
   }
+  desc->ice_mode = ice_mode_;
 
   // If we are trying to establish a secure transport, add a fingerprint.
   if (secure_ == SEC_ENABLED || secure_ == SEC_REQUIRED) {
@@ -69,6 +71,7 @@ TransportDescription* TransportDescriptionFactory::CreateAnswer(
     desc->ice_ufrag = current_description->ice_ufrag;
     desc->ice_pwd = current_description->ice_pwd;
   }
+  desc->ice_mode = ice_mode_;
 
   // Negotiate security params.
   if (offer && offer->identity_fingerprint.get()) {
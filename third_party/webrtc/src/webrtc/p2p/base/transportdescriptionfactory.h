@@ -34,6 +34,7 @@ class TransportDescriptionFactory {
   // Default ctor; use methods below to set configuration.
   TransportDescriptionFactory();
   SecurePolicy secure() const { return secure_; }
+  IceMode ice_mode() const { return ice_mode_; }
   // The certificate to use when setting up DTLS.
   const rtc::scoped_refptr<rtc::RTCCertificate>& certificate() const {
     return certificate_;
@@ -41,6 +42,8 @@ class TransportDescriptionFactory {
 
   // Specifies the transport security policy to use.
   void set_secure(SecurePolicy s) { secure_ = s; }
+  // Specifies whether we do full ICE or are an ICE-lite implementation.
+  void set_ice_mode(IceMode mode) { ice_mode_ = mode; }
   // Specifies the certificate to use (only used when secure != SEC_DISABLED).
   void set_certificate(
       const rtc::scoped_refptr<rtc::RTCCertificate>& certificate) {
@@ -61,6 +64,7 @@ class TransportDescriptionFactory {
                        ConnectionRole role) const;
 
   SecurePolicy secure_;
+  IceMode ice_mode_;
   rtc::scoped_refptr<rtc::RTCCertificate> certificate_;
 };
 
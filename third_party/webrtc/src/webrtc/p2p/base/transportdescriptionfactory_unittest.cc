@@ -260,3 +260,21 @@ TEST_F(TransportDescriptionFactoryTest, TestIceRestart) {
 TEST_F(TransportDescriptionFactoryTest, TestIceRestartWithDtls) {
   TestIceRestart(true);
 }
+
+// Test that the configured ICE mode is used in offers and answers.
+TEST_F(TransportDescriptionFactoryTest, TestIceLite) {
+  f1_.set_ice_mode(cricket::ICEMODE_LITE);
+  scoped_ptr<TransportDescription> offer(f1_.CreateOffer(
+      TransportOptions(), NULL));
+  ASSERT_TRUE(offer.get() != NULL);
+  EXPECT_EQ(cricket::ICEMODE_LITE, offer->ice_mode);
+  scoped_ptr<TransportDescription> answer(f2_.CreateAnswer(
+      offer.get(), TransportOptions(), NULL));
+  ASSERT_TRUE(answer.get() != NULL);
+  EXPECT_EQ(cricket::ICEMODE_FULL, answer->ice_mode);
+
+  f2_.set_ice_mode(cricket::ICEMODE_LITE);
+  answer.reset(f2_.CreateAnswer(offer.get(), TransportOptions(), NULL));
+  ASSERT_TRUE(answer.get() != NULL);
+  EXPECT_EQ(cricket::ICEMODE_LITE, answer->ice_mode);
+}
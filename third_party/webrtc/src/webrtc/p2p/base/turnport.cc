@@ -156,6 +156,11 @@ class TurnEntry : public sigslot::has_slots<> {
   sigslot::signal1<TurnEntry*> SignalDestroyed;
 
  private:
+  // Frames |data| as a ChannelData message, in the caller's headroom if
+  // |options| has room for the header.
+  int SendChannelData(const void* data, size_t size,
+                      const rtc::PacketOptions& options);
+
   TurnPort* port_;
   int channel_id_;
   rtc::SocketAddress ext_addr_;
@@ -1304,31 +1309,52 @@ void TurnEntry::SendChannelBindRequest(int delay) {
 
 int TurnEntry::Send(const void* data, size_t size, bool payload,
                     const rtc::PacketOptions& options) {
-  rtc::ByteBuffer buf;
-  if (state_ != STATE_BOUND) {
-    // If we haven't bound the channel yet, we have to use a Send Indication.
-    TurnMessage msg;
-    msg.SetType(TURN_SEND_INDICATION);
-    msg.SetTransactionID(
-        rtc::CreateRandomString(kStunTransactionIdLength));
-    VERIFY(msg.AddAttribute(new StunXorAddressAttribute(
-        STUN_ATTR_XOR_PEER_ADDRESS, ext_addr_)));
-    VERIFY(msg.AddAttribute(new StunByteStringAttribute(
-        STUN_ATTR_DATA, data, size)));
-    VERIFY(msg.Write(&buf));
-
-    // If we're sending real data, request a channel bind that we can use later.
-    if (state_ == STATE_UNBOUND && payload) {
-      SendChannelBindRequest(0);
-      state_ = STATE_BINDING;
-    }
-  } else {
-    // If the channel is bound, we can send the data as a Channel Message.
-    buf.WriteUInt16(channel_id_);
-    buf.WriteUInt16(static_cast<uint16>(size));
-    buf.WriteBytes(reinterpret_cast<const char*>(data), size);
+  if (state_ == STATE_BOUND) {
+    return SendChannelData(data, size, options);
   }
-  return port_->Send(buf.Data(), buf.Length(), options);
+
+  // If we haven't bound the channel yet, we have to use a Send Indication.
+  rtc::ByteBuffer buf;
+  TurnMessage msg;
+  msg.SetType(TURN_SEND_INDICATION);
+  msg.SetTransactionID(
+      rtc::CreateRandomString(kStunTransactionIdLength));
+  VERIFY(msg.AddAttribute(new StunXorAddressAttribute(
+      STUN_ATTR_XOR_PEER_ADDRESS, ext_addr_)));
+  VERIFY(msg.AddAttribute(new StunByteStringAttribute(
+      STUN_ATTR_DATA, data, size)));
+  VERIFY(msg.Write(&buf));
+
+  // If we're sending real data, request a channel bind that we can use later.
+  if (state_ == STATE_UNBOUND && payload) {
+    SendChannelBindRequest(0);
+    state_ = STATE_BINDING;
+  }
+  rtc::PacketOptions stun_options(options);
+  stun_options.headroom = 0;
+  return port_->Send(buf.Data(), buf.Length(), stun_options);
+}
+
+int TurnEntry::SendChannelData(const void* data, size_t size,
+                               const rtc::PacketOptions& options) {
+  rtc::PacketOptions channel_options(options);
+  channel_options.headroom = 0;
+  if (options.headroom >= TURN_CHANNEL_HEADER_SIZE) {
+    // The caller left room in front of the data, prepend the header there.
+    char* header = static_cast<char*>(const_cast<void*>(data)) -
+        TURN_CHANNEL_HEADER_SIZE;
+    rtc::SetBE16(header, static_cast<uint16>(channel_id_));
+    rtc::SetBE16(header + 2, static_cast<uint16>(size));
+    return port_->Send(header, TURN_CHANNEL_HEADER_SIZE + size,
+                       channel_options);
+  }
+
+  rtc::Buffer& buf = port_->channel_data_buf_;
+  buf.SetSize(TURN_CHANNEL_HEADER_SIZE + size);
+  rtc::SetBE16(buf.data(), static_cast<uint16>(channel_id_));
+  rtc::SetBE16(buf.data() + 2, static_cast<uint16>(size));
+  memcpy(buf.data() + TURN_CHANNEL_HEADER_SIZE, data, size);
+  return port_->Send(buf.data(), buf.size(), channel_options);
 }
 
 void TurnEntry::OnCreatePermissionSuccess() {
@@ -19,6 +19,7 @@
 #include "webrtc/p2p/base/port.h"
 #include "webrtc/p2p/client/basicportallocator.h"
 #include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/buffer.h"
 
 namespace rtc {
 class AsyncResolver;
@@ -242,6 +243,9 @@ class TurnPort : public Port {
   // The number of retries made due to allocate mismatch error.
   size_t allocate_mismatch_retries_;
 
+  // Reused to frame ChannelData messages that come without headroom.
+  rtc::Buffer channel_data_buf_;
+
   friend class TurnEntry;
   friend class TurnAllocateRequest;
   friend class TurnRefreshRequest;
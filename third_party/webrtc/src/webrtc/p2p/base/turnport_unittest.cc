@@ -67,6 +67,7 @@ static const char kTurnUsername[] = "test";
 static const char kTurnPassword[] = "test";
 static const char kTestOrigin[] = "http://example.com";
 static const unsigned int kTimeout = 1000;
+static const size_t kChannelHeaderSize = 4;
 
 static const cricket::ProtocolAddress kTurnUdpProtoAddr(
     kTurnUdpIntAddr, cricket::PROTO_UDP);
@@ -385,7 +386,9 @@ class TurnPortTest : public testing::Test,
     EXPECT_TRUE(conn2->receiving());
   }
 
-  void TestTurnSendData() {
+  // Sends data both ways. With |headroom|, the TURN side passes that many
+  // spare bytes in front of its data for the ChannelData header.
+  void TestTurnSendData(size_t headroom) {
     turn_port_->PrepareAddress();
     EXPECT_TRUE_WAIT(turn_ready_, kTimeout);
     CreateUdpPort();
@@ -409,12 +412,16 @@ class TurnPortTest : public testing::Test,
 
     // Send some data.
     size_t num_packets = 256;
+    rtc::PacketOptions turn_options(options);
+    turn_options.headroom = headroom;
     for (size_t i = 0; i < num_packets; ++i) {
-      unsigned char buf[256] = { 0 };
+      unsigned char storage[16 + 256] = { 0 };
+      ASSERT_LE(headroom, 16U);
+      unsigned char* buf = storage + headroom;
       for (size_t j = 0; j < i + 1; ++j) {
         buf[j] = 0xFF - static_cast<unsigned char>(j);
       }
-      conn1->Send(buf, i + 1, options);
+      conn1->Send(buf, i + 1, turn_options);
       conn2->Send(buf, i + 1, options);
       main_->ProcessMessages(0);
     }
@@ -719,17 +726,23 @@ TEST_F(TurnPortTest, TestTurnConnectionUsingOTUNonce) {
 TEST_F(TurnPortTest, TestTurnSendDataTurnUdpToUdp) {
   // Create ports and prepare addresses.
   CreateTurnPort(kTurnUsername, kTurnPassword, kTurnUdpProtoAddr);
-  TestTurnSendData();
+  TestTurnSendData(0);
   EXPECT_EQ(cricket::UDP_PROTOCOL_NAME,
             turn_port_->Candidates()[0].relay_protocol());
 }
 
+// Same as above, but let the TURN port frame its ChannelData in place.
+TEST_F(TurnPortTest, TestTurnSendDataWithHeadroom) {
+  CreateTurnPort(kTurnUsername, kTurnPassword, kTurnUdpProtoAddr);
+  TestTurnSendData(kChannelHeaderSize);
+}
+
 // Do a TURN allocation, establish a TCP connection, and send some data.
 TEST_F(TurnPortTest, TestTurnSendDataTurnTcpToUdp) {
   turn_server_.AddInternalSocket(kTurnTcpIntAddr, cricket::PROTO_TCP);
   // Create ports and prepare addresses.
   CreateTurnPort(kTurnUsername, kTurnPassword, kTurnTcpProtoAddr);
-  TestTurnSendData();
+  TestTurnSendData(0);
   EXPECT_EQ(cricket::TCP_PROTOCOL_NAME,
             turn_port_->Candidates()[0].relay_protocol());
 }
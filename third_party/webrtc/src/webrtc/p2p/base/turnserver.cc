@@ -11,9 +11,13 @@
 #include "webrtc/p2p/base/turnserver.h"
 
 #include "webrtc/p2p/base/asyncstuntcpsocket.h"
+#include "webrtc/p2p/base/basicpacketsocketfactory.h"
 #include "webrtc/p2p/base/common.h"
 #include "webrtc/p2p/base/packetsocketfactory.h"
 #include "webrtc/p2p/base/stun.h"
+#include "webrtc/base/asyncudpsocket.h"
+#include "webrtc/base/bind.h"
+#include "webrtc/base/byteorder.h"
 #include "webrtc/base/bytebuffer.h"
 #include "webrtc/base/helpers.h"
 #include "webrtc/base/logging.h"
@@ -56,7 +60,6 @@ enum {
 class TurnServerAllocation::Permission : public rtc::MessageHandler {
  public:
   Permission(rtc::Thread* thread, const rtc::IPAddress& peer);
-  ~Permission();
 
   const rtc::IPAddress& peer() const { return peer_; }
   void Refresh();
@@ -68,6 +71,7 @@ class TurnServerAllocation::Permission : public rtc::MessageHandler {
 
   rtc::Thread* thread_;
   rtc::IPAddress peer_;
+  rtc::TimerWheel::Timer timer_;
 };
 
 // Encapsulates a TURN channel binding.
@@ -77,7 +81,6 @@ class TurnServerAllocation::Channel : public rtc::MessageHandler {
  public:
   Channel(rtc::Thread* thread, int id,
                      const rtc::SocketAddress& peer);
-  ~Channel();
 
   int id() const { return id_; }
   const rtc::SocketAddress& peer() const { return peer_; }
@@ -91,6 +94,7 @@ class TurnServerAllocation::Channel : public rtc::MessageHandler {
   rtc::Thread* thread_;
   int id_;
   rtc::SocketAddress peer_;
+  rtc::TimerWheel::Timer timer_;
 };
 
 static bool InitResponse(const StunMessage* req, StunMessage* resp) {
@@ -495,8 +499,13 @@ void TurnServer::SendStun(TurnServerConnection* conn, StunMessage* msg) {
 
 void TurnServer::Send(TurnServerConnection* conn,
                       const rtc::ByteBuffer& buf) {
+  Send(conn, buf.Data(), buf.Length());
+}
+
+void TurnServer::Send(TurnServerConnection* conn,
+                      const char* data, size_t size) {
   rtc::PacketOptions options;
-  conn->socket()->SendTo(buf.Data(), buf.Length(), conn->src(), options);
+  conn->socket()->SendTo(data, size, conn->src(), options);
 }
 
 void TurnServer::OnAllocationDestroyed(TurnServerAllocation* allocation) {
@@ -540,7 +549,18 @@ bool TurnServerConnection::operator==(const TurnServerConnection& c) const {
 }
 
 bool TurnServerConnection::operator<(const TurnServerConnection& c) const {
-  return src_ < c.src_ || dst_ < c.dst_ || proto_ < c.proto_;
+  if (src_ != c.src_)
+    return src_ < c.src_;
+  if (dst_ != c.dst_)
+    return dst_ < c.dst_;
+  return proto_ < c.proto_;
+}
+
+size_t TurnServerConnection::Hash::operator()(
+    const TurnServerConnection& conn) const {
+  // |dst_| is the same for all UDP clients of a socket, so mix |src_| in
+  // rather than xor-ing the two.
+  return conn.src_.Hash() * 31 + conn.dst_.Hash() + conn.proto_;
 }
 
 std::string TurnServerConnection::ToString() const {
@@ -561,21 +581,21 @@ TurnServerAllocation::TurnServerAllocation(TurnServer* server,
       thread_(thread),
       conn_(conn),
       external_socket_(socket),
-      key_(key) {
+      key_(key),
+      timer_(this, MSG_ALLOCATION_TIMEOUT) {
   external_socket_->SignalReadPacket.connect(
       this, &TurnServerAllocation::OnExternalPacket);
 }
 
 TurnServerAllocation::~TurnServerAllocation() {
-  for (ChannelList::iterator it = channels_.begin();
+  for (ChannelIdMap::iterator it = channels_.begin();
        it != channels_.end(); ++it) {
-    delete *it;
+    delete it->second;
   }
-  for (PermissionList::iterator it = perms_.begin();
+  for (PermissionMap::iterator it = perms_.begin();
        it != perms_.end(); ++it) {
-    delete *it;
+    delete it->second;
   }
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
   LOG_J(LS_INFO, this) << "Allocation destroyed";
 }
 
@@ -625,7 +645,7 @@ void TurnServerAllocation::HandleAllocateRequest(const TurnMessage* msg) {
 
   // Figure out the lifetime and start the allocation timer.
   int lifetime_secs = ComputeLifetime(msg);
-  thread_->PostDelayed(lifetime_secs * 1000, this, MSG_ALLOCATION_TIMEOUT);
+  thread_->timer_wheel()->Schedule(&timer_, lifetime_secs * 1000);
 
   LOG_J(LS_INFO, this) << "Created allocation, lifetime=" << lifetime_secs;
 
@@ -652,8 +672,7 @@ void TurnServerAllocation::HandleRefreshRequest(const TurnMessage* msg) {
   int lifetime_secs = ComputeLifetime(msg);
 
   // Reset the expiration timer.
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
-  thread_->PostDelayed(lifetime_secs * 1000, this, MSG_ALLOCATION_TIMEOUT);
+  thread_->timer_wheel()->Schedule(&timer_, lifetime_secs * 1000);
 
   LOG_J(LS_INFO, this) << "Refreshed allocation, lifetime=" << lifetime_secs;
 
@@ -742,7 +761,8 @@ void TurnServerAllocation::HandleChannelBindRequest(const TurnMessage* msg) {
     channel1 = new Channel(thread_, channel_id, peer_attr->GetAddress());
     channel1->SignalDestroyed.connect(this,
         &TurnServerAllocation::OnChannelDestroyed);
-    channels_.push_back(channel1);
+    channels_[channel_id] = channel1;
+    channels_by_peer_[channel1->peer()] = channel1;
   } else {
     channel1->Refresh();
   }
@@ -782,11 +802,20 @@ void TurnServerAllocation::OnExternalPacket(
   Channel* channel = FindChannel(addr);
   if (channel) {
     // There is a channel bound to this address. Send as a channel message.
-    rtc::ByteBuffer buf;
-    buf.WriteUInt16(channel->id());
-    buf.WriteUInt16(static_cast<uint16>(size));
-    buf.WriteBytes(data, size);
-    server_->Send(&conn_, buf);
+    if (socket->GetReceiveHeadroom() >= TURN_CHANNEL_HEADER_SIZE) {
+      // Fast path: write the header into the socket's headroom and relay the
+      // packet straight out of the receive buffer.
+      char* header = const_cast<char*>(data) - TURN_CHANNEL_HEADER_SIZE;
+      rtc::SetBE16(header, static_cast<uint16>(channel->id()));
+      rtc::SetBE16(header + 2, static_cast<uint16>(size));
+      server_->Send(&conn_, header, TURN_CHANNEL_HEADER_SIZE + size);
+    } else {
+      rtc::ByteBuffer buf;
+      buf.WriteUInt16(channel->id());
+      buf.WriteUInt16(static_cast<uint16>(size));
+      buf.WriteBytes(data, size);
+      server_->Send(&conn_, buf);
+    }
   } else if (HasPermission(addr.ipaddr())) {
     // No channel, but a permission exists. Send as a data indication.
     TurnMessage msg;
@@ -824,7 +853,7 @@ void TurnServerAllocation::AddPermission(const rtc::IPAddress& addr) {
     perm = new Permission(thread_, addr);
     perm->SignalDestroyed.connect(
         this, &TurnServerAllocation::OnPermissionDestroyed);
-    perms_.push_back(perm);
+    perms_[addr] = perm;
   } else {
     perm->Refresh();
   }
@@ -832,32 +861,20 @@ void TurnServerAllocation::AddPermission(const rtc::IPAddress& addr) {
 
 TurnServerAllocation::Permission* TurnServerAllocation::FindPermission(
     const rtc::IPAddress& addr) const {
-  for (PermissionList::const_iterator it = perms_.begin();
-       it != perms_.end(); ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  PermissionMap::const_iterator it = perms_.find(addr);
+  return (it != perms_.end()) ? it->second : NULL;
 }
 
 TurnServerAllocation::Channel* TurnServerAllocation::FindChannel(
     int channel_id) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->id() == channel_id)
-      return *it;
-  }
-  return NULL;
+  ChannelIdMap::const_iterator it = channels_.find(channel_id);
+  return (it != channels_.end()) ? it->second : NULL;
 }
 
 TurnServerAllocation::Channel* TurnServerAllocation::FindChannel(
     const rtc::SocketAddress& addr) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  ChannelPeerMap::const_iterator it = channels_by_peer_.find(addr);
+  return (it != channels_by_peer_.end()) ? it->second : NULL;
 }
 
 void TurnServerAllocation::SendResponse(TurnMessage* msg) {
@@ -888,31 +905,22 @@ void TurnServerAllocation::OnMessage(rtc::Message* msg) {
 }
 
 void TurnServerAllocation::OnPermissionDestroyed(Permission* perm) {
-  PermissionList::iterator it = std::find(perms_.begin(), perms_.end(), perm);
-  ASSERT(it != perms_.end());
-  perms_.erase(it);
+  VERIFY(perms_.erase(perm->peer()) == 1);
 }
 
 void TurnServerAllocation::OnChannelDestroyed(Channel* channel) {
-  ChannelList::iterator it =
-      std::find(channels_.begin(), channels_.end(), channel);
-  ASSERT(it != channels_.end());
-  channels_.erase(it);
+  VERIFY(channels_.erase(channel->id()) == 1);
+  VERIFY(channels_by_peer_.erase(channel->peer()) == 1);
 }
 
 TurnServerAllocation::Permission::Permission(rtc::Thread* thread,
                                    const rtc::IPAddress& peer)
-    : thread_(thread), peer_(peer) {
+    : thread_(thread), peer_(peer), timer_(this, MSG_ALLOCATION_TIMEOUT) {
   Refresh();
 }
 
-TurnServerAllocation::Permission::~Permission() {
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
-}
-
 void TurnServerAllocation::Permission::Refresh() {
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
-  thread_->PostDelayed(kPermissionTimeout, this, MSG_ALLOCATION_TIMEOUT);
+  thread_->timer_wheel()->Schedule(&timer_, kPermissionTimeout);
 }
 
 void TurnServerAllocation::Permission::OnMessage(rtc::Message* msg) {
@@ -923,17 +931,13 @@ void TurnServerAllocation::Permission::OnMessage(rtc::Message* msg) {
 
 TurnServerAllocation::Channel::Channel(rtc::Thread* thread, int id,
                              const rtc::SocketAddress& peer)
-    : thread_(thread), id_(id), peer_(peer) {
+    : thread_(thread), id_(id), peer_(peer),
+      timer_(this, MSG_ALLOCATION_TIMEOUT) {
   Refresh();
 }
 
-TurnServerAllocation::Channel::~Channel() {
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
-}
-
 void TurnServerAllocation::Channel::Refresh() {
-  thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
-  thread_->PostDelayed(kChannelTimeout, this, MSG_ALLOCATION_TIMEOUT);
+  thread_->timer_wheel()->Schedule(&timer_, kChannelTimeout);
 }
 
 void TurnServerAllocation::Channel::OnMessage(rtc::Message* msg) {
@@ -942,4 +946,116 @@ void TurnServerAllocation::Channel::OnMessage(rtc::Message* msg) {
   delete this;
 }
 
+ShardedTurnServer::ShardedTurnServer(int num_shards)
+    : shards_(num_shards, "TurnServerShard"), servers_(num_shards) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&ShardedTurnServer::CreateServer, this, i));
+  }
+}
+
+ShardedTurnServer::~ShardedTurnServer() {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&ShardedTurnServer::DestroyServer, this, i));
+  }
+}
+
+void ShardedTurnServer::set_realm(const std::string& realm) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&TurnServer::set_realm, servers_[i], realm));
+  }
+}
+
+void ShardedTurnServer::set_software(const std::string& software) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&TurnServer::set_software, servers_[i], software));
+  }
+}
+
+void ShardedTurnServer::set_auth_hook(TurnAuthInterface* auth_hook) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&TurnServer::set_auth_hook, servers_[i], auth_hook));
+  }
+}
+
+void ShardedTurnServer::set_redirect_hook(
+    TurnRedirectInterface* redirect_hook) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&TurnServer::set_redirect_hook, servers_[i], redirect_hook));
+  }
+}
+
+void ShardedTurnServer::set_enable_otu_nonce(bool enable) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&TurnServer::set_enable_otu_nonce, servers_[i], enable));
+  }
+}
+
+rtc::SocketAddress ShardedTurnServer::AddInternalSocket(
+    const rtc::SocketAddress& address, ProtocolType proto) {
+  int type = (proto == PROTO_UDP) ? SOCK_DGRAM : SOCK_STREAM;
+  return shards_.Listen(address, type,
+                        [this, proto](int index, rtc::AsyncSocket* socket) {
+                          return AdoptInternalSocket(index, proto, socket);
+                        });
+}
+
+void ShardedTurnServer::SetExternalAddress(
+    const rtc::SocketAddress& external_addr) {
+  for (int i = 0; i < shards_.size(); ++i) {
+    shards_.thread(i)->Invoke<void>(
+        rtc::Bind(&ShardedTurnServer::SetExternalSocketFactory, this, i,
+                  external_addr));
+  }
+}
+
+size_t ShardedTurnServer::num_allocations() {
+  size_t count = 0;
+  for (int i = 0; i < shards_.size(); ++i) {
+    count += shards_.thread(i)->Invoke<size_t>(
+        rtc::Bind(&ShardedTurnServer::CountAllocations, this, i));
+  }
+  return count;
+}
+
+void ShardedTurnServer::CreateServer(int index) {
+  servers_[index] = new TurnServer(shards_.thread(index));
+}
+
+void ShardedTurnServer::DestroyServer(int index) {
+  delete servers_[index];
+  servers_[index] = nullptr;
+}
+
+bool ShardedTurnServer::AdoptInternalSocket(int index,
+                                            ProtocolType proto,
+                                            rtc::AsyncSocket* socket) {
+  if (proto == PROTO_UDP) {
+    servers_[index]->AddInternalSocket(new rtc::AsyncUDPSocket(socket), proto);
+  } else {
+    if (socket->Listen(5) != 0) {
+      delete socket;
+      return false;
+    }
+    servers_[index]->AddInternalServerSocket(socket, proto);
+  }
+  return true;
+}
+
+void ShardedTurnServer::SetExternalSocketFactory(
+    int index, const rtc::SocketAddress& external_addr) {
+  servers_[index]->SetExternalSocketFactory(
+      new rtc::BasicPacketSocketFactory(shards_.thread(index)), external_addr);
+}
+
+size_t ShardedTurnServer::CountAllocations(int index) {
+  return servers_[index]->allocations().size();
+}
+
 }  // namespace cricket
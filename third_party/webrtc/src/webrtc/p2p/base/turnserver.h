@@ -11,20 +11,25 @@
 #ifndef WEBRTC_P2P_BASE_TURNSERVER_H_
 #define WEBRTC_P2P_BASE_TURNSERVER_H_
 
-#include <list>
 #include <map>
-#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "webrtc/p2p/base/portinterface.h"
+#include "webrtc/p2p/base/servershards.h"
 #include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/constructormagic.h"
 #include "webrtc/base/messagequeue.h"
+#include "webrtc/base/scoped_ptr.h"
 #include "webrtc/base/sigslot.h"
 #include "webrtc/base/socketaddress.h"
+#include "webrtc/base/timerwheel.h"
 
 namespace rtc {
 class ByteBuffer;
 class PacketSocketFactory;
+class SocketServer;
 class Thread;
 }
 
@@ -50,6 +55,11 @@ class TurnServerConnection {
   bool operator<(const TurnServerConnection& t) const;
   std::string ToString() const;
 
+  // Hashes the 5-tuple, for the server's allocation table.
+  struct Hash {
+    size_t operator()(const TurnServerConnection& conn) const;
+  };
+
  private:
   rtc::SocketAddress src_;
   rtc::SocketAddress dst_;
@@ -90,8 +100,23 @@ class TurnServerAllocation : public rtc::MessageHandler,
  private:
   class Channel;
   class Permission;
-  typedef std::list<Permission*> PermissionList;
-  typedef std::list<Channel*> ChannelList;
+  struct IPAddressHash {
+    size_t operator()(const rtc::IPAddress& ip) const {
+      return rtc::HashIP(ip);
+    }
+  };
+  struct SocketAddressHash {
+    size_t operator()(const rtc::SocketAddress& addr) const {
+      return addr.Hash();
+    }
+  };
+  // Every relayed packet looks up its channel or permission, so these are
+  // hashed rather than scanned.
+  typedef std::unordered_map<rtc::IPAddress, Permission*, IPAddressHash>
+      PermissionMap;
+  typedef std::unordered_map<int, Channel*> ChannelIdMap;
+  typedef std::unordered_map<rtc::SocketAddress, Channel*, SocketAddressHash>
+      ChannelPeerMap;
 
   void HandleAllocateRequest(const TurnMessage* msg);
   void HandleRefreshRequest(const TurnMessage* msg);
@@ -131,8 +156,10 @@ class TurnServerAllocation : public rtc::MessageHandler,
   std::string username_;
   std::string origin_;
   std::string last_nonce_;
-  PermissionList perms_;
-  ChannelList channels_;
+  rtc::TimerWheel::Timer timer_;
+  PermissionMap perms_;
+  ChannelIdMap channels_;
+  ChannelPeerMap channels_by_peer_;
 };
 
 // An interface through which the MD5 credential hash can be retrieved.
@@ -159,7 +186,8 @@ class TurnRedirectInterface {
 // Not yet wired up: TCP support.
 class TurnServer : public sigslot::has_slots<> {
  public:
-  typedef std::map<TurnServerConnection, TurnServerAllocation*> AllocationMap;
+  typedef std::unordered_map<TurnServerConnection, TurnServerAllocation*,
+                             TurnServerConnection::Hash> AllocationMap;
 
   explicit TurnServer(rtc::Thread* thread);
   ~TurnServer();
@@ -237,6 +265,7 @@ class TurnServer : public sigslot::has_slots<> {
 
   void SendStun(TurnServerConnection* conn, StunMessage* msg);
   void Send(TurnServerConnection* conn, const rtc::ByteBuffer& buf);
+  void Send(TurnServerConnection* conn, const char* data, size_t size);
 
   void OnAllocationDestroyed(TurnServerAllocation* allocation);
   void DestroyInternalSocket(rtc::AsyncPacketSocket* socket);
@@ -267,6 +296,52 @@ class TurnServer : public sigslot::has_slots<> {
   friend class TurnServerAllocation;
 };
 
+// Runs a TurnServer on each of a number of threads. Every shard binds the
+// same internal addresses, see ServerShards, so an allocation and all of its
+// traffic stay on one thread.
+// The auth and redirect hooks are called on the shard threads and must be
+// thread-safe.
+class ShardedTurnServer {
+ public:
+  explicit ShardedTurnServer(int num_shards);
+  ~ShardedTurnServer();
+
+  int num_shards() const { return shards_.size(); }
+  rtc::Thread* shard_thread(int index) { return shards_.thread(index); }
+
+  void set_realm(const std::string& realm);
+  void set_software(const std::string& software);
+  void set_auth_hook(TurnAuthInterface* auth_hook);
+  void set_redirect_hook(TurnRedirectInterface* redirect_hook);
+  void set_enable_otu_nonce(bool enable);
+
+  // Starts listening on |address| on every shard that can share it. With
+  // port 0, all shards get the port picked for the first one. Returns the
+  // bound address, or a nil address if the first shard failed to bind.
+  rtc::SocketAddress AddInternalSocket(const rtc::SocketAddress& address,
+                                       ProtocolType proto);
+  // Relayed addresses are allocated on |external_addr|.
+  void SetExternalAddress(const rtc::SocketAddress& external_addr);
+
+  // Total number of allocations across the shards.
+  size_t num_allocations();
+
+ private:
+  // These run on the shard's thread.
+  void CreateServer(int index);
+  void DestroyServer(int index);
+  bool AdoptInternalSocket(int index, ProtocolType proto,
+                           rtc::AsyncSocket* socket);
+  void SetExternalSocketFactory(int index,
+                                const rtc::SocketAddress& external_addr);
+  size_t CountAllocations(int index);
+
+  ServerShards shards_;
+  std::vector<TurnServer*> servers_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(ShardedTurnServer);
+};
+
 }  // namespace cricket
 
 #endif  // WEBRTC_P2P_BASE_TURNSERVER_H_
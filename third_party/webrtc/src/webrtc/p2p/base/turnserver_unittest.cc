@@ -0,0 +1,433 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "webrtc/p2p/base/stun.h"
+#include "webrtc/p2p/base/turnserver.h"
+#include "webrtc/base/asyncudpsocket.h"
+#include "webrtc/base/byteorder.h"
+#include "webrtc/base/bytebuffer.h"
+#include "webrtc/base/gunit.h"
+#include "webrtc/base/helpers.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/physicalsocketserver.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
+
+using cricket::ShardedTurnServer;
+using rtc::SocketAddress;
+
+namespace {
+
+const SocketAddress kLoopbackAddr("127.0.0.1", 0);
+const char kRealm[] = "turnserver.unittest";
+const int kChannel = 0x4000;
+const size_t kChannelHeaderSize = 4;
+const int kTimeoutMs = 10000;
+const int kRetransmitMs = 500;
+
+// Accepts any user whose password is the same as the username.
+class TestAuth : public cricket::TurnAuthInterface {
+ public:
+  bool GetKey(const std::string& username, const std::string& realm,
+              std::string* key) override {
+    return cricket::ComputeStunCredentialHash(username, realm, username, key);
+  }
+};
+
+// Allocates a relay with raw TURN requests and binds a channel to |peer| on
+// it, then sends ChannelData on that channel.
+class TurnTestClient : public sigslot::has_slots<> {
+ public:
+  TurnTestClient(const SocketAddress& server, const SocketAddress& peer)
+      : server_(server),
+        peer_(peer),
+        username_(rtc::CreateRandomString(8)),
+        ready_(false),
+        failed_(false),
+        received_(0),
+        wake_up_at_(0) {}
+
+  bool ready() const { return ready_; }
+  bool failed() const { return failed_; }
+  const SocketAddress& relayed_address() const { return relayed_address_; }
+  // Number of ChannelData messages received from the peer.
+  int received() const { return received_; }
+  const std::string& last_payload() const { return last_payload_; }
+  // Wakes up the socket server when |count| messages have been received.
+  void WakeUpAt(int count) { wake_up_at_ = count; }
+
+  bool Start() {
+    socket_.reset(rtc::AsyncUDPSocket::Create(
+        rtc::Thread::Current()->socketserver(), kLoopbackAddr));
+    if (!socket_) {
+      return false;
+    }
+    socket_->SignalReadPacket.connect(this, &TurnTestClient::OnReadPacket);
+    SendRequest(cricket::STUN_ALLOCATE_REQUEST);
+    return true;
+  }
+
+  // Sends the pending request again, requests may be dropped under load.
+  void Retransmit() {
+    if (!ready_ && request_.Length() > 0) {
+      socket_->SendTo(request_.Data(), request_.Length(), server_,
+                      rtc::PacketOptions());
+    }
+  }
+
+  void SendChannelData(const char* data, size_t size) {
+    rtc::ByteBuffer buf;
+    buf.WriteUInt16(kChannel);
+    buf.WriteUInt16(static_cast<uint16>(size));
+    buf.WriteBytes(data, size);
+    socket_->SendTo(buf.Data(), buf.Length(), server_, rtc::PacketOptions());
+  }
+
+ private:
+  void SendRequest(int type) {
+    cricket::TurnMessage msg;
+    msg.SetType(type);
+    msg.SetTransactionID(
+        rtc::CreateRandomString(cricket::kStunTransactionIdLength));
+    if (type == cricket::STUN_ALLOCATE_REQUEST) {
+      VERIFY(msg.AddAttribute(new cricket::StunUInt32Attribute(
+          cricket::STUN_ATTR_REQUESTED_TRANSPORT, IPPROTO_UDP << 24)));
+    } else {
+      VERIFY(msg.AddAttribute(new cricket::StunUInt32Attribute(
+          cricket::STUN_ATTR_CHANNEL_NUMBER, kChannel << 16)));
+      VERIFY(msg.AddAttribute(new cricket::StunXorAddressAttribute(
+          cricket::STUN_ATTR_XOR_PEER_ADDRESS, peer_)));
+    }
+    if (!nonce_.empty()) {
+      VERIFY(msg.AddAttribute(new cricket::StunByteStringAttribute(
+          cricket::STUN_ATTR_USERNAME, username_)));
+      VERIFY(msg.AddAttribute(new cricket::StunByteStringAttribute(
+          cricket::STUN_ATTR_REALM, realm_)));
+      VERIFY(msg.AddAttribute(new cricket::StunByteStringAttribute(
+          cricket::STUN_ATTR_NONCE, nonce_)));
+      VERIFY(msg.AddMessageIntegrity(key_));
+    }
+    request_.Clear();
+    msg.Write(&request_);
+    socket_->SendTo(request_.Data(), request_.Length(), server_,
+                    rtc::PacketOptions());
+  }
+
+  void OnReadPacket(rtc::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const SocketAddress& remote_addr,
+                    const rtc::PacketTime& packet_time) {
+    if (size >= kChannelHeaderSize && (data[0] & 0xC0) == 0x40) {
+      if (rtc::GetBE16(data) != kChannel ||
+          rtc::GetBE16(data + 2) != size - kChannelHeaderSize) {
+        failed_ = true;
+        return;
+      }
+      last_payload_.assign(data + kChannelHeaderSize,
+                           size - kChannelHeaderSize);
+      if (++received_ == wake_up_at_) {
+        rtc::Thread::Current()->socketserver()->WakeUp();
+      }
+      return;
+    }
+
+    cricket::TurnMessage msg;
+    rtc::ByteBuffer buf(data, size);
+    if (!msg.Read(&buf)) {
+      return;
+    }
+    switch (msg.type()) {
+      case cricket::STUN_ALLOCATE_ERROR_RESPONSE:
+        if (nonce_.empty() && msg.GetByteString(cricket::STUN_ATTR_NONCE) &&
+            msg.GetByteString(cricket::STUN_ATTR_REALM)) {
+          // The first request is always rejected, retry with credentials.
+          nonce_ = msg.GetByteString(cricket::STUN_ATTR_NONCE)->GetString();
+          realm_ = msg.GetByteString(cricket::STUN_ATTR_REALM)->GetString();
+          cricket::ComputeStunCredentialHash(username_, realm_, username_,
+                                             &key_);
+          SendRequest(cricket::STUN_ALLOCATE_REQUEST);
+        } else {
+          failed_ = true;
+        }
+        break;
+      case cricket::STUN_ALLOCATE_RESPONSE:
+        if (msg.GetAddress(cricket::STUN_ATTR_XOR_RELAYED_ADDRESS)) {
+          relayed_address_ =
+              msg.GetAddress(cricket::STUN_ATTR_XOR_RELAYED_ADDRESS)
+                  ->GetAddress();
+        }
+        SendRequest(cricket::TURN_CHANNEL_BIND_REQUEST);
+        break;
+      case cricket::TURN_CHANNEL_BIND_RESPONSE:
+        ready_ = true;
+        break;
+      default:
+        failed_ = true;
+        break;
+    }
+  }
+
+  SocketAddress server_;
+  SocketAddress peer_;
+  std::string username_;
+  std::string realm_;
+  std::string nonce_;
+  std::string key_;
+  rtc::ByteBuffer request_;
+  rtc::scoped_ptr<rtc::AsyncPacketSocket> socket_;
+  SocketAddress relayed_address_;
+  bool ready_;
+  bool failed_;
+  int received_;
+  int wake_up_at_;
+  std::string last_payload_;
+};
+
+// Counts the packets relayed to it.
+class TestPeer : public sigslot::has_slots<> {
+ public:
+  TestPeer()
+      : socket_(rtc::AsyncUDPSocket::Create(
+            rtc::Thread::Current()->socketserver(), kLoopbackAddr)),
+        received_(0),
+        wake_up_at_(0) {
+    socket_->SignalReadPacket.connect(this, &TestPeer::OnReadPacket);
+  }
+
+  SocketAddress address() const { return socket_->GetLocalAddress(); }
+  int received() const { return received_; }
+  const std::string& last_packet() const { return last_packet_; }
+  // Wakes up the socket server when |count| packets have been received.
+  void WakeUpAt(int count) { wake_up_at_ = count; }
+
+  void SendTo(const SocketAddress& addr, const char* data, size_t size) {
+    socket_->SendTo(data, size, addr, rtc::PacketOptions());
+  }
+
+ private:
+  void OnReadPacket(rtc::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const SocketAddress& remote_addr,
+                    const rtc::PacketTime& packet_time) {
+    last_packet_.assign(data, size);
+    if (++received_ == wake_up_at_) {
+      rtc::Thread::Current()->socketserver()->WakeUp();
+    }
+  }
+
+  rtc::scoped_ptr<rtc::AsyncPacketSocket> socket_;
+  int received_;
+  int wake_up_at_;
+  std::string last_packet_;
+};
+
+}  // namespace
+
+class ShardedTurnServerTest : public testing::Test {
+ public:
+  ShardedTurnServerTest()
+      : pss_(rtc::PhysicalSocketServer::WAIT_EPOLL), ss_scope_(&pss_) {}
+
+ protected:
+  // Starts a server with |num_shards| shards listening on the loopback
+  // interface and returns its address.
+  SocketAddress StartServer(int num_shards) {
+    server_.reset(new ShardedTurnServer(num_shards));
+    server_->set_realm(kRealm);
+    server_->set_auth_hook(&auth_);
+    server_->SetExternalAddress(kLoopbackAddr);
+    return server_->AddInternalSocket(kLoopbackAddr, cricket::PROTO_UDP);
+  }
+
+  // Creates |count| clients with a channel to |peer| and waits until they are
+  // all ready. Returns how long that took.
+  int CreateClients(const SocketAddress& server_addr, const TestPeer& peer,
+                    int count) {
+    uint32 start = rtc::Time();
+    for (int i = 0; i < count; ++i) {
+      TurnTestClient* client = new TurnTestClient(server_addr, peer.address());
+      clients_.push_back(client);
+      EXPECT_TRUE(client->Start());
+      // Don't overrun the server's receive buffer.
+      if (i % 100 == 99) {
+        rtc::Thread::Current()->ProcessMessages(0);
+      }
+    }
+    while (NumReady() < count && rtc::TimeSince(start) < kTimeoutMs) {
+      rtc::Thread::Current()->ProcessMessages(kRetransmitMs);
+      for (TurnTestClient* client : clients_) {
+        client->Retransmit();
+      }
+    }
+    EXPECT_EQ(count, NumReady());
+    return rtc::TimeSince(start);
+  }
+
+  int NumReady() const {
+    int ready = 0;
+    for (TurnTestClient* client : clients_) {
+      EXPECT_FALSE(client->failed());
+      ready += client->ready() ? 1 : 0;
+    }
+    return ready;
+  }
+
+  void DestroyClients() {
+    for (TurnTestClient* client : clients_) {
+      delete client;
+    }
+    clients_.clear();
+  }
+
+  void TearDown() override {
+    DestroyClients();
+    server_.reset();
+  }
+
+  rtc::PhysicalSocketServer pss_;
+  rtc::SocketServerScope ss_scope_;
+  TestAuth auth_;
+  rtc::scoped_ptr<ShardedTurnServer> server_;
+  std::vector<TurnTestClient*> clients_;
+};
+
+// Test that clients spread over the shards all get an allocation, and that
+// their channel data is relayed.
+TEST_F(ShardedTurnServerTest, TestRelayChannelData) {
+  const int kNumClients = 16;
+  SocketAddress server_addr = StartServer(2);
+  ASSERT_FALSE(server_addr.IsNil());
+  EXPECT_NE(0, server_addr.port());
+  EXPECT_EQ(2, server_->num_shards());
+
+  TestPeer peer;
+  CreateClients(server_addr, peer, kNumClients);
+  EXPECT_EQ(static_cast<size_t>(kNumClients), server_->num_allocations());
+
+  const char kData[] = "0123456789";
+  for (TurnTestClient* client : clients_) {
+    client->SendChannelData(kData, sizeof(kData));
+  }
+  EXPECT_EQ_WAIT(kNumClients, peer.received(), kTimeoutMs);
+}
+
+// Relays ChannelData for 10k allocations through the loopback interface, with
+// one shard and with one per core. Needs about 20k file descriptors, so it is
+// disabled by default.
+TEST_F(ShardedTurnServerTest, DISABLED_ChannelDataRelayLoad) {
+  const int kNumAllocations = 10000;
+  const int kRounds = 20;
+  const char kData[100] = {0};
+  const int kShards[] = {1, 4};
+
+  for (int num_shards : kShards) {
+    SocketAddress server_addr = StartServer(num_shards);
+    ASSERT_FALSE(server_addr.IsNil());
+    TestPeer peer;
+    int setup_ms = CreateClients(server_addr, peer, kNumAllocations);
+    ASSERT_EQ(static_cast<size_t>(kNumAllocations),
+              server_->num_allocations());
+
+    // Send a packet on every allocation per round; the relayed packets are
+    // counted by |peer| between the rounds.
+    uint32 start = rtc::Time();
+    for (int round = 0; round < kRounds; ++round) {
+      for (size_t i = 0; i < clients_.size(); ++i) {
+        clients_[i]->SendChannelData(kData, sizeof(kData));
+        if (i % 100 == 99) {
+          rtc::Thread::Current()->ProcessMessages(0);
+        }
+      }
+      rtc::Thread::Current()->ProcessMessages(0);
+    }
+    const int kExpected = kNumAllocations * kRounds;
+    // Some packets may be dropped in the socket buffers under this load.
+    WAIT(peer.received() == kExpected, 1000);
+    int relay_ms = std::max(1, rtc::TimeSince(start));
+
+    LOG(LS_INFO) << num_shards << " shard(s), " << kNumAllocations
+                 << " allocations set up in " << setup_ms << " ms; relayed "
+                 << peer.received() << "/" << kExpected << " packets of "
+                 << sizeof(kData) + kChannelHeaderSize << " bytes in "
+                 << relay_ms << " ms ("
+                 << peer.received() * 1000LL / relay_ms << " pps)";
+    EXPECT_GT(peer.received(), 0);
+
+    DestroyClients();
+    server_.reset();
+  }
+}
+
+// Measures the per-packet cost of relaying ChannelData in both directions
+// through a single shard. The peer to client direction is framed in the
+// receive buffer's headroom, so the payload is never copied by the server.
+// Disabled by default since it's a loopback benchmark rather than a check.
+TEST_F(ShardedTurnServerTest, DISABLED_ChannelDataRelayPerf) {
+  const int kNumPackets = 5000;
+  const int kBurst = 50;
+  char data[1000];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = static_cast<char>(i);
+  }
+  const std::string payload(data, sizeof(data));
+
+  SocketAddress server_addr = StartServer(1);
+  ASSERT_FALSE(server_addr.IsNil());
+  TestPeer peer;
+  CreateClients(server_addr, peer, 1);
+  ASSERT_EQ(1, NumReady());
+  TurnTestClient* client = clients_[0];
+  ASSERT_FALSE(client->relayed_address().IsNil());
+
+  // Send in bursts and wait for each one to arrive, so that nothing is lost
+  // in the socket buffers.
+  uint64 start = rtc::TimeNanos();
+  for (int sent = 0; sent < kNumPackets; ) {
+    for (int i = 0; i < kBurst; ++i, ++sent) {
+      client->SendChannelData(data, sizeof(data));
+    }
+    peer.WakeUpAt(sent);
+    if (peer.received() < sent) {
+      pss_.Wait(kTimeoutMs, true);
+    }
+    if (peer.received() < sent) {
+      break;
+    }
+  }
+  uint64 to_peer_ns = rtc::TimeNanos() - start;
+  EXPECT_EQ(kNumPackets, peer.received());
+  EXPECT_EQ(payload, peer.last_packet());
+
+  start = rtc::TimeNanos();
+  for (int sent = 0; sent < kNumPackets; ) {
+    for (int i = 0; i < kBurst; ++i, ++sent) {
+      peer.SendTo(client->relayed_address(), data, sizeof(data));
+    }
+    client->WakeUpAt(sent);
+    if (client->received() < sent) {
+      pss_.Wait(kTimeoutMs, true);
+    }
+    if (client->received() < sent) {
+      break;
+    }
+  }
+  uint64 to_client_ns = rtc::TimeNanos() - start;
+  EXPECT_EQ(kNumPackets, client->received());
+  EXPECT_EQ(payload, client->last_payload());
+  EXPECT_FALSE(client->failed());
+
+  LOG(LS_INFO) << "Relayed " << kNumPackets << " packets of " << sizeof(data)
+               << " bytes: client to peer "
+               << to_peer_ns / kNumPackets << " ns/packet, peer to client "
+               << to_client_ns / kNumPackets << " ns/packet";
+}
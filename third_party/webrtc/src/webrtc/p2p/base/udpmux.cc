@@ -0,0 +1,277 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "webrtc/p2p/base/udpmux.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "webrtc/p2p/base/stun.h"
+#include "webrtc/base/common.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/timeutils.h"
+
+namespace cricket {
+
+const int UDPMux::kRemoteTimeoutMs;
+const size_t UDPMux::kMaxRemotesPerSocket;
+
+UDPMux::UDPMux(rtc::AsyncPacketSocket* socket)
+    : socket_(socket), last_expiry_(rtc::Time()) {
+  ASSERT(socket_);
+  socket_->SignalReadPacket.connect(this, &UDPMux::OnReadPacket);
+  socket_->SignalReadyToSend.connect(this, &UDPMux::OnReadyToSend);
+}
+
+UDPMux::~UDPMux() {
+  for (SocketMap::iterator it = sockets_.begin(); it != sockets_.end(); ++it) {
+    it->second->mux_ = NULL;
+  }
+}
+
+rtc::SocketAddress UDPMux::GetLocalAddress() const {
+  return socket_->GetLocalAddress();
+}
+
+UDPMuxSocket* UDPMux::CreateSocket(const std::string& ufrag,
+                                   const std::string& password) {
+  if (ufrag.empty() || sockets_.find(ufrag) != sockets_.end()) {
+    LOG(LS_WARNING) << "UDPMux: Can't register ufrag " << ufrag;
+    return NULL;
+  }
+
+  UDPMuxSocket* socket = new UDPMuxSocket(this, ufrag, password);
+  sockets_[ufrag] = socket;
+  return socket;
+}
+
+void UDPMux::Unregister(UDPMuxSocket* socket) {
+  sockets_.erase(socket->ufrag());
+  for (RemoteMap::iterator it = remotes_.begin(); it != remotes_.end();) {
+    if (it->second.socket == socket) {
+      EraseRemote(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void UDPMux::AddRemoteAddress(const rtc::SocketAddress& addr,
+                              UDPMuxSocket* socket) {
+  uint32 now = rtc::Time();
+  RemoteMap::iterator it = remotes_.find(addr);
+  if (it != remotes_.end()) {
+    if (it->second.socket == socket) {
+      it->second.last_active = now;
+      return;
+    }
+    LOG(LS_WARNING) << "UDPMux: Remote address " << addr.ToSensitiveString()
+                    << " moved from ufrag " << it->second.socket->ufrag()
+                    << " to " << socket->ufrag();
+    EraseRemote(it);
+  }
+
+  if (rtc::TimeDiff(now, last_expiry_) >= kRemoteTimeoutMs) {
+    ExpireRemoteAddresses(now);
+  }
+  if (socket->num_remotes_ >= kMaxRemotesPerSocket) {
+    EvictOldestRemoteAddress(socket);
+  }
+  Remote remote = {socket, now};
+  remotes_.insert(std::make_pair(addr, remote));
+  ++socket->num_remotes_;
+}
+
+void UDPMux::EraseRemote(RemoteMap::iterator it) {
+  --it->second.socket->num_remotes_;
+  remotes_.erase(it);
+}
+
+void UDPMux::ExpireRemoteAddresses(uint32 now) {
+  for (RemoteMap::iterator it = remotes_.begin(); it != remotes_.end();) {
+    if (rtc::TimeDiff(now, it->second.last_active) >= kRemoteTimeoutMs) {
+      EraseRemote(it++);
+    } else {
+      ++it;
+    }
+  }
+  last_expiry_ = now;
+}
+
+void UDPMux::EvictOldestRemoteAddress(UDPMuxSocket* socket) {
+  RemoteMap::iterator oldest = remotes_.end();
+  for (RemoteMap::iterator it = remotes_.begin(); it != remotes_.end(); ++it) {
+    if (it->second.socket == socket &&
+        (oldest == remotes_.end() ||
+         rtc::TimeIsLater(it->second.last_active,
+                          oldest->second.last_active))) {
+      oldest = it;
+    }
+  }
+  if (oldest != remotes_.end()) {
+    LOG(LS_INFO) << "UDPMux: Too many remote addresses for ufrag "
+                 << socket->ufrag() << ", dropping "
+                 << oldest->first.ToSensitiveString();
+    EraseRemote(oldest);
+  }
+}
+
+UDPMuxSocket* UDPMux::FindSocketForStun(const char* data, size_t size) const {
+  // Only binding requests carry the USERNAME we can route on. Parse in place,
+  // this runs for every packet from an unknown address.
+  StunMessageView msg;
+  if (!msg.Parse(data, size) || msg.type() != STUN_BINDING_REQUEST ||
+      msg.IsLegacy()) {
+    return NULL;
+  }
+
+  const char* username;
+  size_t username_length;
+  if (!msg.GetAttribute(STUN_ATTR_USERNAME, &username, &username_length)) {
+    return NULL;
+  }
+
+  // USERNAME is "<receiver ufrag>:<sender ufrag>".
+  const char* colon =
+      static_cast<const char*>(memchr(username, ':', username_length));
+  std::string ufrag(username, colon ? colon - username : username_length);
+  SocketMap::const_iterator it = sockets_.find(ufrag);
+  if (it == sockets_.end()) {
+    return NULL;
+  }
+
+  // The ufrag is not a secret; only a request signed with the session's
+  // password may bind a new address to it.
+  if (!msg.ValidateMessageIntegrity(it->second->password_hmac_)) {
+    LOG(LS_INFO) << "UDPMux: Binding request for ufrag " << ufrag
+                 << " failed the integrity check";
+    return NULL;
+  }
+  return it->second;
+}
+
+void UDPMux::OnReadPacket(rtc::AsyncPacketSocket* socket,
+                          const char* data, size_t size,
+                          const rtc::SocketAddress& remote_addr,
+                          const rtc::PacketTime& packet_time) {
+  ASSERT(socket == socket_.get());
+
+  UDPMuxSocket* target = NULL;
+  RemoteMap::iterator it = remotes_.find(remote_addr);
+  if (it != remotes_.end()) {
+    target = it->second.socket;
+    it->second.last_active = rtc::Time();
+  } else {
+    target = FindSocketForStun(data, size);
+    if (!target) {
+      LOG(LS_VERBOSE) << "UDPMux: Dropping packet from unknown address "
+                      << remote_addr.ToSensitiveString();
+      return;
+    }
+    AddRemoteAddress(remote_addr, target);
+  }
+
+  target->SignalReadPacket(target, data, size, remote_addr, packet_time);
+}
+
+void UDPMux::OnReadyToSend(rtc::AsyncPacketSocket* socket) {
+  // Copy the targets first, a handler may destroy its socket.
+  std::vector<UDPMuxSocket*> targets;
+  for (SocketMap::iterator it = sockets_.begin(); it != sockets_.end(); ++it) {
+    targets.push_back(it->second);
+  }
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (sockets_.find(targets[i]->ufrag()) != sockets_.end()) {
+      targets[i]->SignalReadyToSend(targets[i]);
+    }
+  }
+}
+
+UDPMuxSocket::UDPMuxSocket(UDPMux* mux, const std::string& ufrag,
+                           const std::string& password)
+    : mux_(mux),
+      ufrag_(ufrag),
+      password_hmac_(password),
+      num_remotes_(0),
+      error_(0) {
+}
+
+UDPMuxSocket::~UDPMuxSocket() {
+  if (mux_) {
+    mux_->Unregister(this);
+  }
+}
+
+rtc::SocketAddress UDPMuxSocket::GetLocalAddress() const {
+  return mux_ ? mux_->GetLocalAddress() : rtc::SocketAddress();
+}
+
+rtc::SocketAddress UDPMuxSocket::GetRemoteAddress() const {
+  return rtc::SocketAddress();
+}
+
+int UDPMuxSocket::Send(const void* pv, size_t cb,
+                       const rtc::PacketOptions& options) {
+  // Muxed sockets are never connected.
+  error_ = ENOTCONN;
+  return -1;
+}
+
+int UDPMuxSocket::SendTo(const void* pv, size_t cb,
+                         const rtc::SocketAddress& addr,
+                         const rtc::PacketOptions& options) {
+  if (!mux_) {
+    error_ = ENOTCONN;
+    return -1;
+  }
+  // Replies to whatever we send must come back to this session.
+  mux_->AddRemoteAddress(addr, this);
+  return mux_->socket_->SendTo(pv, cb, addr, options);
+}
+
+int UDPMuxSocket::Close() {
+  if (mux_) {
+    mux_->Unregister(this);
+    mux_ = NULL;
+  }
+  return 0;
+}
+
+rtc::AsyncPacketSocket::State UDPMuxSocket::GetState() const {
+  return mux_ ? STATE_BOUND : STATE_CLOSED;
+}
+
+int UDPMuxSocket::GetOption(rtc::Socket::Option opt, int* value) {
+  return mux_ ? mux_->socket_->GetOption(opt, value) : -1;
+}
+
+int UDPMuxSocket::SetOption(rtc::Socket::Option opt, int value) {
+  // Options apply to the shared socket and therefore to every session.
+  return mux_ ? mux_->socket_->SetOption(opt, value) : -1;
+}
+
+int UDPMuxSocket::GetError() const {
+  if (error_ != 0 || !mux_) {
+    return error_;
+  }
+  return mux_->socket_->GetError();
+}
+
+void UDPMuxSocket::SetError(int error) {
+  error_ = error;
+}
+
+size_t UDPMuxSocket::GetReceiveHeadroom() const {
+  // Packets are signaled straight out of the shared socket's buffer.
+  return mux_ ? mux_->socket_->GetReceiveHeadroom() : 0;
+}
+
+}  // namespace cricket
@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_P2P_BASE_UDPMUX_H_
+#define WEBRTC_P2P_BASE_UDPMUX_H_
+
+#include <map>
+#include <string>
+
+#include "webrtc/base/asyncpacketsocket.h"
+#include "webrtc/base/hmacsha1.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/socketaddress.h"
+
+namespace cricket {
+
+class UDPMuxSocket;
+
+// Shares a single bound UDP socket between any number of ICE sessions, which
+// is useful for servers hosting many PeerConnections on a public address.
+// Every session gets a lightweight UDPMuxSocket registered under its local
+// ICE ufrag. Incoming packets are routed by remote address once it is known;
+// the first packet from a new remote address must be a STUN binding request
+// whose USERNAME starts with a registered ufrag and whose MESSAGE-INTEGRITY
+// checks out with that session's ICE password. Remote addresses that have
+// been idle for kRemoteTimeoutMs are forgotten, and each session keeps at
+// most kMaxRemotesPerSocket of them.
+//
+// Remote addresses shared by several sessions (e.g. a common STUN or TURN
+// server) cannot be demultiplexed, so muxed sockets should only be used for
+// host candidates. All methods must be called on the thread that owns the
+// shared socket.
+//
+// Only BasicPortAllocator::set_udp_mux() uses this; the Node addon doesn't
+// create a mux, so this is C++ API only.
+class UDPMux : public sigslot::has_slots<> {
+ public:
+  static const int kRemoteTimeoutMs = 30 * 1000;
+  static const size_t kMaxRemotesPerSocket = 32;
+
+  // Takes ownership of |socket|, which must be a bound UDP socket.
+  explicit UDPMux(rtc::AsyncPacketSocket* socket);
+  ~UDPMux() override;
+
+  rtc::SocketAddress GetLocalAddress() const;
+
+  // Creates a socket that receives the packets addressed to |ufrag|, the
+  // local ICE ufrag of a session whose ICE password is |password|. The caller
+  // owns the returned socket. Returns NULL if |ufrag| is already registered.
+  UDPMuxSocket* CreateSocket(const std::string& ufrag,
+                             const std::string& password);
+
+  size_t num_sockets() const { return sockets_.size(); }
+  size_t num_remote_addresses() const { return remotes_.size(); }
+
+ private:
+  friend class UDPMuxSocket;
+
+  struct Remote {
+    UDPMuxSocket* socket;
+    // When a packet was last sent to or received from the address.
+    uint32 last_active;
+  };
+  typedef std::map<std::string, UDPMuxSocket*> SocketMap;
+  typedef std::map<rtc::SocketAddress, Remote> RemoteMap;
+
+  void Unregister(UDPMuxSocket* socket);
+  void AddRemoteAddress(const rtc::SocketAddress& addr, UDPMuxSocket* socket);
+  void EraseRemote(RemoteMap::iterator it);
+  // Forgets the remote addresses that have been idle for kRemoteTimeoutMs.
+  // Runs at most once per timeout, whenever an address is added.
+  void ExpireRemoteAddresses(uint32 now);
+  // Forgets the least recently active remote address of |socket|.
+  void EvictOldestRemoteAddress(UDPMuxSocket* socket);
+  UDPMuxSocket* FindSocketForStun(const char* data, size_t size) const;
+
+  void OnReadPacket(rtc::AsyncPacketSocket* socket,
+                    const char* data, size_t size,
+                    const rtc::SocketAddress& remote_addr,
+                    const rtc::PacketTime& packet_time);
+  void OnReadyToSend(rtc::AsyncPacketSocket* socket);
+
+  rtc::scoped_ptr<rtc::AsyncPacketSocket> socket_;
+  SocketMap sockets_;
+  RemoteMap remotes_;
+  uint32 last_expiry_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(UDPMux);
+};
+
+// Per-session view of the socket owned by a UDPMux. Sends go straight to the
+// shared socket; reads are delivered by the mux.
+class UDPMuxSocket : public rtc::AsyncPacketSocket {
+ public:
+  ~UDPMuxSocket() override;
+
+  const std::string& ufrag() const { return ufrag_; }
+
+  // rtc::AsyncPacketSocket implementation.
+  rtc::SocketAddress GetLocalAddress() const override;
+  rtc::SocketAddress GetRemoteAddress() const override;
+  int Send(const void* pv, size_t cb,
+           const rtc::PacketOptions& options) override;
+  int SendTo(const void* pv, size_t cb, const rtc::SocketAddress& addr,
+             const rtc::PacketOptions& options) override;
+  int Close() override;
+  State GetState() const override;
+  int GetOption(rtc::Socket::Option opt, int* value) override;
+  int SetOption(rtc::Socket::Option opt, int value) override;
+  int GetError() const override;
+  void SetError(int error) override;
+  size_t GetReceiveHeadroom() const override;
+
+ private:
+  friend class UDPMux;
+
+  UDPMuxSocket(UDPMux* mux, const std::string& ufrag,
+               const std::string& password);
+
+  UDPMux* mux_;
+  std::string ufrag_;
+  // Keyed with the session's ICE password, to check binding requests from
+  // new remote addresses.
+  rtc::HmacSha1 password_hmac_;
+  // Number of entries in |mux_|'s remote address map for this socket.
+  size_t num_remotes_;
+  int error_;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(UDPMuxSocket);
+};
+
+}  // namespace cricket
+
+#endif  // WEBRTC_P2P_BASE_UDPMUX_H_
@@ -0,0 +1,190 @@
+/*
+ *  Copyright 2015 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+
+#include "webrtc/p2p/base/stun.h"
+#include "webrtc/p2p/base/udpmux.h"
+#include "webrtc/base/asyncudpsocket.h"
+#include "webrtc/base/gunit.h"
+#include "webrtc/base/physicalsocketserver.h"
+#include "webrtc/base/scoped_ptr.h"
+#include "webrtc/base/testclient.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/virtualsocketserver.h"
+
+using cricket::IceMessage;
+using cricket::StunByteStringAttribute;
+using cricket::UDPMux;
+using cricket::UDPMuxSocket;
+
+static const rtc::SocketAddress kMuxAddr("99.99.99.1", 3478);
+static const rtc::SocketAddress kRemoteAddr1("1.1.1.1", 5000);
+static const rtc::SocketAddress kRemoteAddr2("2.2.2.2", 5000);
+static const char kData[] = "not a stun packet";
+static const char kPassword1[] = "password1password1pass";
+static const char kPassword2[] = "password2password2pass";
+
+class UDPMuxTest : public testing::Test {
+ public:
+  UDPMuxTest()
+      : pss_(new rtc::PhysicalSocketServer),
+        ss_(new rtc::VirtualSocketServer(pss_.get())),
+        ss_scope_(ss_.get()),
+        mux_(new UDPMux(rtc::AsyncUDPSocket::Create(ss_.get(), kMuxAddr))),
+        remote1_(rtc::AsyncUDPSocket::Create(ss_.get(), kRemoteAddr1)),
+        remote2_(rtc::AsyncUDPSocket::Create(ss_.get(), kRemoteAddr2)) {
+  }
+
+  // Sends a binding request from |remote| addressed to |ufrag|, signed with
+  // |password|.
+  void SendBindingRequest(rtc::TestClient* remote, const std::string& ufrag,
+                          const std::string& password) {
+    IceMessage msg;
+    msg.SetType(cricket::STUN_BINDING_REQUEST);
+    msg.SetTransactionID("0123456789ab");
+    msg.AddAttribute(new StunByteStringAttribute(cricket::STUN_ATTR_USERNAME,
+                                                 ufrag + ":remote"));
+    msg.AddMessageIntegrity(password);
+    msg.AddFingerprint();
+    rtc::ByteBuffer buf;
+    msg.Write(&buf);
+    remote->SendTo(buf.Data(), buf.Length(), kMuxAddr);
+  }
+
+  void SendData(rtc::TestClient* remote) {
+    remote->SendTo(kData, sizeof(kData), kMuxAddr);
+  }
+
+  bool CheckData(rtc::TestClient* client, const rtc::SocketAddress& from) {
+    rtc::SocketAddress addr;
+    return client->CheckNextPacket(kData, sizeof(kData), &addr) &&
+           addr == from;
+  }
+
+ protected:
+  rtc::scoped_ptr<rtc::PhysicalSocketServer> pss_;
+  rtc::scoped_ptr<rtc::VirtualSocketServer> ss_;
+  rtc::SocketServerScope ss_scope_;
+  rtc::scoped_ptr<UDPMux> mux_;
+  rtc::TestClient remote1_;
+  rtc::TestClient remote2_;
+};
+
+// Binding requests are routed by ufrag, later packets by remote address.
+TEST_F(UDPMuxTest, TestDemuxByUfragThenAddress) {
+  rtc::TestClient session1(mux_->CreateSocket("ufrag1", kPassword1));
+  rtc::TestClient session2(mux_->CreateSocket("ufrag2", kPassword2));
+  EXPECT_EQ(kMuxAddr, session1.address());
+  EXPECT_EQ(kMuxAddr, session2.address());
+
+  SendBindingRequest(&remote2_, "ufrag2", kPassword2);
+  rtc::scoped_ptr<rtc::TestClient::Packet> packet(
+      session2.NextPacket(rtc::TestClient::kTimeoutMs));
+  ASSERT_TRUE(packet);
+  EXPECT_EQ(kRemoteAddr2, packet->addr);
+  EXPECT_EQ(1U, mux_->num_remote_addresses());
+
+  SendData(&remote2_);
+  EXPECT_TRUE(CheckData(&session2, kRemoteAddr2));
+  EXPECT_TRUE(session1.CheckNoPacket());
+}
+
+// Packets from unknown addresses that can't be routed by ufrag are dropped.
+TEST_F(UDPMuxTest, TestDropUnknown) {
+  rtc::TestClient session1(mux_->CreateSocket("ufrag1", kPassword1));
+
+  SendData(&remote1_);
+  SendBindingRequest(&remote1_, "unknown", kPassword1);
+  EXPECT_TRUE(session1.CheckNoPacket());
+  EXPECT_EQ(0U, mux_->num_remote_addresses());
+}
+
+// A binding request with a known ufrag but the wrong password doesn't bind
+// its address, so the ufrag alone can't be used to take over a session.
+TEST_F(UDPMuxTest, TestRejectBadIntegrity) {
+  rtc::TestClient session1(mux_->CreateSocket("ufrag1", kPassword1));
+  rtc::TestClient session2(mux_->CreateSocket("ufrag2", kPassword2));
+
+  SendBindingRequest(&remote1_, "ufrag1", kPassword2);
+  EXPECT_TRUE(session1.CheckNoPacket());
+  EXPECT_EQ(0U, mux_->num_remote_addresses());
+
+  SendData(&remote1_);
+  EXPECT_TRUE(session1.CheckNoPacket());
+  EXPECT_TRUE(session2.CheckNoPacket());
+}
+
+// Each session keeps only its most recently active remote addresses.
+TEST_F(UDPMuxTest, TestRemoteAddressLimit) {
+  rtc::scoped_ptr<UDPMuxSocket> socket1(
+      mux_->CreateSocket("ufrag1", kPassword1));
+  rtc::scoped_ptr<UDPMuxSocket> socket2(
+      mux_->CreateSocket("ufrag2", kPassword2));
+  socket2->SendTo(kData, sizeof(kData), kRemoteAddr2, rtc::PacketOptions());
+
+  for (size_t i = 0; i < UDPMux::kMaxRemotesPerSocket + 5; ++i) {
+    rtc::SocketAddress addr("3.3.3.3", static_cast<int>(6000 + i));
+    socket1->SendTo(kData, sizeof(kData), addr, rtc::PacketOptions());
+  }
+  EXPECT_EQ(UDPMux::kMaxRemotesPerSocket + 1, mux_->num_remote_addresses());
+
+  // The other session's address is untouched.
+  rtc::TestClient session2(socket2.release());
+  SendData(&remote2_);
+  EXPECT_TRUE(CheckData(&session2, kRemoteAddr2));
+}
+
+// Sending to a remote address routes its replies back to the sender.
+TEST_F(UDPMuxTest, TestSendRegistersRemoteAddress) {
+  rtc::TestClient session1(mux_->CreateSocket("ufrag1", kPassword1));
+  rtc::TestClient session2(mux_->CreateSocket("ufrag2", kPassword2));
+
+  session1.SendTo(kData, sizeof(kData), kRemoteAddr1);
+  EXPECT_TRUE(CheckData(&remote1_, kMuxAddr));
+
+  SendData(&remote1_);
+  EXPECT_TRUE(CheckData(&session1, kRemoteAddr1));
+  EXPECT_TRUE(session2.CheckNoPacket());
+}
+
+TEST_F(UDPMuxTest, TestDuplicateUfrag) {
+  rtc::scoped_ptr<UDPMuxSocket> socket(
+      mux_->CreateSocket("ufrag1", kPassword1));
+  ASSERT_TRUE(socket);
+  EXPECT_TRUE(mux_->CreateSocket("ufrag1", kPassword1) == NULL);
+  EXPECT_TRUE(mux_->CreateSocket("", kPassword1) == NULL);
+}
+
+// Destroying a socket removes its ufrag and remote addresses from the mux.
+TEST_F(UDPMuxTest, TestUnregisterOnDestroy) {
+  rtc::scoped_ptr<UDPMuxSocket> socket(
+      mux_->CreateSocket("ufrag1", kPassword1));
+  socket->SendTo(kData, sizeof(kData), kRemoteAddr1, rtc::PacketOptions());
+  EXPECT_EQ(1U, mux_->num_sockets());
+  EXPECT_EQ(1U, mux_->num_remote_addresses());
+
+  socket.reset();
+  EXPECT_EQ(0U, mux_->num_sockets());
+  EXPECT_EQ(0U, mux_->num_remote_addresses());
+
+  socket.reset(mux_->CreateSocket("ufrag1", kPassword1));
+  EXPECT_TRUE(socket);
+}
+
+// A socket that outlives its mux is closed rather than left dangling.
+TEST_F(UDPMuxTest, TestMuxDestroyedFirst) {
+  rtc::scoped_ptr<UDPMuxSocket> socket(
+      mux_->CreateSocket("ufrag1", kPassword1));
+  mux_.reset();
+  EXPECT_EQ(rtc::AsyncPacketSocket::STATE_CLOSED, socket->GetState());
+  EXPECT_EQ(-1, socket->SendTo(kData, sizeof(kData), kRemoteAddr1,
+                               rtc::PacketOptions()));
+}
@@ -10,7 +10,9 @@
 
 #include "webrtc/p2p/client/basicportallocator.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "webrtc/p2p/base/basicpacketsocketfactory.h"
@@ -20,6 +22,7 @@
 #include "webrtc/p2p/base/stunport.h"
 #include "webrtc/p2p/base/tcpport.h"
 #include "webrtc/p2p/base/turnport.h"
+#include "webrtc/p2p/base/udpmux.h"
 #include "webrtc/p2p/base/udpport.h"
 #include "webrtc/base/checks.h"
 #include "webrtc/base/common.h"
@@ -119,11 +122,29 @@ BasicPortAllocator::BasicPortAllocator(
 
 void BasicPortAllocator::Construct() {
   allow_tcp_listen_ = true;
+  udp_mux_ = NULL;
 }
 
 BasicPortAllocator::~BasicPortAllocator() {
 }
 
+void BasicPortAllocator::set_stun_result_cache_ttl(int ttl_ms) {
+  // Ports of existing sessions hold on to the cache, so it's never deleted
+  // before the allocator. A TTL of 0 keeps them from reusing results.
+  ttl_ms = std::max(0, ttl_ms);
+  if (stun_result_cache_) {
+    stun_result_cache_->set_ttl(ttl_ms);
+  } else if (ttl_ms > 0) {
+    stun_result_cache_.reset(new StunResultCache(ttl_ms));
+  }
+}
+
+StunResultCache* BasicPortAllocator::stun_result_cache() {
+  return (stun_result_cache_ && stun_result_cache_->ttl() > 0)
+             ? stun_result_cache_.get()
+             : NULL;
+}
+
 PortAllocatorSession* BasicPortAllocator::CreateSessionInternal(
     const std::string& content_name, int component,
     const std::string& ice_ufrag, const std::string& ice_pwd) {
@@ -390,6 +411,19 @@ void BasicPortAllocatorSession::DoAllocate() {
 void BasicPortAllocatorSession::OnNetworksChanged() {
   std::vector<rtc::Network*> networks;
   GetNetworks(&networks);
+
+  // The network manager is shared by all sessions and signals again whenever
+  // another session starts; there is only work to do if the networks did
+  // change since we last looked.
+  std::vector<std::pair<rtc::Network*, rtc::IPAddress> > snapshot;
+  for (rtc::Network* network : networks) {
+    snapshot.push_back(std::make_pair(network, network->GetBestIP()));
+  }
+  if (network_manager_started_ && snapshot == networks_) {
+    return;
+  }
+  networks_.swap(snapshot);
+
   for (AllocationSequence* sequence : sequences_) {
     // Remove the network from the allocation sequence if it is not in
     // |networks|.
@@ -722,11 +756,34 @@ AllocationSequence::AllocationSequence(BasicPortAllocatorSession* session,
       state_(kInit),
       flags_(flags),
       udp_socket_(),
+      udp_muxed_(false),
       udp_port_(NULL),
       phase_(0) {
 }
 
 bool AllocationSequence::Init() {
+  UDPMux* mux = session_->allocator()->udp_mux();
+  if (mux && mux->GetLocalAddress().ipaddr() == ip_ &&
+      !IsFlagSet(PORTALLOCATOR_DISABLE_UDP)) {
+    // CreateSocket fails if the ufrag is already muxed, e.g. for the RTCP
+    // component without rtcp-mux. Such sessions fall back to own sockets.
+    udp_socket_.reset(
+        mux->CreateSocket(session_->username(), session_->password()));
+    if (udp_socket_) {
+      // The mux can only route by ufrag and remote address, so STUN servers
+      // shared with other sessions can't be used on the muxed socket, unless
+      // the sessions share the result of one query through the cache.
+      udp_muxed_ = true;
+      flags_ |= PORTALLOCATOR_ENABLE_SHARED_SOCKET;
+      if (!session_->allocator()->stun_result_cache()) {
+        flags_ |= PORTALLOCATOR_DISABLE_STUN;
+      }
+      udp_socket_->SignalReadPacket.connect(
+          this, &AllocationSequence::OnReadPacket);
+      return true;
+    }
+  }
+
   if (IsFlagSet(PORTALLOCATOR_ENABLE_SHARED_SOCKET)) {
     udp_socket_.reset(session_->socket_factory()->CreateUdpSocket(
         rtc::SocketAddress(ip_, 0), session_->allocator()->min_port(),
@@ -812,37 +869,44 @@ void AllocationSequence::OnMessage(rtc::Message* msg) {
     "Udp", "Relay", "Tcp", "SslTcp"
   };
 
-  // Perform all of the phases in the current step.
-  LOG_J(LS_INFO, network_) << "Allocation Phase="
-                           << PHASE_NAMES[phase_];
+  // Perform all of the phases in the current step, which is all of them in
+  // parallel mode.
+  do {
+    LOG_J(LS_INFO, network_) << "Allocation Phase="
+                             << PHASE_NAMES[phase_];
+
+    switch (phase_) {
+      case PHASE_UDP:
+        CreateUDPPorts();
+        CreateStunPorts();
+        EnableProtocol(PROTO_UDP);
+        break;
 
-  switch (phase_) {
-    case PHASE_UDP:
-      CreateUDPPorts();
-      CreateStunPorts();
-      EnableProtocol(PROTO_UDP);
-      break;
+      case PHASE_RELAY:
+        CreateRelayPorts();
+        break;
 
-    case PHASE_RELAY:
-      CreateRelayPorts();
-      break;
+      case PHASE_TCP:
+        CreateTCPPorts();
+        EnableProtocol(PROTO_TCP);
+        break;
 
-    case PHASE_TCP:
-      CreateTCPPorts();
-      EnableProtocol(PROTO_TCP);
-      break;
+      case PHASE_SSLTCP:
+        state_ = kCompleted;
+        EnableProtocol(PROTO_SSLTCP);
+        break;
 
-    case PHASE_SSLTCP:
-      state_ = kCompleted;
-      EnableProtocol(PROTO_SSLTCP);
-      break;
+      default:
+        ASSERT(false);
+    }
 
-    default:
-      ASSERT(false);
-  }
+    if (state() == kRunning) {
+      ++phase_;
+    }
+  } while (state() == kRunning &&
+           IsFlagSet(PORTALLOCATOR_ENABLE_PARALLEL_PHASES));
 
   if (state() == kRunning) {
-    ++phase_;
     session_->network_thread()->PostDelayed(
         session_->allocator()->step_delay(),
         this, MSG_ALLOCATION_PHASE);
@@ -895,6 +959,7 @@ void AllocationSequence::CreateUDPPorts() {
   }
 
   if (port) {
+    port->set_stun_result_cache(session_->allocator()->stun_result_cache());
     // If shared socket is enabled, STUN candidate will be allocated by the
     // UDPPort.
     if (IsFlagSet(PORTALLOCATOR_ENABLE_SHARED_SOCKET)) {
@@ -960,6 +1025,7 @@ void AllocationSequence::CreateStunPorts() {
                                 config_->StunServers(),
                                 session_->allocator()->origin());
   if (port) {
+    port->set_stun_result_cache(session_->allocator()->stun_result_cache());
     session_->AddAllocatedPort(port, this, true);
     // Since StunPort is not created using shared socket, |port| will not be
     // added to the dequeue.
@@ -1042,7 +1108,7 @@ void AllocationSequence::CreateTurnPort(const RelayServerConfig& config) {
     // TODO(mallinath) - Enable shared socket mode for TURN ports. Disabled
     // due to webrtc bug https://code.google.com/p/webrtc/issues/detail?id=3537
     if (IsFlagSet(PORTALLOCATOR_ENABLE_SHARED_SOCKET) &&
-        relay_port->proto == PROTO_UDP && udp_socket_) {
+        relay_port->proto == PROTO_UDP && udp_socket_ && !udp_muxed_) {
       port = TurnPort::Create(session_->network_thread(),
                               session_->socket_factory(),
                               network_, udp_socket_.get(),
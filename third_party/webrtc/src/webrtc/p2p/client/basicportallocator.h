@@ -12,10 +12,12 @@
 #define WEBRTC_P2P_CLIENT_BASICPORTALLOCATOR_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "webrtc/p2p/base/port.h"
 #include "webrtc/p2p/base/portallocator.h"
+#include "webrtc/p2p/base/stunport.h"
 #include "webrtc/base/messagequeue.h"
 #include "webrtc/base/network.h"
 #include "webrtc/base/scoped_ptr.h"
@@ -23,6 +25,8 @@
 
 namespace cricket {
 
+class UDPMux;
+
 struct RelayCredentials {
   RelayCredentials() {}
   RelayCredentials(const std::string& username,
@@ -77,6 +81,24 @@ class BasicPortAllocator : public PortAllocator {
     relays_.push_back(relay);
   }
 
+  // When set, host UDP candidates on the mux's local address are allocated on
+  // the shared mux socket instead of binding a new socket per session. The
+  // mux must outlive all sessions and be used on their network thread.
+  UDPMux* udp_mux() { return udp_mux_; }
+  void set_udp_mux(UDPMux* mux) { udp_mux_ = mux; }
+
+  // When |ttl_ms| is positive, server-reflexive addresses found by the
+  // sessions are shared with later sessions on the same local socket and
+  // STUN server for |ttl_ms| milliseconds, which is refreshed by each STUN
+  // keep-alive. With a UDP mux this lets the muxed sessions gather
+  // server-reflexive candidates with one binding request per STUN server.
+  // The TTL should exceed the keep-alive interval. Setting it to 0 or less
+  // turns sharing off for new sessions, and existing sessions no longer
+  // reuse results.
+  void set_stun_result_cache_ttl(int ttl_ms);
+  // NULL while sharing is off.
+  StunResultCache* stun_result_cache();
+
   virtual PortAllocatorSession* CreateSessionInternal(
       const std::string& content_name,
       int component,
@@ -91,6 +113,8 @@ class BasicPortAllocator : public PortAllocator {
   const ServerAddresses stun_servers_;
   std::vector<RelayServerConfig> relays_;
   bool allow_tcp_listen_;
+  UDPMux* udp_mux_;
+  rtc::scoped_ptr<StunResultCache> stun_result_cache_;
 };
 
 struct PortConfiguration;
@@ -195,6 +219,8 @@ class BasicPortAllocatorSession : public PortAllocatorSession,
   bool network_manager_started_;
   bool running_;  // set when StartGetAllPorts is called
   bool allocation_sequences_created_;
+  // The networks and their best IPs as of the last OnNetworksChanged().
+  std::vector<std::pair<rtc::Network*, rtc::IPAddress> > networks_;
   std::vector<PortConfiguration*> configs_;
   std::vector<AllocationSequence*> sequences_;
   std::vector<PortData> ports_;
@@ -324,6 +350,8 @@ class AllocationSequence : public rtc::MessageHandler,
   uint32 flags_;
   ProtocolList protocols_;
   rtc::scoped_ptr<rtc::AsyncPacketSocket> udp_socket_;
+  // Set when |udp_socket_| is a UDPMuxSocket shared with other sessions.
+  bool udp_muxed_;
   // There will be only one udp port per AllocationSequence.
   UDPPort* udp_port_;
   std::vector<TurnPort*> turn_ports_;
@@ -14,6 +14,7 @@
 #include "webrtc/p2p/base/testrelayserver.h"
 #include "webrtc/p2p/base/teststunserver.h"
 #include "webrtc/p2p/base/testturnserver.h"
+#include "webrtc/p2p/base/udpmux.h"
 #include "webrtc/p2p/client/basicportallocator.h"
 #include "webrtc/p2p/client/httpportallocator.h"
 #include "webrtc/base/fakenetwork.h"
@@ -523,6 +524,21 @@ TEST_F(PortAllocatorTest, TestGetAllPortsWithOneSecondStepDelay) {
   session_->StopGettingPorts();
 }
 
+// Verify that with parallel phases all candidates are gathered without
+// waiting for the step delay between the phases.
+TEST_F(PortAllocatorTest, TestGetAllPortsWithParallelPhases) {
+  AddInterface(kClientAddr);
+  allocator_->set_step_delay(cricket::kDefaultStepDelay);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_ENABLE_PARALLEL_PHASES);
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  session_->StartGettingPorts();
+  // One step delay would be 1000 ms, all four would take 3 seconds.
+  ASSERT_EQ_WAIT(7U, candidates_.size(), 500);
+  EXPECT_EQ(4U, ports_.size());
+  EXPECT_TRUE_WAIT(candidate_allocation_done_, 500);
+}
+
 TEST_F(PortAllocatorTest, TestSetupVideoRtpPortsWithNormalSendBuffers) {
   AddInterface(kClientAddr);
   EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP,
@@ -989,6 +1005,105 @@ TEST_F(PortAllocatorTest, TestSharedSocketWithNat) {
   EXPECT_EQ(3U, candidates_.size());
 }
 
+// Test that sessions with a UDPMux set get their host UDP candidate on the
+// shared mux socket instead of binding a socket each.
+TEST_F(PortAllocatorTest, TestUdpMux) {
+  AddInterface(kClientAddr);
+  ResetWithNoServersOrNat();
+  const SocketAddress mux_addr(kClientAddr.ipaddr(), 3478);
+  cricket::UDPMux mux(rtc::AsyncUDPSocket::Create(vss_.get(), mux_addr));
+  allocator_->set_udp_mux(&mux);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_DISABLE_TCP);
+
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  rtc::scoped_ptr<cricket::PortAllocatorSession> session2(CreateSession(
+      "session2", kContentName, cricket::ICE_CANDIDATE_COMPONENT_RTP,
+      "TESTICEUFRAG0001", kIcePwd0));
+  session_->StartGettingPorts();
+  session2->StartGettingPorts();
+
+  ASSERT_EQ_WAIT(2U, candidates_.size(), kDefaultAllocationTimeout);
+  EXPECT_PRED5(CheckCandidate, candidates_[0],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "local", "udp", mux_addr);
+  EXPECT_PRED5(CheckCandidate, candidates_[1],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "local", "udp", mux_addr);
+  EXPECT_EQ(2U, mux.num_sockets());
+  EXPECT_TRUE_WAIT(candidate_allocation_done_, kDefaultAllocationTimeout);
+
+  session_.reset();
+  session2.reset();
+  EXPECT_EQ(0U, mux.num_sockets());
+}
+
+// Test that sessions on a UDPMux share the srflx address learned by the
+// first one through the allocator's STUN result cache.
+TEST_F(PortAllocatorTest, TestUdpMuxWithStunResultCache) {
+  const SocketAddress kMappedAddr("77.77.77.77", 5000);
+  AddInterface(kClientAddr);
+  ResetWithStunServerNoNat(kStunAddr);
+  stun_server_->set_fake_stun_addr(kMappedAddr);
+  const SocketAddress mux_addr(kClientAddr.ipaddr(), 3478);
+  cricket::UDPMux mux(rtc::AsyncUDPSocket::Create(vss_.get(), mux_addr));
+  allocator_->set_udp_mux(&mux);
+  allocator_->set_stun_result_cache_ttl(60 * 1000);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_DISABLE_TCP |
+                        cricket::PORTALLOCATOR_DISABLE_RELAY);
+
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  session_->StartGettingPorts();
+  ASSERT_EQ_WAIT(2U, candidates_.size(), kDefaultAllocationTimeout);
+  EXPECT_PRED5(CheckCandidate, candidates_[1],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "stun", "udp", kMappedAddr);
+  EXPECT_EQ(1U, allocator().stun_result_cache()->size());
+
+  // The second session gets its srflx candidate without asking the server.
+  stun_server_.reset();
+  rtc::scoped_ptr<cricket::PortAllocatorSession> session2(CreateSession(
+      "session2", kContentName, cricket::ICE_CANDIDATE_COMPONENT_RTP,
+      "TESTICEUFRAG0001", kIcePwd0));
+  session2->StartGettingPorts();
+  ASSERT_EQ_WAIT(4U, candidates_.size(), kDefaultAllocationTimeout);
+  EXPECT_PRED5(CheckCandidate, candidates_[3],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "stun", "udp", kMappedAddr);
+}
+
+// Test that turning the STUN result cache off while sessions use it leaves
+// their ports working, and keeps later muxed sessions from using STUN.
+TEST_F(PortAllocatorTest, TestDisableStunResultCacheWithLiveSessions) {
+  const SocketAddress kMappedAddr("77.77.77.77", 5000);
+  AddInterface(kClientAddr);
+  ResetWithStunServerNoNat(kStunAddr);
+  stun_server_->set_fake_stun_addr(kMappedAddr);
+  const SocketAddress mux_addr(kClientAddr.ipaddr(), 3478);
+  cricket::UDPMux mux(rtc::AsyncUDPSocket::Create(vss_.get(), mux_addr));
+  allocator_->set_udp_mux(&mux);
+  allocator_->set_stun_result_cache_ttl(60 * 1000);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_DISABLE_TCP |
+                        cricket::PORTALLOCATOR_DISABLE_RELAY);
+
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  session_->StartGettingPorts();
+  ASSERT_EQ_WAIT(2U, candidates_.size(), kDefaultAllocationTimeout);
+
+  allocator_->set_stun_result_cache_ttl(0);
+  EXPECT_TRUE(allocator().stun_result_cache() == NULL);
+  rtc::scoped_ptr<cricket::PortAllocatorSession> session2(CreateSession(
+      "session2", kContentName, cricket::ICE_CANDIDATE_COMPONENT_RTP,
+      "TESTICEUFRAG0001", kIcePwd0));
+  session2->StartGettingPorts();
+  EXPECT_TRUE_WAIT(candidate_allocation_done_, kDefaultAllocationTimeout);
+  ASSERT_EQ(3U, candidates_.size());
+  EXPECT_PRED5(CheckCandidate, candidates_[2],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "local", "udp", mux_addr);
+
+  // The first session's ports still use the cache as they go away.
+  session_.reset();
+  session2.reset();
+}
+
 // Test TURN port in shared socket mode with UDP and TCP TURN server addresses.
 TEST_F(PortAllocatorTest, TestSharedSocketWithoutNatUsingTurn) {
   turn_server_.AddInternalSocket(kTurnTcpIntAddr, cricket::PROTO_TCP);
@@ -46,6 +46,8 @@
         'base/relayport.h',
         'base/relayserver.cc',
         'base/relayserver.h',
+        'base/servershards.cc',
+        'base/servershards.h',
         'base/session.cc',
         'base/session.h',
         'base/sessiondescription.cc',
@@ -77,6 +79,8 @@
         'base/turnport.h',
         'base/turnserver.cc',
         'base/turnserver.h',
+        'base/udpmux.cc',
+        'base/udpmux.h',
         'base/udpport.h',
         'client/basicportallocator.cc',
         'client/basicportallocator.h',